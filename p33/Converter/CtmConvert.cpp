@@ -0,0 +1,794 @@
+// Headless, cross-platform replacement for the D3DX-based Converter.
+// Converts OBJ files, text-format .x files, and raw triangle soups to OpenCTM, welding
+// vertices with a spatial hash.  Directories are expanded and their files are converted
+// in parallel, and timing and compression stats are printed for each file.
+//
+// Usage: CtmConvert [options] <file or directory>...
+//   -o <dir>        Write the CTM files here (default: next to each input)
+//   -mg1 | -mg2     Compression method (default: MG1, which is lossless)
+//   -level <0-9>    LZMA compression level (default: 1)
+//   -vprec <rel>    MG2 vertex precision, relative to the average edge length (default: 0.001)
+//   -weld <rel>     Weld tolerance, relative to the bounding box diagonal (default: 1e-6)
+//   -noweld         Keep the vertices exactly as they appear in the input
+//   -nouv           Strip texture coordinates
+//
+// A .raw file is an unindexed triangle soup: three little-endian float3 positions per triangle.
+
+#include <openctm.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#endif
+
+using namespace std;
+
+struct Options
+{
+    string OutputFolder;
+    CTMenum Method;
+    CTMuint Level;
+    float VertexPrecision;
+    float WeldTolerance;
+    bool Weld;
+    bool TexCoords;
+};
+
+// Positions and optional texture coordinates share the vertex indices, like a CTM mesh.
+struct RawMesh
+{
+    vector<float> Positions;
+    vector<float> TexCoords;
+    vector<CTMuint> Indices;
+    string TextureFile;
+};
+
+struct ConvertStats
+{
+    bool Succeeded;
+    string Message;
+    long InputBytes;
+    long OutputBytes;
+    size_t InputVertices;
+    size_t OutputVertices;
+    size_t Triangles;
+    size_t DegenerateTriangles;
+    double LoadTime;
+    double WeldTime;
+    double SaveTime;
+
+    ConvertStats() :
+        Succeeded(false), InputBytes(0), OutputBytes(0),
+        InputVertices(0), OutputVertices(0), Triangles(0), DegenerateTriangles(0),
+        LoadTime(0), WeldTime(0), SaveTime(0) {}
+};
+
+#ifdef _WIN32
+static double GetSeconds()
+{
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+}
+#else
+static double GetSeconds()
+{
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    return tp.tv_sec + tp.tv_usec * 0.000001;
+}
+#endif
+
+static string GetExtension(const string& path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return "";
+    string ext = path.substr(dot);
+    for (size_t i = 0; i < ext.size(); ++i)
+        ext[i] = (char) tolower(ext[i]);
+    return ext;
+}
+
+static bool IsSupported(const string& path)
+{
+    string ext = GetExtension(path);
+    return ext == ".obj" || ext == ".x" || ext == ".raw";
+}
+
+static bool ReadFile(const string& path, vector<char>& contents)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents.resize(size + 1);
+    size_t read = size ? fread(&contents[0], 1, size, file) : 0;
+    fclose(file);
+    contents[size] = 0;
+    return (long) read == size;
+}
+
+static long GetFileSize(const string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// Appends the files in a directory that we know how to convert, in sorted order.
+static void ListFolder(const string& folder, vector<string>& files)
+{
+    vector<string> found;
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE handle = FindFirstFileA((folder + "\\*").c_str(), &data);
+    if (handle == INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && IsSupported(data.cFileName))
+            found.push_back(folder + "\\" + data.cFileName);
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+#else
+    DIR* dir = opendir(folder.c_str());
+    if (!dir)
+        return;
+    while (dirent* entry = readdir(dir))
+    {
+        string path = folder + "/" + entry->d_name;
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode) && IsSupported(path))
+            found.push_back(path);
+    }
+    closedir(dir);
+#endif
+    sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+}
+
+static bool IsFolder(const string& path)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+// OBJ faces can have separate position and texture coordinate indices, so every corner
+// becomes its own vertex here and the welder merges them back together.
+static bool LoadObj(const string& path, RawMesh& mesh, string& error)
+{
+    vector<char> contents;
+    if (!ReadFile(path, contents))
+    {
+        error = "Unable to read file";
+        return false;
+    }
+
+    vector<float> positions, texCoords;
+    vector<int> corners;
+    bool missingTexCoords = false;
+
+    char* line = &contents[0];
+    while (*line)
+    {
+        char* end = line + strcspn(line, "\r\n");
+        char* next = end + strspn(end, "\r\n");
+        *end = 0;
+
+        if (line[0] == 'v' && line[1] == ' ')
+        {
+            float x = 0, y = 0, z = 0;
+            sscanf(line + 2, "%f %f %f", &x, &y, &z);
+            positions.push_back(x);
+            positions.push_back(y);
+            positions.push_back(z);
+        }
+        else if (line[0] == 'v' && line[1] == 't' && line[2] == ' ')
+        {
+            float u = 0, v = 0;
+            sscanf(line + 3, "%f %f", &u, &v);
+            texCoords.push_back(u);
+            texCoords.push_back(v);
+        }
+        else if (line[0] == 'f' && line[1] == ' ')
+        {
+            // Triangulate polygons as fans:
+            vector<int> polygon;
+            char* token = line + 2;
+            while (*(token += strspn(token, " \t")))
+            {
+                int p = atoi(token);
+                int t = 0;
+                const char* slash = strchr(token, '/');
+                if (slash && slash[1] != '/')
+                    t = atoi(slash + 1);
+                polygon.push_back(p < 0 ? (int) positions.size() / 3 + p : p - 1);
+                polygon.push_back(t < 0 ? (int) texCoords.size() / 2 + t : t - 1);
+                missingTexCoords |= (t == 0);
+                token += strcspn(token, " \t");
+            }
+            for (size_t i = 2; i < polygon.size() / 2; ++i)
+            {
+                corners.push_back(polygon[0]);
+                corners.push_back(polygon[1]);
+                corners.push_back(polygon[i * 2 - 2]);
+                corners.push_back(polygon[i * 2 - 1]);
+                corners.push_back(polygon[i * 2]);
+                corners.push_back(polygon[i * 2 + 1]);
+            }
+        }
+
+        line = next;
+    }
+
+    bool hasTexCoords = !texCoords.empty() && !missingTexCoords;
+    size_t cornerCount = corners.size() / 2;
+    mesh.Positions.resize(cornerCount * 3);
+    mesh.Indices.resize(cornerCount);
+    if (hasTexCoords)
+        mesh.TexCoords.resize(cornerCount * 2);
+
+    for (size_t i = 0; i < cornerCount; ++i)
+    {
+        int p = corners[i * 2];
+        int t = corners[i * 2 + 1];
+        if (p < 0 || p * 3 >= (int) positions.size() || (hasTexCoords && (t < 0 || t * 2 >= (int) texCoords.size())))
+        {
+            error = "Face index out of range";
+            return false;
+        }
+        memcpy(&mesh.Positions[i * 3], &positions[p * 3], sizeof(float) * 3);
+        if (hasTexCoords)
+            memcpy(&mesh.TexCoords[i * 2], &texCoords[t * 2], sizeof(float) * 2);
+        mesh.Indices[i] = (CTMuint) i;
+    }
+
+    return true;
+}
+
+// A minimal tokenizer for text-format .x files; commas and semicolons are separators.
+class XTokenizer
+{
+public:
+    XTokenizer(const char* text) : m_pText(text) {}
+
+    string Next()
+    {
+        while (*m_pText && (isspace((unsigned char) *m_pText) || *m_pText == ',' || *m_pText == ';'))
+            ++m_pText;
+        if ((m_pText[0] == '/' && m_pText[1] == '/') || m_pText[0] == '#')
+        {
+            m_pText += strcspn(m_pText, "\r\n");
+            return Next();
+        }
+        const char* start = m_pText;
+        if (*m_pText == '{' || *m_pText == '}')
+            return string(m_pText++, 1);
+        if (*m_pText == '"')
+        {
+            const char* close = strchr(m_pText + 1, '"');
+            m_pText = close ? close + 1 : m_pText + strlen(m_pText);
+            return string(start, m_pText - start);
+        }
+        while (*m_pText && !isspace((unsigned char) *m_pText) && !strchr(",;{}", *m_pText))
+            ++m_pText;
+        return string(start, m_pText - start);
+    }
+
+    float NextFloat() { return (float) atof(Next().c_str()); }
+    int NextInt() { return atoi(Next().c_str()); }
+
+    // Skips to the end of a block whose opening brace has already been consumed.
+    void SkipBlock()
+    {
+        int depth = 1;
+        while (depth > 0)
+        {
+            string token = Next();
+            if (token.empty())
+                return;
+            depth += (token == "{") - (token == "}");
+        }
+    }
+
+    // Consumes an optional block name and the opening brace.
+    bool OpenBlock()
+    {
+        string token = Next();
+        if (token != "{")
+            token = Next();
+        return token == "{";
+    }
+
+private:
+    const char* m_pText;
+};
+
+// Reads every Mesh block (and its MeshTextureCoords) from a text .x file.  Normals are
+// dropped just like the D3DX converter did, and frame transforms are not applied.
+static bool LoadX(const string& path, RawMesh& mesh, string& error)
+{
+    vector<char> contents;
+    if (!ReadFile(path, contents))
+    {
+        error = "Unable to read file";
+        return false;
+    }
+    if (contents.size() < 16 || strncmp(&contents[8], "txt ", 4) != 0)
+    {
+        error = "Only text-format .x files are supported";
+        return false;
+    }
+
+    XTokenizer tokens(&contents[16]);
+    bool allTexCoords = true;
+    int meshCount = 0;
+
+    for (string token = tokens.Next(); !token.empty(); token = tokens.Next())
+    {
+        if (token == "template")
+        {
+            tokens.OpenBlock();
+            tokens.SkipBlock();
+            continue;
+        }
+        if (token != "Mesh")
+            continue;
+
+        if (!tokens.OpenBlock())
+        {
+            error = "Malformed Mesh block";
+            return false;
+        }
+
+        ++meshCount;
+        CTMuint baseVertex = (CTMuint) mesh.Positions.size() / 3;
+        int vertexCount = tokens.NextInt();
+        for (int i = 0; i < vertexCount * 3; ++i)
+            mesh.Positions.push_back(tokens.NextFloat());
+
+        int faceCount = tokens.NextInt();
+        for (int face = 0; face < faceCount; ++face)
+        {
+            int cornerCount = tokens.NextInt();
+            vector<CTMuint> polygon(cornerCount);
+            for (int i = 0; i < cornerCount; ++i)
+                polygon[i] = baseVertex + tokens.NextInt();
+            for (int i = 2; i < cornerCount; ++i)
+            {
+                mesh.Indices.push_back(polygon[0]);
+                mesh.Indices.push_back(polygon[i - 1]);
+                mesh.Indices.push_back(polygon[i]);
+            }
+        }
+
+        // Child blocks of the mesh:
+        bool hasTexCoords = false;
+        for (token = tokens.Next(); !token.empty() && token != "}"; token = tokens.Next())
+        {
+            if (token == "{")
+            {
+                tokens.SkipBlock();
+                continue;
+            }
+            if (!tokens.OpenBlock())
+                break;
+            if (token == "MeshTextureCoords")
+            {
+                int count = tokens.NextInt();
+                mesh.TexCoords.resize(baseVertex * 2);
+                for (int i = 0; i < count * 2; ++i)
+                    mesh.TexCoords.push_back(tokens.NextFloat());
+                hasTexCoords = (count == vertexCount);
+                tokens.SkipBlock();
+            }
+            else if (token == "MeshMaterialList")
+            {
+                // Pull out the first texture name:
+                int depth = 1;
+                while (depth > 0)
+                {
+                    string inner = tokens.Next();
+                    if (inner.empty())
+                        break;
+                    depth += (inner == "{") - (inner == "}");
+                    if (inner[0] == '"' && mesh.TextureFile.empty() && inner.size() > 2)
+                        mesh.TextureFile = inner.substr(1, inner.size() - 2);
+                }
+            }
+            else
+            {
+                tokens.SkipBlock();
+            }
+        }
+        allTexCoords &= hasTexCoords;
+    }
+
+    if (meshCount == 0)
+    {
+        error = "No Mesh blocks found";
+        return false;
+    }
+
+    if (!allTexCoords)
+        mesh.TexCoords.clear();
+
+    CTMuint vertexCount = (CTMuint) mesh.Positions.size() / 3;
+    for (size_t i = 0; i < mesh.Indices.size(); ++i)
+    {
+        if (mesh.Indices[i] >= vertexCount)
+        {
+            error = "Face index out of range";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool LoadRaw(const string& path, RawMesh& mesh, string& error)
+{
+    vector<char> contents;
+    if (!ReadFile(path, contents))
+    {
+        error = "Unable to read file";
+        return false;
+    }
+
+    size_t triangleCount = (contents.size() - 1) / (sizeof(float) * 9);
+    if (triangleCount * sizeof(float) * 9 != contents.size() - 1)
+    {
+        error = "File size is not a multiple of the triangle size";
+        return false;
+    }
+
+    mesh.Positions.resize(triangleCount * 9);
+    mesh.Indices.resize(triangleCount * 3);
+    if (triangleCount)
+        memcpy(&mesh.Positions[0], &contents[0], triangleCount * sizeof(float) * 9);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        mesh.Indices[i] = (CTMuint) i;
+
+    return true;
+}
+
+// Vertices are bucketed into cubic cells that are as wide as the weld tolerance, so any
+// vertex within tolerance of another lives in the same cell or one of its 26 neighbors.
+// Cells are found with an open-addressing hash table and each cell chains its vertices.
+
+static unsigned long long HashCell(unsigned long long key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static unsigned long long CellKey(long long x, long long y, long long z)
+{
+    const long long Mask = (1 << 21) - 1;
+    return ((unsigned long long) (x & Mask) << 42) | ((unsigned long long) (y & Mask) << 21) | (z & Mask);
+}
+
+static void WeldVertices(RawMesh& mesh, float relativeTolerance)
+{
+    const CTMuint None = 0xffffffffu;
+    size_t vertexCount = mesh.Positions.size() / 3;
+    bool hasTexCoords = !mesh.TexCoords.empty();
+    if (vertexCount == 0)
+        return;
+
+    float minimum[3], maximum[3];
+    for (int c = 0; c < 3; ++c)
+        minimum[c] = maximum[c] = mesh.Positions[c];
+    for (size_t i = 1; i < vertexCount; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            minimum[c] = min(minimum[c], mesh.Positions[i * 3 + c]);
+            maximum[c] = max(maximum[c], mesh.Positions[i * 3 + c]);
+        }
+    }
+    float diagonal = sqrtf(
+        (maximum[0] - minimum[0]) * (maximum[0] - minimum[0]) +
+        (maximum[1] - minimum[1]) * (maximum[1] - minimum[1]) +
+        (maximum[2] - minimum[2]) * (maximum[2] - minimum[2]));
+
+    // Keep the cell coordinates within 21 bits so that they pack into a single key:
+    float tolerance = max(diagonal * relativeTolerance, diagonal / (1 << 20));
+    if (tolerance <= 0)
+        tolerance = 1;
+    float scale = 1.0f / tolerance;
+
+    size_t slotCount = 1;
+    while (slotCount < vertexCount * 2)
+        slotCount <<= 1;
+    vector<unsigned long long> keys(slotCount);
+    vector<CTMuint> heads(slotCount, None);
+    vector<CTMuint> chain(vertexCount, None);
+    vector<CTMuint> remap(vertexCount);
+    size_t mask = slotCount - 1;
+
+    vector<float> positions, texCoords;
+    positions.reserve(mesh.Positions.size());
+    if (hasTexCoords)
+        texCoords.reserve(mesh.TexCoords.size());
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const float* p = &mesh.Positions[i * 3];
+        const float* t = hasTexCoords ? &mesh.TexCoords[i * 2] : 0;
+        long long cell[3];
+        for (int c = 0; c < 3; ++c)
+            cell[c] = (long long) floor((p[c] - minimum[c]) * scale);
+
+        // Look for an existing vertex within tolerance in the neighboring cells:
+        CTMuint found = None;
+        for (int n = 0; n < 27 && found == None; ++n)
+        {
+            unsigned long long key = CellKey(cell[0] + n % 3 - 1, cell[1] + n / 3 % 3 - 1, cell[2] + n / 9 - 1);
+            size_t slot = (size_t) HashCell(key) & mask;
+            while (heads[slot] != None && keys[slot] != key)
+                slot = (slot + 1) & mask;
+            for (CTMuint v = heads[slot]; v != None && found == None; v = chain[v])
+            {
+                const float* q = &positions[v * 3];
+                if (fabsf(p[0] - q[0]) > tolerance || fabsf(p[1] - q[1]) > tolerance || fabsf(p[2] - q[2]) > tolerance)
+                    continue;
+                if (t && (t[0] != texCoords[v * 2] || t[1] != texCoords[v * 2 + 1]))
+                    continue;
+                found = v;
+            }
+        }
+
+        if (found == None)
+        {
+            found = (CTMuint) positions.size() / 3;
+            positions.insert(positions.end(), p, p + 3);
+            if (t)
+                texCoords.insert(texCoords.end(), t, t + 2);
+
+            unsigned long long key = CellKey(cell[0], cell[1], cell[2]);
+            size_t slot = (size_t) HashCell(key) & mask;
+            while (heads[slot] != None && keys[slot] != key)
+                slot = (slot + 1) & mask;
+            keys[slot] = key;
+            chain[found] = heads[slot];
+            heads[slot] = found;
+        }
+        remap[i] = found;
+    }
+
+    for (size_t i = 0; i < mesh.Indices.size(); ++i)
+        mesh.Indices[i] = remap[mesh.Indices[i]];
+    mesh.Positions.swap(positions);
+    mesh.TexCoords.swap(texCoords);
+}
+
+// Drops triangles that collapsed to a line or point (either in the input or after welding).
+static size_t RemoveDegenerateTriangles(RawMesh& mesh)
+{
+    size_t kept = 0;
+    size_t triangleCount = mesh.Indices.size() / 3;
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        CTMuint a = mesh.Indices[i * 3], b = mesh.Indices[i * 3 + 1], c = mesh.Indices[i * 3 + 2];
+        if (a == b || b == c || c == a)
+            continue;
+        mesh.Indices[kept * 3] = a;
+        mesh.Indices[kept * 3 + 1] = b;
+        mesh.Indices[kept * 3 + 2] = c;
+        ++kept;
+    }
+    mesh.Indices.resize(kept * 3);
+    return triangleCount - kept;
+}
+
+static string GetOutputPath(const string& input, const Options& options)
+{
+    string name = input;
+    size_t slash = input.find_last_of("/\\");
+    if (!options.OutputFolder.empty())
+        name = options.OutputFolder + "/" + (slash == string::npos ? input : input.substr(slash + 1));
+    size_t dot = name.find_last_of('.');
+    return name.substr(0, dot) + ".ctm";
+}
+
+static ConvertStats ConvertFile(const string& input, const Options& options)
+{
+    ConvertStats stats;
+    stats.InputBytes = GetFileSize(input);
+
+    RawMesh mesh;
+    string error;
+    string ext = GetExtension(input);
+    double start = GetSeconds();
+    bool loaded =
+        ext == ".obj" ? LoadObj(input, mesh, error) :
+        ext == ".x" ? LoadX(input, mesh, error) :
+        LoadRaw(input, mesh, error);
+    stats.LoadTime = GetSeconds() - start;
+    if (!loaded)
+    {
+        stats.Message = error;
+        return stats;
+    }
+    if (!options.TexCoords)
+        mesh.TexCoords.clear();
+
+    stats.InputVertices = mesh.Positions.size() / 3;
+    start = GetSeconds();
+    if (options.Weld)
+        WeldVertices(mesh, options.WeldTolerance);
+    stats.DegenerateTriangles = RemoveDegenerateTriangles(mesh);
+    stats.WeldTime = GetSeconds() - start;
+    stats.OutputVertices = mesh.Positions.size() / 3;
+    stats.Triangles = mesh.Indices.size() / 3;
+
+    if (stats.Triangles == 0)
+    {
+        stats.Message = "No triangles";
+        return stats;
+    }
+
+    string output = GetOutputPath(input, options);
+    start = GetSeconds();
+    CTMcontext context = ctmNewContext(CTM_EXPORT);
+    ctmDefineMesh(context, &mesh.Positions[0], (CTMuint) stats.OutputVertices, &mesh.Indices[0], (CTMuint) stats.Triangles, 0);
+    if (!mesh.TexCoords.empty())
+        ctmAddUVMap(context, &mesh.TexCoords[0], "TexCoords", mesh.TextureFile.empty() ? 0 : mesh.TextureFile.c_str());
+    ctmCompressionMethod(context, options.Method);
+    ctmCompressionLevel(context, options.Level);
+    if (options.Method == CTM_METHOD_MG2)
+        ctmVertexPrecisionRel(context, options.VertexPrecision);
+    ctmSave(context, output.c_str());
+    CTMenum result = ctmGetError(context);
+    ctmFreeContext(context);
+    stats.SaveTime = GetSeconds() - start;
+
+    if (result != CTM_NONE)
+    {
+        stats.Message = string("OpenCTM error: ") + ctmErrorString(result);
+        return stats;
+    }
+
+    stats.OutputBytes = GetFileSize(output);
+    stats.Message = output;
+    stats.Succeeded = true;
+    return stats;
+}
+
+static void PrintUsage()
+{
+    cerr << "Usage: CtmConvert [-o dir] [-mg1|-mg2] [-level n] [-vprec rel] [-weld rel|-noweld] [-nouv] <file or directory>..." << endl;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    options.Method = CTM_METHOD_MG1;
+    options.Level = 1;
+    options.VertexPrecision = 0.001f;
+    options.WeldTolerance = 1e-6f;
+    options.Weld = true;
+    options.TexCoords = true;
+
+    vector<string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-o" && hasValue)
+            options.OutputFolder = argv[++i];
+        else if (arg == "-mg1")
+            options.Method = CTM_METHOD_MG1;
+        else if (arg == "-mg2")
+            options.Method = CTM_METHOD_MG2;
+        else if (arg == "-level" && hasValue)
+            options.Level = (CTMuint) atoi(argv[++i]);
+        else if (arg == "-vprec" && hasValue)
+            options.VertexPrecision = (float) atof(argv[++i]);
+        else if (arg == "-weld" && hasValue)
+            options.WeldTolerance = (float) atof(argv[++i]);
+        else if (arg == "-noweld")
+            options.Weld = false;
+        else if (arg == "-nouv")
+            options.TexCoords = false;
+        else if (arg[0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else if (IsFolder(arg))
+            ListFolder(arg, files);
+        else
+            files.push_back(arg);
+    }
+
+    if (files.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (!options.OutputFolder.empty() && !IsFolder(options.OutputFolder))
+    {
+#ifdef _WIN32
+        CreateDirectoryA(options.OutputFolder.c_str(), 0);
+#else
+        mkdir(options.OutputFolder.c_str(), 0755);
+#endif
+    }
+
+    // Each file is independent, so they're converted in parallel and reported in order:
+    vector<ConvertStats> stats(files.size());
+    double start = GetSeconds();
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < (int) files.size(); ++i)
+        stats[i] = ConvertFile(files[i], options);
+
+    double totalTime = GetSeconds() - start;
+
+    long inputBytes = 0, outputBytes = 0;
+    int failures = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const ConvertStats& s = stats[i];
+        if (!s.Succeeded)
+        {
+            cerr << files[i] << ": " << s.Message << endl;
+            ++failures;
+            continue;
+        }
+        inputBytes += s.InputBytes;
+        outputBytes += s.OutputBytes;
+        cout << fixed << setprecision(1)
+             << s.Message << ": "
+             << s.InputVertices << " -> " << s.OutputVertices << " verts, "
+             << s.Triangles << " tris";
+        if (s.DegenerateTriangles)
+            cout << " (" << s.DegenerateTriangles << " degenerate removed)";
+        cout << ", " << s.InputBytes << " -> " << s.OutputBytes << " bytes ("
+             << (s.OutputBytes ? (double) s.InputBytes / s.OutputBytes : 0.0) << ":1), "
+             << "load " << s.LoadTime * 1000.0 << " ms, "
+             << "weld " << s.WeldTime * 1000.0 << " ms, "
+             << "save " << s.SaveTime * 1000.0 << " ms" << endl;
+    }
+
+    cout << fixed << setprecision(1)
+         << files.size() - failures << " of " << files.size() << " files converted in "
+         << totalTime * 1000.0 << " ms, "
+         << inputBytes << " -> " << outputBytes << " bytes" << endl;
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,61 @@
+// Measures post-transform vertex cache efficiency (ACMR and ATVR) for each index ordering
+// of the parametric surfaces, and for any OBJ files given on the command line.
+// Usage: Acmr [divisions] [cacheSize] [file.obj...]
+
+#include "Classes/ParametricEquations.hpp"
+#include "Classes/ObjSurface.hpp"
+#include "Classes/VertexCache.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+static void Report(const char* name, const ISurface& surface, int cacheSize)
+{
+    static const char* OrderNames[] = { "row-major", "tiled", "hilbert" };
+    printf("%-24s %8d verts", name, surface.GetVertexCount());
+    for (int order = IndexOrderRowMajor; order <= IndexOrderHilbert; ++order) {
+        vector<unsigned int> indices;
+        surface.GenerateTriangleIndices(indices, (IndexOrder) order);
+        VertexCacheStats stats = MeasureVertexCache(indices, surface.GetVertexCount(), cacheSize);
+        printf("  %s: ACMR %.3f ATVR %.3f", OrderNames[order], stats.Acmr, stats.Atvr);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    int divisions = argc > 1 ? atoi(argv[1]) : 512;
+    int cacheSize = argc > 2 ? atoi(argv[2]) : 32;
+
+    printf("FIFO cache with %d entries, %dx%d grids\n", cacheSize, divisions, divisions);
+
+    Cone cone(3, 1);
+    Sphere sphere(1.4f);
+    Torus torus(1.4f, 0.3f);
+    TrefoilKnot knot(1.8f);
+    MobiusStrip mobius(1);
+    KleinBottle klein(0.2f);
+    ParametricSurface* surfaces[] = { &cone, &sphere, &torus, &knot, &mobius, &klein };
+    const char* names[] = { "Cone", "Sphere", "Torus", "TrefoilKnot", "MobiusStrip", "KleinBottle" };
+
+    // The original tessellation, then the high resolution one:
+    for (int i = 0; i < 6; ++i)
+        Report(names[i], *surfaces[i], cacheSize);
+    for (int i = 0; i < 6; ++i) {
+        surfaces[i]->SetDivisions(ivec2(divisions, divisions));
+        Report(names[i], *surfaces[i], cacheSize);
+    }
+
+    // OBJ files keep their own ordering:
+    int failures = 0;
+    for (int i = 3; i < argc; ++i) {
+        try {
+            Report(argv[i], ObjSurface(argv[i]), cacheSize);
+        } catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            ++failures;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+// Headless benchmark for ParametricSurface vertex generation at offline-baking resolutions.
+// Compares the batched, multithreaded path against per-vertex evaluation with
+// finite-difference normals (the original algorithm).
+// Usage: Benchmark [divisions]
+
+#include "Classes/ParametricEquations.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+static double GetSeconds()
+{
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+}
+#else
+#include <sys/time.h>
+static double GetSeconds()
+{
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    return tp.tv_sec + tp.tv_usec * 0.000001;
+}
+#endif
+
+// One evaluation per vertex plus three more for the finite-difference normal.
+static void GenerateReference(const ParametricSurface& surface, ivec2 divisions,
+                              const vec2& upperBound, vector<float>& vertices)
+{
+    ivec2 slices = divisions - ivec2(1, 1);
+    vertices.resize(divisions.x * divisions.y * 6);
+    float* attribute = &vertices[0];
+    for (int j = 0; j < divisions.y; j++) {
+        for (int i = 0; i < divisions.x; i++) {
+            vec2 domain(i * upperBound.x / slices.x, j * upperBound.y / slices.y);
+            attribute = surface.Evaluate(domain).Write(attribute);
+
+            float s = i, t = j;
+            if (i == 0) s += 0.01f;
+            if (i == divisions.x - 1) s -= 0.01f;
+            if (j == 0) t += 0.01f;
+            if (j == divisions.y - 1) t -= 0.01f;
+            vec3 p = surface.Evaluate(vec2(s * upperBound.x / slices.x, t * upperBound.y / slices.y));
+            vec3 u = surface.Evaluate(vec2((s + 0.01f) * upperBound.x / slices.x, t * upperBound.y / slices.y)) - p;
+            vec3 v = surface.Evaluate(vec2(s * upperBound.x / slices.x, (t + 0.01f) * upperBound.y / slices.y)) - p;
+            attribute = u.Cross(v).Normalized().Write(attribute);
+        }
+    }
+}
+
+static void RunBenchmark(const char* name, ParametricSurface& surface, const vec2& upperBound,
+                         bool invertsNormals, int divisions)
+{
+    const int Iterations = 3;
+    ivec2 size(divisions, divisions);
+    surface.SetDivisions(size);
+    double vertexCount = (double) divisions * divisions;
+
+    vector<float> reference, batched;
+    double start = GetSeconds();
+    GenerateReference(surface, size, upperBound, reference);
+    double referenceTime = GetSeconds() - start;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+    omp_set_num_threads(1);
+#else
+    int threadCount = 1;
+#endif
+    start = GetSeconds();
+    for (int i = 0; i < Iterations; ++i)
+        surface.GenerateVertices(batched, VertexFlagsNormals);
+    double singleTime = (GetSeconds() - start) / Iterations;
+
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+    start = GetSeconds();
+    for (int i = 0; i < Iterations; ++i)
+        surface.GenerateVertices(batched, VertexFlagsNormals);
+    double threadedTime = (GetSeconds() - start) / Iterations;
+
+    // Positions should match exactly; normals only approximately when they're analytic.
+    // Surfaces that flip some of their normals are compared without regard to sign.
+    int positionMismatches = 0;
+    float minDot = 1;
+    for (size_t v = 0; v < batched.size(); v += 6) {
+        for (int c = 0; c < 3; ++c)
+            positionMismatches += (batched[v + c] != reference[v + c]);
+        vec3 a(batched[v + 3], batched[v + 4], batched[v + 5]);
+        vec3 b(reference[v + 3], reference[v + 4], reference[v + 5]);
+        float dot = a.Dot(b);
+        minDot = std::min(minDot, invertsNormals ? std::fabs(dot) : dot);
+    }
+
+    printf("%-12s %5dx%-5d reference: %6.1f Mverts/s  batched: %6.1f Mverts/s  %2d threads: %6.1f Mverts/s  "
+           "positions: %s  min normal dot: %.4f\n",
+           name, divisions, divisions,
+           vertexCount / referenceTime * 0.000001,
+           vertexCount / singleTime * 0.000001,
+           threadCount, vertexCount / threadedTime * 0.000001,
+           positionMismatches ? "MISMATCH" : "identical", minDot);
+}
+
+int main(int argc, char** argv)
+{
+    int divisions = argc > 1 ? atoi(argv[1]) : 1024;
+
+    Cone cone(3, 1);
+    Sphere sphere(1.4f);
+    Torus torus(1.4f, 0.3f);
+    TrefoilKnot knot(1.8f);
+    MobiusStrip mobius(1);
+    KleinBottle klein(0.2f);
+
+    RunBenchmark("Cone", cone, vec2(TwoPi, 1), false, divisions);
+    RunBenchmark("Sphere", sphere, vec2(Pi, TwoPi), false, divisions);
+    RunBenchmark("Torus", torus, vec2(TwoPi, TwoPi), false, divisions);
+    RunBenchmark("TrefoilKnot", knot, vec2(TwoPi, TwoPi), false, divisions);
+    RunBenchmark("MobiusStrip", mobius, vec2(TwoPi, TwoPi), false, divisions);
+    RunBenchmark("KleinBottle", klein, vec2(TwoPi, TwoPi), true, divisions);
+
+    return 0;
+}
@@ -22,6 +22,14 @@ struct IApplicationEngine {
     virtual ~IApplicationEngine() {}
 };
 
+// Triangle orderings for surfaces that are generated on a grid.  The tiled and Hilbert
+// orders improve post-transform vertex cache reuse over plain row-major quads.
+enum IndexOrder {
+    IndexOrderRowMajor,
+    IndexOrderTiled,
+    IndexOrderHilbert,
+};
+
 struct ISurface {
     virtual int GetVertexCount() const = 0;
     virtual int GetLineIndexCount() const = 0;
@@ -30,6 +38,9 @@ struct ISurface {
                                   unsigned char flags = 0) const = 0;
     virtual void GenerateLineIndices(vector<unsigned short>& indices) const = 0;
     virtual void GenerateTriangleIndices(vector<unsigned short>& indices) const = 0;
+    virtual void GenerateLineIndices(vector<unsigned int>& indices) const = 0;
+    virtual void GenerateTriangleIndices(vector<unsigned int>& indices,
+                                         IndexOrder order = IndexOrderRowMajor) const = 0;
     virtual ~ISurface() {}
 };
 
@@ -1,106 +1,260 @@
 #include "ObjSurface.hpp"
-#import <list>
-#import <fstream>
 #import <assert.h>
+#import <string.h>
+#import <errno.h>
+#import <stdexcept>
+#import <fcntl.h>
+#import <unistd.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
 
 using namespace std;
 
-ObjSurface::ObjSurface(const string& name) :
-    m_name(name),
-    m_faceCount(0),
-    m_vertexCount(0)
+namespace {
+
+// Parsing is split at line boundaries into roughly this many bytes per chunk.
+const size_t ChunkSize = 1 << 18;
+
+struct ObjChunk {
+    const char* Begin;
+    const char* End;
+    vector<vec3> Positions;
+    vector<ivec3> Faces;
+    vector<size_t> RelativeIndices; // Slots in Faces that hold negative (relative) indices
+    vector<int> Polygon;            // Corners of the face being parsed, reused between faces
+    vector<bool> Relative;
+};
+
+inline const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+    return p;
+}
+
+// Parses a decimal float with an optional exponent; much faster than strtod and good
+// to within an ulp or so, which is plenty for vertex positions.
+inline const char* ParseFloat(const char* p, const char* end, float* value)
 {
-    m_faces.resize(GetTriangleIndexCount() / 3);
-    ifstream objFile(m_name.c_str());
-    vector<ivec3>::iterator face = m_faces.begin();
-    while (objFile) {
-        char c = objFile.get();
-        if (c == 'f') {
-            assert(face != m_faces.end() && "parse error");
-            objFile >> face->x >> face->y >> face->z;
-            *face++ -= ivec3(1, 1, 1);
+    static const double Powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    p = SkipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    double mantissa = 0;
+    int exponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        mantissa = mantissa * 10 + (*p - '0');
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            mantissa = mantissa * 10 + (*p - '0');
+            --exponent;
         }
-        objFile.ignore(MaxLineSize, '\n');
     }
-    assert(face == m_faces.end() && "parse error");
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negativeExponent = (*p++ == '-');
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+            e = e * 10 + (*p - '0');
+        exponent += negativeExponent ? -e : e;
+    }
+
+    while (exponent < -22) {
+        mantissa /= Powers[22];
+        exponent += 22;
+    }
+    while (exponent > 22) {
+        mantissa *= Powers[22];
+        exponent -= 22;
+    }
+    mantissa = exponent < 0 ? mantissa / Powers[-exponent] : mantissa * Powers[exponent];
+    *value = (float) (negative ? -mantissa : mantissa);
+    return p;
 }
 
-int ObjSurface::GetVertexCount() const
+// Parses one face corner ("v", "v/vt", "v//vn" or "v/vt/vn") and returns its position index.
+inline const char* ParseCorner(const char* p, const char* end, int* index)
 {
-    if (m_vertexCount != 0)
-        return m_vertexCount;
-    
-    ifstream objFile(m_name.c_str());
-    while (objFile) {
-        char c = objFile.get();
-        if (c == 'v')
-            m_vertexCount++;
-        objFile.ignore(MaxLineSize, '\n');
-    }
-    return m_vertexCount;
+    p = SkipSpaces(p, end);
+    bool negative = (p < end && *p == '-');
+    if (negative)
+        ++p;
+    int value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        value = value * 10 + (*p - '0');
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        ++p;
+    *index = negative ? -value : value;
+    return p;
 }
 
-int ObjSurface::GetTriangleIndexCount() const
+void ParseChunk(ObjChunk& chunk)
 {
-    if (m_faceCount != 0)
-        return m_faceCount * 3;
-    
-    ifstream objFile(m_name.c_str());
-    while (objFile) {
-        char c = objFile.get();
-        if (c == 'f')
-            m_faceCount++;
-        objFile.ignore(MaxLineSize, '\n');
+    const char* end = chunk.End;
+    for (const char* p = chunk.Begin; p < end; ++p) {
+        if (p[0] == 'v' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+            vec3 position;
+            p = ParseFloat(p + 1, end, &position.x);
+            p = ParseFloat(p, end, &position.y);
+            p = ParseFloat(p, end, &position.z);
+            chunk.Positions.push_back(position);
+        } else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+            // Triangulate polygons as fans.  Relative indices are kept as offsets from the
+            // chunk's first vertex until the chunk is merged.
+            int local = chunk.Positions.size();
+            vector<int>& polygon = chunk.Polygon;
+            vector<bool>& relative = chunk.Relative;
+            polygon.clear();
+            relative.clear();
+            p = SkipSpaces(p + 1, end);
+            while (p < end && *p != '\r' && *p != '\n') {
+                int index;
+                p = ParseCorner(p, end, &index);
+                relative.push_back(index < 0);
+                polygon.push_back(index < 0 ? local + index : index - 1);
+                p = SkipSpaces(p, end);
+            }
+            int count = polygon.size();
+            for (int i = 2; i < count; ++i) {
+                int corners[3] = { 0, i - 1, i };
+                for (int k = 0; k < 3; ++k)
+                    if (relative[corners[k]])
+                        chunk.RelativeIndices.push_back(chunk.Faces.size() * 3 + k);
+                chunk.Faces.push_back(ivec3(polygon[0], polygon[i - 1], polygon[i]));
+            }
+        }
+        while (p < end && *p != '\n')
+            ++p;
     }
-    return m_faceCount * 3;
 }
 
-void ObjSurface::GenerateVertices(vector<float>& floats, unsigned char flags) const
+}
+
+ObjSurface::ObjSurface(const string& name)
 {
-    assert(flags == VertexFlagsNormals && "Unsupported flags.");
+    int file = open(name.c_str(), O_RDONLY);
+    if (file < 0)
+        throw runtime_error("Unable to open " + name + ": " + strerror(errno));
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        int error = errno;
+        close(file);
+        throw runtime_error("Unable to stat " + name + ": " + strerror(error));
+    }
+    size_t size = info.st_size;
+    const char* contents = 0;
+    if (size > 0) {
+        void* mapping = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping == MAP_FAILED) {
+            int error = errno;
+            close(file);
+            throw runtime_error("Unable to map " + name + ": " + strerror(error));
+        }
+        contents = (const char*) mapping;
+    }
+    close(file);
+
+    // Split the file into chunks that end just after a newline.
+    vector<ObjChunk> chunks;
+    const char* end = contents + size;
+    for (const char* begin = contents; begin < end; ) {
+        const char* split = begin + ChunkSize < end ? begin + ChunkSize : end;
+        while (split < end && split[-1] != '\n')
+            ++split;
+        chunks.push_back(ObjChunk());
+        chunks.back().Begin = begin;
+        chunks.back().End = split;
+        begin = split;
+    }
+
+    int chunkCount = chunks.size();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunkCount; ++c)
+        ParseChunk(chunks[c]);
+
+    if (size > 0)
+        munmap((void*) contents, size);
+
+    // Prefix sums tell each chunk where its vertices and faces go.
+    vector<size_t> vertexOffsets(chunkCount + 1, 0), faceOffsets(chunkCount + 1, 0);
+    for (int c = 0; c < chunkCount; ++c) {
+        vertexOffsets[c + 1] = vertexOffsets[c] + chunks[c].Positions.size();
+        faceOffsets[c + 1] = faceOffsets[c] + chunks[c].Faces.size();
+    }
 
     struct Vertex {
         vec3 Position;
         vec3 Normal;
     };
 
-    // Read in the vertex positions and initialize lighting normals to (0, 0, 0).
-    floats.resize(GetVertexCount() * 6);
-    ifstream objFile(m_name.c_str());
-    Vertex* vertex = (Vertex*) &floats[0];
-    while (objFile) {
-        char c = objFile.get();
-        if (c == 'v') {
-            vertex->Normal = vec3(0, 0, 0);
-            vec3& position = (vertex++)->Position;
-            objFile >> position.x >> position.y >> position.z;
+    // Copy the positions and initialize lighting normals to (0, 0, 0).
+    m_vertices.resize(vertexOffsets[chunkCount] * 6);
+    m_faces.resize(faceOffsets[chunkCount]);
+    Vertex* vertex = m_vertices.empty() ? 0 : (Vertex*) &m_vertices[0];
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunkCount; ++c) {
+        Vertex* dest = vertex + vertexOffsets[c];
+        const vector<vec3>& positions = chunks[c].Positions;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            dest[i].Position = positions[i];
+            dest[i].Normal = vec3(0, 0, 0);
         }
-        objFile.ignore(MaxLineSize, '\n');
+        vector<vec3>().swap(chunks[c].Positions);
     }
 
-    vertex = (Vertex*) &floats[0];
-    for (size_t faceIndex = 0; faceIndex < m_faces.size(); ++faceIndex) {
-        ivec3 face = m_faces[faceIndex];
+    // Store the faces, adding each facet normal to the lighting normal of its corners
+    // on the way.  This runs in file order so the sums don't depend on the thread count.
+    int vertexCount = GetVertexCount();
+    for (int c = 0; c < chunkCount; ++c) {
+        ObjChunk& chunk = chunks[c];
+        if (chunk.Faces.empty())
+            continue;
+        int* indices = (int*) &chunk.Faces[0];
+        for (size_t i = 0; i < chunk.RelativeIndices.size(); ++i)
+            indices[chunk.RelativeIndices[i]] += vertexOffsets[c];
 
-        // Compute the facet normal.
-        vec3 a = vertex[face.x].Position;
-        vec3 b = vertex[face.y].Position;
-        vec3 c = vertex[face.z].Position;
-        vec3 facetNormal = (b - a).Cross(c - a);
+        ivec3* face = &m_faces[faceOffsets[c]];
+        for (size_t f = 0; f < chunk.Faces.size(); ++f, ++face) {
+            *face = chunk.Faces[f];
+            if (face->x < 0 || face->x >= vertexCount ||
+                face->y < 0 || face->y >= vertexCount ||
+                face->z < 0 || face->z >= vertexCount)
+                throw runtime_error("Bad face index in " + name);
 
-        // Add the facet normal to the lighting normal of each adjoining vertex.
-        vertex[face.x].Normal += facetNormal;
-        vertex[face.y].Normal += facetNormal;
-        vertex[face.z].Normal += facetNormal;
+            vec3 a = vertex[face->x].Position;
+            vec3 b = vertex[face->y].Position;
+            vec3 d = vertex[face->z].Position;
+            vec3 facetNormal = (b - a).Cross(d - a);
+
+            vertex[face->x].Normal += facetNormal;
+            vertex[face->y].Normal += facetNormal;
+            vertex[face->z].Normal += facetNormal;
+        }
     }
 
     // Normalize the normals.
-    for (int v = 0; v < GetVertexCount(); ++v)
+    #pragma omp parallel for
+    for (int v = 0; v < vertexCount; ++v)
         vertex[v].Normal.Normalize();
 }
 
+void ObjSurface::GenerateVertices(vector<float>& floats, unsigned char flags) const
+{
+    assert(flags == VertexFlagsNormals && "Unsupported flags.");
+    floats = m_vertices;
+}
+
 void ObjSurface::GenerateTriangleIndices(vector<unsigned short>& indices) const
 {
+    assert(GetVertexCount() <= 0x10000 && "Too many vertices for 16-bit indices.");
     indices.resize(GetTriangleIndexCount());
     vector<unsigned short>::iterator index = indices.begin();
     for (vector<ivec3>::const_iterator f = m_faces.begin(); f != m_faces.end(); ++f) {
@@ -109,3 +263,11 @@ void ObjSurface::GenerateTriangleIndices(vector<unsigned short>& indices) const
         *index++ = f->z;
     }
 }
+
+// The faces are kept in file order; the order argument only applies to grid surfaces.
+void ObjSurface::GenerateTriangleIndices(vector<unsigned int>& indices, IndexOrder order) const
+{
+    indices.resize(GetTriangleIndexCount());
+    if (!m_faces.empty())
+        memcpy(&indices[0], &m_faces[0], m_faces.size() * sizeof(ivec3));
+}
@@ -1,18 +1,21 @@
 #include "Interfaces.hpp"
 
+// Loads the whole OBJ up front: the file is memory-mapped, split into line-aligned chunks
+// that are parsed in parallel, and stitched together with smooth normals.  Throws
+// std::runtime_error if the file can't be opened or mapped, or a face refers to a missing vertex.
 class ObjSurface : public ISurface {
 public:
     ObjSurface(const string& name);
-    int GetVertexCount() const;
+    int GetVertexCount() const { return m_vertices.size() / 6; }
     int GetLineIndexCount() const { return 0; }
-    int GetTriangleIndexCount() const;
+    int GetTriangleIndexCount() const { return m_faces.size() * 3; }
     void GenerateVertices(vector<float>& vertices, unsigned char flags) const;
     void GenerateLineIndices(vector<unsigned short>& indices) const {}
     void GenerateTriangleIndices(vector<unsigned short>& indices) const;
+    void GenerateLineIndices(vector<unsigned int>& indices) const {}
+    void GenerateTriangleIndices(vector<unsigned int>& indices,
+                                 IndexOrder order = IndexOrderRowMajor) const;
 private:
-    string m_name;
+    vector<float> m_vertices; // Interleaved position and normal
     vector<ivec3> m_faces;
-    mutable size_t m_faceCount;
-    mutable size_t m_vertexCount;
-    static const int MaxLineSize = 128;
 };
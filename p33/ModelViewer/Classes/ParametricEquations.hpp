@@ -7,13 +7,28 @@ public:
         ParametricInterval interval = { ivec2(20, 20), vec2(TwoPi, 1), vec2(30, 20) };
         SetInterval(interval);
     }
-    vec3 Evaluate(const vec2& domain) const
+    void EvaluateRow(const float* us, const float* vs, int count, ParametricRow range) const
     {
-        float u = domain.x, v = domain.y;
-        float x = m_radius * (1 - v) * cos(u);
-        float y = m_height * (v - 0.5f);
-        float z = m_radius * (1 - v) * -sin(u);
-        return vec3(x, y, z);
+        for (int i = 0; i < count; i++) {
+            float u = us[i], v = vs[i];
+            range.X[i] = m_radius * (1 - v) * cos(u);
+            range.Y[i] = m_height * (v - 0.5f);
+            range.Z[i] = m_radius * (1 - v) * -sin(u);
+        }
+    }
+    bool EvaluatePartials(const float* us, const float* vs, int count,
+                          ParametricRow du, ParametricRow dv) const
+    {
+        for (int i = 0; i < count; i++) {
+            float u = us[i], v = vs[i];
+            du.X[i] = m_radius * (1 - v) * -sin(u);
+            du.Y[i] = 0;
+            du.Z[i] = m_radius * (1 - v) * -cos(u);
+            dv.X[i] = -m_radius * cos(u);
+            dv.Y[i] = m_height;
+            dv.Z[i] = m_radius * sin(u);
+        }
+        return true;
     }
 private:
     float m_height;
@@ -27,13 +42,28 @@ public:
         ParametricInterval interval = { ivec2(20, 20), vec2(Pi, TwoPi), vec2(20, 35) };
         SetInterval(interval);
     }
-    vec3 Evaluate(const vec2& domain) const
+    void EvaluateRow(const float* us, const float* vs, int count, ParametricRow range) const
+    {
+        for (int i = 0; i < count; i++) {
+            float u = us[i], v = vs[i];
+            range.X[i] = m_radius * sin(u) * cos(v);
+            range.Y[i] = m_radius * cos(u);
+            range.Z[i] = m_radius * -sin(u) * sin(v);
+        }
+    }
+    bool EvaluatePartials(const float* us, const float* vs, int count,
+                          ParametricRow du, ParametricRow dv) const
     {
-        float u = domain.x, v = domain.y;
-        float x = m_radius * sin(u) * cos(v);
-        float y = m_radius * cos(u);
-        float z = m_radius * -sin(u) * sin(v);
-        return vec3(x, y, z);
+        for (int i = 0; i < count; i++) {
+            float u = us[i], v = vs[i];
+            du.X[i] = m_radius * cos(u) * cos(v);
+            du.Y[i] = m_radius * -sin(u);
+            du.Z[i] = m_radius * -cos(u) * sin(v);
+            dv.X[i] = m_radius * sin(u) * -sin(v);
+            dv.Y[i] = 0;
+            dv.Z[i] = m_radius * -sin(u) * cos(v);
+        }
+        return true;
     }
 private:
     float m_radius;
@@ -48,15 +78,32 @@ public:
         ParametricInterval interval = { ivec2(40, 20), vec2(TwoPi, TwoPi), vec2(40, 10) };
         SetInterval(interval);
     }
-    vec3 Evaluate(const vec2& domain) const
+    void EvaluateRow(const float* us, const float* vs, int count, ParametricRow range) const
     {
         const float major = m_majorRadius;
         const float minor = m_minorRadius;
-        float u = domain.x, v = domain.y;
-        float x = (major + minor * cos(v)) * cos(u);
-        float y = (major + minor * cos(v)) * sin(u);
-        float z = minor * sin(v);
-        return vec3(x, y, z);
+        for (int i = 0; i < count; i++) {
+            float u = us[i], v = vs[i];
+            range.X[i] = (major + minor * cos(v)) * cos(u);
+            range.Y[i] = (major + minor * cos(v)) * sin(u);
+            range.Z[i] = minor * sin(v);
+        }
+    }
+    bool EvaluatePartials(const float* us, const float* vs, int count,
+                          ParametricRow du, ParametricRow dv) const
+    {
+        const float major = m_majorRadius;
+        const float minor = m_minorRadius;
+        for (int i = 0; i < count; i++) {
+            float u = us[i], v = vs[i];
+            du.X[i] = -(major + minor * cos(v)) * sin(u);
+            du.Y[i] = (major + minor * cos(v)) * cos(u);
+            du.Z[i] = 0;
+            dv.X[i] = -minor * sin(v) * cos(u);
+            dv.Y[i] = -minor * sin(v) * sin(u);
+            dv.Z[i] = minor * cos(v);
+        }
+        return true;
     }
 private:
     float m_majorRadius;
@@ -70,36 +117,36 @@ public:
         ParametricInterval interval = { ivec2(120, 30), vec2(TwoPi, TwoPi), vec2(100, 8) };
         SetInterval(interval);
     }
-    vec3 Evaluate(const vec2& domain) const
+    void EvaluateRow(const float* us, const float* vs, int count, ParametricRow range) const
     {
         const float a = 0.5f;
         const float b = 0.3f;
         const float c = 0.5f;
         const float d = 0.1f;
-        float u = (TwoPi - domain.x) * 2;
-        float v = domain.y;
-        
-        float r = a + b * cos(1.5f * u);
-        float x = r * cos(u);
-        float y = r * sin(u);
-        float z = c * sin(1.5f * u);
-        
-        vec3 dv;
-        dv.x = -1.5f * b * sin(1.5f * u) * cos(u) -
-               (a + b * cos(1.5f * u)) * sin(u);
-        dv.y = -1.5f * b * sin(1.5f * u) * sin(u) +
-               (a + b * cos(1.5f * u)) * cos(u);
-        dv.z = 1.5f * c * cos(1.5f * u);
-        
-        vec3 q = dv.Normalized();
-        vec3 qvn = vec3(q.y, -q.x, 0).Normalized();
-        vec3 ww = q.Cross(qvn);
-        
-        vec3 range;
-        range.x = x + d * (qvn.x * cos(v) + ww.x * sin(v));
-        range.y = y + d * (qvn.y * cos(v) + ww.y * sin(v));
-        range.z = z + d * ww.z * sin(v);
-        return range * m_scale;
+        for (int i = 0; i < count; i++) {
+            float u = (TwoPi - us[i]) * 2;
+            float v = vs[i];
+
+            float r = a + b * cos(1.5f * u);
+            float x = r * cos(u);
+            float y = r * sin(u);
+            float z = c * sin(1.5f * u);
+
+            vec3 dv;
+            dv.x = -1.5f * b * sin(1.5f * u) * cos(u) -
+                   (a + b * cos(1.5f * u)) * sin(u);
+            dv.y = -1.5f * b * sin(1.5f * u) * sin(u) +
+                   (a + b * cos(1.5f * u)) * cos(u);
+            dv.z = 1.5f * c * cos(1.5f * u);
+
+            vec3 q = dv.Normalized();
+            vec3 qvn = vec3(q.y, -q.x, 0).Normalized();
+            vec3 ww = q.Cross(qvn);
+
+            range.X[i] = (x + d * (qvn.x * cos(v) + ww.x * sin(v))) * m_scale;
+            range.Y[i] = (y + d * (qvn.y * cos(v) + ww.y * sin(v))) * m_scale;
+            range.Z[i] = (z + d * ww.z * sin(v)) * m_scale;
+        }
     }
 private:
     float m_scale;
@@ -112,26 +159,53 @@ public:
         ParametricInterval interval = { ivec2(40, 20), vec2(TwoPi, TwoPi), vec2(40, 15) };
         SetInterval(interval);
     }
-    vec3 Evaluate(const vec2& domain) const
-    {
-        float u = domain.x;
-        float t = domain.y;
-        float major = 1.25;
-        float a = 0.125f;
-        float b = 0.5f;
-        float phi = u / 2;
-        
-        // General equation for an ellipse where phi is the angle
-        // between the major axis and the X axis.
-        float x = a * cos(t) * cos(phi) - b * sin(t) * sin(phi);
-        float y = a * cos(t) * sin(phi) + b * sin(t) * cos(phi);
-
-        // Sweep the ellipse along a circle, like a torus.
-        vec3 range;
-        range.x = (major + x) * cos(u);
-        range.y = (major + x) * sin(u);
-        range.z = y;
-        return range * m_scale;
+    void EvaluateRow(const float* us, const float* ts, int count, ParametricRow range) const
+    {
+        const float major = 1.25;
+        const float a = 0.125f;
+        const float b = 0.5f;
+        for (int i = 0; i < count; i++) {
+            float u = us[i];
+            float t = ts[i];
+            float phi = u / 2;
+
+            // General equation for an ellipse where phi is the angle
+            // between the major axis and the X axis.
+            float x = a * cos(t) * cos(phi) - b * sin(t) * sin(phi);
+            float y = a * cos(t) * sin(phi) + b * sin(t) * cos(phi);
+
+            // Sweep the ellipse along a circle, like a torus.
+            range.X[i] = (major + x) * cos(u) * m_scale;
+            range.Y[i] = (major + x) * sin(u) * m_scale;
+            range.Z[i] = y * m_scale;
+        }
+    }
+    bool EvaluatePartials(const float* us, const float* ts, int count,
+                          ParametricRow du, ParametricRow dt) const
+    {
+        const float major = 1.25;
+        const float a = 0.125f;
+        const float b = 0.5f;
+        for (int i = 0; i < count; i++) {
+            float u = us[i];
+            float t = ts[i];
+            float phi = u / 2;
+            float x = a * cos(t) * cos(phi) - b * sin(t) * sin(phi);
+            float y = a * cos(t) * sin(phi) + b * sin(t) * cos(phi);
+
+            // Rotating the ellipse by phi = u / 2 turns (x, y) into (-y, x) / 2.
+            float dxdu = -y / 2;
+            du.X[i] = (dxdu * cos(u) - (major + x) * sin(u)) * m_scale;
+            du.Y[i] = (dxdu * sin(u) + (major + x) * cos(u)) * m_scale;
+            du.Z[i] = x / 2 * m_scale;
+
+            float dxdt = -a * sin(t) * cos(phi) - b * cos(t) * sin(phi);
+            float dydt = -a * sin(t) * sin(phi) + b * cos(t) * cos(phi);
+            dt.X[i] = dxdt * cos(u) * m_scale;
+            dt.Y[i] = dxdt * sin(u) * m_scale;
+            dt.Z[i] = dydt * m_scale;
+        }
+        return true;
     }
 private:
     float m_scale;
@@ -144,26 +218,26 @@ public:
         ParametricInterval interval = { ivec2(40, 40), vec2(TwoPi, TwoPi), vec2(15, 50) };
         SetInterval(interval);
     }
-    vec3 Evaluate(const vec2& domain) const
-    {
-        float v = 1 - domain.x;
-        float u = domain.y;
-        
-        float x0 = 3 * cos(u) * (1 + sin(u)) +
-                   (2 * (1 - cos(u) / 2)) * cos(u) * cos(v);
-        
-        float y0  = 8 * sin(u) + (2 * (1 - cos(u) / 2)) * sin(u) * cos(v);
-        
-        float x1 = 3 * cos(u) * (1 + sin(u)) +
-                   (2 * (1 - cos(u) / 2)) * cos(v + Pi);
-        
-        float y1 = 8 * sin(u);
-        
-        vec3 range;
-        range.x = u < Pi ? x0 : x1;
-        range.y = u < Pi ? -y0 : -y1;
-        range.z = (-2 * (1 - cos(u) / 2)) * sin(v);
-        return range * m_scale;
+    void EvaluateRow(const float* us, const float* vs, int count, ParametricRow range) const
+    {
+        for (int i = 0; i < count; i++) {
+            float v = 1 - us[i];
+            float u = vs[i];
+
+            float x0 = 3 * cos(u) * (1 + sin(u)) +
+                       (2 * (1 - cos(u) / 2)) * cos(u) * cos(v);
+
+            float y0  = 8 * sin(u) + (2 * (1 - cos(u) / 2)) * sin(u) * cos(v);
+
+            float x1 = 3 * cos(u) * (1 + sin(u)) +
+                       (2 * (1 - cos(u) / 2)) * cos(v + Pi);
+
+            float y1 = 8 * sin(u);
+
+            range.X[i] = (u < Pi ? x0 : x1) * m_scale;
+            range.Y[i] = (u < Pi ? -y0 : -y1) * m_scale;
+            range.Z[i] = (-2 * (1 - cos(u) / 2)) * sin(v) * m_scale;
+        }
     }
     bool InvertNormal(const vec2& domain) const
     {
@@ -1,4 +1,6 @@
 #include "ParametricSurface.hpp"
+#include <algorithm>
+#include <cassert>
 
 void ParametricSurface::SetInterval(const ParametricInterval& interval)
 {
@@ -28,6 +30,20 @@ vec2 ParametricSurface::ComputeDomain(float x, float y) const
     return vec2(x * m_upperBound.x / m_slices.x, y * m_upperBound.y / m_slices.y);
 }
 
+vec3 ParametricSurface::Evaluate(const vec2& domain) const
+{
+    vec3 range;
+    ParametricRow row = { &range.x, &range.y, &range.z };
+    EvaluateRow(&domain.x, &domain.y, 1, row);
+    return range;
+}
+
+void ParametricSurface::SetDivisions(const ivec2& divisions)
+{
+    m_divisions = divisions;
+    m_slices = m_divisions - ivec2(1, 1);
+}
+
 void ParametricSurface::GenerateVertices(vector<float>& vertices,
                                          unsigned char flags) const
 {
@@ -39,49 +55,111 @@ void ParametricSurface::GenerateVertices(vector<float>& vertices,
 
     vertices.resize(GetVertexCount() * floatsPerVertex);
     float* attribute = &vertices[0];
+    int rowSize = m_divisions.x * floatsPerVertex;
+
+    // Rows are independent, so each one is evaluated as a batch on its own thread.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int j = 0; j < m_divisions.y; j++)
+        GenerateRow(j, flags, floatsPerVertex, attribute + j * rowSize);
+}
+
+void ParametricSurface::GenerateRow(int j, unsigned char flags, int floatsPerVertex,
+                                    float* attribute) const
+{
+    const int count = m_divisions.x;
+    const bool normals = (flags & VertexFlagsNormals) != 0;
+
+    // Scratch space for the domain and range of the row, and for normals, the nudged
+    // domain and the two tangents (plus the extra domains for finite differences).
+    vector<float> scratch(count * (normals ? 20 : 5));
+    float* next = &scratch[0];
+    float* u = next; next += count;
+    float* v = next; next += count;
+    ParametricRow range = { next, next + count, next + count * 2 };
+    next += count * 3;
+
+    for (int i = 0; i < count; i++) {
+        vec2 domain = ComputeDomain(i, j);
+        u[i] = domain.x;
+        v[i] = domain.y;
+    }
+    EvaluateRow(u, v, count, range);
 
-    for (int j = 0; j < m_divisions.y; j++) {
-        for (int i = 0; i < m_divisions.x; i++) {
+    ParametricRow du, dv;
+    if (normals) {
+        float* nu = next; next += count;
+        float* nv = next; next += count;
+        du.X = next; du.Y = next + count; du.Z = next + count * 2;
+        next += count * 3;
+        dv.X = next; dv.Y = next + count; dv.Z = next + count * 2;
+        next += count * 3;
 
-            // Compute Position
-            vec2 domain = ComputeDomain(i, j);
-            vec3 range = Evaluate(domain);
-            attribute = range.Write(attribute);
+        // Nudge the points where the normal is indeterminate.
+        float t = j;
+        if (j == 0) t += 0.01f;
+        if (j == m_divisions.y - 1) t -= 0.01f;
+        for (int i = 0; i < count; i++) {
+            float s = i;
+            if (i == 0) s += 0.01f;
+            if (i == count - 1) s -= 0.01f;
+            vec2 domain = ComputeDomain(s, t);
+            nu[i] = domain.x;
+            nv[i] = domain.y;
+        }
 
-            // Compute Normal
-            if (flags & VertexFlagsNormals) {
-                float s = i, t = j;
+        if (!EvaluatePartials(nu, nv, count, du, dv)) {
 
-                // Nudge the point if the normal is indeterminate.
+            // Compute the tangents by finite differences.
+            float* uu = next; next += count;
+            float* uv = next; next += count;
+            float* vu = next; next += count;
+            float* vv = next; next += count;
+            ParametricRow p = { next, next + count, next + count * 2 };
+            for (int i = 0; i < count; i++) {
+                float s = i;
                 if (i == 0) s += 0.01f;
-                if (i == m_divisions.x - 1) s -= 0.01f;
-                if (j == 0) t += 0.01f;
-                if (j == m_divisions.y - 1) t -= 0.01f;
-                
-                // Compute the tangents and their cross product.
-                vec3 p = Evaluate(ComputeDomain(s, t));
-                vec3 u = Evaluate(ComputeDomain(s + 0.01f, t)) - p;
-                vec3 v = Evaluate(ComputeDomain(s, t + 0.01f)) - p;
-                vec3 normal = u.Cross(v).Normalized();
-                if (InvertNormal(domain))
-                    normal = -normal;
-                attribute = normal.Write(attribute);
+                if (i == count - 1) s -= 0.01f;
+                vec2 uDomain = ComputeDomain(s + 0.01f, t);
+                vec2 vDomain = ComputeDomain(s, t + 0.01f);
+                uu[i] = uDomain.x; uv[i] = uDomain.y;
+                vu[i] = vDomain.x; vv[i] = vDomain.y;
             }
-            
-            // Compute Texture Coordinates
-            if (flags & VertexFlagsTexCoords) {
-                float s = m_textureCount.x * i / m_slices.x;
-                float t = m_textureCount.y * j / m_slices.y;
-                attribute = vec2(s, t).Write(attribute);
+            EvaluateRow(nu, nv, count, p);
+            EvaluateRow(uu, uv, count, du);
+            EvaluateRow(vu, vv, count, dv);
+            for (int i = 0; i < count; i++) {
+                du.X[i] -= p.X[i]; du.Y[i] -= p.Y[i]; du.Z[i] -= p.Z[i];
+                dv.X[i] -= p.X[i]; dv.Y[i] -= p.Y[i]; dv.Z[i] -= p.Z[i];
             }
         }
     }
+
+    // Interleave the attributes.
+    for (int i = 0; i < count; i++) {
+        attribute = vec3(range.X[i], range.Y[i], range.Z[i]).Write(attribute);
+
+        if (normals) {
+            vec3 tangentU(du.X[i], du.Y[i], du.Z[i]);
+            vec3 tangentV(dv.X[i], dv.Y[i], dv.Z[i]);
+            vec3 normal = tangentU.Cross(tangentV).Normalized();
+            if (InvertNormal(vec2(u[i], v[i])))
+                normal = -normal;
+            attribute = normal.Write(attribute);
+        }
+
+        if (flags & VertexFlagsTexCoords) {
+            float s = m_textureCount.x * i / m_slices.x;
+            float t = m_textureCount.y * j / m_slices.y;
+            attribute = vec2(s, t).Write(attribute);
+        }
+    }
 }
 
-void ParametricSurface::GenerateLineIndices(vector<unsigned short>& indices) const
+template <typename Index>
+void ParametricSurface::GenerateLines(vector<Index>& indices) const
 {
     indices.resize(GetLineIndexCount());
-    vector<unsigned short>::iterator index = indices.begin();
+    typename vector<Index>::iterator index = indices.begin();
     for (int j = 0, vertex = 0; j < m_slices.y; j++) {
         for (int i = 0; i < m_slices.x; i++) {
             int next = (i + 1) % m_divisions.x;
@@ -94,21 +172,94 @@ void ParametricSurface::GenerateLineIndices(vector<unsigned short>& indices) con
     }
 }
 
-void
-ParametricSurface::GenerateTriangleIndices(vector<unsigned short>& indices) const
+// Converts a distance along a Hilbert curve into grid coordinates.
+static ivec2 HilbertToGrid(int n, int d)
+{
+    ivec2 p(0, 0);
+    for (int s = 1; s < n; s *= 2) {
+        int rx = 1 & (d / 2);
+        int ry = 1 & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                p.x = s - 1 - p.x;
+                p.y = s - 1 - p.y;
+            }
+            std::swap(p.x, p.y);
+        }
+        p.x += s * rx;
+        p.y += s * ry;
+        d /= 4;
+    }
+    return p;
+}
+
+// Columns per band in the tiled order.  Each row of a band shares its upper vertices with
+// the next row, so two rows of a band (2 * (TileWidth + 1) vertices) fit in a 32-entry cache.
+static const int TileWidth = 15;
+
+template <typename Index>
+void ParametricSurface::GenerateTriangles(vector<Index>& indices, IndexOrder order) const
 {
     indices.resize(GetTriangleIndexCount());
-    vector<unsigned short>::iterator index = indices.begin();
-    for (int j = 0, vertex = 0; j < m_slices.y; j++) {
-        for (int i = 0; i < m_slices.x; i++) {
-            int next = (i + 1) % m_divisions.x;
-            *index++ = vertex + i;
-            *index++ = vertex + next;
-            *index++ = vertex + i + m_divisions.x;
-            *index++ = vertex + next;
-            *index++ = vertex + next + m_divisions.x;
-            *index++ = vertex + i + m_divisions.x;
+    typename vector<Index>::iterator index = indices.begin();
+
+    // Visit the quads in the requested order; each quad becomes two triangles.
+    vector<ivec2> quads;
+    quads.reserve(m_slices.x * m_slices.y);
+    if (order == IndexOrderTiled) {
+        for (int band = 0; band < m_slices.x; band += TileWidth) {
+            int bandEnd = std::min(band + TileWidth, m_slices.x);
+            for (int j = 0; j < m_slices.y; j++)
+                for (int i = band; i < bandEnd; i++)
+                    quads.push_back(ivec2(i, j));
         }
-        vertex += m_divisions.x;
+    } else if (order == IndexOrderHilbert) {
+        int n = 1;
+        while (n < m_slices.x || n < m_slices.y)
+            n *= 2;
+        for (int d = 0; d < n * n; d++) {
+            ivec2 quad = HilbertToGrid(n, d);
+            if (quad.x < m_slices.x && quad.y < m_slices.y)
+                quads.push_back(quad);
+        }
+    } else {
+        for (int j = 0; j < m_slices.y; j++)
+            for (int i = 0; i < m_slices.x; i++)
+                quads.push_back(ivec2(i, j));
+    }
+
+    for (vector<ivec2>::const_iterator quad = quads.begin(); quad != quads.end(); ++quad) {
+        int vertex = quad->y * m_divisions.x;
+        int i = quad->x;
+        int next = (i + 1) % m_divisions.x;
+        *index++ = vertex + i;
+        *index++ = vertex + next;
+        *index++ = vertex + i + m_divisions.x;
+        *index++ = vertex + next;
+        *index++ = vertex + next + m_divisions.x;
+        *index++ = vertex + i + m_divisions.x;
     }
 }
+
+void ParametricSurface::GenerateLineIndices(vector<unsigned short>& indices) const
+{
+    assert(GetVertexCount() <= 0x10000 && "Too many vertices for 16-bit indices.");
+    GenerateLines(indices);
+}
+
+void ParametricSurface::GenerateTriangleIndices(vector<unsigned short>& indices) const
+{
+    assert(GetVertexCount() <= 0x10000 && "Too many vertices for 16-bit indices.");
+    GenerateTriangles(indices, IndexOrderRowMajor);
+}
+
+void ParametricSurface::GenerateLineIndices(vector<unsigned int>& indices) const
+{
+    GenerateLines(indices);
+}
+
+void ParametricSurface::GenerateTriangleIndices(vector<unsigned int>& indices,
+                                                IndexOrder order) const
+{
+    GenerateTriangles(indices, order);
+}
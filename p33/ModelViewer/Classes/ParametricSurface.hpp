@@ -6,6 +6,14 @@ struct ParametricInterval {
     vec2 TextureCount;
 };
 
+// Structure-of-arrays storage for a row of points or vectors, so that batched evaluation
+// loops are easy for the compiler to vectorize.
+struct ParametricRow {
+    float* X;
+    float* Y;
+    float* Z;
+};
+
 class ParametricSurface : public ISurface {
 public:
     int GetVertexCount() const;
@@ -14,12 +22,25 @@ public:
     void GenerateVertices(vector<float>& vertices, unsigned char flags) const;
     void GenerateLineIndices(vector<unsigned short>& indices) const;
     void GenerateTriangleIndices(vector<unsigned short>& indices) const;
+    void GenerateLineIndices(vector<unsigned int>& indices) const;
+    void GenerateTriangleIndices(vector<unsigned int>& indices,
+                                 IndexOrder order = IndexOrderRowMajor) const;
+    void SetDivisions(const ivec2& divisions);
+    vec3 Evaluate(const vec2& domain) const;
 protected:
     void SetInterval(const ParametricInterval& interval);
-    virtual vec3 Evaluate(const vec2& domain) const = 0;
+    virtual void EvaluateRow(const float* u, const float* v, int count,
+                             ParametricRow range) const = 0;
+    // Surfaces that know their partial derivatives return true; the rest get normals
+    // from finite differences.
+    virtual bool EvaluatePartials(const float* u, const float* v, int count,
+                                  ParametricRow du, ParametricRow dv) const { return false; }
     virtual bool InvertNormal(const vec2& domain) const { return false; }
 private:
     vec2 ComputeDomain(float i, float j) const;
+    void GenerateRow(int j, unsigned char flags, int floatsPerVertex, float* attribute) const;
+    template <typename Index> void GenerateLines(vector<Index>& indices) const;
+    template <typename Index> void GenerateTriangles(vector<Index>& indices, IndexOrder order) const;
     ivec2 m_slices;
     ivec2 m_divisions;
     vec2 m_upperBound;
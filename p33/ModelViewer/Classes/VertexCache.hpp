@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+
+using std::vector;
+
+// Post-transform vertex cache statistics for an indexed triangle list, simulated with a
+// FIFO cache like most GPUs use.  ACMR is the average number of cache misses per triangle
+// (0.5 is ideal for large regular grids, 3 is the worst case); ATVR is the number of
+// misses per vertex (1 is ideal).
+struct VertexCacheStats {
+    float Acmr;
+    float Atvr;
+};
+
+template <typename Index>
+VertexCacheStats MeasureVertexCache(const vector<Index>& indices, int vertexCount, int cacheSize)
+{
+    // A vertex is in the cache if fewer than cacheSize misses happened since it was loaded.
+    vector<int> loadedAt(vertexCount, -cacheSize - 1);
+    int misses = 0;
+    for (typename vector<Index>::const_iterator i = indices.begin(); i != indices.end(); ++i) {
+        if (misses - loadedAt[*i] > cacheSize) {
+            loadedAt[*i] = misses++;
+        }
+    }
+
+    VertexCacheStats stats;
+    stats.Acmr = indices.empty() ? 0 : (float) misses / (indices.size() / 3);
+    stats.Atvr = vertexCount ? (float) misses / vertexCount : 0;
+    return stats;
+}
@@ -1,5 +1,20 @@
 #include "Platform.h"
+#include "HalfEdgeMesh.h"
 #include <Judy.h>
+#include <stdlib.h>
+
+// ComputeAdjacency builds a throwaway HalfEdgeMesh; callers that need other topology
+// queries should create the mesh themselves and call ComputeAdjacencyFromMesh.
+// The original Judy-based implementation is kept around as ComputeAdjacencyJudy for benchmarking.
+
+void ComputeAdjacency(unsigned int* dest, const unsigned int* source, int faceCount, int vertCount)
+{
+    HalfEdgeMesh mesh = CreateHalfEdgeMesh(source, faceCount, vertCount);
+    if (mesh.BoundaryCount > 0)
+        PezDebugString("Mesh is not watertight.  Contains %d boundary edges.\n", mesh.BoundaryCount);
+    ComputeAdjacencyFromMesh(dest, &mesh);
+    FreeHalfEdgeMesh(&mesh);
+}
 
 // We use a Judy array for vertex-to-edge mapping.
 // See http://judy.sourceforge.net/ for more on Judy arrays.
@@ -19,7 +34,7 @@ typedef struct HalfEdgeRec
     struct HalfEdgeRec* Next; // Next half-edge around the face
 } HalfEdge;
 
-void ComputeAdjacency(unsigned short* dest, const unsigned short* source, int faceCount, int vertCount)
+void ComputeAdjacencyJudy(unsigned short* dest, const unsigned short* source, int faceCount, int vertCount)
 {
     // Allocate all pieces of the half-edge data structure:
     HalfEdge* edges = (HalfEdge*) calloc(faceCount * 3, sizeof(HalfEdge));
@@ -39,19 +54,19 @@ void ComputeAdjacency(unsigned short* dest, const unsigned short* source, int fa
         unsigned short C = *pSrc++;
 
         // Create the half-edge that goes from C to A:
-        JUDY_ADD(edgeTable, C | (A << 16), pEdge);
+        JUDY_ADD(edgeTable, C | ((unsigned long) A << 16), pEdge);
         pEdge->Vert = A;
         pEdge->Next = 1 + pEdge;
         ++pEdge;
 
         // Create the half-edge that goes from A to B:
-        JUDY_ADD(edgeTable, A | (B << 16), pEdge);
+        JUDY_ADD(edgeTable, A | ((unsigned long) B << 16), pEdge);
         pEdge->Vert = B;
         pEdge->Next = 1 + pEdge;
         ++pEdge;
 
         // Create the half-edge that goes from B to C:
-        JUDY_ADD(edgeTable, B | (C << 16), pEdge);
+        JUDY_ADD(edgeTable, B | ((unsigned long) C << 16), pEdge);
         pEdge->Vert = C;
         pEdge->Next = pEdge - 2;
         ++pEdge;
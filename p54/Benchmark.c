@@ -0,0 +1,553 @@
+// Headless benchmarks for ComputeAdjacency versus the original Judy-based implementation,
+// for HalfEdgeMesh traversal versus a pointer-chasing half-edge layout, for OpenCTM
+// loading with single-threaded, multithreaded, and streaming import, for MG2 saving, and
+// for the vertex cache and overdraw optimizer.
+// Usage: Benchmark [file.ctm] [torusSlices]
+
+#include "Platform.h"
+#include "Utility.h"
+#include "HalfEdgeMesh.h"
+#include "MeshOptimizer.h"
+#include <openctm.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+static double GetSeconds()
+{
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+}
+#else
+#include <sys/time.h>
+static double GetSeconds()
+{
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    return tp.tv_sec + tp.tv_usec * 0.000001;
+}
+#endif
+
+// The benchmark doesn't link against a Pez platform layer, so it provides its own:
+
+void PezDebugString(const char* pStr, ...)
+{
+    va_list a;
+    va_start(a, pStr);
+    vfprintf(stderr, pStr, a);
+    va_end(a);
+}
+
+void PezCheckCondition(int condition, ...)
+{
+    va_list a;
+    const char* pStr;
+
+    if (condition)
+        return;
+
+    va_start(a, condition);
+    pStr = va_arg(a, const char*);
+    vfprintf(stderr, pStr, a);
+    fputs("\n", stderr);
+    exit(1);
+}
+
+// Closed torus with slices*slices*2 triangles; useful for meshes too big for the Judy path.
+static unsigned int* CreateTorusFaces(int slices, int* faceCount)
+{
+    unsigned int* faces = (unsigned int*) malloc(slices * slices * 6 * sizeof(unsigned int));
+    unsigned int* pFace = faces;
+    for (int i = 0; i < slices; ++i)
+    {
+        for (int j = 0; j < slices; ++j)
+        {
+            unsigned int a = i * slices + j;
+            unsigned int b = i * slices + (j + 1) % slices;
+            unsigned int c = ((i + 1) % slices) * slices + j;
+            unsigned int d = ((i + 1) % slices) * slices + (j + 1) % slices;
+            *pFace++ = a; *pFace++ = b; *pFace++ = d;
+            *pFace++ = d; *pFace++ = c; *pFace++ = a;
+        }
+    }
+    *faceCount = slices * slices * 2;
+    return faces;
+}
+
+static void RunBenchmark(const char* name, const unsigned int* faces, int faceCount, int vertCount)
+{
+    const int Iterations = 10;
+    unsigned int* dest = (unsigned int*) malloc(faceCount * 6 * sizeof(unsigned int));
+
+    double start = GetSeconds();
+    for (int i = 0; i < Iterations; ++i)
+        ComputeAdjacency(dest, faces, faceCount, vertCount);
+    double hashTime = (GetSeconds() - start) / Iterations;
+    printf("%-24s %9d faces  hash: %8.2f ms", name, faceCount, hashTime * 1000.0);
+
+    if (vertCount < (1 << 16))
+    {
+        unsigned short* shortFaces = (unsigned short*) malloc(faceCount * 3 * sizeof(unsigned short));
+        unsigned short* shortDest = (unsigned short*) malloc(faceCount * 6 * sizeof(unsigned short));
+        for (int i = 0; i < faceCount * 3; ++i)
+            shortFaces[i] = (unsigned short) faces[i];
+
+        start = GetSeconds();
+        for (int i = 0; i < Iterations; ++i)
+            ComputeAdjacencyJudy(shortDest, shortFaces, faceCount, vertCount);
+        double judyTime = (GetSeconds() - start) / Iterations;
+
+        int mismatches = 0;
+        for (int i = 0; i < faceCount * 6; ++i)
+            mismatches += (dest[i] != shortDest[i]);
+
+        printf("  judy: %8.2f ms  speedup: %5.1fx  %s", judyTime * 1000.0, judyTime / hashTime,
+            mismatches ? "MISMATCH" : "identical");
+
+        free(shortFaces);
+        free(shortDest);
+    }
+
+    printf("\n");
+    free(dest);
+}
+
+// The layout that ComputeAdjacencyJudy uses, with an extra per-vertex table for one-rings.
+typedef struct PointerEdgeRec
+{
+    unsigned int Vert;
+    struct PointerEdgeRec* Twin;
+    struct PointerEdgeRec* Next;
+} PointerEdge;
+
+static void RunTraversalBenchmark(const char* name, const unsigned int* faces, int faceCount, int vertCount)
+{
+    const int Iterations = 10;
+
+    double start = GetSeconds();
+    HalfEdgeMesh mesh = CreateHalfEdgeMesh(faces, faceCount, vertCount);
+    double buildTime = GetSeconds() - start;
+
+    PointerEdge* edges = (PointerEdge*) calloc(faceCount * 3, sizeof(PointerEdge));
+    PointerEdge** vertEdges = (PointerEdge**) calloc(vertCount, sizeof(PointerEdge*));
+    for (int edge = 0; edge < faceCount * 3; ++edge)
+    {
+        edges[edge].Vert = faces[edge];
+        edges[edge].Next = edges + HE_NEXT(edge);
+        edges[edge].Twin = mesh.Twins[edge] == HE_NONE ? 0 : edges + mesh.Twins[edge];
+    }
+    for (int vert = 0; vert < vertCount; ++vert)
+        vertEdges[vert] = mesh.VertEdges[vert] == HE_NONE ? 0 : edges + mesh.VertEdges[vert];
+
+    // Visit every vertex's one-ring and checksum the neighbors:
+    unsigned long long indexSum = 0;
+    long long visited = 0;
+    start = GetSeconds();
+    for (int i = 0; i < Iterations; ++i)
+    {
+        for (int vert = 0; vert < vertCount; ++vert)
+        {
+            HalfEdgeIterator it;
+            for (it = HeOneRing(&mesh, vert); it.Edge != HE_NONE; HeNextOneRing(&mesh, &it))
+            {
+                indexSum += mesh.Verts[it.Edge];
+                ++visited;
+            }
+        }
+    }
+    double indexTime = GetSeconds() - start;
+
+    unsigned long long pointerSum = 0;
+    start = GetSeconds();
+    for (int i = 0; i < Iterations; ++i)
+    {
+        for (int vert = 0; vert < vertCount; ++vert)
+        {
+            PointerEdge* first = vertEdges[vert];
+            PointerEdge* edge = first;
+            while (edge)
+            {
+                pointerSum += edge->Vert;
+                edge = edge->Next->Next->Twin;
+                if (edge == first)
+                    break;
+            }
+        }
+    }
+    double pointerTime = GetSeconds() - start;
+
+    printf("%-24s build: %8.2f ms  one-ring: %7.1f M edges/s (index)  %7.1f M edges/s (pointer)  %s\n",
+        name, buildTime * 1000.0,
+        visited / indexTime * 0.000001, visited / pointerTime * 0.000001,
+        indexSum == pointerSum ? "identical" : "MISMATCH");
+
+    free(vertEdges);
+    free(edges);
+    FreeHalfEdgeMesh(&mesh);
+}
+
+typedef struct StreamingLoadRec
+{
+    double StartTime;
+    double FirstArrayTime;
+    int ChunkCount;
+    void* Arrays[3];
+    CTMenum Types[3];
+    CTMuint Sizes[3];
+    int ArrayCount;
+} StreamingLoad;
+
+static void* CTMCALL MapArray(CTMenum array, CTMuint size, void* userData)
+{
+    StreamingLoad* load = (StreamingLoad*) userData;
+    load->Types[load->ArrayCount] = array;
+    load->Sizes[load->ArrayCount] = size;
+    return load->Arrays[load->ArrayCount++] = malloc(size);
+}
+
+static void CTMCALL OnProgress(CTMenum array, CTMuint bytesRead, void* userData)
+{
+    StreamingLoad* load = (StreamingLoad*) userData;
+    if (array == CTM_NONE)
+        ++load->ChunkCount;
+    else if (load->FirstArrayTime == 0)
+        load->FirstArrayTime = GetSeconds() - load->StartTime;
+}
+
+// Checks that the streamed arrays hold exactly what a normal load of the same file returns:
+static int SameAsLoaded(const StreamingLoad* load, CTMcontext loaded)
+{
+    int expected = ctmGetInteger(loaded, CTM_HAS_NORMALS) ? 3 : 2;
+    if (load->ArrayCount != expected)
+        return 0;
+    for (int a = 0; a < load->ArrayCount; ++a)
+    {
+        const void* array = load->Types[a] == CTM_INDICES ?
+            (const void*) ctmGetIntegerArray(loaded, CTM_INDICES) :
+            (const void*) ctmGetFloatArray(loaded, load->Types[a]);
+        if (!array || memcmp(array, load->Arrays[a], load->Sizes[a]))
+            return 0;
+    }
+    return 1;
+}
+
+static int SameFloats(CTMcontext a, CTMcontext b, CTMenum array, int count)
+{
+    const CTMfloat* x = ctmGetFloatArray(a, array);
+    const CTMfloat* y = ctmGetFloatArray(b, array);
+    return x && y && !memcmp(x, y, count * sizeof(CTMfloat));
+}
+
+// Checks that two loads of the same file decoded to the same indices, vertices, normals, and UVs:
+static int SameMesh(CTMcontext a, CTMcontext b)
+{
+    int faceCount = ctmGetInteger(a, CTM_TRIANGLE_COUNT);
+    int vertCount = ctmGetInteger(a, CTM_VERTEX_COUNT);
+    int uvMapCount = ctmGetInteger(a, CTM_UV_MAP_COUNT);
+    if (faceCount != ctmGetInteger(b, CTM_TRIANGLE_COUNT) || vertCount != ctmGetInteger(b, CTM_VERTEX_COUNT) ||
+        uvMapCount != ctmGetInteger(b, CTM_UV_MAP_COUNT) ||
+        ctmGetInteger(a, CTM_HAS_NORMALS) != ctmGetInteger(b, CTM_HAS_NORMALS))
+        return 0;
+    if (memcmp(ctmGetIntegerArray(a, CTM_INDICES), ctmGetIntegerArray(b, CTM_INDICES), faceCount * 3 * sizeof(CTMuint)))
+        return 0;
+    if (!SameFloats(a, b, CTM_VERTICES, vertCount * 3))
+        return 0;
+    if (ctmGetInteger(a, CTM_HAS_NORMALS) && !SameFloats(a, b, CTM_NORMALS, vertCount * 3))
+        return 0;
+    for (int i = 0; i < uvMapCount; ++i)
+        if (!SameFloats(a, b, (CTMenum) (CTM_UV_MAP_1 + i), vertCount * 2))
+            return 0;
+    return 1;
+}
+
+static CTMcontext LoadMesh(const char* ctmFile, int decodeThreads)
+{
+    CTMcontext ctmContext = ctmNewContext(CTM_IMPORT);
+    ctmDecodeThreads(ctmContext, decodeThreads);
+    ctmLoad(ctmContext, ctmFile);
+    PezCheckCondition(ctmGetError(ctmContext) == CTM_NONE, "OpenCTM issue with loading %s", ctmFile);
+    return ctmContext;
+}
+
+static double TimeLoad(const char* ctmFile, int decodeThreads, int iterations)
+{
+    double start = GetSeconds();
+    for (int i = 0; i < iterations; ++i)
+        ctmFreeContext(LoadMesh(ctmFile, decodeThreads));
+    return (GetSeconds() - start) / iterations;
+}
+
+// Returns 0 if the threaded or streamed arrays differ from a single-threaded load.
+static int RunLoadBenchmark(const char* ctmFile)
+{
+    const int Iterations = 10;
+
+    FILE* file = fopen(ctmFile, "rb");
+    if (!file)
+    {
+        printf("%-32s not found\n", ctmFile);
+        return 1;
+    }
+    fclose(file);
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    double loadTime = TimeLoad(ctmFile, 1, Iterations);
+    double threadedTime = TimeLoad(ctmFile, threadCount, Iterations);
+
+    CTMcontext loaded = LoadMesh(ctmFile, 1);
+    CTMcontext threaded = LoadMesh(ctmFile, threadCount);
+    int threadedSame = SameMesh(loaded, threaded);
+    ctmFreeContext(threaded);
+
+    double streamTime = 0, firstArrayTime = 0;
+    int chunkCount = 0, streamedSame = 1;
+    for (int i = 0; i < Iterations; ++i)
+    {
+        StreamingLoad load = {0};
+        load.StartTime = GetSeconds();
+        CTMcontext ctmContext = ctmNewContext(CTM_IMPORT);
+        ctmStreamingImport(ctmContext, MapArray, OnProgress, &load);
+        ctmLoad(ctmContext, ctmFile);
+        PezCheckCondition(ctmGetError(ctmContext) == CTM_NONE, "OpenCTM issue with loading %s", ctmFile);
+        ctmFreeContext(ctmContext);
+        streamTime += GetSeconds() - load.StartTime;
+        firstArrayTime += load.FirstArrayTime;
+        chunkCount = load.ChunkCount;
+        streamedSame = SameAsLoaded(&load, loaded) && streamedSame;
+        for (int a = 0; a < load.ArrayCount; ++a)
+            free(load.Arrays[a]);
+    }
+    streamTime /= Iterations;
+    firstArrayTime /= Iterations;
+    ctmFreeContext(loaded);
+
+    printf("%-32s load: %7.2f ms  %2d threads: %7.2f ms (%4.1fx, %s)  streaming: %7.2f ms  first array: %7.2f ms  (%d chunks, %s)\n",
+        ctmFile, loadTime * 1000.0, threadCount, threadedTime * 1000.0, loadTime / threadedTime,
+        threadedSame ? "identical" : "MISMATCH",
+        streamTime * 1000.0, firstArrayTime * 1000.0, chunkCount, streamedSame ? "identical" : "MISMATCH");
+    return threadedSame && streamedSame;
+}
+
+// Counts and checksums the compressed bytes instead of writing them to disk.
+typedef struct SaveStreamRec
+{
+    CTMuint Size;
+    unsigned int Hash;
+} SaveStream;
+
+static CTMuint CTMCALL WriteStream(const void* buf, CTMuint count, void* userData)
+{
+    SaveStream* stream = (SaveStream*) userData;
+    const unsigned char* bytes = (const unsigned char*) buf;
+    for (CTMuint i = 0; i < count; ++i)
+        stream->Hash = (stream->Hash ^ bytes[i]) * 16777619u;
+    stream->Size += count;
+    return count;
+}
+
+static double TimeSave(CTMcontext mesh, int compressionThreads, CTMenum preset, int iterations, SaveStream* stream)
+{
+    const CTMfloat* normals = ctmGetInteger(mesh, CTM_HAS_NORMALS) ? ctmGetFloatArray(mesh, CTM_NORMALS) : 0;
+    double start = GetSeconds();
+    for (int i = 0; i < iterations; ++i)
+    {
+        CTMcontext ctmContext = ctmNewContext(CTM_EXPORT);
+        ctmDefineMesh(ctmContext,
+            ctmGetFloatArray(mesh, CTM_VERTICES), ctmGetInteger(mesh, CTM_VERTEX_COUNT),
+            ctmGetIntegerArray(mesh, CTM_INDICES), ctmGetInteger(mesh, CTM_TRIANGLE_COUNT),
+            normals);
+        ctmCompressionMethod(ctmContext, CTM_METHOD_MG2);
+        ctmCompressionThreads(ctmContext, compressionThreads);
+        ctmCompressionPreset(ctmContext, preset);
+        stream->Size = 0;
+        stream->Hash = 2166136261u;
+        ctmSaveCustom(ctmContext, WriteStream, stream);
+        PezCheckCondition(ctmGetError(ctmContext) == CTM_NONE, "OpenCTM issue with saving");
+        ctmFreeContext(ctmContext);
+    }
+    return (GetSeconds() - start) / iterations;
+}
+
+static void RunSaveBenchmark(const char* ctmFile)
+{
+    const int Iterations = 3;
+
+    FILE* file = fopen(ctmFile, "rb");
+    if (!file)
+    {
+        printf("%-32s not found\n", ctmFile);
+        return;
+    }
+    fclose(file);
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    CTMcontext mesh = ctmNewContext(CTM_IMPORT);
+    ctmLoad(mesh, ctmFile);
+    PezCheckCondition(ctmGetError(mesh) == CTM_NONE, "OpenCTM issue with loading %s", ctmFile);
+
+    // Throughput is measured against the size of the uncompressed mesh arrays:
+    double megabytes = (ctmGetInteger(mesh, CTM_VERTEX_COUNT) * (ctmGetInteger(mesh, CTM_HAS_NORMALS) ? 6 : 3) +
+        ctmGetInteger(mesh, CTM_TRIANGLE_COUNT) * 3) * 4.0 / (1024.0 * 1024.0);
+
+    SaveStream single, threaded, fast;
+    double saveTime = TimeSave(mesh, 1, CTM_PRESET_DEFAULT, Iterations, &single);
+    double threadedTime = TimeSave(mesh, threadCount, CTM_PRESET_DEFAULT, Iterations, &threaded);
+    double fastTime = TimeSave(mesh, threadCount, CTM_PRESET_FAST, Iterations, &fast);
+    ctmFreeContext(mesh);
+
+    printf("%-32s save: %6.1f MB/s  %2d threads: %6.1f MB/s (%4.1fx) %s  fast: %6.1f MB/s  size: %d / %d bytes\n",
+        ctmFile, megabytes / saveTime, threadCount, megabytes / threadedTime, saveTime / threadedTime,
+        single.Size == threaded.Size && single.Hash == threaded.Hash ? "identical" : "MISMATCH",
+        megabytes / fastTime, (int) single.Size, (int) fast.Size);
+}
+
+// Order-independent checksum of a triangle list, invariant to rotating each triangle's corners.
+static unsigned long long HashFaceSet(const unsigned int* indices, int faceCount, const unsigned int* vertIds)
+{
+    unsigned long long sum = 0;
+    for (int face = 0; face < faceCount; ++face)
+    {
+        unsigned int v[3];
+        for (int k = 0; k < 3; ++k)
+            v[k] = vertIds ? vertIds[indices[face * 3 + k]] : indices[face * 3 + k];
+        int first = (v[0] < v[1] && v[0] < v[2]) ? 0 : (v[1] < v[2] ? 1 : 2);
+        unsigned long long hash = 1469598103934665603ULL;
+        for (int k = 0; k < 3; ++k)
+            hash = (hash ^ v[(first + k) % 3]) * 1099511628211ULL;
+        sum += hash ^ (hash >> 29);
+    }
+    return sum;
+}
+
+static void RunOptimizerBenchmark(const char* ctmFile)
+{
+    const int CacheSize = 16;
+
+    FILE* file = fopen(ctmFile, "rb");
+    if (!file)
+    {
+        printf("%-32s not found\n", ctmFile);
+        return;
+    }
+    fclose(file);
+
+    CTMcontext ctmContext = ctmNewContext(CTM_IMPORT);
+    ctmLoad(ctmContext, ctmFile);
+    PezCheckCondition(ctmGetError(ctmContext) == CTM_NONE, "OpenCTM issue with loading %s", ctmFile);
+    const CTMuint* indices = ctmGetIntegerArray(ctmContext, CTM_INDICES);
+    const CTMfloat* positions = ctmGetFloatArray(ctmContext, CTM_VERTICES);
+    int faceCount = ctmGetInteger(ctmContext, CTM_TRIANGLE_COUNT);
+    int vertCount = ctmGetInteger(ctmContext, CTM_VERTEX_COUNT);
+
+    unsigned int* cacheOnly = (unsigned int*) malloc(faceCount * 3 * sizeof(unsigned int));
+    unsigned int* optimized = (unsigned int*) malloc(faceCount * 3 * sizeof(unsigned int));
+    unsigned int* remap = (unsigned int*) malloc(vertCount * sizeof(unsigned int));
+    unsigned int* original = (unsigned int*) malloc(vertCount * sizeof(unsigned int));
+    memcpy(cacheOnly, indices, faceCount * 3 * sizeof(unsigned int));
+    memcpy(optimized, indices, faceCount * 3 * sizeof(unsigned int));
+
+    double start = GetSeconds();
+    OptimizeFaceOrder(cacheOnly, faceCount, vertCount, CacheSize, 0);
+    double cacheTime = GetSeconds() - start;
+
+    start = GetSeconds();
+    OptimizeFaceOrder(optimized, faceCount, vertCount, CacheSize, positions);
+    double overdrawTime = GetSeconds() - start;
+
+    start = GetSeconds();
+    OptimizeVertexFetch(remap, optimized, faceCount, vertCount);
+    double fetchTime = GetSeconds() - start;
+
+    // Undo the renumbering to check that the same triangles come out:
+    for (int vert = 0; vert < vertCount; ++vert)
+        original[remap[vert]] = vert;
+    unsigned long long hash = HashFaceSet(indices, faceCount, 0);
+    int identical = hash == HashFaceSet(cacheOnly, faceCount, 0) && hash == HashFaceSet(optimized, faceCount, original);
+
+    printf("%-32s tipsify: %6.2f ms  +overdraw: %6.2f ms  +fetch: %5.2f ms  %s\n",
+        ctmFile, cacheTime * 1000.0, overdrawTime * 1000.0, fetchTime * 1000.0,
+        identical ? "identical" : "MISMATCH");
+
+    int cacheSizes[] = { 16, 32 };
+    for (int i = 0; i < (int) countof(cacheSizes); ++i)
+    {
+        VertexCacheStats before = MeasureVertexCache(indices, faceCount, vertCount, cacheSizes[i]);
+        VertexCacheStats tipsify = MeasureVertexCache(cacheOnly, faceCount, vertCount, cacheSizes[i]);
+        VertexCacheStats after = MeasureVertexCache(optimized, faceCount, vertCount, cacheSizes[i]);
+        printf("    FIFO %2d  ACMR: %5.3f -> %5.3f (%5.3f with overdraw)  ATVR: %5.3f -> %5.3f (%5.3f with overdraw)\n",
+            cacheSizes[i], before.Acmr, tipsify.Acmr, after.Acmr, before.Atvr, tipsify.Atvr, after.Atvr);
+    }
+
+    free(original);
+    free(remap);
+    free(optimized);
+    free(cacheOnly);
+    ctmFreeContext(ctmContext);
+}
+
+int main(int argc, char** argv)
+{
+    const char* ctmFile = argc > 1 ? argv[1] : "../ChineseDragon.ctm";
+    int torusSlices = argc > 2 ? atoi(argv[2]) : 1024;
+
+    CTMcontext ctmContext = ctmNewContext(CTM_IMPORT);
+    ctmLoad(ctmContext, ctmFile);
+    PezCheckCondition(ctmGetError(ctmContext) == CTM_NONE, "OpenCTM issue with loading %s", ctmFile);
+    const CTMuint* indices = ctmGetIntegerArray(ctmContext, CTM_INDICES);
+    int faceCount = ctmGetInteger(ctmContext, CTM_TRIANGLE_COUNT);
+    int vertCount = ctmGetInteger(ctmContext, CTM_VERTEX_COUNT);
+    RunBenchmark(ctmFile, indices, faceCount, vertCount);
+    RunTraversalBenchmark(ctmFile, indices, faceCount, vertCount);
+    ctmFreeContext(ctmContext);
+
+    int slices[] = { 64, 128, torusSlices };
+    for (int i = 0; i < (int) countof(slices); ++i)
+    {
+        char name[32];
+        int faceCount;
+        unsigned int* faces = CreateTorusFaces(slices[i], &faceCount);
+        sprintf(name, "torus %dx%d", slices[i], slices[i]);
+        RunBenchmark(name, faces, faceCount, slices[i] * slices[i]);
+        RunTraversalBenchmark(name, faces, faceCount, slices[i] * slices[i]);
+        free(faces);
+    }
+
+    // Load and save times for the meshes that ship with the other demos (run from the build folder):
+    const char* assets[] = {
+        ctmFile,
+        "../../p35/HeadlessGiant.ctm",
+        "../../p51/buddha.ctm",
+        "../../p56/demo/Dolphin.ctm",
+        "../../p56/demo/Squid.ctm",
+        "../../p56/demo/Tuna.ctm",
+    };
+    int loadsSame = 1;
+    for (int i = 0; i < (int) countof(assets); ++i)
+        loadsSame = RunLoadBenchmark(assets[i]) && loadsSame;
+    for (int i = 0; i < (int) countof(assets); ++i)
+        RunSaveBenchmark(assets[i]);
+
+    RunOptimizerBenchmark(ctmFile);
+    RunOptimizerBenchmark("../../p51/buddha.ctm");
+
+    return loadsSame ? 0 : 1;
+}
@@ -1,9 +1,15 @@
 #include "Platform.h"
 #include "Utility.h"
+#include "HalfEdgeMesh.h"
+#include "MeshOptimizer.h"
 #include <openctm.h>
 #include <string.h>
 #include <malloc.h>
 
+// Triangles are ordered for a small post-transform cache; Tipsify orderings degrade gracefully
+// on larger caches, but not the other way around.
+#define VERTEX_CACHE_SIZE 16
+
 Mesh CreateQuad()
 {
     Mesh mesh = {0};
@@ -37,15 +43,57 @@ Mesh CreateMesh(const char* ctmFile, bool computeAdjacency)
     strcat(qualifiedPath, "/\0");
     strcat(qualifiedPath, ctmFile);
     
-    // Open the CTM file:
+    // Open the CTM file.  Every mesh gets reordered below, so it's decoded into OpenCTM's own
+    // arrays rather than streamed into buffers:
     CTMcontext ctmContext = ctmNewContext(CTM_IMPORT);
     ctmLoad(ctmContext, qualifiedPath);
     PezCheckCondition(ctmGetError(ctmContext) == CTM_NONE, "OpenCTM issue with loading %s", qualifiedPath);
     CTMuint vertexCount = ctmGetInteger(ctmContext, CTM_VERTEX_COUNT);
     CTMuint faceCount = ctmGetInteger(ctmContext, CTM_TRIANGLE_COUNT);
+    const CTMuint* indices = ctmGetIntegerArray(ctmContext, CTM_INDICES);
+    const CTMfloat* positions = ctmGetFloatArray(ctmContext, CTM_VERTICES);
+    const CTMfloat* normals = ctmGetFloatArray(ctmContext, CTM_NORMALS);
+
+    // Reorder faces for the post-transform cache and overdraw, then vertices for fetch locality.
+    // OpenCTM's arrays stay untouched; the reordered ones are our own copies.
+    unsigned int* optimized = 0;
+    float* optimizedPositions = 0;
+    float* optimizedNormals = 0;
+    if (indices && positions) {
+        VertexCacheStats before = MeasureVertexCache(indices, faceCount, vertexCount, VERTEX_CACHE_SIZE);
+        optimized = (unsigned int*) malloc(faceCount * 3 * sizeof(unsigned int));
+        memcpy(optimized, indices, faceCount * 3 * sizeof(unsigned int));
+        OptimizeFaceOrder(optimized, faceCount, vertexCount, VERTEX_CACHE_SIZE, positions);
+
+        unsigned int* remap = (unsigned int*) malloc(vertexCount * sizeof(unsigned int));
+        OptimizeVertexFetch(remap, optimized, faceCount, vertexCount);
+        optimizedPositions = (float*) malloc(vertexCount * 3 * sizeof(float));
+        RemapVertexArray(optimizedPositions, positions, 3, remap, vertexCount);
+        if (normals) {
+            optimizedNormals = (float*) malloc(vertexCount * 3 * sizeof(float));
+            RemapVertexArray(optimizedNormals, normals, 3, remap, vertexCount);
+        }
+        free(remap);
+
+        VertexCacheStats after = MeasureVertexCache(optimized, faceCount, vertexCount, VERTEX_CACHE_SIZE);
+        PezDebugString("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", ctmFile,
+            before.Acmr, after.Acmr, before.Atvr, after.Atvr);
+        indices = optimized;
+        positions = optimizedPositions;
+        normals = optimizedNormals;
+    }
+
+    // Build the half-edge structure once; it's shared by normal smoothing and adjacency:
+    HalfEdgeMesh halfEdges = {0};
+    bool smoothNormals = !normals && positions && indices;
+    if (indices && (computeAdjacency || smoothNormals))
+    {
+        halfEdges = CreateHalfEdgeMesh(indices, faceCount, vertexCount);
+        if (halfEdges.BoundaryCount > 0)
+            PezDebugString("Mesh is not watertight.  Contains %d boundary edges.\n", halfEdges.BoundaryCount);
+    }
 
     // Create the VBO for positions:
-    const CTMfloat* positions = ctmGetFloatArray(ctmContext, CTM_VERTICES);
     if (positions) {
         GLuint handle;
         GLsizeiptr size = vertexCount * sizeof(float) * 3;
@@ -55,8 +103,13 @@ Mesh CreateMesh(const char* ctmFile, bool computeAdjacency)
         mesh.Positions = handle;
     }
     
-    // Create the VBO for normals:
-    const CTMfloat* normals = ctmGetFloatArray(ctmContext, CTM_NORMALS);
+    // Create the VBO for normals, smoothing them ourselves if the file doesn't have any:
+    float* smoothed = 0;
+    if (smoothNormals) {
+        smoothed = (float*) malloc(vertexCount * sizeof(float) * 3);
+        ComputeSmoothNormals(smoothed, positions, &halfEdges);
+        normals = smoothed;
+    }
     if (normals) {
         GLuint handle;
         GLsizeiptr size = vertexCount * sizeof(float) * 3;
@@ -65,33 +118,23 @@ Mesh CreateMesh(const char* ctmFile, bool computeAdjacency)
         glBufferData(GL_ARRAY_BUFFER, size, normals, GL_STATIC_DRAW);
         mesh.Normals = handle;
     }
+    free(smoothed);
+    free(optimizedPositions);
+    free(optimizedNormals);
     
     // Create the VBO for indices:
-    const CTMuint* indices = ctmGetIntegerArray(ctmContext, CTM_INDICES);
     if (indices) {
         
-        GLsizeiptr bufferSize = faceCount * 3 * sizeof(unsigned short);
-        
-        // Convert indices from 32-bit to 16-bit:
-        PezCheckCondition(vertexCount < (1 << 16), "Too many indices to fit in 16 bits");
-        unsigned short* faceBuffer = (unsigned short*) malloc(bufferSize);
-        unsigned short* pDest = faceBuffer;
-        const CTMuint* pSrc = indices;
-        unsigned int remainingFaces = faceCount;
-        while (remainingFaces--)
-        {
-            *pDest++ = (unsigned short) *pSrc++;
-            *pDest++ = (unsigned short) *pSrc++;
-            *pDest++ = (unsigned short) *pSrc++;
-        }
+        GLsizeiptr bufferSize = faceCount * 3 * sizeof(unsigned int);
+        const unsigned int* faceBuffer = indices;
+        unsigned int* destBuffer = 0;
 
         // Compute adjacency if desired:
         if (computeAdjacency)
         {
-            bufferSize = faceCount * 6 * sizeof(unsigned short);
-            unsigned short* destBuffer = (unsigned short*) malloc(bufferSize);
-            ComputeAdjacency(destBuffer, faceBuffer, faceCount, vertexCount);
-            free(faceBuffer);
+            bufferSize = faceCount * 6 * sizeof(unsigned int);
+            destBuffer = (unsigned int*) malloc(bufferSize);
+            ComputeAdjacencyFromMesh(destBuffer, &halfEdges);
             faceBuffer = destBuffer;
         }
         
@@ -101,9 +144,11 @@ Mesh CreateMesh(const char* ctmFile, bool computeAdjacency)
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, bufferSize, faceBuffer, GL_STATIC_DRAW);
         mesh.Faces = handle;
         
-        free(faceBuffer);
+        free(destBuffer);
     }
     
+    FreeHalfEdgeMesh(&halfEdges);
+    free(optimized);
     ctmFreeContext(ctmContext);
 
     mesh.FaceCount = faceCount;
@@ -0,0 +1,283 @@
+#include "Platform.h"
+#include "HalfEdgeMesh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Twins are found with an open-addressing hash table keyed on (origin, end) vertex pairs.
+// Half-edges are first bucketed into partitions (by the high bits of their hash) so that
+// each partition can be filled by a separate thread without any locks or atomics.
+
+#define PARTITION_BITS  8
+#define PARTITION_COUNT (1 << PARTITION_BITS)
+#define CHUNK_COUNT     64
+
+#define EDGE_KEY(FROM, TO) (((unsigned long long) (FROM) << 32) | (TO))
+
+static unsigned long long HashEdgeKey(unsigned long long key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+typedef struct EdgeTableRec
+{
+    unsigned long long* Keys;    // Packed vertex pairs, one per slot
+    unsigned int* Edges;         // Half-edge index, or HE_NONE
+    unsigned int* Offsets;       // First slot of each partition; partition sizes are powers of two
+} EdgeTable;
+
+static unsigned int FindEdge(const EdgeTable* table, unsigned long long key)
+{
+    unsigned long long hash = HashEdgeKey(key);
+    unsigned int partition = (unsigned int) (hash >> (64 - PARTITION_BITS));
+    unsigned int first = table->Offsets[partition];
+    unsigned int mask = table->Offsets[partition + 1] - first - 1;
+    if (mask == HE_NONE)
+        return HE_NONE;
+
+    unsigned int slot = (unsigned int) hash & mask;
+    while (table->Edges[first + slot] != HE_NONE)
+    {
+        if (table->Keys[first + slot] == key)
+            return table->Edges[first + slot];
+        slot = (slot + 1) & mask;
+    }
+    return HE_NONE;
+}
+
+HalfEdgeMesh CreateHalfEdgeMesh(const unsigned int* faces, int faceCount, int vertCount)
+{
+    const unsigned int* source = faces;
+    const int edgeCount = faceCount * 3;
+    const int chunkSize = (edgeCount + CHUNK_COUNT - 1) / CHUNK_COUNT;
+
+    // Each chunk of half-edges counts how many of its edges land in each partition:
+    unsigned int* counts = (unsigned int*) calloc(CHUNK_COUNT * PARTITION_COUNT, sizeof(unsigned int));
+    unsigned char* partitions = (unsigned char*) malloc(edgeCount);
+
+    #pragma omp parallel for
+    for (int chunk = 0; chunk < CHUNK_COUNT; ++chunk)
+    {
+        unsigned int* pCount = counts + chunk * PARTITION_COUNT;
+        int end = (chunk + 1) * chunkSize < edgeCount ? (chunk + 1) * chunkSize : edgeCount;
+        for (int edge = chunk * chunkSize; edge < end; ++edge)
+        {
+            unsigned long long key = EDGE_KEY(source[HE_PREV(edge)], source[edge]);
+            unsigned char partition = (unsigned char) (HashEdgeKey(key) >> (64 - PARTITION_BITS));
+            partitions[edge] = partition;
+            ++pCount[partition];
+        }
+    }
+
+    // Prefix-sum the counts so every (partition, chunk) pair knows where to scatter:
+    unsigned int offsets[PARTITION_COUNT + 1];
+    unsigned int total = 0;
+    for (int partition = 0; partition < PARTITION_COUNT; ++partition)
+    {
+        offsets[partition] = total;
+        for (int chunk = 0; chunk < CHUNK_COUNT; ++chunk)
+        {
+            unsigned int count = counts[chunk * PARTITION_COUNT + partition];
+            counts[chunk * PARTITION_COUNT + partition] = total;
+            total += count;
+        }
+    }
+    offsets[PARTITION_COUNT] = total;
+
+    unsigned int* bucketed = (unsigned int*) malloc(edgeCount * sizeof(unsigned int));
+
+    #pragma omp parallel for
+    for (int chunk = 0; chunk < CHUNK_COUNT; ++chunk)
+    {
+        unsigned int* pCursor = counts + chunk * PARTITION_COUNT;
+        int end = (chunk + 1) * chunkSize < edgeCount ? (chunk + 1) * chunkSize : edgeCount;
+        for (int edge = chunk * chunkSize; edge < end; ++edge)
+            bucketed[pCursor[partitions[edge]]++] = edge;
+    }
+
+    free(partitions);
+    free(counts);
+
+    // Each partition gets at least twice as many slots as it has edges, rounded up to a power of two:
+    EdgeTable table;
+    unsigned int slotOffsets[PARTITION_COUNT + 1];
+    unsigned int slotCount = 0;
+    for (int partition = 0; partition < PARTITION_COUNT; ++partition)
+    {
+        unsigned int count = offsets[partition + 1] - offsets[partition];
+        unsigned int size = count ? 1 : 0;
+        while (size < count * 2)
+            size <<= 1;
+        slotOffsets[partition] = slotCount;
+        slotCount += size;
+    }
+    slotOffsets[PARTITION_COUNT] = slotCount;
+    table.Offsets = slotOffsets;
+    table.Keys = (unsigned long long*) malloc(slotCount * sizeof(unsigned long long));
+    table.Edges = (unsigned int*) malloc(slotCount * sizeof(unsigned int));
+    memset(table.Edges, 0xff, slotCount * sizeof(unsigned int));
+
+    // Fill the hash table one partition per thread:
+    int duplicateCount = 0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:duplicateCount)
+    for (int partition = 0; partition < PARTITION_COUNT; ++partition)
+    {
+        unsigned int first = slotOffsets[partition];
+        unsigned int mask = slotOffsets[partition + 1] - first - 1;
+        for (unsigned int i = offsets[partition]; i < offsets[partition + 1]; ++i)
+        {
+            unsigned int edge = bucketed[i];
+            unsigned long long key = EDGE_KEY(source[HE_PREV(edge)], source[edge]);
+            unsigned int slot = (unsigned int) HashEdgeKey(key) & mask;
+            while (table.Edges[first + slot] != HE_NONE && table.Keys[first + slot] != key)
+                slot = (slot + 1) & mask;
+            if (table.Edges[first + slot] != HE_NONE)
+            {
+                ++duplicateCount;
+                continue;
+            }
+            table.Keys[first + slot] = key;
+            table.Edges[first + slot] = edge;
+        }
+    }
+
+    free(bucketed);
+
+    // Verify that the mesh is clean:
+    PezCheckCondition(duplicateCount == 0, "Bad mesh: duplicated edges or inconsistent winding.");
+
+    HalfEdgeMesh mesh;
+    mesh.FaceCount = faceCount;
+    mesh.VertexCount = vertCount;
+    mesh.Verts = faces;
+    mesh.Twins = (unsigned int*) malloc(edgeCount * sizeof(unsigned int));
+    mesh.VertEdges = (unsigned int*) malloc(vertCount * sizeof(unsigned int));
+    memset(mesh.VertEdges, 0xff, vertCount * sizeof(unsigned int));
+
+    // Look up each twin:
+    int boundaryCount = 0;
+
+    #pragma omp parallel for reduction(+:boundaryCount)
+    for (int edge = 0; edge < edgeCount; ++edge)
+    {
+        unsigned int twin = FindEdge(&table, EDGE_KEY(source[edge], source[HE_PREV(edge)]));
+        mesh.Twins[edge] = twin;
+        boundaryCount += (twin == HE_NONE);
+    }
+
+    mesh.BoundaryCount = boundaryCount;
+    free(table.Keys);
+    free(table.Edges);
+
+    // Pick an outgoing half-edge for each vertex, preferring boundary edges so that
+    // one-ring traversal can start at the beginning of an open fan:
+    for (int edge = 0; edge < edgeCount; ++edge)
+    {
+        unsigned int origin = source[HE_PREV(edge)];
+        if (mesh.VertEdges[origin] == HE_NONE || mesh.Twins[edge] == HE_NONE)
+            mesh.VertEdges[origin] = edge;
+    }
+
+    return mesh;
+}
+
+void FreeHalfEdgeMesh(HalfEdgeMesh* mesh)
+{
+    free(mesh->Twins);
+    free(mesh->VertEdges);
+    mesh->Twins = 0;
+    mesh->VertEdges = 0;
+}
+
+void ComputeAdjacencyFromMesh(unsigned int* dest, const HalfEdgeMesh* mesh)
+{
+    const unsigned int* source = mesh->Verts;
+    const unsigned int* twins = mesh->Twins;
+
+    // Boundary edges repeat a neighboring corner, matching the original Judy-based output.
+    #pragma omp parallel for
+    for (int faceIndex = 0; faceIndex < mesh->FaceCount; ++faceIndex)
+    {
+        const unsigned int* pSrc = source + faceIndex * 3;
+        const unsigned int* pTwin = twins + faceIndex * 3;
+        unsigned int* pDest = dest + faceIndex * 6;
+        pDest[0] = pSrc[2];
+        pDest[1] = pTwin[0] != HE_NONE ? source[HE_NEXT(pTwin[0])] : pDest[0];
+        pDest[2] = pSrc[0];
+        pDest[3] = pTwin[1] != HE_NONE ? source[HE_NEXT(pTwin[1])] : pDest[1];
+        pDest[4] = pSrc[1];
+        pDest[5] = pTwin[2] != HE_NONE ? source[HE_NEXT(pTwin[2])] : pDest[2];
+    }
+}
+
+static void ComputeFaceNormal(float* normal, const float* positions, const unsigned int* corners)
+{
+    const float* a = positions + corners[0] * 3;
+    const float* b = positions + corners[1] * 3;
+    const float* c = positions + corners[2] * 3;
+    float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    normal[0] = u[1] * v[2] - u[2] * v[1];
+    normal[1] = u[2] * v[0] - u[0] * v[2];
+    normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+void ComputeSmoothNormals(float* normals, const float* positions, const HalfEdgeMesh* mesh)
+{
+    // Area-weighted average of the faces in each vertex's one-ring:
+    #pragma omp parallel for
+    for (int vert = 0; vert < mesh->VertexCount; ++vert)
+    {
+        float sum[3] = { 0, 0, 0 };
+        HalfEdgeIterator it;
+        for (it = HeOneRing(mesh, vert); it.Edge != HE_NONE; HeNextOneRing(mesh, &it))
+        {
+            float faceNormal[3];
+            ComputeFaceNormal(faceNormal, positions, mesh->Verts + HE_FACE(it.Edge) * 3);
+            sum[0] += faceNormal[0];
+            sum[1] += faceNormal[1];
+            sum[2] += faceNormal[2];
+        }
+
+        float length = sqrtf(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+        float scale = length > 0 ? 1.0f / length : 0;
+        normals[vert * 3 + 0] = sum[0] * scale;
+        normals[vert * 3 + 1] = sum[1] * scale;
+        normals[vert * 3 + 2] = sum[2] * scale;
+    }
+}
+
+static int IsFrontFacing(const float* positions, const unsigned int* corners, const float* eye)
+{
+    float normal[3];
+    ComputeFaceNormal(normal, positions, corners);
+    const float* a = positions + corners[0] * 3;
+    float toEye[3] = { eye[0] - a[0], eye[1] - a[1], eye[2] - a[2] };
+    return normal[0] * toEye[0] + normal[1] * toEye[1] + normal[2] * toEye[2] > 0;
+}
+
+int FindSilhouetteEdges(unsigned int* edges, const float* positions, const float* eye, const HalfEdgeMesh* mesh)
+{
+    // Emits each front-facing half-edge whose neighbor is back-facing (or missing).
+    int count = 0;
+    for (int face = 0; face < mesh->FaceCount; ++face)
+    {
+        if (!IsFrontFacing(positions, mesh->Verts + face * 3, eye))
+            continue;
+
+        HalfEdgeIterator it;
+        for (it = HeFaceLoop(mesh, face); it.Edge != HE_NONE; HeNextFaceLoop(mesh, &it))
+        {
+            unsigned int neighbor = HeFaceNeighbor(mesh, it.Edge);
+            if (neighbor == HE_NONE || !IsFrontFacing(positions, mesh->Verts + neighbor * 3, eye))
+                edges[count++] = it.Edge;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// HalfEdgeMesh is a persistent, index-based half-edge structure stored as parallel arrays.
+// Half-edges are implicit in the triangle list: half-edge 3f+i belongs to face f, ends at
+// Verts[3f+i], and starts at the vertex of the previous corner.  Next, Prev, and Face are
+// therefore pure arithmetic, and only the twin and per-vertex tables need to be stored.
+
+#define HE_NONE 0xffffffffu
+
+#define HE_NEXT(E) ((E) % 3 == 2 ? (E) - 2 : (E) + 1)
+#define HE_PREV(E) ((E) % 3 == 0 ? (E) + 2 : (E) - 1)
+#define HE_FACE(E) ((E) / 3)
+
+typedef struct HalfEdgeMeshRec
+{
+    int FaceCount;
+    int VertexCount;
+    const unsigned int* Verts; // End vertex of each half-edge (the caller's index buffer)
+    unsigned int* Twins;       // Oppositely oriented half-edge, or HE_NONE on the boundary
+    unsigned int* VertEdges;   // One outgoing half-edge per vertex; a boundary edge if possible
+    int BoundaryCount;         // Number of half-edges without a twin
+} HalfEdgeMesh;
+
+typedef struct HalfEdgeIteratorRec
+{
+    unsigned int First;
+    unsigned int Edge; // HE_NONE once the traversal is complete
+} HalfEdgeIterator;
+
+// The index buffer is referenced rather than copied, so it must outlive the mesh.
+HalfEdgeMesh CreateHalfEdgeMesh(const unsigned int* faces, int faceCount, int vertCount);
+void FreeHalfEdgeMesh(HalfEdgeMesh* mesh);
+
+// Traversal is inline so that tight loops over the mesh don't pay for a call per step.
+#ifdef _MSC_VER
+#define HE_INLINE static __inline
+#else
+#define HE_INLINE static inline
+#endif
+
+// Outgoing half-edges around a vertex, in order:
+//    for (it = HeOneRing(m, v); it.Edge != HE_NONE; HeNextOneRing(m, &it))
+HE_INLINE HalfEdgeIterator HeOneRing(const HalfEdgeMesh* mesh, unsigned int vert)
+{
+    HalfEdgeIterator it;
+    it.First = it.Edge = mesh->VertEdges[vert];
+    return it;
+}
+
+HE_INLINE void HeNextOneRing(const HalfEdgeMesh* mesh, HalfEdgeIterator* it)
+{
+    // The twin of the incoming edge is the next outgoing edge around the vertex:
+    unsigned int edge = mesh->Twins[HE_PREV(it->Edge)];
+    it->Edge = (edge == it->First) ? HE_NONE : edge;
+}
+
+// The three half-edges of a face:
+HE_INLINE HalfEdgeIterator HeFaceLoop(const HalfEdgeMesh* mesh, unsigned int face)
+{
+    HalfEdgeIterator it;
+    it.First = it.Edge = face * 3;
+    return it;
+}
+
+HE_INLINE void HeNextFaceLoop(const HalfEdgeMesh* mesh, HalfEdgeIterator* it)
+{
+    unsigned int edge = HE_NEXT(it->Edge);
+    it->Edge = (edge == it->First) ? HE_NONE : edge;
+}
+
+// Boundary half-edges in the loop that contains the given boundary half-edge:
+HE_INLINE HalfEdgeIterator HeBoundaryLoop(const HalfEdgeMesh* mesh, unsigned int edge)
+{
+    HalfEdgeIterator it;
+    it.First = it.Edge = edge;
+    return it;
+}
+
+HE_INLINE void HeNextBoundaryLoop(const HalfEdgeMesh* mesh, HalfEdgeIterator* it)
+{
+    // Swing around the end vertex until we find the next boundary half-edge:
+    unsigned int edge = HE_NEXT(it->Edge);
+    while (mesh->Twins[edge] != HE_NONE)
+        edge = HE_NEXT(mesh->Twins[edge]);
+    it->Edge = (edge == it->First) ? HE_NONE : edge;
+}
+
+HE_INLINE unsigned int HeOrigin(const HalfEdgeMesh* mesh, unsigned int edge)
+{
+    return mesh->Verts[HE_PREV(edge)];
+}
+
+HE_INLINE unsigned int HeFaceNeighbor(const HalfEdgeMesh* mesh, unsigned int edge)
+{
+    unsigned int twin = mesh->Twins[edge];
+    return twin == HE_NONE ? HE_NONE : HE_FACE(twin);
+}
+
+// Consumers that share a single build:
+void ComputeAdjacencyFromMesh(unsigned int* dest, const HalfEdgeMesh* mesh);
+void ComputeSmoothNormals(float* normals, const float* positions, const HalfEdgeMesh* mesh);
+int FindSilhouetteEdges(unsigned int* edges, const float* positions, const float* eye, const HalfEdgeMesh* mesh);
+
+#ifdef __cplusplus
+}
+#endif
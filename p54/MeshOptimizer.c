@@ -0,0 +1,263 @@
+#include "MeshOptimizer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+VertexCacheStats MeasureVertexCache(const unsigned int* indices, int faceCount, int vertCount, int cacheSize)
+{
+    // A vertex is still cached if fewer than cacheSize misses have happened since it was loaded:
+    int* loadedAt = (int*) malloc(vertCount * sizeof(int));
+    for (int vert = 0; vert < vertCount; ++vert)
+        loadedAt[vert] = -cacheSize - 1;
+
+    int misses = 0;
+    int usedCount = 0;
+    for (int i = 0; i < faceCount * 3; ++i)
+    {
+        unsigned int vert = indices[i];
+        usedCount += (loadedAt[vert] == -cacheSize - 1);
+        if (misses - loadedAt[vert] > cacheSize)
+            loadedAt[vert] = misses++;
+    }
+
+    free(loadedAt);
+
+    VertexCacheStats stats;
+    stats.Acmr = faceCount ? (float) misses / faceCount : 0;
+    stats.Atvr = usedCount ? (float) misses / usedCount : 0;
+    return stats;
+}
+
+typedef struct ClusterRec
+{
+    int FirstFace;
+    int FaceCount;
+    float SortKey;
+} Cluster;
+
+static int CompareClusters(const void* a, const void* b)
+{
+    const Cluster* ca = (const Cluster*) a;
+    const Cluster* cb = (const Cluster*) b;
+    if (ca->SortKey != cb->SortKey)
+        return ca->SortKey > cb->SortKey ? -1 : 1;
+    return ca->FirstFace - cb->FirstFace;
+}
+
+// Clusters whose area-weighted normal points away from the mesh centroid are drawn first,
+// since they're the most likely to occlude the rest of the mesh from any viewpoint.
+static void SortClusters(unsigned int* indices, const unsigned int* ordered, int faceCount,
+    Cluster* clusters, int clusterCount, const float* positions)
+{
+    float center[3] = { 0, 0, 0 };
+    double area = 0;
+    for (int face = 0; face < faceCount; ++face)
+    {
+        const float* a = positions + ordered[face * 3 + 0] * 3;
+        const float* b = positions + ordered[face * 3 + 1] * 3;
+        const float* c = positions + ordered[face * 3 + 2] * 3;
+        float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+        float weight = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (int k = 0; k < 3; ++k)
+            center[k] += weight * (a[k] + b[k] + c[k]);
+        area += weight;
+    }
+    for (int k = 0; k < 3; ++k)
+        center[k] = area > 0 ? (float) (center[k] / (area * 3)) : 0;
+
+    for (int i = 0; i < clusterCount; ++i)
+    {
+        float centroid[3] = { 0, 0, 0 };
+        float normal[3] = { 0, 0, 0 };
+        float clusterArea = 0;
+        const unsigned int* pFace = ordered + clusters[i].FirstFace * 3;
+        for (int face = 0; face < clusters[i].FaceCount; ++face, pFace += 3)
+        {
+            const float* a = positions + pFace[0] * 3;
+            const float* b = positions + pFace[1] * 3;
+            const float* c = positions + pFace[2] * 3;
+            float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+            float weight = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k)
+            {
+                centroid[k] += weight * (a[k] + b[k] + c[k]);
+                normal[k] += n[k];
+            }
+            clusterArea += weight;
+        }
+
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0;
+        if (length > 0 && clusterArea > 0)
+        {
+            for (int k = 0; k < 3; ++k)
+                key += (centroid[k] / (clusterArea * 3) - center[k]) * normal[k];
+            key /= length;
+        }
+        clusters[i].SortKey = key;
+    }
+
+    qsort(clusters, clusterCount, sizeof(Cluster), CompareClusters);
+
+    unsigned int* pDest = indices;
+    for (int i = 0; i < clusterCount; ++i)
+    {
+        memcpy(pDest, ordered + clusters[i].FirstFace * 3, clusters[i].FaceCount * 3 * sizeof(unsigned int));
+        pDest += clusters[i].FaceCount * 3;
+    }
+}
+
+void OptimizeFaceOrder(unsigned int* indices, int faceCount, int vertCount, int cacheSize, const float* positions)
+{
+    if (faceCount == 0)
+        return;
+
+    // Vertex-to-face adjacency as a compact offset table; the live count of a vertex is the
+    // number of its faces that haven't been emitted yet:
+    int* liveCounts = (int*) calloc(vertCount, sizeof(int));
+    int* offsets = (int*) malloc((vertCount + 1) * sizeof(int));
+    int* adjacency = (int*) malloc(faceCount * 3 * sizeof(int));
+    for (int i = 0; i < faceCount * 3; ++i)
+        ++liveCounts[indices[i]];
+    offsets[0] = 0;
+    for (int vert = 0; vert < vertCount; ++vert)
+        offsets[vert + 1] = offsets[vert] + liveCounts[vert];
+    int* cursors = (int*) malloc(vertCount * sizeof(int));
+    memcpy(cursors, offsets, vertCount * sizeof(int));
+    for (int i = 0; i < faceCount * 3; ++i)
+        adjacency[cursors[indices[i]]++] = i / 3;
+    free(cursors);
+
+    int* cacheTimes = (int*) calloc(vertCount, sizeof(int));
+    unsigned int* deadEnds = (unsigned int*) malloc(faceCount * 3 * sizeof(unsigned int));
+    unsigned int* candidates = (unsigned int*) malloc(faceCount * 3 * sizeof(unsigned int));
+    unsigned char* emitted = (unsigned char*) calloc(faceCount, 1);
+    unsigned int* ordered = (unsigned int*) malloc(faceCount * 3 * sizeof(unsigned int));
+    Cluster* clusters = (Cluster*) malloc(faceCount * sizeof(Cluster));
+
+    int deadEndCount = 0;
+    int emittedCount = 0;
+    int clusterCount = 0;
+    int timeStamp = cacheSize + 1;
+    int cursor = 0;
+    int fanning = indices[0];
+
+    while (fanning >= 0)
+    {
+        // Emit every remaining face around the fanning vertex:
+        int candidateCount = 0;
+        for (int i = offsets[fanning]; i < offsets[fanning + 1]; ++i)
+        {
+            int face = adjacency[i];
+            if (emitted[face])
+                continue;
+            emitted[face] = 1;
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int vert = indices[face * 3 + k];
+                ordered[emittedCount * 3 + k] = vert;
+                deadEnds[deadEndCount++] = vert;
+                candidates[candidateCount++] = vert;
+                --liveCounts[vert];
+                if (timeStamp - cacheTimes[vert] > cacheSize)
+                    cacheTimes[vert] = timeStamp++;
+            }
+            ++emittedCount;
+        }
+
+        // Prefer the candidate that will still be in the cache once all of its faces are emitted:
+        int next = -1;
+        int best = -1;
+        for (int i = 0; i < candidateCount; ++i)
+        {
+            unsigned int vert = candidates[i];
+            if (liveCounts[vert] <= 0)
+                continue;
+            int priority = 0;
+            if (timeStamp - cacheTimes[vert] + 2 * liveCounts[vert] <= cacheSize)
+                priority = timeStamp - cacheTimes[vert];
+            if (priority > best)
+            {
+                best = priority;
+                next = vert;
+            }
+        }
+
+        // Otherwise back up through recently used vertices, and finally scan in input order.
+        // Jumps to a vertex that has left the cache start a new cluster for overdraw sorting.
+        if (next < 0)
+        {
+            while (deadEndCount > 0 && next < 0)
+            {
+                unsigned int vert = deadEnds[--deadEndCount];
+                if (liveCounts[vert] > 0)
+                    next = vert;
+            }
+            while (next < 0 && cursor < vertCount)
+            {
+                if (liveCounts[cursor] > 0)
+                    next = cursor;
+                ++cursor;
+            }
+        }
+
+        if (next < 0 || timeStamp - cacheTimes[next] > cacheSize)
+        {
+            int first = clusterCount ? clusters[clusterCount - 1].FirstFace + clusters[clusterCount - 1].FaceCount : 0;
+            if (emittedCount > first)
+            {
+                clusters[clusterCount].FirstFace = first;
+                clusters[clusterCount].FaceCount = emittedCount - first;
+                ++clusterCount;
+            }
+        }
+
+        fanning = next;
+    }
+
+    if (positions)
+        SortClusters(indices, ordered, faceCount, clusters, clusterCount, positions);
+    else
+        memcpy(indices, ordered, faceCount * 3 * sizeof(unsigned int));
+
+    free(clusters);
+    free(ordered);
+    free(emitted);
+    free(candidates);
+    free(deadEnds);
+    free(cacheTimes);
+    free(adjacency);
+    free(offsets);
+    free(liveCounts);
+}
+
+void OptimizeVertexFetch(unsigned int* remap, unsigned int* indices, int faceCount, int vertCount)
+{
+    memset(remap, 0xff, vertCount * sizeof(unsigned int));
+
+    unsigned int nextVert = 0;
+    for (int i = 0; i < faceCount * 3; ++i)
+    {
+        unsigned int vert = indices[i];
+        if (remap[vert] == 0xffffffffu)
+            remap[vert] = nextVert++;
+        indices[i] = remap[vert];
+    }
+
+    for (int vert = 0; vert < vertCount; ++vert)
+    {
+        if (remap[vert] == 0xffffffffu)
+            remap[vert] = nextVert++;
+    }
+}
+
+void RemapVertexArray(float* dest, const float* source, int components, const unsigned int* remap, int vertCount)
+{
+    #pragma omp parallel for
+    for (int vert = 0; vert < vertCount; ++vert)
+        memcpy(dest + remap[vert] * components, source + vert * components, components * sizeof(float));
+}
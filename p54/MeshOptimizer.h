@@ -0,0 +1,31 @@
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Triangle and vertex reordering for the post-transform cache, overdraw, and the
+// pre-transform (vertex fetch) cache.  Face ordering follows Sander, Nehab and Barczak's
+// "Tipsify" (linear time, tunable to the cache size); index arrays are reordered in place.
+
+typedef struct VertexCacheStatsRec
+{
+    float Acmr; // Transformed vertices per triangle; 0.5 is ideal for a large regular mesh
+    float Atvr; // Transformed vertices per vertex; 1.0 is ideal
+} VertexCacheStats;
+
+// Simulates a FIFO post-transform cache with the given number of entries.
+VertexCacheStats MeasureVertexCache(const unsigned int* indices, int faceCount, int vertCount, int cacheSize);
+
+// Reorders triangles for a cache of the given size.  If positions are supplied, the
+// clusters that Tipsify produces are also sorted so that outward-facing ones draw first.
+void OptimizeFaceOrder(unsigned int* indices, int faceCount, int vertCount, int cacheSize, const float* positions);
+
+// Renumbers vertices in order of first use and writes the old-to-new mapping into remap.
+// Unreferenced vertices move to the end.  Apply the mapping to each vertex array with
+// RemapVertexArray, which scatters source into a separate dest array.
+void OptimizeVertexFetch(unsigned int* remap, unsigned int* indices, int faceCount, int vertCount);
+void RemapVertexArray(float* dest, const float* source, int components, const unsigned int* remap, int vertCount);
+
+#ifdef __cplusplus
+}
+#endif
@@ -102,7 +102,7 @@ static void RenderMesh()
         glEnableVertexAttribArray(normalSlot);
     }
 
-    glDrawElements(GL_TRIANGLES_ADJACENCY, DemoMesh.FaceCount * 6, GL_UNSIGNED_SHORT, 0);
+    glDrawElements(GL_TRIANGLES_ADJACENCY, DemoMesh.FaceCount * 6, GL_UNSIGNED_INT, 0);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -15,4 +15,5 @@ typedef struct MeshRec
 Mesh CreateMesh(const char* ctmFile, bool computeAdjacency);
 Mesh CreateQuad();
 GLuint CreateProgram(const char* vsKey, const char* gsKey, const char* fsKey);
-void ComputeAdjacency(unsigned short* dest, const unsigned short* source, int faceCount, int vertCount);
+void ComputeAdjacency(unsigned int* dest, const unsigned int* source, int faceCount, int vertCount);
+void ComputeAdjacencyJudy(unsigned short* dest, const unsigned short* source, int faceCount, int vertCount);
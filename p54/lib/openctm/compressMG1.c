@@ -238,35 +238,32 @@ int _ctmCompressMesh_MG1(_CTMcontext * self)
 //-----------------------------------------------------------------------------
 int _ctmUncompressMesh_MG1(_CTMcontext * self)
 {
-  CTMuint * indices;
   _CTMfloatmap * map;
   CTMuint i;
 
-  // Allocate memory for the indices
-  indices = (CTMuint *) malloc(sizeof(CTMuint) * self->mTriangleCount * 3);
-  if(!indices)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
-
-  // Read triangle indices
+  // Read triangle indices (straight into the index array, since the index
+  // restoration works in place)
   if(_ctmStreamReadUINT(self) != FOURCC("INDX"))
   {
     self->mError = CTM_BAD_FORMAT;
-    free(indices);
     return CTM_FALSE;
   }
-  if(!_ctmStreamReadPackedInts(self, (CTMint *) indices, self->mTriangleCount, 3, CTM_FALSE))
+  if(!_ctmStreamReadPackedInts(self, (CTMint *) self->mIndices, self->mTriangleCount, 3, CTM_FALSE))
     return CTM_FALSE;
 
   // Restore indices
-  _ctmRestoreIndices(self, indices);
-  for(i = 0; i < self->mTriangleCount * 3; ++ i)
-    self->mIndices[i] = indices[i];
+  _ctmRestoreIndices(self, self->mIndices);
 
-  // Free temporary resources
-  free(indices);
+  // Check that all indices are within range
+  for(i = 0; i < (self->mTriangleCount * 3); ++ i)
+  {
+    if(self->mIndices[i] >= self->mVertexCount)
+    {
+      self->mError = CTM_INVALID_MESH;
+      return CTM_FALSE;
+    }
+  }
+  _ctmStreamArrayReady(self, CTM_INDICES);
 
   // Read vertices
   if(_ctmStreamReadUINT(self) != FOURCC("VERT"))
@@ -276,6 +273,7 @@ int _ctmUncompressMesh_MG1(_CTMcontext * self)
   }
   if(!_ctmStreamReadPackedFloats(self, self->mVertices, self->mVertexCount * 3, 1))
     return CTM_FALSE;
+  _ctmStreamArrayReady(self, CTM_VERTICES);
 
   // Read normals
   if(self->mNormals)
@@ -287,6 +285,7 @@ int _ctmUncompressMesh_MG1(_CTMcontext * self)
     }
     if(!_ctmStreamReadPackedFloats(self, self->mNormals, self->mVertexCount, 3))
       return CTM_FALSE;
+    _ctmStreamArrayReady(self, CTM_NORMALS);
   }
 
   // Read UV maps
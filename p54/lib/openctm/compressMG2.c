@@ -26,6 +26,7 @@
 //-----------------------------------------------------------------------------
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "openctm.h"
 #include "internal.h"
@@ -172,43 +173,173 @@ static void _ctmGridIdxToPoint(_CTMgrid * aGrid, CTMuint aIdx, CTMfloat * aPoint
 }
 
 //-----------------------------------------------------------------------------
-// _compareVertex() - Comparator for the vertex sorting.
+// _ctmRadixSort() - Stable sort of aCount elements by a pair of unsigned keys
+// (aPrimary first, then aSecondary). The resulting order is returned as a
+// permutation in aOrder. The elements are split into a fixed number of chunks
+// that are histogrammed and scattered in parallel, so the result does not
+// depend on the number of threads.
 //-----------------------------------------------------------------------------
-static int _compareVertex(const void * elem1, const void * elem2)
+#define _CTM_RADIX_BITS   8
+#define _CTM_RADIX_SIZE   (1 << _CTM_RADIX_BITS)
+#define _CTM_RADIX_CHUNKS 64
+
+static int _ctmRadixSort(_CTMcontext * self, CTMuint * aOrder,
+  const CTMuint * aPrimary, const CTMuint * aSecondary, CTMuint aCount)
 {
-  _CTMsortvertex * v1 = (_CTMsortvertex *) elem1;
-  _CTMsortvertex * v2 = (_CTMsortvertex *) elem2;
-  if(v1->mGridIndex != v2->mGridIndex)
-    return v1->mGridIndex - v2->mGridIndex;
-  else if(v1->x < v2->x)
-    return -1;
-  else if(v1->x > v2->x)
-    return 1;
-  else
-    return 0;
+  CTMuint * keys, * tmpKeys, * tmpOrder, * counts, * swap;
+  CTMuint chunkSize, total, pass, shift, digit, key;
+  int chunk, i;
+
+  keys = (CTMuint *) malloc(sizeof(CTMuint) * aCount * 3);
+  counts = (CTMuint *) malloc(sizeof(CTMuint) * _CTM_RADIX_CHUNKS * _CTM_RADIX_SIZE);
+  if(!keys || !counts)
+  {
+    free((void *) keys);
+    free((void *) counts);
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+  tmpKeys = keys + aCount;
+  tmpOrder = keys + aCount * 2;
+  chunkSize = (aCount + _CTM_RADIX_CHUNKS - 1) / _CTM_RADIX_CHUNKS;
+
+  for(i = 0; i < (int) aCount; ++ i)
+    aOrder[i] = i;
+
+  // Least significant key first: secondary key passes, then primary key passes
+  for(pass = 0; pass < 8; ++ pass)
+  {
+    shift = (pass & 3) * _CTM_RADIX_BITS;
+
+    // Gather the current key in the current order at the start of each key
+    if((pass & 3) == 0)
+    {
+      const CTMuint * src = (pass < 4) ? aSecondary : aPrimary;
+      #pragma omp parallel for num_threads((int) self->mCompressionThreads)
+      for(i = 0; i < (int) aCount; ++ i)
+        keys[i] = src[aOrder[i]];
+    }
+
+    // Histogram each chunk
+    #pragma omp parallel for num_threads((int) self->mCompressionThreads)
+    for(chunk = 0; chunk < _CTM_RADIX_CHUNKS; ++ chunk)
+    {
+      CTMuint * count = counts + chunk * _CTM_RADIX_SIZE;
+      CTMuint j, end = (chunk + 1) * chunkSize < aCount ? (chunk + 1) * chunkSize : aCount;
+      memset(count, 0, sizeof(CTMuint) * _CTM_RADIX_SIZE);
+      for(j = chunk * chunkSize; j < end; ++ j)
+        ++ count[(keys[j] >> shift) & (_CTM_RADIX_SIZE - 1)];
+    }
+
+    // Prefix sum (digit major, chunk minor) to get the scatter offsets, and
+    // skip the pass if every element has the same digit
+    total = 0;
+    key = 0;
+    for(digit = 0; digit < _CTM_RADIX_SIZE; ++ digit)
+    {
+      CTMuint digitTotal = total;
+      for(chunk = 0; chunk < _CTM_RADIX_CHUNKS; ++ chunk)
+      {
+        CTMuint c = counts[chunk * _CTM_RADIX_SIZE + digit];
+        counts[chunk * _CTM_RADIX_SIZE + digit] = total;
+        total += c;
+      }
+      if(total - digitTotal == aCount)
+        key = 1;
+    }
+    if(key)
+      continue;
+
+    // Scatter each chunk
+    #pragma omp parallel for num_threads((int) self->mCompressionThreads)
+    for(chunk = 0; chunk < _CTM_RADIX_CHUNKS; ++ chunk)
+    {
+      CTMuint * offset = counts + chunk * _CTM_RADIX_SIZE;
+      CTMuint j, dest, end = (chunk + 1) * chunkSize < aCount ? (chunk + 1) * chunkSize : aCount;
+      for(j = chunk * chunkSize; j < end; ++ j)
+      {
+        dest = offset[(keys[j] >> shift) & (_CTM_RADIX_SIZE - 1)] ++;
+        tmpKeys[dest] = keys[j];
+        tmpOrder[dest] = aOrder[j];
+      }
+    }
+
+    swap = keys; keys = tmpKeys; tmpKeys = swap;
+    memcpy(aOrder, tmpOrder, sizeof(CTMuint) * aCount);
+  }
+
+  // The three arrays were allocated as one block, starting at the lowest of
+  // the (possibly swapped) key pointers
+  free((void *) (keys < tmpKeys ? keys : tmpKeys));
+  free((void *) counts);
+
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmFloatSortKey() - Map a float to an unsigned integer with the same sort
+// order (negative and positive zero are treated as equal).
+//-----------------------------------------------------------------------------
+static CTMuint _ctmFloatSortKey(CTMfloat aValue)
+{
+  union {
+    CTMfloat f;
+    CTMuint i;
+  } value;
+
+  value.f = aValue;
+  if(value.i == 0x80000000)
+    value.i = 0;
+  return (value.i & 0x80000000) ? ~value.i : (value.i | 0x80000000);
 }
 
 //-----------------------------------------------------------------------------
 // _ctmSortVertices() - Setup the vertex array. Assign each vertex to a grid
 // box, and sort all vertices.
 //-----------------------------------------------------------------------------
-static void _ctmSortVertices(_CTMcontext * self, _CTMsortvertex * aSortVertices,
+static int _ctmSortVertices(_CTMcontext * self, _CTMsortvertex * aSortVertices,
   _CTMgrid * aGrid)
 {
-  CTMuint i;
+  CTMuint * gridIndices, * xKeys, * order;
+  int i;
 
-  // Prepare sort vertex array
-  for(i = 0; i < self->mVertexCount; ++ i)
+  gridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount * 3);
+  if(!gridIndices)
   {
-    // Store vertex properties in the sort vertex array
-    aSortVertices[i].x = self->mVertices[i * 3];
-    aSortVertices[i].mGridIndex = _ctmPointToGridIdx(aGrid, &self->mVertices[i * 3]);
-    aSortVertices[i].mOriginalIndex = i;
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+  xKeys = gridIndices + self->mVertexCount;
+  order = gridIndices + self->mVertexCount * 2;
+
+  // Calculate the sort keys
+  #pragma omp parallel for num_threads((int) self->mCompressionThreads)
+  for(i = 0; i < (int) self->mVertexCount; ++ i)
+  {
+    gridIndices[i] = _ctmPointToGridIdx(aGrid, &self->mVertices[i * 3]);
+    xKeys[i] = _ctmFloatSortKey(self->mVertices[i * 3]);
   }
 
   // Sort vertices. The elements are first sorted by their grid indices, and
   // scondly by their x coordinates.
-  qsort((void *) aSortVertices, self->mVertexCount, sizeof(_CTMsortvertex), _compareVertex);
+  if(!_ctmRadixSort(self, order, gridIndices, xKeys, self->mVertexCount))
+  {
+    free((void *) gridIndices);
+    return CTM_FALSE;
+  }
+
+  // Store vertex properties in the sort vertex array
+  #pragma omp parallel for num_threads((int) self->mCompressionThreads)
+  for(i = 0; i < (int) self->mVertexCount; ++ i)
+  {
+    aSortVertices[i].x = self->mVertices[order[i] * 3];
+    aSortVertices[i].mGridIndex = gridIndices[order[i]];
+    aSortVertices[i].mOriginalIndex = order[i];
+  }
+
+  free((void *) gridIndices);
+
+  return CTM_TRUE;
 }
 
 //-----------------------------------------------------------------------------
@@ -239,30 +370,19 @@ static int _ctmReIndexIndices(_CTMcontext * self, _CTMsortvertex * aSortVertices
   return CTM_TRUE;
 }
 
-//-----------------------------------------------------------------------------
-// _compareTriangle() - Comparator for the triangle sorting.
-//-----------------------------------------------------------------------------
-static int _compareTriangle(const void * elem1, const void * elem2)
-{
-  CTMuint * tri1 = (CTMuint *) elem1;
-  CTMuint * tri2 = (CTMuint *) elem2;
-  if(tri1[0] != tri2[0])
-    return tri1[0] - tri2[0];
-  else
-    return tri1[1] - tri2[1];
-}
-
 //-----------------------------------------------------------------------------
 // _ctmReArrangeTriangles() - Re-arrange all triangles for optimal
 // compression.
 //-----------------------------------------------------------------------------
-static void _ctmReArrangeTriangles(_CTMcontext * self, CTMuint * aIndices)
+static int _ctmReArrangeTriangles(_CTMcontext * self, CTMuint * aIndices)
 {
-  CTMuint * tri, tmp, i;
+  CTMuint * tri, * first, * second, * order, * sorted, tmp;
+  int i;
 
   // Step 1: Make sure that the first index of each triangle is the smallest
   // one (rotate triangle nodes if necessary)
-  for(i = 0; i < self->mTriangleCount; ++ i)
+  #pragma omp parallel for private(tri, tmp) num_threads((int) self->mCompressionThreads)
+  for(i = 0; i < (int) self->mTriangleCount; ++ i)
   {
     tri = &aIndices[i * 3];
     if((tri[1] < tri[0]) && (tri[1] < tri[2]))
@@ -281,8 +401,38 @@ static void _ctmReArrangeTriangles(_CTMcontext * self, CTMuint * aIndices)
     }
   }
 
-  // Step 2: Sort the triangles based on the first triangle index
-  qsort((void *) aIndices, self->mTriangleCount, sizeof(CTMuint) * 3, _compareTriangle);
+  // Step 2: Sort the triangles based on the first triangle index (and the
+  // second triangle index for triangles that share the first index)
+  first = (CTMuint *) malloc(sizeof(CTMuint) * self->mTriangleCount * 6);
+  if(!first)
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+  second = first + self->mTriangleCount;
+  order = first + self->mTriangleCount * 2;
+  sorted = first + self->mTriangleCount * 3;
+  for(i = 0; i < (int) self->mTriangleCount; ++ i)
+  {
+    first[i] = aIndices[i * 3];
+    second[i] = aIndices[i * 3 + 1];
+  }
+  if(!_ctmRadixSort(self, order, first, second, self->mTriangleCount))
+  {
+    free((void *) first);
+    return CTM_FALSE;
+  }
+  #pragma omp parallel for num_threads((int) self->mCompressionThreads)
+  for(i = 0; i < (int) self->mTriangleCount; ++ i)
+  {
+    sorted[i * 3] = aIndices[order[i] * 3];
+    sorted[i * 3 + 1] = aIndices[order[i] * 3 + 1];
+    sorted[i * 3 + 2] = aIndices[order[i] * 3 + 2];
+  }
+  memcpy(aIndices, sorted, sizeof(CTMuint) * self->mTriangleCount * 3);
+  free((void *) first);
+
+  return CTM_TRUE;
 }
 
 //-----------------------------------------------------------------------------
@@ -798,96 +948,55 @@ static void _ctmRestoreAttribs(_CTMcontext * self, _CTMfloatmap * aMap,
 }
 
 //-----------------------------------------------------------------------------
-// _ctmCompressMesh_MG2() - Compress the mesh that is stored in the CTM
-// context, and write it the the output stream in the CTM context.
+// _ctmNewMG2Block() - Allocate the integer array for the next packed stream
+// of an MG2 file. Returns NULL if the allocation failed.
 //-----------------------------------------------------------------------------
-int _ctmCompressMesh_MG2(_CTMcontext * self)
+static CTMint * _ctmNewMG2Block(_CTMcontext * self, _CTMpackedints * aBlocks,
+  CTMuint * aBlockCount, CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  _CTMpackedints * block = &aBlocks[(*aBlockCount) ++];
+
+  block->mPacked = (unsigned char *) 0;
+  block->mCount = aCount;
+  block->mSize = aSize;
+  block->mSignedInts = aSignedInts;
+  block->mData = (CTMint *) malloc(sizeof(CTMint) * aCount * aSize);
+  if(!block->mData)
+    self->mError = CTM_OUT_OF_MEMORY;
+  return block->mData;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmMakeMG2Streams() - Calculate the integer arrays for all the packed
+// streams of an MG2 file (vertices, grid indices, indices, normals, UV maps and
+// attribute maps, in file order).
+//-----------------------------------------------------------------------------
+static int _ctmMakeMG2Streams(_CTMcontext * self, _CTMgrid * aGrid,
+  _CTMsortvertex * aSortVertices, _CTMpackedints * aBlocks,
+  CTMuint * aBlockCount)
 {
-  _CTMgrid grid;
-  _CTMsortvertex * sortVertices;
   _CTMfloatmap * map;
-  CTMuint * indices, * deltaIndices, * gridIndices;
-  CTMint * intVertices, * intNormals, * intUVCoords, * intAttribs;
+  CTMuint * indices, * gridIndices, * deltaIndices;
+  CTMint * intVertices, * intNormals, * intMaps;
   CTMfloat * restoredVertices;
   CTMuint i;
 
-#ifdef __DEBUG_
-  printf("COMPRESSION METHOD: MG2\n");
-#endif
-
-  // Setup 3D space subdivision grid
-  _ctmSetupGrid(self, &grid);
-
-  // Write MG2-specific header information to the stream
-  _ctmStreamWrite(self, (void *) "MG2H", 4);
-  _ctmStreamWriteFLOAT(self, self->mVertexPrecision);
-  _ctmStreamWriteFLOAT(self, self->mNormalPrecision);
-  _ctmStreamWriteFLOAT(self, grid.mMin[0]);
-  _ctmStreamWriteFLOAT(self, grid.mMin[1]);
-  _ctmStreamWriteFLOAT(self, grid.mMin[2]);
-  _ctmStreamWriteFLOAT(self, grid.mMax[0]);
-  _ctmStreamWriteFLOAT(self, grid.mMax[1]);
-  _ctmStreamWriteFLOAT(self, grid.mMax[2]);
-  _ctmStreamWriteUINT(self, grid.mDivision[0]);
-  _ctmStreamWriteUINT(self, grid.mDivision[1]);
-  _ctmStreamWriteUINT(self, grid.mDivision[2]);
-
   // Prepare (sort) vertices
-  sortVertices = (_CTMsortvertex *) malloc(sizeof(_CTMsortvertex) * self->mVertexCount);
-  if(!sortVertices)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
+  if(!_ctmSortVertices(self, aSortVertices, aGrid))
     return CTM_FALSE;
-  }
-  _ctmSortVertices(self, sortVertices, &grid);
 
   // Convert vertices to integers and calculate vertex deltas (entropy-reduction)
-  intVertices = (CTMint *) malloc(sizeof(CTMint) * 3 * self->mVertexCount);
+  intVertices = _ctmNewMG2Block(self, aBlocks, aBlockCount, self->mVertexCount, 3, CTM_FALSE);
   if(!intVertices)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    free((void *) sortVertices);
-    return CTM_FALSE;
-  }
-  _ctmMakeVertexDeltas(self, intVertices, sortVertices, &grid);
-
-  // Write vertices
-#ifdef __DEBUG_
-  printf("Vertices: ");
-#endif
-  _ctmStreamWrite(self, (void *) "VERT", 4);
-  if(!_ctmStreamWritePackedInts(self, intVertices, self->mVertexCount, 3, CTM_FALSE))
-  {
-    free((void *) intVertices);
-    free((void *) sortVertices);
     return CTM_FALSE;
-  }
+  _ctmMakeVertexDeltas(self, intVertices, aSortVertices, aGrid);
 
-  // Prepare grid indices (deltas)
-  gridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount);
+  // Prepare grid indices
+  gridIndices = (CTMuint *) _ctmNewMG2Block(self, aBlocks, aBlockCount, self->mVertexCount, 1, CTM_FALSE);
   if(!gridIndices)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    free((void *) intVertices);
-    free((void *) sortVertices);
-    return CTM_FALSE;
-  }
-  gridIndices[0] = sortVertices[0].mGridIndex;
-  for(i = 1; i < self->mVertexCount; ++ i)
-    gridIndices[i] = sortVertices[i].mGridIndex - sortVertices[i - 1].mGridIndex;
-  
-  // Write grid indices
-#ifdef __DEBUG_
-  printf("Grid indices: ");
-#endif
-  _ctmStreamWrite(self, (void *) "GIDX", 4);
-  if(!_ctmStreamWritePackedInts(self, (CTMint *) gridIndices, self->mVertexCount, 1, CTM_FALSE))
-  {
-    free((void *) gridIndices);
-    free((void *) intVertices);
-    free((void *) sortVertices);
     return CTM_FALSE;
-  }
+  for(i = 0; i < self->mVertexCount; ++ i)
+    gridIndices[i] = aSortVertices[i].mGridIndex;
 
   // Calculate the result of the compressed -> decompressed vertices, in order
   // to use the same vertex data for calculating nominal normals as the
@@ -897,18 +1006,13 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
   if(!restoredVertices)
   {
     self->mError = CTM_OUT_OF_MEMORY;
-    free((void *) gridIndices);
-    free((void *) intVertices);
-    free((void *) sortVertices);
     return CTM_FALSE;
   }
-  for(i = 1; i < self->mVertexCount; ++ i)
-    gridIndices[i] += gridIndices[i - 1];
-  _ctmRestoreVertices(self, intVertices, gridIndices, &grid, restoredVertices);
+  _ctmRestoreVertices(self, intVertices, gridIndices, aGrid, restoredVertices);
 
-  // Free temporary resources
-  free((void *) gridIndices);
-  free((void *) intVertices);
+  // Convert grid indices to deltas
+  for(i = self->mVertexCount; i > 1; -- i)
+    gridIndices[i - 1] -= gridIndices[i - 2];
 
   // Perpare (sort) indices
   indices = (CTMuint *) malloc(sizeof(CTMuint) * self->mTriangleCount * 3);
@@ -916,163 +1020,355 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
   {
     self->mError = CTM_OUT_OF_MEMORY;
     free((void *) restoredVertices);
-    free((void *) sortVertices);
     return CTM_FALSE;
   }
-  if(!_ctmReIndexIndices(self, sortVertices, indices))
+  if(!_ctmReIndexIndices(self, aSortVertices, indices) ||
+     !_ctmReArrangeTriangles(self, indices))
   {
     free((void *) indices);
     free((void *) restoredVertices);
-    free((void *) sortVertices);
     return CTM_FALSE;
   }
-  _ctmReArrangeTriangles(self, indices);
 
   // Calculate index deltas (entropy-reduction)
-  deltaIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mTriangleCount * 3);
-  if(!indices)
+  deltaIndices = (CTMuint *) _ctmNewMG2Block(self, aBlocks, aBlockCount, self->mTriangleCount, 3, CTM_FALSE);
+  if(!deltaIndices)
   {
-    self->mError = CTM_OUT_OF_MEMORY;
     free((void *) indices);
     free((void *) restoredVertices);
-    free((void *) sortVertices);
     return CTM_FALSE;
   }
-  for(i = 0; i < self->mTriangleCount * 3; ++ i)
-    deltaIndices[i] = indices[i];
+  memcpy(deltaIndices, indices, sizeof(CTMuint) * self->mTriangleCount * 3);
   _ctmMakeIndexDeltas(self, deltaIndices);
 
-  // Write triangle indices
-#ifdef __DEBUG_
-  printf("Indices: ");
-#endif
-  _ctmStreamWrite(self, (void *) "INDX", 4);
-  if(!_ctmStreamWritePackedInts(self, (CTMint *) deltaIndices, self->mTriangleCount, 3, CTM_FALSE))
-  {
-    free((void *) deltaIndices);
-    free((void *) indices);
-    free((void *) restoredVertices);
-    free((void *) sortVertices);
-    return CTM_FALSE;
-  }
-
-  // Free temporary data for the indices
-  free((void *) deltaIndices);
-
   if(self->mNormals)
   {
     // Convert normals to integers and calculate deltas (entropy-reduction)
-    intNormals = (CTMint *) malloc(sizeof(CTMint) * 3 * self->mVertexCount);
-    if(!intNormals)
+    intNormals = _ctmNewMG2Block(self, aBlocks, aBlockCount, self->mVertexCount, 3, CTM_FALSE);
+    if(!intNormals ||
+       !_ctmMakeNormalDeltas(self, intNormals, restoredVertices, indices, aSortVertices))
     {
-      self->mError = CTM_OUT_OF_MEMORY;
       free((void *) indices);
       free((void *) restoredVertices);
-      free((void *) sortVertices);
       return CTM_FALSE;
     }
-    if(!_ctmMakeNormalDeltas(self, intNormals, restoredVertices, indices, sortVertices))
-    {
-      free((void *) indices);
-      free((void *) intNormals);
-      free((void *) restoredVertices);
-      free((void *) sortVertices);
-      return CTM_FALSE;
-    }
-
-    // Write normals
-#ifdef __DEBUG_
-    printf("Normals: ");
-#endif
-    _ctmStreamWrite(self, (void *) "NORM", 4);
-    if(!_ctmStreamWritePackedInts(self, intNormals, self->mVertexCount, 3, CTM_FALSE))
-    {
-      free((void *) indices);
-      free((void *) intNormals);
-      free((void *) restoredVertices);
-      free((void *) sortVertices);
-      return CTM_FALSE;
-    }
-
-    // Free temporary normal data
-    free((void *) intNormals);
   }
 
   // Free restored indices and vertices
   free((void *) indices);
   free((void *) restoredVertices);
 
-  // Write UV maps
-  map = self->mUVMaps;
-  while(map)
+  // Convert UV coordinates to integers and calculate deltas (entropy-reduction)
+  for(map = self->mUVMaps; map; map = map->mNext)
   {
-    // Convert UV coordinates to integers and calculate deltas (entropy-reduction)
-    intUVCoords = (CTMint *) malloc(sizeof(CTMint) * 2 * self->mVertexCount);
-    if(!intUVCoords)
-    {
-      self->mError = CTM_OUT_OF_MEMORY;
-      free((void *) sortVertices);
+    intMaps = _ctmNewMG2Block(self, aBlocks, aBlockCount, self->mVertexCount, 2, CTM_TRUE);
+    if(!intMaps)
       return CTM_FALSE;
+    _ctmMakeUVCoordDeltas(self, map, intMaps, aSortVertices);
+  }
+
+  // Convert vertex attributes to integers and calculate deltas (entropy-reduction)
+  for(map = self->mAttribMaps; map; map = map->mNext)
+  {
+    intMaps = _ctmNewMG2Block(self, aBlocks, aBlockCount, self->mVertexCount, 4, CTM_TRUE);
+    if(!intMaps)
+      return CTM_FALSE;
+    _ctmMakeAttribDeltas(self, map, intMaps, aSortVertices);
+  }
+
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmPackMG2Streams() - Compress all the packed streams concurrently. Each
+// stream is compressed exactly as it would be on its own, so the output does
+// not depend on the number of threads.
+//-----------------------------------------------------------------------------
+static int _ctmPackMG2Streams(_CTMcontext * self, _CTMpackedints * aBlocks,
+  CTMuint aBlockCount)
+{
+  CTMenum error = CTM_NONE;
+  int i;
+
+  #pragma omp parallel for num_threads((int) self->mCompressionThreads) schedule(dynamic, 1)
+  for(i = 0; i < (int) aBlockCount; ++ i)
+  {
+    CTMenum result = _ctmPackInts(&aBlocks[i], self->mCompressionLevel, self->mFastCompression);
+    if(result != CTM_NONE)
+    {
+      #pragma omp critical
+      error = result;
     }
-    _ctmMakeUVCoordDeltas(self, map, intUVCoords, sortVertices);
+  }
+
+  if(error != CTM_NONE)
+  {
+    self->mError = error;
+    return CTM_FALSE;
+  }
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmCompressMesh_MG2() - Compress the mesh that is stored in the CTM
+// context, and write it the the output stream in the CTM context.
+//-----------------------------------------------------------------------------
+int _ctmCompressMesh_MG2(_CTMcontext * self)
+{
+  _CTMgrid grid;
+  _CTMsortvertex * sortVertices;
+  _CTMpackedints * blocks, * block;
+  _CTMfloatmap * map;
+  CTMuint i, blockCount, mapCount;
+  int ok;
 
-    // Write UV coordinates
 #ifdef __DEBUG_
-    printf("Texture coordinates (%s): ", map->mName ? map->mName : "no name");
+  printf("COMPRESSION METHOD: MG2\n");
 #endif
-    _ctmStreamWrite(self, (void *) "TEXC", 4);
-    _ctmStreamWriteSTRING(self, map->mName);
-    _ctmStreamWriteSTRING(self, map->mFileName);
-    _ctmStreamWriteFLOAT(self, map->mPrecision);
-    if(!_ctmStreamWritePackedInts(self, intUVCoords, self->mVertexCount, 2, CTM_TRUE))
+
+  // Setup 3D space subdivision grid
+  _ctmSetupGrid(self, &grid);
+
+  // Allocate the temporary arrays (vertices, grid indices, indices, normals
+  // and one per map)
+  mapCount = 0;
+  for(map = self->mUVMaps; map; map = map->mNext)
+    ++ mapCount;
+  for(map = self->mAttribMaps; map; map = map->mNext)
+    ++ mapCount;
+  sortVertices = (_CTMsortvertex *) malloc(sizeof(_CTMsortvertex) * self->mVertexCount);
+  blocks = (_CTMpackedints *) malloc(sizeof(_CTMpackedints) * (4 + mapCount));
+  if(!sortVertices || !blocks)
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    free((void *) sortVertices);
+    free((void *) blocks);
+    return CTM_FALSE;
+  }
+
+  // Calculate and compress all the streams before writing anything
+  blockCount = 0;
+  ok = _ctmMakeMG2Streams(self, &grid, sortVertices, blocks, &blockCount) &&
+       _ctmPackMG2Streams(self, blocks, blockCount);
+  free((void *) sortVertices);
+  if(ok)
+  {
+    // Write MG2-specific header information to the stream
+    _ctmStreamWrite(self, (void *) "MG2H", 4);
+    _ctmStreamWriteFLOAT(self, self->mVertexPrecision);
+    _ctmStreamWriteFLOAT(self, self->mNormalPrecision);
+    _ctmStreamWriteFLOAT(self, grid.mMin[0]);
+    _ctmStreamWriteFLOAT(self, grid.mMin[1]);
+    _ctmStreamWriteFLOAT(self, grid.mMin[2]);
+    _ctmStreamWriteFLOAT(self, grid.mMax[0]);
+    _ctmStreamWriteFLOAT(self, grid.mMax[1]);
+    _ctmStreamWriteFLOAT(self, grid.mMax[2]);
+    _ctmStreamWriteUINT(self, grid.mDivision[0]);
+    _ctmStreamWriteUINT(self, grid.mDivision[1]);
+    _ctmStreamWriteUINT(self, grid.mDivision[2]);
+
+    // Write vertices, grid indices and triangle indices
+    block = blocks;
+    _ctmStreamWrite(self, (void *) "VERT", 4);
+    _ctmStreamWritePackedBlock(self, block ++);
+    _ctmStreamWrite(self, (void *) "GIDX", 4);
+    _ctmStreamWritePackedBlock(self, block ++);
+    _ctmStreamWrite(self, (void *) "INDX", 4);
+    _ctmStreamWritePackedBlock(self, block ++);
+
+    // Write normals
+    if(self->mNormals)
     {
-      free((void *) intUVCoords);
-      free((void *) sortVertices);
-      return CTM_FALSE;
+      _ctmStreamWrite(self, (void *) "NORM", 4);
+      _ctmStreamWritePackedBlock(self, block ++);
     }
 
-    // Free temporary UV coordinate data
-    free((void *) intUVCoords);
+    // Write UV maps
+    for(map = self->mUVMaps; map; map = map->mNext)
+    {
+      _ctmStreamWrite(self, (void *) "TEXC", 4);
+      _ctmStreamWriteSTRING(self, map->mName);
+      _ctmStreamWriteSTRING(self, map->mFileName);
+      _ctmStreamWriteFLOAT(self, map->mPrecision);
+      _ctmStreamWritePackedBlock(self, block ++);
+    }
 
-    map = map->mNext;
+    // Write vertex attribute maps
+    for(map = self->mAttribMaps; map; map = map->mNext)
+    {
+      _ctmStreamWrite(self, (void *) "ATTR", 4);
+      _ctmStreamWriteSTRING(self, map->mName);
+      _ctmStreamWriteFLOAT(self, map->mPrecision);
+      _ctmStreamWritePackedBlock(self, block ++);
+    }
   }
 
-  // Write vertex attribute maps
-  map = self->mAttribMaps;
-  while(map)
+  // Free temporary data
+  for(i = 0; i < blockCount; ++ i)
+  {
+    free((void *) blocks[i].mData);
+    free((void *) blocks[i].mPacked);
+  }
+  free((void *) blocks);
+
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+// _CTMmg2streams - Temporary arrays for the packed streams of an MG2 file.
+// For multithreaded decoding, the packed data of every stream is read up front
+// (into mBlocks), and all streams are uncompressed concurrently before any of
+// the mesh arrays are restored.
+//-----------------------------------------------------------------------------
+typedef struct {
+  CTMint * mIntVertices;
+  CTMuint * mGridIndices;
+  CTMint * mIntNormals;
+  CTMint ** mIntMaps;       // UV maps followed by attribute maps
+  CTMuint mMapCount;
+  _CTMpackedints * mBlocks; // Deferred packed streams (NULL = decode directly)
+  CTMuint mBlockCount;
+} _CTMmg2streams;
+
+//-----------------------------------------------------------------------------
+// _ctmFreeMG2Streams() - Free all temporary MG2 stream data.
+//-----------------------------------------------------------------------------
+static void _ctmFreeMG2Streams(_CTMmg2streams * aStreams)
+{
+  CTMuint i;
+
+  free((void *) aStreams->mIntVertices);
+  free((void *) aStreams->mGridIndices);
+  free((void *) aStreams->mIntNormals);
+  if(aStreams->mIntMaps)
+  {
+    for(i = 0; i < aStreams->mMapCount; ++ i)
+      free((void *) aStreams->mIntMaps[i]);
+    free((void *) aStreams->mIntMaps);
+  }
+  if(aStreams->mBlocks)
+  {
+    for(i = 0; i < aStreams->mBlockCount; ++ i)
+      free((void *) aStreams->mBlocks[i].mPacked);
+    free((void *) aStreams->mBlocks);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// _ctmReadMG2Stream() - Read a packed integer stream, and either uncompress it
+// right away or queue it for multithreaded decoding.
+//-----------------------------------------------------------------------------
+static int _ctmReadMG2Stream(_CTMcontext * self, _CTMmg2streams * aStreams,
+  CTMint * aData, CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  _CTMpackedints * block;
+
+  if(!aStreams->mBlocks)
+    return _ctmStreamReadPackedInts(self, aData, aCount, aSize, aSignedInts);
+
+  block = &aStreams->mBlocks[aStreams->mBlockCount ++];
+  block->mPacked = (unsigned char *) 0;
+  block->mData = aData;
+  block->mCount = aCount;
+  block->mSize = aSize;
+  block->mSignedInts = aSignedInts;
+  return _ctmStreamReadPackedBlock(self, block);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmDecodeMG2Streams() - Uncompress all queued packed streams concurrently.
+//-----------------------------------------------------------------------------
+static int _ctmDecodeMG2Streams(_CTMcontext * self, _CTMmg2streams * aStreams)
+{
+  CTMenum error = CTM_NONE;
+  int i;
+
+  #pragma omp parallel for num_threads((int) self->mDecodeThreads) schedule(dynamic, 1)
+  for(i = 0; i < (int) aStreams->mBlockCount; ++ i)
   {
-    // Convert vertex attributes to integers and calculate deltas (entropy-reduction)
-    intAttribs = (CTMint *) malloc(sizeof(CTMint) * 4 * self->mVertexCount);
-    if(!intAttribs)
+    CTMenum result = _ctmUnpackInts(&aStreams->mBlocks[i]);
+    if(result != CTM_NONE)
     {
-      self->mError = CTM_OUT_OF_MEMORY;
-      free((void *) sortVertices);
-      return CTM_FALSE;
+      #pragma omp critical
+      error = result;
     }
-    _ctmMakeAttribDeltas(self, map, intAttribs, sortVertices);
+  }
 
-    // Write vertex attributes
-#ifdef __DEBUG_
-    printf("Vertex attributes (%s): ", map->mName ? map->mName : "no name");
-#endif
-    _ctmStreamWrite(self, (void *) "ATTR", 4);
-    _ctmStreamWriteSTRING(self, map->mName);
-    _ctmStreamWriteFLOAT(self, map->mPrecision);
-    if(!_ctmStreamWritePackedInts(self, intAttribs, self->mVertexCount, 4, CTM_TRUE))
+  if(error != CTM_NONE)
+  {
+    self->mError = error;
+    return CTM_FALSE;
+  }
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmRestoreMG2Vertices() - Restore the vertices from the decoded vertex and
+// grid index streams.
+//-----------------------------------------------------------------------------
+static void _ctmRestoreMG2Vertices(_CTMcontext * self,
+  _CTMmg2streams * aStreams, _CTMgrid * aGrid)
+{
+  CTMuint i;
+
+  // Restore grid indices (deltas)
+  for(i = 1; i < self->mVertexCount; ++ i)
+    aStreams->mGridIndices[i] += aStreams->mGridIndices[i - 1];
+
+  // Restore vertices
+  _ctmRestoreVertices(self, aStreams->mIntVertices, aStreams->mGridIndices,
+                      aGrid, self->mVertices);
+
+  // Free temporary resources
+  free((void *) aStreams->mGridIndices);
+  free((void *) aStreams->mIntVertices);
+  aStreams->mGridIndices = (CTMuint *) 0;
+  aStreams->mIntVertices = (CTMint *) 0;
+  _ctmStreamArrayReady(self, CTM_VERTICES);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmRestoreMG2Indices() - Restore the triangle indices in place.
+//-----------------------------------------------------------------------------
+static int _ctmRestoreMG2Indices(_CTMcontext * self)
+{
+  CTMuint i;
+
+  // Restore indices
+  _ctmRestoreIndices(self, self->mIndices);
+
+  // Check that all indices are within range
+  for(i = 0; i < (self->mTriangleCount * 3); ++ i)
+  {
+    if(self->mIndices[i] >= self->mVertexCount)
     {
-      free((void *) intAttribs);
-      free((void *) sortVertices);
+      self->mError = CTM_INVALID_MESH;
       return CTM_FALSE;
     }
+  }
+  _ctmStreamArrayReady(self, CTM_INDICES);
 
-    // Free temporary vertex attribute data
-    free((void *) intAttribs);
+  return CTM_TRUE;
+}
 
-    map = map->mNext;
-  }
+//-----------------------------------------------------------------------------
+// _ctmRestoreMG2Normals() - Restore the normals (requires the vertices and
+// indices to be restored first).
+//-----------------------------------------------------------------------------
+static int _ctmRestoreMG2Normals(_CTMcontext * self,
+  _CTMmg2streams * aStreams)
+{
+  if(!aStreams->mIntNormals)
+    return CTM_TRUE;
 
-  // Free temporary data
-  free((void *) sortVertices);
+  // Restore normals
+  if(!_ctmRestoreNormals(self, aStreams->mIntNormals))
+    return CTM_FALSE;
+
+  // Free temporary normals data
+  free((void *) aStreams->mIntNormals);
+  aStreams->mIntNormals = (CTMint *) 0;
+  _ctmStreamArrayReady(self, CTM_NORMALS);
 
   return CTM_TRUE;
 }
@@ -1083,10 +1379,11 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
 //-----------------------------------------------------------------------------
 int _ctmUncompressMesh_MG2(_CTMcontext * self)
 {
-  CTMuint * gridIndices, i;
-  CTMint * intVertices, * intNormals, * intUVCoords, * intAttribs;
+  CTMuint i, k;
+  CTMint deferred;
   _CTMfloatmap * map;
   _CTMgrid grid;
+  _CTMmg2streams streams;
 
   // Read MG2-specific header information from the stream
   if(_ctmStreamReadUINT(self) != FOURCC("MG2H"))
@@ -1132,124 +1429,115 @@ int _ctmUncompressMesh_MG2(_CTMcontext * self)
   for(i = 0; i < 3; ++ i)
     grid.mSize[i] = (grid.mMax[i] - grid.mMin[i]) / grid.mDivision[i];
 
-  // Read vertices
-  if(_ctmStreamReadUINT(self) != FOURCC("VERT"))
+  // Allocate temporary memory for all the streams
+  memset(&streams, 0, sizeof(_CTMmg2streams));
+  streams.mMapCount = self->mUVMapCount + self->mAttribMapCount;
+  streams.mIntVertices = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 3);
+  streams.mGridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount);
+  if(self->mNormals)
+    streams.mIntNormals = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 3);
+  if(streams.mMapCount > 0)
+    streams.mIntMaps = (CTMint **) calloc(streams.mMapCount, sizeof(CTMint *));
+  if(!streams.mIntVertices || !streams.mGridIndices ||
+     (self->mNormals && !streams.mIntNormals) ||
+     ((streams.mMapCount > 0) && !streams.mIntMaps))
   {
-    self->mError = CTM_BAD_FORMAT;
+    self->mError = CTM_OUT_OF_MEMORY;
+    _ctmFreeMG2Streams(&streams);
     return CTM_FALSE;
   }
-  intVertices = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 3);
-  if(!intVertices)
+  for(i = 0; i < streams.mMapCount; ++ i)
   {
-    self->mError = CTM_OUT_OF_MEMORY;
+    k = (i < self->mUVMapCount) ? 2 : 4;
+    streams.mIntMaps[i] = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * k);
+    if(!streams.mIntMaps[i])
+    {
+      self->mError = CTM_OUT_OF_MEMORY;
+      _ctmFreeMG2Streams(&streams);
+      return CTM_FALSE;
+    }
+  }
+
+  // Queue the packed streams for concurrent decoding?
+  if(self->mDecodeThreads > 1)
+  {
+    streams.mBlocks = (_CTMpackedints *) malloc(sizeof(_CTMpackedints) * (4 + streams.mMapCount));
+    if(!streams.mBlocks)
+    {
+      self->mError = CTM_OUT_OF_MEMORY;
+      _ctmFreeMG2Streams(&streams);
+      return CTM_FALSE;
+    }
+  }
+  deferred = streams.mBlocks ? CTM_TRUE : CTM_FALSE;
+
+  // Read vertices
+  if(_ctmStreamReadUINT(self) != FOURCC("VERT"))
+  {
+    self->mError = CTM_BAD_FORMAT;
+    _ctmFreeMG2Streams(&streams);
     return CTM_FALSE;
   }
-  if(!_ctmStreamReadPackedInts(self, intVertices, self->mVertexCount, 3, CTM_FALSE))
+  if(!_ctmReadMG2Stream(self, &streams, streams.mIntVertices, self->mVertexCount, 3, CTM_FALSE))
   {
-    free((void *) intVertices);
+    _ctmFreeMG2Streams(&streams);
     return CTM_FALSE;
   }
 
   // Read grid indices
   if(_ctmStreamReadUINT(self) != FOURCC("GIDX"))
   {
-    free((void *) intVertices);
     self->mError = CTM_BAD_FORMAT;
+    _ctmFreeMG2Streams(&streams);
     return CTM_FALSE;
   }
-  gridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount);
-  if(!gridIndices)
+  if(!_ctmReadMG2Stream(self, &streams, (CTMint *) streams.mGridIndices, self->mVertexCount, 1, CTM_FALSE))
   {
-    self->mError = CTM_OUT_OF_MEMORY;
-    free((void *) intVertices);
+    _ctmFreeMG2Streams(&streams);
     return CTM_FALSE;
   }
-  if(!_ctmStreamReadPackedInts(self, (CTMint *) gridIndices, self->mVertexCount, 1, CTM_FALSE))
-  {
-    free((void *) gridIndices);
-    free((void *) intVertices);
-    return CTM_FALSE;
-  }
-
-  // Restore grid indices (deltas)
-  for(i = 1; i < self->mVertexCount; ++ i)
-    gridIndices[i] += gridIndices[i - 1];
-
-  // Restore vertices
-  _ctmRestoreVertices(self, intVertices, gridIndices, &grid, self->mVertices);
-
-  // Free temporary resources
-  free((void *) gridIndices);
-  free((void *) intVertices);
+  if(!deferred)
+    _ctmRestoreMG2Vertices(self, &streams, &grid);
 
   // Read triangle indices
   if(_ctmStreamReadUINT(self) != FOURCC("INDX"))
   {
     self->mError = CTM_BAD_FORMAT;
+    _ctmFreeMG2Streams(&streams);
     return CTM_FALSE;
   }
-  if(!_ctmStreamReadPackedInts(self, (CTMint *) self->mIndices, self->mTriangleCount, 3, CTM_FALSE))
-    return CTM_FALSE;
-
-  // Restore indices
-  _ctmRestoreIndices(self, self->mIndices);
-
-  // Check that all indices are within range
-  for(i = 0; i < (self->mTriangleCount * 3); ++ i)
+  if(!_ctmReadMG2Stream(self, &streams, (CTMint *) self->mIndices, self->mTriangleCount, 3, CTM_FALSE) ||
+     (!deferred && !_ctmRestoreMG2Indices(self)))
   {
-    if(self->mIndices[i] >= self->mVertexCount)
-    {
-      self->mError = CTM_INVALID_MESH;
-      return CTM_FALSE;
-    }
+    _ctmFreeMG2Streams(&streams);
+    return CTM_FALSE;
   }
 
   // Read normals
   if(self->mNormals)
   {
-    intNormals = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 3);
-    if(!intNormals)
-    {
-      self->mError = CTM_OUT_OF_MEMORY;
-      return CTM_FALSE;
-    }
     if(_ctmStreamReadUINT(self) != FOURCC("NORM"))
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intNormals);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
-    if(!_ctmStreamReadPackedInts(self, intNormals, self->mVertexCount, 3, CTM_FALSE))
+    if(!_ctmReadMG2Stream(self, &streams, streams.mIntNormals, self->mVertexCount, 3, CTM_FALSE) ||
+       (!deferred && !_ctmRestoreMG2Normals(self, &streams)))
     {
-      free((void *) intNormals);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
-
-    // Restore normals
-    if(!_ctmRestoreNormals(self, intNormals))
-    {
-      free((void *) intNormals);
-      return CTM_FALSE;
-    }
-
-    // Free temporary normals data
-    free((void *) intNormals);
   }
 
   // Read UV maps
   map = self->mUVMaps;
-  while(map)
+  for(i = 0; map; ++ i, map = map->mNext)
   {
-    intUVCoords = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 2);
-    if(!intUVCoords)
-    {
-      self->mError = CTM_OUT_OF_MEMORY;
-      return CTM_FALSE;
-    }
     if(_ctmStreamReadUINT(self) != FOURCC("TEXC"))
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intUVCoords);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
     _ctmStreamReadSTRING(self, &map->mName);
@@ -1258,38 +1546,24 @@ int _ctmUncompressMesh_MG2(_CTMcontext * self)
     if(map->mPrecision <= 0.0f)
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intUVCoords);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
-    if(!_ctmStreamReadPackedInts(self, intUVCoords, self->mVertexCount, 2, CTM_TRUE))
+    if(!_ctmReadMG2Stream(self, &streams, streams.mIntMaps[i], self->mVertexCount, 2, CTM_TRUE))
     {
-      free((void *) intUVCoords);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
-
-    // Restore UV coordinates
-    _ctmRestoreUVCoords(self, map, intUVCoords);
-
-    // Free temporary UV coordinate data
-    free((void *) intUVCoords);
-
-    map = map->mNext;
   }
 
   // Read vertex attribute maps
   map = self->mAttribMaps;
-  while(map)
+  for(; map; ++ i, map = map->mNext)
   {
-    intAttribs = (CTMint *) malloc(sizeof(CTMint) * self->mVertexCount * 4);
-    if(!intAttribs)
-    {
-      self->mError = CTM_OUT_OF_MEMORY;
-      return CTM_FALSE;
-    }
     if(_ctmStreamReadUINT(self) != FOURCC("ATTR"))
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intAttribs);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
     _ctmStreamReadSTRING(self, &map->mName);
@@ -1297,23 +1571,43 @@ int _ctmUncompressMesh_MG2(_CTMcontext * self)
     if(map->mPrecision <= 0.0f)
     {
       self->mError = CTM_BAD_FORMAT;
-      free((void *) intAttribs);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
-    if(!_ctmStreamReadPackedInts(self, intAttribs, self->mVertexCount, 4, CTM_TRUE))
+    if(!_ctmReadMG2Stream(self, &streams, streams.mIntMaps[i], self->mVertexCount, 4, CTM_TRUE))
     {
-      free((void *) intAttribs);
+      _ctmFreeMG2Streams(&streams);
       return CTM_FALSE;
     }
+  }
 
-    // Restore vertex attributes
-    _ctmRestoreAttribs(self, map, intAttribs);
+  // Uncompress all queued streams, and restore the mesh arrays in dependency
+  // order (normals are predicted from the vertices and indices)
+  if(deferred)
+  {
+    if(!_ctmDecodeMG2Streams(self, &streams))
+    {
+      _ctmFreeMG2Streams(&streams);
+      return CTM_FALSE;
+    }
+    _ctmRestoreMG2Vertices(self, &streams, &grid);
+    if(!_ctmRestoreMG2Indices(self) || !_ctmRestoreMG2Normals(self, &streams))
+    {
+      _ctmFreeMG2Streams(&streams);
+      return CTM_FALSE;
+    }
+  }
 
-    // Free temporary vertex attribute data
-    free((void *) intAttribs);
+  // Restore UV coordinates and vertex attributes
+  map = self->mUVMaps;
+  for(i = 0; map; ++ i, map = map->mNext)
+    _ctmRestoreUVCoords(self, map, streams.mIntMaps[i]);
+  map = self->mAttribMaps;
+  for(; map; ++ i, map = map->mNext)
+    _ctmRestoreAttribs(self, map, streams.mIntMaps[i]);
 
-    map = map->mNext;
-  }
+  // Free temporary resources
+  _ctmFreeMG2Streams(&streams);
 
   return CTM_TRUE;
 }
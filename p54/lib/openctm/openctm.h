@@ -215,6 +215,10 @@ typedef enum {
   CTM_METHOD_MG1        = 0x0202, ///< Lossless compression (floating point).
   CTM_METHOD_MG2        = 0x0203, ///< Lossless compression (fixed point).
 
+  // Compression presets
+  CTM_PRESET_DEFAULT    = 0x0401, ///< Best compression ratio for the compression level.
+  CTM_PRESET_FAST       = 0x0402, ///< Faster LZMA encoding, at a slightly lower ratio.
+
   // Context queries
   CTM_VERTEX_COUNT      = 0x0301, ///< Number of vertices in the mesh (integer).
   CTM_TRIANGLE_COUNT    = 0x0302, ///< Number of triangles in the mesh (integer).
@@ -272,6 +276,24 @@ typedef CTMuint (CTMCALL * CTMreadfn)(void * aBuf, CTMuint aCount, void * aUserD
 ///         indicates that an error occured).
 typedef CTMuint (CTMCALL * CTMwritefn)(const void * aBuf, CTMuint aCount, void * aUserData);
 
+/// Streaming import map() function pointer.
+/// @param[in] aArray The array that is about to be decoded (CTM_INDICES,
+///            CTM_VERTICES or CTM_NORMALS).
+/// @param[in] aSize The size of the array, in bytes.
+/// @param[in] aUserData The custom user data that was passed to the
+///            ctmStreamingImport() function.
+/// @return A caller owned buffer of at least aSize bytes that the array will
+///         be decoded into, or NULL to let OpenCTM allocate the array itself.
+typedef void * (CTMCALL * CTMmapfn)(CTMenum aArray, CTMuint aSize, void * aUserData);
+
+/// Streaming import progress() function pointer.
+/// @param[in] aArray The array that has just been fully decoded, or CTM_NONE
+///            for an intermediate progress report.
+/// @param[in] aBytesRead The number of bytes consumed from the stream so far.
+/// @param[in] aUserData The custom user data that was passed to the
+///            ctmStreamingImport() function.
+typedef void (CTMCALL * CTMprogressfn)(CTMenum aArray, CTMuint aBytesRead, void * aUserData);
+
 /// Create a new OpenCTM context. The context is used for all subsequent
 /// OpenCTM function calls. Several contexts can coexist at the same time.
 /// @param[in] aMode An OpenCTM context mode. Set this to CTM_IMPORT if the
@@ -471,6 +493,41 @@ CTMEXPORT void CTMCALL ctmCompressionMethod(CTMcontext aContext,
 CTMEXPORT void CTMCALL ctmCompressionLevel(CTMcontext aContext,
   CTMuint aLevel);
 
+/// Select an LZMA encoder preset. CTM_PRESET_FAST uses a faster match finder
+/// and shorter matches, which speeds up encoding considerably at the cost of
+/// a slightly larger file. The files can be read by any OpenCTM reader. The
+/// default preset is CTM_PRESET_DEFAULT.
+/// @param[in] aContext An OpenCTM context that has been created by
+///            ctmNewContext().
+/// @param[in] aPreset Which preset to use: CTM_PRESET_DEFAULT or
+///            CTM_PRESET_FAST.
+/// @see ctmCompressionLevel().
+CTMEXPORT void CTMCALL ctmCompressionPreset(CTMcontext aContext,
+  CTMenum aPreset);
+
+/// Set how many threads to use for compressing a mesh (only used by the MG2
+/// compression method). Vertex and triangle sorting is split between the
+/// threads, and the packed streams are compressed concurrently. The output is
+/// identical for any number of threads. The default is 1. Multithreaded
+/// compression requires OpenMP support in the build.
+/// @param[in] aContext An OpenCTM context that has been created by
+///            ctmNewContext().
+/// @param[in] aThreadCount Maximum number of compression threads (at least 1).
+CTMEXPORT void CTMCALL ctmCompressionThreads(CTMcontext aContext,
+  CTMuint aThreadCount);
+
+/// Set how many threads to use for decoding packed data when importing a file
+/// (only used by the MG2 compression method). The packed streams of an MG2
+/// file are independent, so with more than one thread they are read up front
+/// and uncompressed concurrently. The default is 1 (decode on the calling
+/// thread, in small chunks). Multithreaded decoding requires OpenMP support
+/// in the build; otherwise the streams are decoded one after another.
+/// @param[in] aContext An OpenCTM context that has been created by
+///            ctmNewContext().
+/// @param[in] aThreadCount Maximum number of decoding threads.
+CTMEXPORT void CTMCALL ctmDecodeThreads(CTMcontext aContext,
+  CTMuint aThreadCount);
+
 /// Set the vertex coordinate precision (only used by the MG2 compression
 /// method).
 /// @param[in] aContext An OpenCTM context that has been created by
@@ -622,6 +679,25 @@ CTMEXPORT void CTMCALL ctmLoad(CTMcontext aContext, const char * aFileName);
 CTMEXPORT void CTMCALL ctmLoadCustom(CTMcontext aContext, CTMreadfn aReadFn,
   void * aUserData);
 
+/// Enable streaming import for subsequent calls to ctmLoad() and
+/// ctmLoadCustom(). Compressed data is read and decoded in small chunks, and the
+/// index, vertex and normal arrays are decoded directly into buffers that are
+/// provided by the map function (e.g. mapped GPU staging memory). The progress
+/// function is called periodically, and once for each array as soon as it is
+/// complete.
+/// @note Caller provided arrays must remain readable until the load function
+///       returns, since MG2 predicts normals from the vertices and indices.
+///       They are never freed by OpenCTM.
+/// @param[in] aContext An OpenCTM context that has been created by
+///            ctmNewContext().
+/// @param[in] aMapFn Pointer to a custom map function (or NULL).
+/// @param[in] aProgressFn Pointer to a custom progress function (or NULL).
+/// @param[in] aUserData Custom user data, which will be passed to the map
+///            and progress functions.
+/// @see CTMmapfn, CTMprogressfn.
+CTMEXPORT void CTMCALL ctmStreamingImport(CTMcontext aContext, CTMmapfn aMapFn,
+  CTMprogressfn aProgressFn, void * aUserData);
+
 /// Save an OpenCTM format file. The mesh must have been defined by
 /// ctmDefineMesh().
 /// @param[in] aContext An OpenCTM context that has been created by
@@ -0,0 +1,64 @@
+#include "CurveSampler.h"
+#include <math.h>
+
+#ifndef Pi
+#define Pi (3.14159265f)
+#endif
+
+// The closed paths that the fish swim along, each once around over t in [0, 1].
+
+Point3 EllipseCurve(float t, const void* context)
+{
+    float theta = 2 * Pi * t;
+    return P3MakeFromElems(2 * cos(theta), 0, sin(theta));
+}
+
+// Upside-down Pacman ghost, in eight stages:
+Point3 GhostCurve(float t, const void* context)
+{
+    float tt = fmod(t, 1.0f) * 8.0f;
+    int stage = (int) tt;
+    float fraction = tt - (float) stage;
+    float x = 0, y = 0;
+    switch (stage) {
+    case 0:
+        x = -6 + fraction * 12.0f;
+        y = -7;
+        break;
+    case 1:
+        tt = (1 - fraction) * Pi * 0.5f;
+        x = +6 + 6 * cos(tt);
+        y = -1 - 6 * sin(tt);
+        break;
+    case 2:
+        x = 12;
+        y = -1 + 6 * fraction;
+        break;
+    case 3:
+    case 4:
+    case 5:
+        fraction = ((stage - 3) + fraction) / 3.0f;
+        x = 12 - 24 * fraction;
+        y = 5 + 3 * sin(fraction * 5.0f * Pi);
+        break;
+    case 6:
+        x = -12;
+        y = 5 - 6 * fraction;
+        break;
+    case 7:
+        tt = fraction * Pi * 0.5f;
+        x = -6 - 6 * cos(tt);
+        y = -1 - 6 * sin(tt);
+        break;
+    }
+    return P3MakeFromElems(x / 4.0f, 0, y / 5.0f);
+}
+
+Point3 GrannyKnotCurve(float t, const void* context)
+{
+    t = 2 * Pi * t;
+    float x = -0.22 * cos(t) - 1.28 * sin(t) - 0.44 * cos(3 * t) - 0.78 * sin(3 * t);
+    float y = -0.1 * cos(2 * t) - 0.27 * sin(2 * t) + 0.38 * cos(4 * t) + 0.46 * sin(4 * t);
+    float z = 0.7 * cos(3 * t) - 0.4 * sin(3 * t);
+    return P3MakeFromElems(x, y, z);
+}
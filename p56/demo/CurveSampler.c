@@ -0,0 +1,264 @@
+#include "CurveSampler.h"
+#include <stdlib.h>
+#include <math.h>
+
+// A piece of the curve with its ends and quarter points, keyed by how far the quarter points
+// stray from the chord:
+typedef struct SegmentRec
+{
+    float T0, T1;
+    Point3 Points[5];
+    float Error;
+} Segment;
+
+static Point3 Evaluate(Curve curve, float t)
+{
+    return curve.Function(t, curve.Context);
+}
+
+static float GetDistanceToLine(Point3 p, Point3 a, Point3 b)
+{
+    Vector3 axis = P3Sub(b, a);
+    Vector3 offset = P3Sub(p, a);
+    float lengthSqr = V3LengthSqr(axis);
+    if (lengthSqr == 0)
+        return V3Length(offset);
+    float along = V3Dot(offset, axis) / lengthSqr;
+    return V3Length(V3Sub(offset, V3ScalarMul(axis, along)));
+}
+
+static void MeasureSegment(Segment* segment)
+{
+    Point3* p = segment->Points;
+    segment->Error = 0;
+    for (int i = 1; i < 4; ++i) {
+        float d = GetDistanceToLine(p[i], p[0], p[4]);
+        if (d > segment->Error)
+            segment->Error = d;
+    }
+}
+
+// Fills in the quarter points of a segment whose ends and middle are known:
+static void FillSegment(Curve curve, Segment* segment)
+{
+    float dt = (segment->T1 - segment->T0) * 0.25f;
+    segment->Points[1] = Evaluate(curve, segment->T0 + dt);
+    segment->Points[3] = Evaluate(curve, segment->T0 + 3 * dt);
+    MeasureSegment(segment);
+}
+
+// Max-heap of segments by error:
+static void SiftDown(Segment* heap, int count, int i)
+{
+    for (;;) {
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && heap[left].Error > heap[largest].Error)
+            largest = left;
+        if (right < count && heap[right].Error > heap[largest].Error)
+            largest = right;
+        if (largest == i)
+            return;
+        Segment temp = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = temp;
+        i = largest;
+    }
+}
+
+static void SiftUp(Segment* heap, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent].Error >= heap[i].Error)
+            return;
+        Segment temp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = temp;
+        i = parent;
+    }
+}
+
+static int CompareSegments(const void* a, const void* b)
+{
+    float ta = ((const Segment*) a)->T0;
+    float tb = ((const Segment*) b)->T0;
+    return (ta > tb) - (ta < tb);
+}
+
+static ArcLengthTable AllocateTable(int count)
+{
+    ArcLengthTable table;
+    table.Count = count;
+    table.Params = (float*) malloc(sizeof(float) * count);
+    table.Lengths = (float*) malloc(sizeof(float) * count);
+    table.Points = (Point3*) malloc(sizeof(Point3) * count);
+    return table;
+}
+
+static void AccumulateLengths(ArcLengthTable* table)
+{
+    // Sum in double, since thousands of float additions would lose more than the tolerance:
+    double length = 0;
+    table->Lengths[0] = 0;
+    for (int i = 1; i < table->Count; ++i) {
+        length += P3Dist(table->Points[i - 1], table->Points[i]);
+        table->Lengths[i] = (float) length;
+    }
+}
+
+ArcLengthTable CreateArcLengthTable(Curve curve, float tolerance, int maxSamples)
+{
+    // Each segment adds four samples, and a split adds four more.  Budgets too small for
+    // CurveMinSegments start with fewer, but never less than one:
+    int maxSegments = (maxSamples - 1) / 4;
+    if (maxSegments < 1)
+        maxSegments = 1;
+    Segment* heap = (Segment*) malloc(sizeof(Segment) * maxSegments);
+
+    int count = maxSegments < CurveMinSegments ? maxSegments : CurveMinSegments;
+    Point3 start = Evaluate(curve, 0);
+    for (int i = 0; i < count; ++i) {
+        Segment* segment = heap + i;
+        segment->T0 = (float) i / count;
+        segment->T1 = (float) (i + 1) / count;
+        segment->Points[0] = start;
+        segment->Points[2] = Evaluate(curve, 0.5f * (segment->T0 + segment->T1));
+        segment->Points[4] = start = Evaluate(curve, segment->T1);
+        FillSegment(curve, segment);
+    }
+    for (int i = count / 2 - 1; i >= 0; --i)
+        SiftDown(heap, count, i);
+
+    // Split the worst segment until all are good enough or the budget is spent:
+    while (count < maxSegments && heap[0].Error > tolerance) {
+        Segment parent = heap[0];
+        float middle = 0.5f * (parent.T0 + parent.T1);
+        if (middle <= parent.T0 || middle >= parent.T1)
+            break;
+
+        Segment* left = heap;
+        left->T0 = parent.T0;
+        left->T1 = middle;
+        left->Points[0] = parent.Points[0];
+        left->Points[2] = parent.Points[1];
+        left->Points[4] = parent.Points[2];
+        FillSegment(curve, left);
+        SiftDown(heap, count, 0);
+
+        Segment* right = heap + count;
+        right->T0 = middle;
+        right->T1 = parent.T1;
+        right->Points[0] = parent.Points[2];
+        right->Points[2] = parent.Points[3];
+        right->Points[4] = parent.Points[4];
+        FillSegment(curve, right);
+        SiftUp(heap, count++);
+    }
+
+    qsort(heap, count, sizeof(Segment), CompareSegments);
+    ArcLengthTable table = AllocateTable(4 * count + 1);
+    for (int i = 0; i < count; ++i) {
+        float dt = (heap[i].T1 - heap[i].T0) * 0.25f;
+        for (int j = 0; j < 4; ++j) {
+            table.Params[4 * i + j] = heap[i].T0 + j * dt;
+            table.Points[4 * i + j] = heap[i].Points[j];
+        }
+    }
+    table.Params[4 * count] = 1;
+    table.Points[4 * count] = heap[count - 1].Points[4];
+    AccumulateLengths(&table);
+
+    free(heap);
+    return table;
+}
+
+ArcLengthTable CreateUniformArcLengthTable(Curve curve, int count)
+{
+    ArcLengthTable table = AllocateTable(count);
+    for (int i = 0; i < count; ++i) {
+        table.Params[i] = (float) i / (count - 1);
+        table.Points[i] = Evaluate(curve, table.Params[i]);
+    }
+    AccumulateLengths(&table);
+    return table;
+}
+
+void FreeArcLengthTable(ArcLengthTable* table)
+{
+    free(table->Params);
+    free(table->Lengths);
+    free(table->Points);
+    table->Count = 0;
+}
+
+float FindCurveParam(Curve curve, const ArcLengthTable* table, float s, int newtonSteps)
+{
+    // Find the last sample at or before s:
+    int lo = 0;
+    int hi = table->Count - 1;
+    while (hi - lo > 1) {
+        int middle = (lo + hi) / 2;
+        if (table->Lengths[middle] <= s)
+            lo = middle;
+        else
+            hi = middle;
+    }
+
+    float t0 = table->Params[lo];
+    float t1 = table->Params[hi];
+    float s0 = table->Lengths[lo];
+    float chord = table->Lengths[hi] - s0;
+    float fraction = chord > 0 ? (s - s0) / chord : 0;
+    fraction = fraction < 0 ? 0 : (fraction > 1 ? 1 : fraction);
+    float t = t0 + (t1 - t0) * fraction;
+
+    // Within the segment, take the distance from its start as the arc length and solve for
+    // where that reaches s, with the slope taken over a small step:
+    float dt = (t1 - t0) * (1.0f / 64.0f);
+    Point3 origin = table->Points[lo];
+    for (int step = 0; step < newtonSteps; ++step) {
+        float h = t + dt <= t1 ? dt : -dt;
+        float d = P3Dist(Evaluate(curve, t), origin);
+        float slope = (P3Dist(Evaluate(curve, t + h), origin) - d) / h;
+        if (!(slope > 0))
+            break;
+        float next = t - (s0 + d - s) / slope;
+        next = next < t0 ? t0 : (next > t1 ? t1 : next);
+        if (next == t)
+            break;
+        t = next;
+    }
+    return t;
+}
+
+void ResampleCurve(const ArcLengthTable* table, int newtonSteps, const CurveJob* job)
+{
+    float length = GetArcLength(table);
+    float spacing = job->Closed ? length / job->Count : length / (job->Count - 1);
+    float start = job->Closed ? job->Phase * length : 0;
+    for (int i = 0; i < job->Count; ++i) {
+        float s = start + i * spacing;
+        if (job->Closed)
+            s = fmodf(s, length);
+        float t = FindCurveParam(job->Path, table, s, newtonSteps);
+        job->Params[i] = t;
+        if (job->Positions) {
+            Point3 p = Evaluate(job->Path, t);
+            job->Positions[3 * i + 0] = p.x;
+            job->Positions[3 * i + 1] = p.y;
+            job->Positions[3 * i + 2] = p.z;
+        }
+    }
+}
+
+void ResampleCurves(const CurveJob* jobs, int jobCount, float tolerance, int maxSamples, int newtonSteps)
+{
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < jobCount; ++i) {
+        ArcLengthTable table = CreateArcLengthTable(jobs[i].Path, tolerance, maxSamples);
+        ResampleCurve(&table, newtonSteps, jobs + i);
+        FreeArcLengthTable(&table);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <vectormath.h>
+
+// Arc-length sampling of parametric curves, for laying out path textures with evenly spaced
+// nodes at any width.  Nothing here needs OpenGL.
+//
+// A curve is sampled by adaptive subdivision: the parameter range starts out cut into
+// CurveMinSegments pieces (fewer if the sample budget is smaller), and the piece whose quarter points stray furthest from its chord
+// is split until every piece is within the tolerance or the sample budget runs out, so the
+// work is bounded however wiggly the curve.  The samples form a table of cumulative chord
+// length, which is inverted by binary search followed by a few Newton steps on the exact curve.
+
+enum { CurveMinSegments = 32 };
+
+typedef Point3 (*CurveFunction)(float t, const void* context);
+
+typedef struct CurveRec
+{
+    CurveFunction Function;     // Defined over t in [0, 1]
+    const void* Context;
+} Curve;
+
+typedef struct ArcLengthTableRec
+{
+    int Count;                  // The first sample is at t = 0 and the last at t = 1
+    float* Params;
+    float* Lengths;             // Chord length from t = 0 to each sample
+    Point3* Points;
+} ArcLengthTable;
+
+// Nodes spread evenly along a curve.  A closed curve gets Count nodes spaced by its length
+// over Count, starting Phase of the way around, so that the last wraps onto the first.  An
+// open curve gets nodes at both ends and ignores Phase.  Positions is xyz per node and may be null.
+typedef struct CurveJobRec
+{
+    Curve Path;
+    int Closed;
+    float Phase;
+    int Count;
+    float* Params;
+    float* Positions;
+} CurveJob;
+
+// Subdivides until the curve is within tolerance of the chords or maxSamples is reached.
+// A table has 4n + 1 samples for n segments, so it never has more than maxSamples unless
+// maxSamples is below 5, the size of a single segment.
+ArcLengthTable CreateArcLengthTable(Curve curve, float tolerance, int maxSamples);
+
+// Samples evenly in t, as a fixed-size path texture used to be laid out.
+ArcLengthTable CreateUniformArcLengthTable(Curve curve, int count);
+
+void FreeArcLengthTable(ArcLengthTable* table);
+
+static inline float GetArcLength(const ArcLengthTable* table)
+{
+    return table->Lengths[table->Count - 1];
+}
+
+// Parameter at arc length s.  With no Newton steps this interpolates linearly within the table.
+float FindCurveParam(Curve curve, const ArcLengthTable* table, float s, int newtonSteps);
+
+void ResampleCurve(const ArcLengthTable* table, int newtonSteps, const CurveJob* job);
+
+// Builds a table for each job and resamples it, with the jobs spread over all threads.
+void ResampleCurves(const CurveJob* jobs, int jobCount, float tolerance, int maxSamples, int newtonSteps);
+
+// CurvePaths.c
+Point3 EllipseCurve(float t, const void* context);
+Point3 GhostCurve(float t, const void* context);
+Point3 GrannyKnotCurve(float t, const void* context);
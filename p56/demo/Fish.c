@@ -136,7 +136,7 @@ const char* PezInitialize(int width, int height)
     DolphinMesh = CreateMesh("Dolphin.ctm", 1, 1.25f);
     SquidMesh = CreateMesh("Squid.ctm", 1, 1);
     TunaMesh = CreateMesh("Tuna.ctm", 0.25, 0.25);
-    PathTexture = CreatePathTexture();
+    PathTexture = CreatePathTexture(128, 128);
     BentProgram = CreateProgram("Fish.Vertex.Bent", 0, "Fish.Fragment");
 
     // Set up the projection matrix:
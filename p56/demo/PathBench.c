@@ -0,0 +1,214 @@
+// Headless accuracy and timing of the curve sampling in CurveSampler.c; needs neither OpenGL
+// nor a window.  For each of the fish paths, compares tables sampled evenly in t (as the path
+// texture used to be laid out) against adaptive tables at several tolerances, with and without
+// Newton steps, and reports the sample count, the error in total length, and how far the
+// spacing between resampled nodes strays from even, measured against a dense reference in
+// double precision.  Then resamples a batch of granny knots on one thread and on all of them.
+// Usage: pathbench [width] [batchCount]
+
+#include "CurveSampler.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const int ReferenceCount = 1 << 16;
+static const float BatchTolerance = 0.001f;
+static const int BatchMaxSamples = 4097;
+
+typedef struct ReferenceRec
+{
+    Curve Path;
+    const char* Label;
+    double* Lengths;
+} Reference;
+
+static void SetThreadCount(int threadCount)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+}
+
+static Reference CreateReference(CurveFunction function, const char* label)
+{
+    Reference reference;
+    reference.Path.Function = function;
+    reference.Path.Context = 0;
+    reference.Label = label;
+    reference.Lengths = (double*) malloc(sizeof(double) * (ReferenceCount + 1));
+    reference.Lengths[0] = 0;
+    Point3 previous = function(0, 0);
+    for (int i = 1; i <= ReferenceCount; ++i) {
+        Point3 p = function((float) ((double) i / ReferenceCount), 0);
+        double dx = p.x - previous.x, dy = p.y - previous.y, dz = p.z - previous.z;
+        reference.Lengths[i] = reference.Lengths[i - 1] + sqrt(dx * dx + dy * dy + dz * dz);
+        previous = p;
+    }
+    return reference;
+}
+
+static double GetReferenceLength(const Reference* reference, float t)
+{
+    double x = t * (double) ReferenceCount;
+    int i = (int) x;
+    if (i >= ReferenceCount)
+        return reference->Lengths[ReferenceCount];
+    double f = x - i;
+    return reference->Lengths[i] * (1 - f) + reference->Lengths[i + 1] * f;
+}
+
+// Largest departure of the spacing between consecutive nodes of a closed path from even,
+// relative to the even spacing:
+static double GetSpacingError(const Reference* reference, const float* params, int count)
+{
+    double total = reference->Lengths[ReferenceCount];
+    double spacing = total / count;
+    double worst = 0;
+    for (int i = 0; i < count; ++i) {
+        double a = GetReferenceLength(reference, params[i]);
+        double b = GetReferenceLength(reference, params[(i + 1) % count]);
+        double gap = fmod(b - a + total, total);
+        double error = fabs(gap - spacing) / spacing;
+        if (error > worst)
+            worst = error;
+    }
+    return worst;
+}
+
+// Builds a table as configured; a positive count samples evenly in t instead of adaptively.
+static ArcLengthTable CreateTable(Curve path, int uniformCount, float tolerance)
+{
+    if (uniformCount > 0)
+        return CreateUniformArcLengthTable(path, uniformCount);
+    return CreateArcLengthTable(path, tolerance, BatchMaxSamples);
+}
+
+static double RunSampler(const Reference* reference, int uniformCount, float tolerance, int newtonSteps, int width)
+{
+    float* params = (float*) malloc(sizeof(float) * width);
+    CurveJob job;
+    job.Path = reference->Path;
+    job.Closed = 1;
+    job.Phase = 0;
+    job.Count = width;
+    job.Params = params;
+    job.Positions = 0;
+
+    // Time enough repetitions to get past the timer's resolution:
+    int repeats = 0;
+    int sampleCount = 0;
+    double start = GetSeconds();
+    double elapsed;
+    do {
+        ArcLengthTable table = CreateTable(reference->Path, uniformCount, tolerance);
+        ResampleCurve(&table, newtonSteps, &job);
+        sampleCount = table.Count;
+        FreeArcLengthTable(&table);
+        ++repeats;
+        elapsed = GetSeconds() - start;
+    } while (elapsed < 0.05);
+
+    ArcLengthTable table = CreateTable(reference->Path, uniformCount, tolerance);
+    double total = reference->Lengths[ReferenceCount];
+    double lengthError = fabs(GetArcLength(&table) - total) / total;
+    FreeArcLengthTable(&table);
+    double spacingError = GetSpacingError(reference, params, width);
+    free(params);
+
+    char method[32];
+    if (uniformCount > 0)
+        sprintf(method, "uniform");
+    else
+        sprintf(method, "adaptive %.0e", tolerance);
+    printf("%-8s %-14s newton %d  %5d samples  length error %.1e  spacing error %.1e  %8.1f us\n",
+        reference->Label, method, newtonSteps, sampleCount, lengthError, spacingError, elapsed / repeats * 1e6);
+    return spacingError;
+}
+
+static double RunBatch(CurveJob* jobs, int jobCount, int threadCount)
+{
+    SetThreadCount(threadCount);
+    double start = GetSeconds();
+    ResampleCurves(jobs, jobCount, BatchTolerance, BatchMaxSamples, 2);
+    return GetSeconds() - start;
+}
+
+int main(int argc, char** argv)
+{
+    int width = argc > 1 ? atoi(argv[1]) : 128;
+    int batchCount = argc > 2 ? atoi(argv[2]) : 4096;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    Reference references[3];
+    references[0] = CreateReference(EllipseCurve, "ellipse");
+    references[1] = CreateReference(GhostCurve, "ghost");
+    references[2] = CreateReference(GrannyKnotCurve, "granny");
+
+    // The adaptive tables at the tolerance used for the path texture must space the nodes
+    // within a percent of even:
+    int passed = 1;
+    for (int i = 0; i < 3; ++i) {
+        for (int count = 33; count <= 2049; count = 4 * count - 3)
+            RunSampler(references + i, count, 0, 0, width);
+        for (float tolerance = 0.01f; tolerance > 0.000005f; tolerance *= 0.1f)
+            for (int newtonSteps = 0; newtonSteps <= 2; newtonSteps += 2) {
+                double error = RunSampler(references + i, 0, tolerance, newtonSteps, width);
+                if (tolerance < 0.002f && newtonSteps > 0 && error > 0.01)
+                    passed = 0;
+            }
+    }
+
+    // The sample budget must hold even when the tolerance can never be met, including budgets
+    // too small for CurveMinSegments:
+    int budgets[] = { 1025, 4 * CurveMinSegments + 1, 33, 5 };
+    for (int i = 0; i < (int) (sizeof(budgets) / sizeof(budgets[0])); ++i) {
+        ArcLengthTable capped = CreateArcLengthTable(references[1].Path, 0, budgets[i]);
+        int bounded = capped.Count <= budgets[i];
+        printf("ghost at zero tolerance: %d samples of at most %d  %s\n", capped.Count, budgets[i],
+            bounded ? "bounded" : "UNBOUNDED");
+        FreeArcLengthTable(&capped);
+        passed = passed && bounded;
+    }
+
+    // Granny knots at random phases, as in the path texture:
+    CurveJob* jobs = (CurveJob*) malloc(sizeof(CurveJob) * batchCount);
+    float* params = (float*) malloc(sizeof(float) * width * batchCount);
+    float* threadedParams = (float*) malloc(sizeof(float) * width * batchCount);
+    for (int i = 0; i < batchCount; ++i) {
+        jobs[i].Path = references[2].Path;
+        jobs[i].Closed = 1;
+        jobs[i].Phase = (float) rand() / RAND_MAX;
+        jobs[i].Count = width;
+        jobs[i].Params = params + i * width;
+        jobs[i].Positions = 0;
+    }
+    double serialTime = RunBatch(jobs, batchCount, 1);
+    for (int i = 0; i < batchCount; ++i)
+        jobs[i].Params = threadedParams + i * width;
+    double threadedTime = RunBatch(jobs, batchCount, threadCount);
+    int identical = !memcmp(params, threadedParams, sizeof(float) * width * batchCount);
+    printf("batch of %d knots x %d nodes  1 thread %.1f ms  %d threads %.1f ms  %.0f paths/s  %s\n",
+        batchCount, width, serialTime * 1e3, threadCount, threadedTime * 1e3, batchCount / threadedTime,
+        identical ? "identical" : "MISMATCH");
+    passed = passed && identical;
+
+    free(jobs);
+    free(params);
+    free(threadedParams);
+    for (int i = 0; i < 3; ++i)
+        free(references[i].Lengths);
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
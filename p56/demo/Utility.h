@@ -19,4 +19,4 @@ typedef struct TextureRec
 Mesh CreateMesh(const char* ctmFile, float totalScale, float lengthScale);
 Mesh CreateCylinder(float height, float radius, int stacks, int slices);
 GLuint CreateProgram(const char* vsKey, const char* gsKey, const char* fsKey);
-Texture CreatePathTexture();
+Texture CreatePathTexture(int width, int height);
@@ -1,52 +1,82 @@
 #include "Splat.h"
+#include "Timer.h"
 #include <fstream>
 #include <string>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
 
 using namespace std;
 
+SplatList CreateSplatPoints(const PointList& positions)
+{
+    SplatList points(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        VectorMath::Point3 position = positions[i];
+        VectorMath::Vector3 velocity = positions[(i + 1) % positions.size()] - position;
+        SplatPointPod& point = points[i];
+        point.Position[0] = position.getX();
+        point.Position[1] = position.getY();
+        point.Position[2] = position.getZ();
+        point.Value[0] = velocity.getX();
+        point.Value[1] = velocity.getY();
+        point.Value[2] = velocity.getZ();
+    }
+    return points;
+}
+
 GLuint CreateSplat(GLuint quadVao, PointList positions)
 {
-    const int Size = 64;
+    return CreateSplat(quadVao, CreateSplatPoints(positions), CreateSplatKernel(0.4f, 1.0f), 64);
+}
+
+GLuint CreateSplat(GLuint quadVao, const SplatList& points, SplatKernelPod kernel, int size)
+{
+    static GLuint program = 0;
+    if (!program)
+        program = CreateProgram("Splat.VS", "Splat.GS", "Splat.FS");
 
-    Surface surface = CreateVolume(Size, Size, Size);
-    GLuint program = CreateProgram("Splat.VS", "Splat.GS", "Splat.FS");
+    Surface surface = CreateVolume(size, size, size);
     glUseProgram(program);
 
     GLint inverseSize = glGetUniformLocation(program, "InverseSize");
-    glUniform1f(inverseSize, 1.0f / (float) Size);
-
-    const float innerScale = 0.4f;
+    glUniform1f(inverseSize, 1.0f / (float) size);
 
     GLint inverseVariance = glGetUniformLocation(program, "InverseVariance");
-    glUniform1f(inverseVariance, -1.0f / (2.0f * innerScale * innerScale));
+    glUniform1f(inverseVariance, kernel.InverseVariance);
 
     GLint normalizationConstant = glGetUniformLocation(program, "NormalizationConstant");
-    glUniform1f(normalizationConstant, 1.0f / std::pow(std::sqrt(TwoPi) * innerScale, 3.0f));
+    glUniform1f(normalizationConstant, kernel.NormalizationConstant);
+
+    GLint radius = glGetUniformLocation(program, "Radius");
+    glUniform1f(radius, kernel.Radius);
+
+    GLint center = glGetUniformLocation(program, "Center");
+    GLint color = glGetUniformLocation(program, "Color");
+    GLint firstLayer = glGetUniformLocation(program, "FirstLayer");
 
     glBindFramebuffer(GL_FRAMEBUFFER, surface.FboHandle);
     glBindTexture(GL_TEXTURE_3D, 0);
-    glViewport(0, 0, Size, Size);
+    glViewport(0, 0, size, size);
     glBindVertexArray(quadVao);
     
     glEnable(GL_BLEND);
     glBlendFunc(GL_ONE, GL_ONE);
 
-    PointList::const_iterator i = positions.begin();
-    for (; i != positions.end(); ++i) {
-
-        PointList::const_iterator next = i;
-        if (++next == positions.end())
-            next = positions.begin();
-        VectorMath::Vector3 velocity = (*next - *i);
+    SplatList::const_iterator i = points.begin();
+    for (; i != points.end(); ++i) {
 
-        GLint center = glGetUniformLocation(program, "Center");
-        glUniform4f(center, i->getX(), i->getY(), i->getZ(), 0);
+        // Draw only the layers within the footprint; layer k sits at 1 - 2k / size:
+        float z = i->Position[2];
+        int firstCovered = std::max(0, (int) std::ceil((1.0f - z - kernel.Radius) * size / 2));
+        int lastCovered = std::min(size - 1, (int) std::floor((1.0f - z + kernel.Radius) * size / 2));
+        if (firstCovered > lastCovered)
+            continue;
 
-        GLint color = glGetUniformLocation(program, "Color");
-        glUniform3fv(color, 1, (float*) &velocity);
-
-        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, Size);
+        glUniform4f(center, i->Position[0], i->Position[1], z, 0);
+        glUniform3fv(color, 1, i->Value);
+        glUniform1i(firstLayer, firstCovered);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, lastCovered - firstCovered + 1);
     }
 
     PezCheckCondition(GL_NO_ERROR == glGetError(), "Unable to create splat.");
@@ -57,53 +87,69 @@ GLuint CreateSplat(GLuint quadVao, PointList positions)
     return surface.TextureHandle[0];
 }
 
-GLuint CreateCpuSplat(GLuint quadVao)
+GLuint CreateCpuSplat(const SplatList& points, SplatKernelPod kernel, int size)
 {
-    const int Size = 64;
-    const float InnerScale = 0.4f;
-    const float RadiusScale = 0.001f;
-
-    char* pixels = new char[Size*Size*Size];
-    {
-        // http://www.stat.wisc.edu/~mchung/teaching/MIA/reading/diffusion.gaussian.kernel.pdf.pdf
-        float doubleVariance = 2.0f * InnerScale * InnerScale;
-        float normalizationConstant = 1.0f / std::pow(std::sqrt(TwoPi) * InnerScale, 3.0f);
-        char* pDest = pixels;
-        float maxDensity = 0;
-        float sumDensity = 0;
-        float minDensity = 100.0f;
-        for (int z = 0; z < Size; ++z) {
-            for (int y = 0; y < Size; ++y) {
-                for (int x = 0; x < Size; ++x) {
-                    int cx = x - Size / 2;
-                    int cy = y - Size / 2;
-                    int cz = z - Size / 2;
-                    float r2 = RadiusScale * float(cx*cx + cy*cy + cz*cz);
-                    float density = normalizationConstant * std::exp(-r2 / doubleVariance);
-                    maxDensity = std::max(maxDensity, density);
-                    minDensity = std::min(minDensity, density);
-                    sumDensity += density;
-                    *pDest++ = (char) (255.0f * density);
-                }
-            }
-        }
-        PezDebugString("maximum = %f\n", maxDensity);
-        PezDebugString("minimum = %f\n", minDensity);
-        PezDebugString("sum = %f\n", sumDensity);
-    }
+    SplatGridPod grid = CreateSplatGrid(size, size, size);
+    SplatPoints(points, kernel, &grid);
 
     GLuint textureHandle;
     glGenTextures(1, &textureHandle);
     glBindTexture(GL_TEXTURE_3D, textureHandle);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, Size, Size, Size, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
-
-    delete [] pixels;
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, size, size, size, 0, GL_RGB, GL_FLOAT, &grid.Data[0]);
 
     return textureHandle;
 }
 
+void BenchmarkSplats(GLuint quadVao)
+{
+    // A footprint of three standard deviations, with the deviation at one and a half cells:
+    const int Size = 128;
+    float innerScale = 1.5f * 2.0f / Size;
+    SplatKernelPod kernel = CreateSplatKernel(innerScale, 3 * innerScale);
+
+    for (int count = 10000; count <= 1000000; count *= 10) {
+        SplatList points(count);
+        for (int i = 0; i < count; ++i)
+            for (int c = 0; c < 3; ++c) {
+                points[i].Position[c] = 2.0f * rand() / RAND_MAX - 1.0f;
+                points[i].Value[c] = 2.0f * rand() / RAND_MAX - 1.0f;
+            }
+
+        glFinish();
+        double start = GetSeconds();
+        GLuint gpuTexture = CreateSplat(quadVao, points, kernel, Size);
+        glFinish();
+        double gpuTime = GetSeconds() - start;
+
+        start = GetSeconds();
+        GLuint cpuTexture = CreateCpuSplat(points, kernel, Size);
+        glFinish();
+        double cpuTime = GetSeconds() - start;
+
+        // Both textures hold halves, so compare them as read back:
+        std::vector<float> gpu(Size * Size * Size * 3), cpu(gpu.size());
+        glBindTexture(GL_TEXTURE_3D, gpuTexture);
+        glGetTexImage(GL_TEXTURE_3D, 0, GL_RGB, GL_FLOAT, &gpu[0]);
+        glBindTexture(GL_TEXTURE_3D, cpuTexture);
+        glGetTexImage(GL_TEXTURE_3D, 0, GL_RGB, GL_FLOAT, &cpu[0]);
+        float error = 0, largest = 0;
+        for (size_t i = 0; i < gpu.size(); ++i) {
+            error = std::max(error, std::fabs(gpu[i] - cpu[i]));
+            largest = std::max(largest, std::fabs(cpu[i]));
+        }
+
+        PezDebugString("%7d splats: GL %8.1f ms, CPU %7.1f ms, relative difference %.1e\n",
+            count, gpuTime * 1000, cpuTime * 1000, largest > 0 ? error / largest : error);
+        glDeleteTextures(1, &gpuTexture);
+        glDeleteTextures(1, &cpuTexture);
+    }
+}
+
 GLuint CreateTeapot()
 {
     int Width = 256;
@@ -18,6 +18,7 @@ static GLuint NoiseTexture;
 static Matrix4 ProjectionMatrix;
 static Matrix4 ModelviewMatrix;
 static Trackball Trackball(PEZ_VIEWPORT_HEIGHT / 2);
+static bool BenchmarkSplat = false;
 
 static void BindProgram(GLuint program);
 static GLenum* EnumArray(GLenum a, GLenum b);
@@ -36,6 +37,8 @@ const char* PezInitialize(int width, int height)
 
     PointList positions = CreatePathline();
     SplatTexture = CreateSplat(QuadVao, positions);
+    if (BenchmarkSplat)
+        BenchmarkSplats(QuadVao);
 
     NoiseTexture = CreateNoise();
 
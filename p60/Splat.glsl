@@ -4,11 +4,12 @@ in vec4 Position;
 out vec2 vPosition;
 out int vInstance;
 uniform vec4 Center;
+uniform float Radius;
 
 void main()
 {
-    gl_Position = Position + Center;
-    vPosition = Position.xy;
+    vPosition = Position.xy * Radius;
+    gl_Position = vec4(vPosition + Center.xy, 0, 1);
     vInstance = gl_InstanceID;
 }
 
@@ -22,11 +23,14 @@ in vec2 vPosition[3];
 out vec3 gPosition;
 
 uniform float InverseSize;
+uniform int FirstLayer;
+uniform vec4 Center;
 
 void main()
 {
-    gPosition.z = 1.0 - 2.0 * vInstance[0] * InverseSize;
-    gl_Layer = int(vInstance[0]);
+    int layer = FirstLayer + vInstance[0];
+    gPosition.z = 1.0 - 2.0 * layer * InverseSize - Center.z;
+    gl_Layer = layer;
 
     gPosition.xy = vPosition[0];
     gl_Position = gl_in[0].gl_Position;
@@ -1,8 +1,10 @@
 #include "Pez.h"
 #include "VectorMath.h"
+#include "SplatCpu.h"
 #include <vector>
 
 typedef std::vector<VectorMath::Point3> PointList;
+typedef std::vector<SplatPointPod> SplatList;
 
 struct Surface {
     GLuint FboHandle;
@@ -18,6 +20,10 @@ GLuint CreateCube();
 GLuint CreateProgram(const char* vsKey, const char* gsKey, const char* fsKey);
 PointList CreatePathline();
 GLuint CreateSplat(GLuint quadVao, PointList positions);
+GLuint CreateSplat(GLuint quadVao, const SplatList& points, SplatKernelPod kernel, int size);
+GLuint CreateCpuSplat(const SplatList& points, SplatKernelPod kernel, int size);
+SplatList CreateSplatPoints(const PointList& positions);
+void BenchmarkSplats(GLuint quadVao);
 GLuint CreateNoise();
 Surface CreateSurface(GLsizei width, GLsizei height, int numComponents, int numTargets = 1);
 Surface CreateVolume(GLsizei width, GLsizei height, GLsizei depth);
@@ -0,0 +1,122 @@
+// Headless timing of the CPU splatting in SplatCpu.cpp.  For 10k, 100k, and 1M random points
+// on a 128^3 grid, times the serial per-cell splat and the tiled one on one thread and on all
+// of them; checks that the tiled results agree with each other exactly and with the serial
+// one to within rounding.  Also checks a grid that isn't a multiple of the tile size, and the
+// kernel that CreateSplat uses for the pathline.  The GL path needs a window; Splat.cpp times
+// it against the CPU when BenchmarkSplat is set.
+// Usage: SplatBench [maxPointCount]
+
+#include "SplatCpu.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static unsigned int Seed = 1;
+
+static float Random(float lo, float hi)
+{
+    Seed = Seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (Seed >> 8) / 16777216.0f;
+}
+
+static std::vector<SplatPointPod> CreateRandomPoints(int count)
+{
+    std::vector<SplatPointPod> points(count);
+    for (int i = 0; i < count; ++i)
+        for (int c = 0; c < 3; ++c) {
+            points[i].Position[c] = Random(-1, 1);
+            points[i].Value[c] = Random(-1, 1);
+        }
+    return points;
+}
+
+// Largest difference relative to the largest magnitude in the serial result.
+static float GetRelativeError(const SplatGridPod& a, const SplatGridPod& b)
+{
+    float error = 0, largest = 0;
+    for (size_t i = 0; i < a.Data.size(); ++i) {
+        error = std::max(error, std::fabs(a.Data[i] - b.Data[i]));
+        largest = std::max(largest, std::fabs(a.Data[i]));
+    }
+    return largest > 0 ? error / largest : error;
+}
+
+static void SetThreadCount(int threadCount)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+}
+
+static bool Compare(const char* label, const std::vector<SplatPointPod>& points, SplatKernelPod kernel,
+    int width, int height, int depth, int threadCount)
+{
+    SplatGridPod serial = CreateSplatGrid(width, height, depth);
+    SplatGridPod single = serial, threaded = serial;
+
+    double start = GetSeconds();
+    SplatPointsSerial(points, kernel, &serial);
+    double serialTime = GetSeconds() - start;
+
+    SetThreadCount(1);
+    start = GetSeconds();
+    SplatPoints(points, kernel, &single);
+    double singleTime = GetSeconds() - start;
+
+    SetThreadCount(threadCount);
+    start = GetSeconds();
+    SplatPoints(points, kernel, &threaded);
+    double threadedTime = GetSeconds() - start;
+
+    bool identical = single.Data == threaded.Data;
+    float error = GetRelativeError(serial, single);
+    bool passed = identical && error < 1e-4f;
+    printf("%-14s %8d points %dx%dx%d  serial %8.1f ms  tiled 1 thread %7.1f ms  %2d threads %7.1f ms  error %.1e  %s\n",
+        label, (int) points.size(), width, height, depth, serialTime * 1000, singleTime * 1000,
+        threadCount, threadedTime * 1000, error, passed ? "identical" : "MISMATCH");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    int maxPointCount = argc > 1 ? atoi(argv[1]) : 1000000;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    // A footprint of three standard deviations, with the deviation at one and a half cells:
+    const int Size = 128;
+    float innerScale = 1.5f * 2.0f / Size;
+    SplatKernelPod kernel = CreateSplatKernel(innerScale, 3 * innerScale);
+
+    bool passed = true;
+    for (int count = 10000; count <= maxPointCount; count *= 10)
+        passed = Compare("random", CreateRandomPoints(count), kernel, Size, Size, Size, threadCount) && passed;
+    passed = Compare("uneven grid", CreateRandomPoints(10000), kernel, 100, 72, 50, threadCount) && passed;
+
+    // The pathline from CreatePathline with the kernel in CreateSplat:
+    std::vector<SplatPointPod> pathline(64);
+    for (int i = 0; i < 64; ++i) {
+        float theta = i * 6.28318531f / 64, next = (i + 1) * 6.28318531f / 64;
+        SplatPointPod& point = pathline[i];
+        point.Position[0] = 0.5f * std::cos(theta);
+        point.Position[1] = 0.5f * std::sin(theta);
+        point.Position[2] = 0;
+        point.Value[0] = 0.5f * (std::cos(next) - std::cos(theta));
+        point.Value[1] = 0.5f * (std::sin(next) - std::sin(theta));
+        point.Value[2] = 0;
+    }
+    passed = Compare("pathline", pathline, CreateSplatKernel(0.4f, 1.0f), 64, 64, 64, threadCount) && passed;
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include "SplatCpu.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPLAT_SSE2 1
+#endif
+
+static const int TileCells = SplatTileSize * SplatTileSize * SplatTileSize;
+
+// Binning works on chunks of points in parallel; each chunk keeps its own count per tile.
+static const int MinChunkSize = 4096;
+static const int MaxChunkCount = 64;
+
+SplatGridPod CreateSplatGrid(int width, int height, int depth)
+{
+    SplatGridPod grid;
+    grid.Width = width;
+    grid.Height = height;
+    grid.Depth = depth;
+    grid.Origin[0] = -1.0f + 1.0f / width;
+    grid.Origin[1] = -1.0f + 1.0f / height;
+    grid.Origin[2] = 1.0f;
+    grid.Spacing[0] = 2.0f / width;
+    grid.Spacing[1] = 2.0f / height;
+    grid.Spacing[2] = -2.0f / depth;
+    grid.Data.resize((size_t) width * height * depth * 3);
+    return grid;
+}
+
+SplatKernelPod CreateSplatKernel(float innerScale, float radius)
+{
+    const float twoPi = 6.28318531f;
+    SplatKernelPod kernel;
+    kernel.InverseVariance = -1.0f / (2.0f * innerScale * innerScale);
+    kernel.NormalizationConstant = 1.0f / std::pow(std::sqrt(twoPi) * innerScale, 3.0f);
+    kernel.Radius = radius;
+    return kernel;
+}
+
+// Finds the cells along one axis whose centers are within radius of p.
+static bool GetCellRange(float p, float radius, float origin, float spacing, int count, int* lo, int* hi)
+{
+    float a = (p - radius - origin) / spacing;
+    float b = (p + radius - origin) / spacing;
+    if (a > b)
+        std::swap(a, b);
+    if (!(b >= 0 && a <= count - 1))
+        return false;
+    *lo = std::max((int) std::ceil(std::max(a, -1.0f)), 0);
+    *hi = std::min((int) std::floor(std::min(b, (float) count)), count - 1);
+    return *lo <= *hi;
+}
+
+static bool GetFootprint(const SplatGridPod& grid, const SplatPointPod& point, float radius, int lo[3], int hi[3])
+{
+    int counts[3] = { grid.Width, grid.Height, grid.Depth };
+    for (int axis = 0; axis < 3; ++axis)
+        if (!GetCellRange(point.Position[axis], radius, grid.Origin[axis], grid.Spacing[axis], counts[axis], &lo[axis], &hi[axis]))
+            return false;
+    return true;
+}
+
+// Adds weights[x] * scale to row[x] for x in [x0, x1].  Weights outside that range must be
+// zero, since the SSE version works on whole groups of four.
+static void AddRow(float* row, const float* weights, float scale, int x0, int x1)
+{
+#ifdef SPLAT_SSE2
+    __m128 s = _mm_set1_ps(scale);
+    for (int x = x0 & ~3; x <= x1; x += 4) {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(row + x), _mm_mul_ps(_mm_loadu_ps(weights + x), s));
+        _mm_storeu_ps(row + x, sum);
+    }
+#else
+    for (int x = x0; x <= x1; ++x)
+        row[x] += weights[x] * scale;
+#endif
+}
+
+void SplatPoints(const std::vector<SplatPointPod>& points, SplatKernelPod kernel, SplatGridPod* grid)
+{
+    const int T = SplatTileSize;
+    int tilesX = (grid->Width + T - 1) / T;
+    int tilesY = (grid->Height + T - 1) / T;
+    int tilesZ = (grid->Depth + T - 1) / T;
+    int tileCount = tilesX * tilesY * tilesZ;
+    int pointCount = (int) points.size();
+    int chunkSize = std::max(MinChunkSize, (pointCount + MaxChunkCount - 1) / MaxChunkCount);
+    int chunkCount = (pointCount + chunkSize - 1) / chunkSize;
+
+    // Count the points that overlap each tile, per chunk:
+    std::vector<int> cursors((size_t) chunkCount * tileCount, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        int* counts = &cursors[(size_t) chunk * tileCount];
+        int end = std::min(pointCount, (chunk + 1) * chunkSize);
+        for (int i = chunk * chunkSize; i < end; ++i) {
+            int lo[3], hi[3];
+            if (!GetFootprint(*grid, points[i], kernel.Radius, lo, hi))
+                continue;
+            for (int tz = lo[2] / T; tz <= hi[2] / T; ++tz)
+                for (int ty = lo[1] / T; ty <= hi[1] / T; ++ty)
+                    for (int tx = lo[0] / T; tx <= hi[0] / T; ++tx)
+                        ++counts[(tz * tilesY + ty) * tilesX + tx];
+        }
+    }
+
+    // Lay out each tile's list with the chunks in order, so the points stay in their original
+    // order within a tile:
+    std::vector<int> tileStarts(tileCount + 1);
+    int entryCount = 0;
+    for (int tile = 0; tile < tileCount; ++tile) {
+        tileStarts[tile] = entryCount;
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            int& cursor = cursors[(size_t) chunk * tileCount + tile];
+            int count = cursor;
+            cursor = entryCount;
+            entryCount += count;
+        }
+    }
+    tileStarts[tileCount] = entryCount;
+
+    std::vector<int> entries(entryCount);
+    #pragma omp parallel for schedule(dynamic)
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        int* cursor = &cursors[(size_t) chunk * tileCount];
+        int end = std::min(pointCount, (chunk + 1) * chunkSize);
+        for (int i = chunk * chunkSize; i < end; ++i) {
+            int lo[3], hi[3];
+            if (!GetFootprint(*grid, points[i], kernel.Radius, lo, hi))
+                continue;
+            for (int tz = lo[2] / T; tz <= hi[2] / T; ++tz)
+                for (int ty = lo[1] / T; ty <= hi[1] / T; ++ty)
+                    for (int tx = lo[0] / T; tx <= hi[0] / T; ++tx)
+                        entries[cursor[(tz * tilesY + ty) * tilesX + tx]++] = i;
+        }
+    }
+
+    // Accumulate each tile into a planar block, then interleave it into the grid:
+    #pragma omp parallel
+    {
+        std::vector<float> block(3 * TileCells);
+        float weights[3][SplatTileSize];
+
+        #pragma omp for schedule(dynamic)
+        for (int tile = 0; tile < tileCount; ++tile) {
+            int origin[3] = {
+                (tile % tilesX) * T,
+                (tile / tilesX % tilesY) * T,
+                (tile / (tilesX * tilesY)) * T };
+            int extent[3] = {
+                std::min(T, grid->Width - origin[0]),
+                std::min(T, grid->Height - origin[1]),
+                std::min(T, grid->Depth - origin[2]) };
+
+            std::fill(block.begin(), block.end(), 0.0f);
+            for (int entry = tileStarts[tile]; entry < tileStarts[tile + 1]; ++entry) {
+                const SplatPointPod& point = points[entries[entry]];
+                int lo[3], hi[3];
+                GetFootprint(*grid, point, kernel.Radius, lo, hi);
+
+                // Clip the footprint to the tile and find the 1D weights along each axis:
+                for (int axis = 0; axis < 3; ++axis) {
+                    lo[axis] = std::max(lo[axis] - origin[axis], 0);
+                    hi[axis] = std::min(hi[axis] - origin[axis], extent[axis] - 1);
+                    std::fill(weights[axis], weights[axis] + T, 0.0f);
+                    for (int i = lo[axis]; i <= hi[axis]; ++i) {
+                        float d = grid->Origin[axis] + (origin[axis] + i) * grid->Spacing[axis] - point.Position[axis];
+                        weights[axis][i] = std::exp(d * d * kernel.InverseVariance);
+                    }
+                }
+
+                float scale[3];
+                for (int c = 0; c < 3; ++c)
+                    scale[c] = point.Value[c] * kernel.NormalizationConstant;
+
+                for (int z = lo[2]; z <= hi[2]; ++z)
+                    for (int y = lo[1]; y <= hi[1]; ++y) {
+                        float w = weights[2][z] * weights[1][y];
+                        float* row = &block[(z * T + y) * T];
+                        for (int c = 0; c < 3; ++c)
+                            AddRow(row + c * TileCells, weights[0], w * scale[c], lo[0], hi[0]);
+                    }
+            }
+
+            for (int z = 0; z < extent[2]; ++z)
+                for (int y = 0; y < extent[1]; ++y) {
+                    const float* row = &block[(z * T + y) * T];
+                    float* dest = &grid->Data[3 * (((size_t) (origin[2] + z) * grid->Height + origin[1] + y) * grid->Width + origin[0])];
+                    for (int x = 0; x < extent[0]; ++x)
+                        for (int c = 0; c < 3; ++c)
+                            *dest++ = row[c * TileCells + x];
+                }
+        }
+    }
+}
+
+void SplatPointsSerial(const std::vector<SplatPointPod>& points, SplatKernelPod kernel, SplatGridPod* grid)
+{
+    std::fill(grid->Data.begin(), grid->Data.end(), 0.0f);
+    std::vector<SplatPointPod>::const_iterator point = points.begin();
+    for (; point != points.end(); ++point) {
+        int lo[3], hi[3];
+        if (!GetFootprint(*grid, *point, kernel.Radius, lo, hi))
+            continue;
+        for (int z = lo[2]; z <= hi[2]; ++z)
+            for (int y = lo[1]; y <= hi[1]; ++y)
+                for (int x = lo[0]; x <= hi[0]; ++x) {
+                    float dx = grid->Origin[0] + x * grid->Spacing[0] - point->Position[0];
+                    float dy = grid->Origin[1] + y * grid->Spacing[1] - point->Position[1];
+                    float dz = grid->Origin[2] + z * grid->Spacing[2] - point->Position[2];
+                    float r2 = dx * dx + dy * dy + dz * dz;
+                    float density = kernel.NormalizationConstant * std::exp(r2 * kernel.InverseVariance);
+                    float* dest = &grid->Data[3 * (((size_t) z * grid->Height + y) * grid->Width + x)];
+                    for (int c = 0; c < 3; ++c)
+                        dest[c] += point->Value[c] * density;
+                }
+    }
+}
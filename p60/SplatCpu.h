@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+
+// CPU version of the Gaussian splatting in Splat.glsl.  Each point adds
+//
+//     Value * NormalizationConstant * exp(r^2 * InverseVariance)
+//
+// to every cell whose center lies within a box of half-width Radius around it, as the quad
+// that CreateSplat draws per point does.  The grid is cut into tiles of SplatTileSize^3 cells,
+// the points are binned by the tiles that their footprints overlap, and each tile is
+// accumulated by one thread, so there's no contention.  Within a tile the Gaussian is
+// applied as a product of three 1D weights, so a point costs one exp per row rather than per cell.
+
+enum { SplatTileSize = 16 };
+
+struct SplatPointPod {
+    float Position[3];
+    float Value[3];
+};
+
+struct SplatKernelPod {
+    float InverseVariance;          // -1 / (2 sigma^2)
+    float NormalizationConstant;
+    float Radius;
+};
+
+// Cell (i, j, k) sits at Origin + (i, j, k) * Spacing; spacings may be negative.
+struct SplatGridPod {
+    int Width;
+    int Height;
+    int Depth;
+    float Origin[3];
+    float Spacing[3];
+    std::vector<float> Data;        // Three components per cell; x fastest
+};
+
+// Creates a grid with the cell positions that the layered draws in CreateSplat produce: pixel
+// centers across [-1, +1] in x and y, and layer k at 1 - 2k / depth in z.
+SplatGridPod CreateSplatGrid(int width, int height, int depth);
+
+// Kernel with a standard deviation of innerScale, normalized to unit volume.
+SplatKernelPod CreateSplatKernel(float innerScale, float radius);
+
+// Overwrites the grid with the sum of the splats.  The sum at each cell is taken in the
+// order of the points, so the result doesn't depend on the number of threads.
+void SplatPoints(const std::vector<SplatPointPod>& points, SplatKernelPod kernel, SplatGridPod* grid);
+
+// One point at a time with an exp per cell, as the fragment shader does it.
+void SplatPointsSerial(const std::vector<SplatPointPod>& points, SplatKernelPod kernel, SplatGridPod* grid);
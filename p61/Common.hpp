@@ -47,7 +47,7 @@ void SetUniform(const char* name, vmath::Vector3 value);
 void SetUniform(const char* name, vmath::Vector4 value);
 
 // Curve.cpp
-Curve CreateHilbertCurve(int slices, bool adjacency);
+Curve CreateHilbertCurve(int slices, int level, bool adjacency);
 Curve CreateCircle(int slices, bool adjacency);
 Curve CreateSuperellipse(int slices, float n, float a, float b, bool adjacency);
 void RenderCurve(Curve c);
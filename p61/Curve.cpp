@@ -2,75 +2,10 @@
 #include <cmath>
 #include <pez.h>
 #include "Common.hpp"
+#include "Sweep.hpp"
 
 using namespace vmath;
 
-typedef std::vector<Point3> PointList;
-static PointList HilbertPath;
-static float HilbertSegmentLength = 0.05f;
-
-struct Turtle {
-    void Move(float dx, float dy, bool changeFace = false)
-    {
-        if (changeFace) ++Face;
-        switch (Face) {
-            case 0: P += Vector3(dx, dy, 0); break;
-            case 1: P += Vector3(0, dy, dx); break;
-            case 2: P += Vector3(-dy, 0, dx); break;
-            case 3: P += Vector3(0, -dy, dx); break;
-            case 4: P += Vector3(dy, 0, dx); break;
-            case 5: P += Vector3(dy, dx, 0); break;
-        }
-
-        HilbertPath.push_back(P);
-    }
-    Point3 P;
-    int Face;
-};
-
-static Turtle HilbertTurtle;
-
-static void HilbertU(int level);
-static void HilbertD(int level);
-static void HilbertC(int level);
-static void HilbertA(int level);
-
-static void HilbertU(int level)
-{
-    if (level == 0) return; float dist = HilbertSegmentLength;
-    HilbertD(level-1);      HilbertTurtle.Move(0, -dist);
-    HilbertU(level-1);      HilbertTurtle.Move(dist, 0);
-    HilbertU(level-1);      HilbertTurtle.Move(0, dist);
-    HilbertC(level-1);
-}
- 
-static void HilbertD(int level)
-{
-    if (level == 0) return; float dist = HilbertSegmentLength;
-    HilbertU(level-1);      HilbertTurtle.Move(dist, 0);
-    HilbertD(level-1);      HilbertTurtle.Move(0, -dist);
-    HilbertD(level-1);      HilbertTurtle.Move(-dist, 0);
-    HilbertA(level-1);
-}
- 
-static void HilbertC(int level)
-{
-    if (level == 0) return; float dist = HilbertSegmentLength;
-    HilbertA(level-1);      HilbertTurtle.Move(-dist, 0);
-    HilbertC(level-1);      HilbertTurtle.Move(0, dist);
-    HilbertC(level-1);      HilbertTurtle.Move(dist, 0);
-    HilbertU(level-1);
-}
- 
-static void HilbertA(int level)
-{
-    if (level == 0) return; float dist = HilbertSegmentLength;
-    HilbertC(level-1);      HilbertTurtle.Move(0, dist);
-    HilbertA(level-1);      HilbertTurtle.Move(-dist, 0);
-    HilbertA(level-1);      HilbertTurtle.Move(0, -dist);
-    HilbertD(level-1);
-}
-
 Curve CreateCircle(int slices, bool adjacency)
 {
     Curve curve;
@@ -140,60 +75,37 @@ Curve CreateSuperellipse(int slices, float n, float a, float b, bool adjacency)
     return curve;
 }
 
-Curve CreateHilbertCurve(int slices, bool adjacency)
+Curve CreateHilbertCurve(int slices, int level, bool adjacency)
 {
-    HilbertPath.clear();
-    
-    const int lod = 3;
-    const float dist = HilbertSegmentLength;
-    HilbertU(lod); HilbertTurtle.Move(dist, 0, true);
-    HilbertU(lod); HilbertTurtle.Move(0, dist, true);
-    HilbertC(lod); HilbertTurtle.Move(0, dist, true);
-    HilbertC(lod); HilbertTurtle.Move(0, dist, true);
-    HilbertC(lod); HilbertTurtle.Move(dist, 0, true);
-    HilbertD(lod);
+    PointList path = CreateHilbertPath(level);
 
-    Point3 minCorner = HilbertPath.front();
-    Point3 maxCorner = HilbertPath.front();
-    for (PointList::const_iterator i = ++HilbertPath.begin(); i != HilbertPath.end(); ++i) {
-        minCorner = minPerElem(*i, minCorner);
-        maxCorner = maxPerElem(*i, maxCorner);
-    }
-    Vector3 offset ( lerp(0.5f, minCorner, maxCorner) );
-    for (PointList::iterator i = HilbertPath.begin(); i != HilbertPath.end(); ++i) {
-        *i -= offset;
-        *i = Point3(1.25f * normalize(Vector3(*i)));
-    }
-
-    if (adjacency) {
-        Point3 A = *HilbertPath.begin();
-        Point3 B = *(++HilbertPath.begin());
-        Point3 C = *(--HilbertPath.end());
-        Point3 D = *(--(--HilbertPath.end()));
-        HilbertPath.insert(HilbertPath.begin(), HilbertPath.front() + (A - B));
-        HilbertPath.insert(HilbertPath.begin(), HilbertPath.front() + (A - B));
-        HilbertPath.insert(HilbertPath.end(),  HilbertPath.back() + (C - D));
-        HilbertPath.insert(HilbertPath.end(),  HilbertPath.back() + (C - D));
-    }
+    // Adjacency extends the ends by two steps each, in the directions they leave in:
+    const size_t padding = adjacency ? 2 : 0;
+    const size_t count = path.size();
+    Vector3 head = path[0] - path[1];
+    Vector3 tail = path[count - 1] - path[count - 2];
 
     Curve curve;
-    curve.Count = HilbertPath.size();
+    curve.Count = count + 2 * padding;
     curve.Positions = new float[7 * curve.Count];
 
-    const float radius = 1.0f;
-    const float dtheta = TwoPi / float(slices - 1);
-    float theta = adjacency ? -dtheta : 0;
     float* p = curve.Positions;
-    PointList::const_iterator pNode = HilbertPath.begin();
-    for (size_t n = 0; n < curve.Count; theta += dtheta, ++n, ++pNode) {
+    for (size_t n = 0; n < curve.Count; ++n) {
+        Point3 node;
+        if (n < padding)
+            node = path[0] + float(padding - n) * head;
+        else if (n >= padding + count)
+            node = path[count - 1] + float(n - padding - count + 1) * tail;
+        else
+            node = path[n - padding];
 
         // Position attribute:
-        *p++ = pNode->getX();
-        *p++ = pNode->getY();
-        *p++ = pNode->getZ();
+        *p++ = node.getX();
+        *p++ = node.getY();
+        *p++ = node.getZ();
 
         // Normal vector attribute:
-        Vector3 guide( normalize(Vector3(*pNode)) );
+        Vector3 guide( normalize(Vector3(node)) );
         *p++ = guide.getX();
         *p++ = guide.getY();
         *p++ = guide.getZ();
@@ -55,7 +55,7 @@ void PezInitialize()
     PezConfig cfg = PezGetConfig();
     ParticleSurface = CreateSurface(cfg.Width, cfg.Height, 4);
     Fullscreen = CreateQuad();
-    HilbertCurve = CreateHilbertCurve(16, true);
+    HilbertCurve = CreateHilbertCurve(16, 3, true);
 
     ViewTrackball = CreateTrackball(cfg.Width * 1.0f, cfg.Height * 1.0f, cfg.Width * 0.5f);
     ModelTrackball = CreateTrackball(cfg.Width * 1.0f, cfg.Height * 1.0f, cfg.Width * 0.5f);
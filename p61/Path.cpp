@@ -0,0 +1,106 @@
+#include "Sweep.hpp"
+#include "SpaceCurve.hpp"
+#include <pez.h>
+#include <cmath>
+
+using namespace vmath;
+
+// The Hilbert path covers the six faces of a cube, each with a 2D Hilbert curve from
+// SpaceCurve.cpp that is turned so that it starts and ends next to its neighbours.  Each
+// point is found from its index alone, so the path is filled in parallel at any level.
+static const float HilbertSegmentLength = 0.05f;
+
+// 2x2 turns of the curve on each face, which starts at (0, 0) and ends at (2^level - 1, 0):
+static const int HilbertU[4] = { 1, 0, 0, -1 };
+static const int HilbertC[4] = { 0, -1, 1, 0 };
+static const int HilbertD[4] = { 0, 1, -1, 0 };
+static const int* HilbertFaceTurns[6] = { HilbertU, HilbertU, HilbertC, HilbertC, HilbertC, HilbertD };
+
+// The step from the end of each face onto the next, in the next face's coordinates:
+static const int HilbertFaceSteps[5][2] = { {1, 0}, {0, 1}, {0, 1}, {0, 1}, {1, 0} };
+
+static Vector3 MapToFace(int face, float dx, float dy)
+{
+    switch (face) {
+        case 0: return Vector3(dx, dy, 0);
+        case 1: return Vector3(0, dy, dx);
+        case 2: return Vector3(-dy, 0, dx);
+        case 3: return Vector3(0, -dy, dx);
+        case 4: return Vector3(dy, 0, dx);
+        default: return Vector3(dy, dx, 0);
+    }
+}
+
+static Vector3 GetFaceOffset(int face, uint64_t index, int level)
+{
+    unsigned axes[2];
+    DecodeHilbert(index, level, 2, axes);
+    const int* turn = HilbertFaceTurns[face];
+    float x = float(turn[0] * int(axes[0]) + turn[1] * int(axes[1]));
+    float y = float(turn[2] * int(axes[0]) + turn[3] * int(axes[1]));
+    return MapToFace(face, x * HilbertSegmentLength, y * HilbertSegmentLength);
+}
+
+PointList CreateHilbertPath(int level)
+{
+    // Each face has 4^level cells; the path leaves out the very first:
+    const int cellCount = 1 << (2 * level);
+    const int count = 6 * cellCount - 1;
+    PointList path(count);
+
+    Point3 starts[6];
+    starts[0] = Point3(0);
+    for (int face = 0; face < 5; ++face) {
+        const int* step = HilbertFaceSteps[face];
+        Point3 end = starts[face] + GetFaceOffset(face, cellCount - 1, level);
+        starts[face + 1] = end + MapToFace(face + 1, step[0] * HilbertSegmentLength, step[1] * HilbertSegmentLength);
+    }
+
+    #pragma omp parallel for
+    for (int i = 0; i < count; ++i) {
+        int face = (i + 1) / cellCount;
+        int cell = (i + 1) % cellCount;
+        path[i] = starts[face] + GetFaceOffset(face, cell, level);
+    }
+
+    Point3 minCorner = path.front();
+    Point3 maxCorner = path.front();
+    for (PointList::const_iterator i = ++path.begin(); i != path.end(); ++i) {
+        minCorner = minPerElem(*i, minCorner);
+        maxCorner = maxPerElem(*i, maxCorner);
+    }
+    Vector3 offset ( lerp(0.5f, minCorner, maxCorner) );
+    #pragma omp parallel for
+    for (int i = 0; i < count; ++i)
+        path[i] = Point3(1.25f * normalize(path[i] - Point3(offset)));
+
+    return path;
+}
+
+PointList CreateSuperellipsePath(int count, float n, float a, float b)
+{
+    PointList path(count);
+    const float dtheta = TwoPi / float(count);
+    for (int i = 0; i < count; ++i) {
+        float c = std::cos(i * dtheta);
+        float s = std::sin(i * dtheta);
+        float x = std::pow(std::abs(c), 2.0f / n) * a;
+        float y = std::pow(std::abs(s), 2.0f / n) * b;
+        path[i] = Point3(c < 0 ? -x : x, s < 0 ? -y : y, 0);
+    }
+    return path;
+}
+
+// Same knot as CreatePathTexture in p56.
+PointList CreateGrannyKnotPath(int count)
+{
+    PointList path(count);
+    for (int i = 0; i < count; ++i) {
+        float t = TwoPi * i / float(count);
+        float x = -0.22f * std::cos(t) - 1.28f * std::sin(t) - 0.44f * std::cos(3 * t) - 0.78f * std::sin(3 * t);
+        float y = -0.1f * std::cos(2 * t) - 0.27f * std::sin(2 * t) + 0.38f * std::cos(4 * t) + 0.46f * std::sin(4 * t);
+        float z = 0.7f * std::cos(3 * t) - 0.4f * std::sin(3 * t);
+        path[i] = Point3(x, y, z);
+    }
+    return path;
+}
@@ -0,0 +1,181 @@
+#include "SpaceCurve.hpp"
+
+// Cells are generated in chunks, so the loop counter fits in an int at any level:
+static const int ChunkSize = 4096;
+
+// Spreads the bits of x out to every second or third bit:
+static uint64_t SpreadBy1(uint64_t x)
+{
+    x &= 0xffffffffull;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+}
+
+static uint64_t SpreadBy2(uint64_t x)
+{
+    x &= 0x1fffffull;
+    x = (x | (x << 32)) & 0x001f00000000ffffull;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+    x = (x | (x << 8)) & 0x100f00f00f00f00full;
+    x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x << 2)) & 0x1249249249249249ull;
+    return x;
+}
+
+static unsigned CompactBy1(uint64_t x)
+{
+    x &= 0x5555555555555555ull;
+    x = (x | (x >> 1)) & 0x3333333333333333ull;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ffull;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffffull;
+    x = (x | (x >> 16)) & 0x00000000ffffffffull;
+    return (unsigned) x;
+}
+
+static unsigned CompactBy2(uint64_t x)
+{
+    x &= 0x1249249249249249ull;
+    x = (x | (x >> 2)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x >> 4)) & 0x100f00f00f00f00full;
+    x = (x | (x >> 8)) & 0x001f0000ff0000ffull;
+    x = (x | (x >> 16)) & 0x001f00000000ffffull;
+    x = (x | (x >> 32)) & 0x00000000001fffffull;
+    return (unsigned) x;
+}
+
+uint64_t EncodeMorton2(unsigned x, unsigned y)
+{
+    return SpreadBy1(x) | (SpreadBy1(y) << 1);
+}
+
+uint64_t EncodeMorton3(unsigned x, unsigned y, unsigned z)
+{
+    return SpreadBy2(x) | (SpreadBy2(y) << 1) | (SpreadBy2(z) << 2);
+}
+
+void DecodeMorton2(uint64_t index, unsigned* x, unsigned* y)
+{
+    *x = CompactBy1(index);
+    *y = CompactBy1(index >> 1);
+}
+
+void DecodeMorton3(uint64_t index, unsigned* x, unsigned* y, unsigned* z)
+{
+    *x = CompactBy2(index);
+    *y = CompactBy2(index >> 1);
+    *z = CompactBy2(index >> 2);
+}
+
+// Skilling's "transpose" holds the index with its bits dealt out across the axes, the most
+// significant to the first axis.  That's a Morton code with the axes in reverse order.
+static uint64_t TransposeToIndex(const unsigned* x, int dims)
+{
+    return dims == 2 ? EncodeMorton2(x[1], x[0]) : EncodeMorton3(x[2], x[1], x[0]);
+}
+
+static void IndexToTranspose(uint64_t index, int dims, unsigned* x)
+{
+    if (dims == 2)
+        DecodeMorton2(index, &x[1], &x[0]);
+    else
+        DecodeMorton3(index, &x[2], &x[1], &x[0]);
+}
+
+uint64_t EncodeHilbert(const unsigned* axes, int level, int dims)
+{
+    unsigned x[3] = { 0, 0, 0 };
+    for (int i = 0; i < dims; ++i)
+        x[i] = axes[i];
+
+    // Undo the turns, from the top level down:
+    for (unsigned q = 1u << (level - 1); q > 1; q >>= 1) {
+        unsigned p = q - 1;
+        for (int i = 0; i < dims; ++i) {
+            if (x[i] & q) {
+                x[0] ^= p;
+            } else {
+                unsigned t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+
+    // Gray encode:
+    for (int i = 1; i < dims; ++i)
+        x[i] ^= x[i - 1];
+    unsigned t = 0;
+    for (unsigned q = 1u << (level - 1); q > 1; q >>= 1)
+        if (x[dims - 1] & q)
+            t ^= q - 1;
+    for (int i = 0; i < dims; ++i)
+        x[i] ^= t;
+
+    return TransposeToIndex(x, dims);
+}
+
+void DecodeHilbert(uint64_t index, int level, int dims, unsigned* axes)
+{
+    unsigned x[3] = { 0, 0, 0 };
+    IndexToTranspose(index, dims, x);
+
+    // Gray decode:
+    unsigned t = x[dims - 1] >> 1;
+    for (int i = dims - 1; i > 0; --i)
+        x[i] ^= x[i - 1];
+    x[0] ^= t;
+
+    // Redo the turns, from the bottom level up:
+    unsigned end = level < 32 ? 1u << level : 0;
+    for (unsigned q = 2; q != end; q <<= 1) {
+        unsigned p = q - 1;
+        for (int i = dims - 1; i >= 0; --i) {
+            if (x[i] & q) {
+                x[0] ^= p;
+            } else {
+                t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+
+    for (int i = 0; i < dims; ++i)
+        axes[i] = x[i];
+}
+
+void FillHilbertAxes(int level, int dims, unsigned* axes)
+{
+    uint64_t count = 1ull << (dims * level);
+    int chunkCount = (int) ((count + ChunkSize - 1) / ChunkSize);
+    #pragma omp parallel for
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        uint64_t end = (uint64_t) (chunk + 1) * ChunkSize;
+        end = end < count ? end : count;
+        for (uint64_t i = (uint64_t) chunk * ChunkSize; i < end; ++i)
+            DecodeHilbert(i, level, dims, axes + i * dims);
+    }
+}
+
+void FillMortonAxes(int level, int dims, unsigned* axes)
+{
+    uint64_t count = 1ull << (dims * level);
+    int chunkCount = (int) ((count + ChunkSize - 1) / ChunkSize);
+    #pragma omp parallel for
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        uint64_t end = (uint64_t) (chunk + 1) * ChunkSize;
+        end = end < count ? end : count;
+        for (uint64_t i = (uint64_t) chunk * ChunkSize; i < end; ++i) {
+            unsigned* a = axes + i * dims;
+            if (dims == 2)
+                DecodeMorton2(i, &a[0], &a[1]);
+            else
+                DecodeMorton3(i, &a[0], &a[1], &a[2]);
+        }
+    }
+}
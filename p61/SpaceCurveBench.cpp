@@ -0,0 +1,165 @@
+// Headless timing of the closed-form space-filling curves in SpaceCurve.cpp.  Fills 2D and 3D
+// Hilbert and Morton curves at increasing levels on one thread and on all of them, and checks
+// that both runs agree, that every cell is visited once, that each Hilbert step moves to a
+// face neighbour, and that every index survives a round trip.  Round trips are also checked
+// at random indices at the deepest levels, and the cube-face path in Path.cpp is timed.
+// Usage: SpaceCurveBench [maxLevel2D] [maxLevel3D]
+
+#include "SpaceCurve.hpp"
+#include "Sweep.hpp"
+#include "Timer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+typedef void (*FillFunction)(int level, int dims, unsigned* axes);
+
+static void SetThreadCount(int threadCount)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+}
+
+static uint64_t Encode(bool hilbert, const unsigned* axes, int level, int dims)
+{
+    if (hilbert)
+        return EncodeHilbert(axes, level, dims);
+    return dims == 2 ? EncodeMorton2(axes[0], axes[1]) : EncodeMorton3(axes[0], axes[1], axes[2]);
+}
+
+static bool RunFill(bool hilbert, int level, int dims, int threadCount)
+{
+    FillFunction fill = hilbert ? FillHilbertAxes : FillMortonAxes;
+    size_t count = size_t(1) << (dims * level);
+    std::vector<unsigned> axes(count * dims), threadedAxes(count * dims);
+
+    // Time enough repetitions to get past the timer's resolution:
+    int repeats = (int) std::max(size_t(1), (size_t(1) << 22) / count);
+    SetThreadCount(1);
+    double start = GetSeconds();
+    for (int i = 0; i < repeats; ++i)
+        fill(level, dims, &axes[0]);
+    double serialTime = (GetSeconds() - start) / repeats;
+
+    SetThreadCount(threadCount);
+    start = GetSeconds();
+    for (int i = 0; i < repeats; ++i)
+        fill(level, dims, &threadedAxes[0]);
+    double threadedTime = (GetSeconds() - start) / repeats;
+
+    bool identical = axes == threadedAxes;
+
+    // Every cell once, every index back again, and Hilbert steps of one cell:
+    std::vector<bool> visited(count, false);
+    size_t revisits = 0, roundTrips = 0, jumps = 0;
+    unsigned side = 1u << level;
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned* a = &axes[i * dims];
+        uint64_t cell = 0;
+        for (int d = dims - 1; d >= 0; --d)
+            cell = cell * side + (a[d] < side ? a[d] : 0);
+        if (visited[(size_t) cell])
+            ++revisits;
+        visited[(size_t) cell] = true;
+        if (Encode(hilbert, a, level, dims) != i)
+            ++roundTrips;
+        if (hilbert && i > 0) {
+            int distance = 0;
+            for (int d = 0; d < dims; ++d)
+                distance += abs(int(a[d]) - int(a[d - dims]));
+            if (distance != 1)
+                ++jumps;
+        }
+    }
+
+    bool passed = identical && revisits == 0 && roundTrips == 0 && jumps == 0;
+    printf("%-7s %dD level %2d  %9d cells  %7.1f M/s  %2d threads: %7.1f M/s  "
+        "revisits %d  round trips %d  jumps %d  %s\n",
+        hilbert ? "hilbert" : "morton", dims, level, (int) count, count / serialTime * 1e-6,
+        threadCount, count / threadedTime * 1e-6, (int) revisits, (int) roundTrips, (int) jumps,
+        identical ? "identical" : "MISMATCH");
+    return passed;
+}
+
+static uint64_t RandomIndex(int bits)
+{
+    uint64_t index = 0;
+    for (int i = 0; i < 4; ++i)
+        index = (index << 16) ^ (uint64_t) (rand() & 0xffff);
+    return bits < 64 ? index & ((1ull << bits) - 1) : index;
+}
+
+// Round trips and neighbouring steps at random indices, where the curve is too big to fill:
+static bool RunDeep(int level, int dims)
+{
+    const int trials = 100000;
+    int failures = 0;
+    uint64_t last = (1ull << (dims * level)) - 1;
+    for (int trial = 0; trial < trials; ++trial) {
+        uint64_t index = RandomIndex(dims * level);
+        if (index == last)
+            --index;
+        unsigned a[3], b[3];
+        DecodeHilbert(index, level, dims, a);
+        DecodeHilbert(index + 1, level, dims, b);
+        int distance = 0;
+        for (int d = 0; d < dims; ++d)
+            distance += a[d] > b[d] ? int(a[d] - b[d]) : int(b[d] - a[d]);
+        if (EncodeHilbert(a, level, dims) != index || distance != 1)
+            ++failures;
+
+        DecodeMorton2(index, &a[0], &a[1]);
+        DecodeMorton3(index & ((1ull << 63) - 1), &b[0], &b[1], &b[2]);
+        if (dims == 2 && EncodeMorton2(a[0], a[1]) != index)
+            ++failures;
+        if (dims == 3 && EncodeMorton3(b[0], b[1], b[2]) != index)
+            ++failures;
+    }
+    printf("deep    %dD level %2d  %d random indices  failures %d  %s\n",
+        dims, level, trials, failures, failures ? "MISMATCH" : "identical");
+    return failures == 0;
+}
+
+int main(int argc, char** argv)
+{
+    int maxLevel2 = argc > 1 ? atoi(argv[1]) : 10;
+    int maxLevel3 = argc > 2 ? atoi(argv[2]) : 7;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    bool passed = true;
+    for (int level = 4; level <= maxLevel2; level += 2) {
+        passed = RunFill(true, level, 2, threadCount) && passed;
+        passed = RunFill(false, level, 2, threadCount) && passed;
+    }
+    for (int level = 1; level <= maxLevel3; level += 2) {
+        passed = RunFill(true, level, 3, threadCount) && passed;
+        passed = RunFill(false, level, 3, threadCount) && passed;
+    }
+    passed = RunDeep(SpaceCurveMaxLevel2D, 2) && passed;
+    passed = RunDeep(SpaceCurveMaxLevel3D, 3) && passed;
+
+    // The cube path of Path.cpp has six faces of 4^level points, less the first:
+    for (int level = 3; level <= 9; level += 3) {
+        double start = GetSeconds();
+        PointList path = CreateHilbertPath(level);
+        double elapsed = GetSeconds() - start;
+        bool sized = path.size() == 6 * (size_t(1) << (2 * level)) - 1;
+        printf("cube path level %d  %8d points  %7.1f M/s  %s\n",
+            level, (int) path.size(), path.size() / elapsed * 1e-6, sized ? "sized" : "MISSIZED");
+        passed = passed && sized;
+    }
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
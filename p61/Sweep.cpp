@@ -0,0 +1,291 @@
+#include "Sweep.hpp"
+#include <pez.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWEEP_SSE2 1
+#endif
+
+using namespace vmath;
+
+// Frames are transported within chunks of this many points in parallel, then the chunks are
+// rotated to line up.  The chunking doesn't depend on the thread count, so neither do the frames.
+static const int ChunkSize = 256;
+
+static const float MaxStretch = 4.0f;
+
+static Vector3 SafeNormalize(Vector3 v, Vector3 fallback)
+{
+    float length = std::sqrt(dot(v, v));
+    return length > 1e-12f ? v / length : fallback;
+}
+
+// Any unit vector perpendicular to u, from the axis least aligned with it.
+static Vector3 Perpendicular(Vector3 u)
+{
+    Vector3 axis = Vector3::xAxis();
+    float x = std::abs(u.getX()), y = std::abs(u.getY()), z = std::abs(u.getZ());
+    if (y <= x && y <= z)
+        axis = Vector3::yAxis();
+    else if (z <= x && z <= y)
+        axis = Vector3::zAxis();
+    return normalize(cross(u, axis));
+}
+
+// Double reflection: carries r at (x0, t0) over to (x1, t1).
+static Vector3 Transport(Point3 x0, Vector3 t0, Vector3 r0, Point3 x1, Vector3 t1)
+{
+    Vector3 v1 = x1 - x0;
+    float c1 = dot(v1, v1);
+    Vector3 r = r0, t = t0;
+    if (c1 > 0) {
+        r = r0 - (2.0f / c1) * dot(v1, r0) * v1;
+        t = t0 - (2.0f / c1) * dot(v1, t0) * v1;
+    }
+    Vector3 v2 = t1 - t;
+    float c2 = dot(v2, v2);
+    if (c2 > 0)
+        r = r - (2.0f / c2) * dot(v2, r) * v2;
+
+    // Keep it from drifting out of the plane over long paths:
+    return SafeNormalize(r - dot(r, t1) * t1, Perpendicular(t1));
+}
+
+// Angle about t that turns a onto b; both are perpendicular to t.
+static float GetTwist(Vector3 a, Vector3 b, Vector3 t)
+{
+    return std::atan2(dot(cross(a, b), t), dot(a, b));
+}
+
+void ComputeFrames(const PointList& path, bool closed, std::vector<FramePod>* frames)
+{
+    int count = (int) path.size();
+    frames->resize(count);
+    if (count < 2) {
+        if (count) {
+            FramePod& frame = (*frames)[0];
+            frame.Tangent = Vector3::zAxis();
+            frame.Normal = Vector3::xAxis();
+            frame.Binormal = Vector3::yAxis();
+            frame.Bend = Vector3::xAxis();
+            frame.Stretch = 1;
+        }
+        return;
+    }
+
+    // Tangents bisect the segments on either side; the open ends take their one segment:
+    #pragma omp parallel for
+    for (int i = 0; i < count; ++i) {
+        bool first = i == 0 && !closed, last = i == count - 1 && !closed;
+        Point3 p = path[i];
+        Point3 previous = path[(i + count - 1) % count];
+        Point3 next = path[(i + 1) % count];
+        Vector3 out = SafeNormalize(next - p, Vector3(0));
+        Vector3 in = SafeNormalize(p - previous, out);
+        if (last || dot(out, out) == 0)
+            out = in;
+        if (first)
+            in = out;
+
+        FramePod& frame = (*frames)[i];
+        frame.Tangent = SafeNormalize(in + out, in);
+        frame.Bend = SafeNormalize(out - in, Perpendicular(frame.Tangent));
+        frame.Stretch = std::min(1.0f / std::max(dot(in, frame.Tangent), 1e-6f), MaxStretch);
+    }
+
+    // Transport frames through each chunk from an arbitrary start, and on into the next chunk:
+    int chunkCount = (count + ChunkSize - 1) / ChunkSize;
+    std::vector<Vector3> handoffs(chunkCount);
+    #pragma omp parallel for schedule(dynamic)
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        int begin = chunk * ChunkSize, end = std::min(begin + ChunkSize, count);
+        FramePod* f = &(*frames)[0];
+        f[begin].Normal = Perpendicular(f[begin].Tangent);
+        for (int i = begin + 1; i < end; ++i)
+            f[i].Normal = Transport(path[i - 1], f[i - 1].Tangent, f[i - 1].Normal, path[i], f[i].Tangent);
+        int next = end % count;
+        if (end < count || closed)
+            handoffs[chunk] = Transport(path[end - 1], f[end - 1].Tangent, f[end - 1].Normal, path[next], f[next].Tangent);
+    }
+
+    // Find the rotation that lines up each chunk with the one before it:
+    std::vector<float> twists(chunkCount, 0.0f);
+    for (int chunk = 1; chunk < chunkCount; ++chunk) {
+        const FramePod& start = (*frames)[chunk * ChunkSize];
+        twists[chunk] = twists[chunk - 1] + GetTwist(start.Normal, handoffs[chunk - 1], start.Tangent);
+    }
+
+    // Going around a closed path leaves the frame twisted by some angle; undo it gradually:
+    float holonomy = 0;
+    if (closed) {
+        const FramePod& start = (*frames)[0];
+        Vector3 end = handoffs[chunkCount - 1];
+        float angle = twists[chunkCount - 1];
+        Vector3 arrived = std::cos(angle) * end + std::sin(angle) * cross(start.Tangent, end);
+        holonomy = GetTwist(start.Normal, arrived, start.Tangent);
+    }
+
+    #pragma omp parallel for
+    for (int i = 0; i < count; ++i) {
+        FramePod& frame = (*frames)[i];
+        float angle = twists[i / ChunkSize] - holonomy * i / count;
+        Vector3 side = cross(frame.Tangent, frame.Normal);
+        frame.Normal = std::cos(angle) * frame.Normal + std::sin(angle) * side;
+        frame.Binormal = cross(frame.Tangent, frame.Normal);
+    }
+}
+
+// Per ring: center, the two axes of the (stretched) ring, and the two axes of its normals.
+struct RingPod {
+    float Center[3];
+    float AxisA[3];
+    float AxisC[3];
+    float Normal[3];
+    float Binormal[3];
+};
+
+static RingPod CreateRing(Point3 center, const FramePod& frame, float radius)
+{
+    float excess = frame.Stretch - 1.0f;
+    Vector3 a = radius * (frame.Normal + excess * dot(frame.Normal, frame.Bend) * frame.Bend);
+    Vector3 c = radius * (frame.Binormal + excess * dot(frame.Binormal, frame.Bend) * frame.Bend);
+    RingPod ring;
+    for (int k = 0; k < 3; ++k) {
+        ring.Center[k] = center[k];
+        ring.AxisA[k] = a[k];
+        ring.AxisC[k] = c[k];
+        ring.Normal[k] = frame.Normal[k];
+        ring.Binormal[k] = frame.Binormal[k];
+    }
+    return ring;
+}
+
+// Vertex j of a ring is Center + cos * AxisA + sin * AxisC, with normal cos * Normal + sin * Binormal.
+static void EmitRings(const RingPod* rings, int ringCount, int firstRing, const float* cosines,
+    const float* sines, int slices, TubeMeshPod* mesh)
+{
+    int r = 0;
+#ifdef SWEEP_SSE2
+    // Four rings at a time, one per lane:
+    for (; r + 4 <= ringCount; r += 4) {
+        __m128 center[3], axisA[3], axisC[3], normal[3], binormal[3];
+        for (int k = 0; k < 3; ++k) {
+            center[k] = _mm_setr_ps(rings[r].Center[k], rings[r + 1].Center[k], rings[r + 2].Center[k], rings[r + 3].Center[k]);
+            axisA[k] = _mm_setr_ps(rings[r].AxisA[k], rings[r + 1].AxisA[k], rings[r + 2].AxisA[k], rings[r + 3].AxisA[k]);
+            axisC[k] = _mm_setr_ps(rings[r].AxisC[k], rings[r + 1].AxisC[k], rings[r + 2].AxisC[k], rings[r + 3].AxisC[k]);
+            normal[k] = _mm_setr_ps(rings[r].Normal[k], rings[r + 1].Normal[k], rings[r + 2].Normal[k], rings[r + 3].Normal[k]);
+            binormal[k] = _mm_setr_ps(rings[r].Binormal[k], rings[r + 1].Binormal[k], rings[r + 2].Binormal[k], rings[r + 3].Binormal[k]);
+        }
+        for (int j = 0; j < slices; ++j) {
+            __m128 c = _mm_set1_ps(cosines[j]), s = _mm_set1_ps(sines[j]);
+            float position[3][4], direction[3][4];
+            for (int k = 0; k < 3; ++k) {
+                __m128 p = _mm_add_ps(_mm_add_ps(center[k], _mm_mul_ps(c, axisA[k])), _mm_mul_ps(s, axisC[k]));
+                __m128 n = _mm_add_ps(_mm_mul_ps(c, normal[k]), _mm_mul_ps(s, binormal[k]));
+                _mm_storeu_ps(position[k], p);
+                _mm_storeu_ps(direction[k], n);
+            }
+            for (int lane = 0; lane < 4; ++lane) {
+                size_t vertex = 3 * ((size_t) (firstRing + r + lane) * slices + j);
+                for (int k = 0; k < 3; ++k) {
+                    mesh->Positions[vertex + k] = position[k][lane];
+                    mesh->Normals[vertex + k] = direction[k][lane];
+                }
+            }
+        }
+    }
+#endif
+    for (; r < ringCount; ++r) {
+        const RingPod& ring = rings[r];
+        for (int j = 0; j < slices; ++j) {
+            float c = cosines[j], s = sines[j];
+            size_t vertex = 3 * ((size_t) (firstRing + r) * slices + j);
+            for (int k = 0; k < 3; ++k) {
+                mesh->Positions[vertex + k] = ring.Center[k] + c * ring.AxisA[k] + s * ring.AxisC[k];
+                mesh->Normals[vertex + k] = c * ring.Normal[k] + s * ring.Binormal[k];
+            }
+        }
+    }
+}
+
+void SweepTube(const PointList& path, const std::vector<FramePod>& frames, bool closed,
+    float radius, int slices, TubeMeshPod* mesh)
+{
+    int count = (int) path.size();
+    mesh->Rings = count;
+    mesh->Slices = slices;
+    mesh->Positions.resize((size_t) count * slices * 3);
+    mesh->Normals.resize(mesh->Positions.size());
+    mesh->PathCoords.resize((size_t) count * slices);
+
+    std::vector<float> cosines(slices), sines(slices);
+    for (int j = 0; j < slices; ++j) {
+        cosines[j] = std::cos(TwoPi * j / slices);
+        sines[j] = std::sin(TwoPi * j / slices);
+    }
+
+    // Distance along the path, as a fraction of the whole:
+    std::vector<float> distances(count + 1, 0.0f);
+    for (int i = 1; i <= count; ++i)
+        distances[i] = distances[i - 1] + (i < count || closed ? length(path[i % count] - path[i - 1]) : 0);
+    float total = distances[count] > 0 ? distances[count] : 1.0f;
+
+    // Each group of rings is independent of the others:
+    const int GroupSize = 64;
+    int groupCount = (count + GroupSize - 1) / GroupSize;
+    #pragma omp parallel for schedule(dynamic)
+    for (int group = 0; group < groupCount; ++group) {
+        int begin = group * GroupSize, end = std::min(begin + GroupSize, count);
+        RingPod rings[GroupSize];
+        for (int i = begin; i < end; ++i) {
+            rings[i - begin] = CreateRing(path[i], frames[i], radius);
+            std::fill(&mesh->PathCoords[(size_t) i * slices], &mesh->PathCoords[(size_t) i * slices] + slices,
+                distances[i] / total);
+        }
+        EmitRings(rings, end - begin, begin, &cosines[0], &sines[0], slices, mesh);
+    }
+
+    // Two triangles per quad between neighboring rings:
+    int segmentCount = closed ? count : count - 1;
+    mesh->Indices.resize((size_t) std::max(segmentCount, 0) * slices * 6);
+    #pragma omp parallel for
+    for (int i = 0; i < segmentCount; ++i) {
+        unsigned int* index = &mesh->Indices[(size_t) i * slices * 6];
+        unsigned int ring = i * slices, next = ((i + 1) % count) * slices;
+        for (int j = 0; j < slices; ++j) {
+            unsigned int a = ring + j, b = ring + (j + 1) % slices;
+            unsigned int c = next + (j + 1) % slices, d = next + j;
+            *index++ = a; *index++ = b; *index++ = d;
+            *index++ = b; *index++ = c; *index++ = d;
+        }
+    }
+}
+
+bool ExportTube(const TubeMeshPod& mesh, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+        return false;
+
+    size_t vertexCount = mesh.PathCoords.size();
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* p = &mesh.Positions[3 * i];
+        fprintf(file, "v %f %f %f\n", p[0], p[1], p[2]);
+    }
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* n = &mesh.Normals[3 * i];
+        fprintf(file, "vn %f %f %f\n", n[0], n[1], n[2]);
+    }
+    for (size_t i = 0; i < vertexCount; ++i)
+        fprintf(file, "vt %f %f\n", mesh.PathCoords[i], (float) (i % mesh.Slices) / mesh.Slices);
+    for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+        unsigned int a = mesh.Indices[i] + 1, b = mesh.Indices[i + 1] + 1, c = mesh.Indices[i + 2] + 1;
+        fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+    }
+
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
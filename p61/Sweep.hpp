@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <vmath.hpp>
+
+// Tubes swept along a path on the CPU, for exporting or caching what Cylinder.glsl extrudes
+// on the fly.  Neither this nor Path.cpp needs OpenGL.
+//
+// The frames along the path are rotation-minimizing, by the double reflection method of
+// Wang et al., "Computation of Rotation Minimizing Frames" (2008).  For a closed path, the
+// twist left over after going around once is spread evenly over the frames so the tube
+// closes up.  Each ring lies in the plane that bisects the two segments at its point and is
+// stretched across the bend, so that sharp corners (as in the Hilbert path) are mitered
+// rather than pinched.
+
+typedef std::vector<vmath::Point3> PointList;
+
+struct FramePod {
+    vmath::Vector3 Tangent;     // Bisects the adjacent segments
+    vmath::Vector3 Normal;
+    vmath::Vector3 Binormal;
+    vmath::Vector3 Bend;        // Unit direction across the bend, in the ring's plane
+    float Stretch;              // Along Bend: 1 / cos(half the bend angle), limited at hairpins
+};
+
+struct TubeMeshPod {
+    int Rings;
+    int Slices;
+    std::vector<float> Positions;       // xyz per vertex, Slices per ring
+    std::vector<float> Normals;
+    std::vector<float> PathCoords;      // Distance along the path, from 0 to 1
+    std::vector<unsigned int> Indices;  // Triangles, counter-clockwise from outside
+};
+
+// Path.cpp
+PointList CreateHilbertPath(int level);
+PointList CreateSuperellipsePath(int count, float n, float a, float b);
+PointList CreateGrannyKnotPath(int count);
+
+// Sweep.cpp
+void ComputeFrames(const PointList& path, bool closed, std::vector<FramePod>* frames);
+
+// Slices is the level of detail; a closed tube joins its last ring to its first.
+void SweepTube(const PointList& path, const std::vector<FramePod>& frames, bool closed,
+    float radius, int slices, TubeMeshPod* mesh);
+
+// Writes the tube as a Wavefront OBJ with normals.
+bool ExportTube(const TubeMeshPod& mesh, const char* filename);
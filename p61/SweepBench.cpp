@@ -0,0 +1,173 @@
+// Headless timing of the tube sweep in Sweep.cpp.  Sweeps the Hilbert path, a superellipse,
+// and a finely sampled granny knot, and reports frames per second and rings per second on one
+// thread and on all of them.  Checks that both runs give the same mesh, that the chunked frames
+// match frames transported serially from one end, that closed tubes meet up at the seam, and
+// that every vertex of a mitered ring is one radius from both of its segments.  Optionally
+// writes the Hilbert tube out as OBJ.
+// Usage: SweepBench [knotPointCount] [objFile]
+
+#include "Sweep.hpp"
+#include "Timer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace vmath;
+
+static const float Radius = 0.01f;
+
+static void SetThreadCount(int threadCount)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+}
+
+// Carries a normal from frame a over to frame b by double reflection, as Sweep.cpp does.
+static Vector3 Transport(Point3 xa, const FramePod& a, Vector3 normal, Point3 xb, const FramePod& b)
+{
+    Vector3 v1 = xb - xa;
+    float c1 = dot(v1, v1);
+    Vector3 r = normal - (2.0f / c1) * dot(v1, normal) * v1;
+    Vector3 t = a.Tangent - (2.0f / c1) * dot(v1, a.Tangent) * v1;
+    Vector3 v2 = b.Tangent - t;
+    float c2 = dot(v2, v2);
+    if (c2 > 0)
+        r = r - (2.0f / c2) * dot(v2, r) * v2;
+    return normalize(r);
+}
+
+static float GetAngle(Vector3 a, Vector3 b)
+{
+    return std::acos(std::max(-1.0f, std::min(1.0f, dot(a, b))));
+}
+
+// Angle between the normals of an open path's frames and ones carried along serially from
+// the first, across all the chunks.
+static float CompareWithSerial(const PointList& path, const std::vector<FramePod>& frames)
+{
+    Vector3 normal = frames[0].Normal;
+    float worst = 0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        normal = Transport(path[i - 1], frames[i - 1], normal, path[i], frames[i]);
+        worst = std::max(worst, GetAngle(normal, frames[i].Normal));
+    }
+    return worst;
+}
+
+// Distance from p to the line through a and b, less the radius.
+static float GetRadiusError(Point3 p, Point3 a, Point3 b)
+{
+    Vector3 axis = normalize(b - a);
+    Vector3 offset = p - a;
+    return std::abs(length(offset - dot(offset, axis) * axis) - Radius);
+}
+
+static float CheckMiters(const PointList& path, const std::vector<FramePod>& frames, bool closed, const TubeMeshPod& mesh)
+{
+    int count = (int) path.size();
+    float worst = 0;
+    for (int i = 0; i < count; ++i) {
+        if (frames[i].Stretch >= 4.0f)
+            continue;
+        for (int j = 0; j < mesh.Slices; ++j) {
+            const float* v = &mesh.Positions[3 * ((size_t) i * mesh.Slices + j)];
+            Point3 p(v[0], v[1], v[2]);
+            if (i > 0 || closed)
+                worst = std::max(worst, GetRadiusError(p, path[(i + count - 1) % count], path[i]));
+            if (i < count - 1 || closed)
+                worst = std::max(worst, GetRadiusError(p, path[i], path[(i + 1) % count]));
+        }
+    }
+    return worst;
+}
+
+static bool RunSweep(const char* label, const PointList& path, bool closed, int slices, int threadCount, const char* objFile)
+{
+    std::vector<FramePod> frames, threadedFrames;
+    TubeMeshPod mesh, threadedMesh;
+    int count = (int) path.size();
+
+    // Time enough repetitions to get past the timer's resolution:
+    int repeats = std::max(1, 200000 / count);
+    SetThreadCount(1);
+    double start = GetSeconds();
+    for (int i = 0; i < repeats; ++i)
+        ComputeFrames(path, closed, &frames);
+    double frameTime = (GetSeconds() - start) / repeats;
+    start = GetSeconds();
+    for (int i = 0; i < repeats; ++i)
+        SweepTube(path, frames, closed, Radius, slices, &mesh);
+    double sweepTime = (GetSeconds() - start) / repeats;
+
+    SetThreadCount(threadCount);
+    start = GetSeconds();
+    for (int i = 0; i < repeats; ++i)
+        ComputeFrames(path, closed, &threadedFrames);
+    double threadedFrameTime = (GetSeconds() - start) / repeats;
+    start = GetSeconds();
+    for (int i = 0; i < repeats; ++i)
+        SweepTube(path, threadedFrames, closed, Radius, slices, &threadedMesh);
+    double threadedSweepTime = (GetSeconds() - start) / repeats;
+
+    bool identical = mesh.Positions == threadedMesh.Positions && mesh.Normals == threadedMesh.Normals &&
+        mesh.Indices == threadedMesh.Indices;
+
+    // Frames must be orthonormal and, at the seam of a closed path, carry over onto the first:
+    float skew = 0;
+    for (int i = 0; i < count; ++i) {
+        const FramePod& f = frames[i];
+        skew = std::max(skew, std::abs(dot(f.Tangent, f.Normal)));
+        skew = std::max(skew, std::abs(dot(f.Binormal, f.Normal)));
+        skew = std::max(skew, std::abs(length(f.Normal) - 1));
+    }
+    float drift = closed ? 0 : CompareWithSerial(path, frames);
+    float seam = 0;
+    if (closed)
+        seam = GetAngle(Transport(path[count - 1], frames[count - 1], frames[count - 1].Normal, path[0], frames[0]),
+            frames[0].Normal);
+    float miter = CheckMiters(path, frames, closed, mesh);
+
+    bool passed = identical && skew < 1e-4f && drift < 2e-3f && seam < 1e-3f && miter < 1e-4f;
+    printf("%-12s %7d rings x %2d  frames %7.2f M/s  rings %6.2f M/s  %2d threads: %7.2f / %6.2f M/s  "
+        "skew %.0e  drift %.0e  seam %.0e  miter %.0e  %s\n",
+        label, count, slices, count / frameTime * 1e-6, count / sweepTime * 1e-6, threadCount,
+        count / threadedFrameTime * 1e-6, count / threadedSweepTime * 1e-6,
+        skew, drift, seam, miter, passed ? "identical" : "MISMATCH");
+
+    if (objFile) {
+        bool written = ExportTube(mesh, objFile);
+        printf("tube %s %s\n", written ? "written to" : "could not be written to", objFile);
+        passed = passed && written;
+    }
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    int knotCount = argc > 1 ? atoi(argv[1]) : 100000;
+    const char* objFile = argc > 2 ? argv[2] : 0;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    PointList hilbert = CreateHilbertPath(3);
+    PointList superellipse = CreateSuperellipsePath(4096, 2.5f, 1.0f, 0.6f);
+    PointList knot = CreateGrannyKnotPath(knotCount);
+
+    bool passed = RunSweep("hilbert", hilbert, false, 16, threadCount, objFile);
+    passed = RunSweep("superellipse", superellipse, true, 16, threadCount, 0) && passed;
+    for (int slices = 8; slices <= 32; slices *= 2)
+        passed = RunSweep("granny knot", knot, true, slices, threadCount, 0) && passed;
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// Headless check and benchmark for the curl of the velocity potential: compares the analytic
+// Jacobian against central differences at random points around the plume, then times both.
+// Exits with a nonzero status if they disagree.  Also measures particle advection throughput
+// for the original array-of-structures loop versus the threaded ParticleSystem, and bakes a
+// small velocity grid to check the on-disk cache.
+// Usage: Benchmark [sampleCount] [particleCount]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <pez.h>
+#include "noise.h"
+#include "Potential.hpp"
+#include "ParticleSystem.hpp"
+#include "VelocityBake.hpp"
+#include "Timer.hpp"
+
+using namespace vmath;
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Random points in the box that CreateVelocityTexture covers, skipping the obstacle's surface
+// where the potential has a crease.
+static Point3 RandomPoint(unsigned int& seed)
+{
+    Point3 p;
+    do {
+        float x = randhashf(seed++, -2, 2);
+        float y = randhashf(seed++, -4, 4);
+        float z = randhashf(seed++, -2, 2);
+        p = Point3(x, y, z);
+    } while (std::fabs(length(Vector3(p)) - 1) < 0.01f);
+    return p;
+}
+
+// The loop that AdvanceTime used to run over the interleaved particles.
+static void AdvectReference(Particle* particleList, int count, float timeStep)
+{
+    Particle* pNode = particleList;
+    for (int i = 0; i < count; ++i, ++pNode) {
+        Point3 p(pNode->Px, pNode->Py, pNode->Pz);
+        Vector3 v = ComputeCurl(p);
+        Point3 midx = p + 0.5f * timeStep * v;
+        v = ComputeCurl(midx);
+        p += timeStep * v;
+        pNode->Px = p.getX(); pNode->Py = p.getY(); pNode->Pz = p.getZ();
+        pNode->Vx = v.getX(); pNode->Vy = v.getY(); pNode->Vz = v.getZ();
+    }
+}
+
+static void RunParticleBenchmark(int particleCount)
+{
+    const int StepCount = 3;
+    const float TimeStep = 0.01f;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    ParticleSystem system;
+    ParticleEmitter emitter = { PlumeBase, 0.5f, 4.0f, 0 };
+    unsigned int seed = 0;
+    InitParticleSystem(&system, particleCount);
+    KillAndSpawn(&system, PlumeCeiling, particleCount, emitter, 1.0f, &seed);
+
+    std::vector<Particle> reference(particleCount);
+    PackParticles(system, &reference[0], particleCount);
+
+    double start = GetSeconds();
+    for (int step = 0; step < StepCount; ++step)
+        AdvectReference(&reference[0], particleCount, TimeStep);
+    double referenceTime = GetSeconds() - start;
+
+    ParticleSystem single = system;
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+    start = GetSeconds();
+    for (int step = 0; step < StepCount; ++step)
+        AdvectParticles(&single, ComputeCurl, TimeStep);
+    double singleTime = GetSeconds() - start;
+
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+    start = GetSeconds();
+    for (int step = 0; step < StepCount; ++step) {
+        AdvectParticles(&system, ComputeCurl, TimeStep);
+        KillAndSpawn(&system, PlumeCeiling, 0, emitter, 1.0f, &seed);
+    }
+    std::vector<Particle> packed(particleCount);
+    PackParticles(system, &packed[0], particleCount);
+    double threadedTime = GetSeconds() - start;
+
+    // Nothing reaches the ceiling in a few steps, so the packed arrays should match exactly:
+    bool identical = system.Count == (unsigned int) particleCount &&
+        memcmp(&reference[0], &packed[0], particleCount * sizeof(Particle)) == 0;
+
+    double steps = (double) particleCount * StepCount;
+    printf("advect %d particles  reference: %7.1f K/s  SoA: %7.1f K/s  %2d threads with compaction and pack: %7.1f K/s  %s\n",
+        particleCount, steps / referenceTime * 0.001, steps / singleTime * 0.001,
+        threadCount, steps / threadedTime * 0.001, identical ? "identical" : "MISMATCH");
+}
+
+// Bakes a small grid serially and in parallel, then saves it and maps it back.  Returns false
+// if any copy differs or if a stale file is accepted.
+static bool RunBakeBenchmark()
+{
+    const int Width = 32, Height = 64, Depth = 32;
+    const float W = 2.0f, H = W * Height / Width, D = W;
+    const char* Path = "BenchmarkVelocity.dat";
+    size_t count = (size_t) Width * Height * Depth * 3;
+
+    std::vector<float> reference(count);
+    double start = GetSeconds();
+    float* pData = &reference[0];
+    for (int slice = 0; slice < Depth; ++slice)
+        for (int row = 0; row < Height; ++row)
+            for (int col = 0; col < Width; ++col) {
+                Point3 p;
+                p[0] = -W + 2 * W * col / Width;
+                p[1] = -H + 2 * H * row / Height;
+                p[2] = -D + 2 * D * slice / Depth;
+                Vector3 v = ComputeCurl(p);
+                *pData++ = v[0];
+                *pData++ = v[1];
+                *pData++ = v[2];
+            }
+    double serialTime = GetSeconds() - start;
+
+    std::vector<float> parallel(count);
+    start = GetSeconds();
+    BakeVelocity(&parallel[0], Width, Height, Depth);
+    double parallelTime = GetSeconds() - start;
+
+    remove(Path);
+    VelocityBake bake;
+    bool loaded = OpenVelocityBake(&bake, Path, Width, Height, Depth);
+    bool saved = !loaded && bake.Mapping != 0;
+    CloseVelocityBake(&bake);
+
+    start = GetSeconds();
+    bool reloaded = OpenVelocityBake(&bake, Path, Width, Height, Depth);
+    double mapTime = GetSeconds() - start;
+    bool identical = parallel == reference && reloaded && bake.Mapping &&
+        memcmp(bake.Data, &reference[0], count * sizeof(float)) == 0;
+    CloseVelocityBake(&bake);
+
+    // A different potential must not reuse the file:
+    SetPotentialTime(2.5f);
+    bool rejected = !OpenVelocityBake(&bake, Path, Width, Height, Depth);
+    CloseVelocityBake(&bake);
+    SetPotentialTime(1.5f);
+    remove(Path);
+
+    bool passed = saved && identical && rejected;
+    printf("bake  %dx%dx%d  serial: %7.1f ms  parallel: %7.1f ms  mapped from disk: %5.2f ms  %s\n",
+        Width, Height, Depth, serialTime * 1000, parallelTime * 1000, mapTime * 1000,
+        passed ? "identical" : "MISMATCH");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    int sampleCount = argc > 1 ? atoi(argv[1]) : 10000;
+    int particleCount = argc > 2 ? atoi(argv[2]) : 100000;
+    const float Tolerance = 0.02f;
+
+    SetPotentialTime(1.5f);
+
+    // A larger step than the default keeps float cancellation below the truncation error:
+    unsigned int seed = 0;
+    float worstError = 0;
+    for (int i = 0; i < sampleCount; ++i) {
+        Point3 p = RandomPoint(seed);
+        Vector3 analytic = ComputeCurl(p);
+        Vector3 reference = ComputeCurlFiniteDifference(p, 1e-3f);
+        float error = length(analytic - reference) / std::max(length(reference), 1.0f);
+        worstError = std::max(worstError, error);
+    }
+
+    seed = 0;
+    Vector3 sum(0, 0, 0);
+    double start = GetSeconds();
+    for (int i = 0; i < sampleCount; ++i)
+        sum += ComputeCurlFiniteDifference(RandomPoint(seed));
+    double differenceTime = GetSeconds() - start;
+
+    seed = 0;
+    start = GetSeconds();
+    for (int i = 0; i < sampleCount; ++i)
+        sum += ComputeCurl(RandomPoint(seed));
+    double analyticTime = GetSeconds() - start;
+
+    printf("curl  finite differences: %7.1f K samples/s  analytic: %7.1f K samples/s  speedup: %4.1fx  "
+        "worst relative error: %.2e  %s\n",
+        sampleCount / differenceTime * 0.001, sampleCount / analyticTime * 0.001,
+        differenceTime / analyticTime, worstError, worstError < Tolerance ? "PASS" : "FAIL");
+
+    RunParticleBenchmark(particleCount);
+    bool bakePassed = RunBakeBenchmark();
+
+    return worstError < Tolerance && bakePassed ? 0 : 1;
+}
@@ -2,16 +2,7 @@
 #include <vmath.hpp>
 #include <pez.h>
 #include <glew.h>
-
-struct Particle {
-    float Px;  // Position X
-    float Py;  // Position Y
-    float Pz;  // Position Z
-    float ToB; // Time of Birth
-    float Vx;  // Velocity X
-    float Vy;  // Velocity Y
-    float Vz;  // Velocity Z
-};
+#include "ParticleSystem.hpp"
 
 enum AttributeSlot {
     SlotPosition,
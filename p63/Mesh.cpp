@@ -1,9 +1,67 @@
 #include <string>
 #include <openctm.h>
 #include "Common.hpp"
+#include "Timer.hpp"
 
 using std::string;
 
+// OpenCTM decodes indices, positions, and normals straight into mapped VBOs.
+struct StreamingLoad {
+    MeshPod* Pod;
+    GLuint MappedBuffers[3];
+    GLenum MappedTargets[3];
+    int MappedCount;
+    double StartTime;
+    double FirstAttributeTime;
+};
+
+static void* CTMCALL MapMeshArray(CTMenum array, CTMuint size, void* userData)
+{
+    StreamingLoad* load = (StreamingLoad*) userData;
+    GLuint* buffer;
+    GLenum target = GL_ARRAY_BUFFER;
+    switch (array) {
+        case CTM_INDICES:  buffer = &load->Pod->IndexBuffer; target = GL_ELEMENT_ARRAY_BUFFER; break;
+        case CTM_VERTICES: buffer = &load->Pod->PositionsBuffer; break;
+        case CTM_NORMALS:  buffer = &load->Pod->NormalsBuffer; break;
+        default: return 0;
+    }
+
+    glGenBuffers(1, buffer);
+    glBindBuffer(target, *buffer);
+    glBufferData(target, size, 0, GL_STATIC_DRAW);
+
+    // MG2 predicts normals from the decoded positions and indices, so the mapping must be readable.
+    void* mapped = glMapBuffer(target, GL_READ_WRITE);
+    if (!mapped) {
+        glDeleteBuffers(1, buffer);
+        *buffer = 0;
+        return 0;
+    }
+
+    load->MappedBuffers[load->MappedCount] = *buffer;
+    load->MappedTargets[load->MappedCount] = target;
+    ++load->MappedCount;
+    return mapped;
+}
+
+static void CTMCALL OnMeshProgress(CTMenum array, CTMuint bytesRead, void* userData)
+{
+    StreamingLoad* load = (StreamingLoad*) userData;
+    if (array != CTM_NONE && load->FirstAttributeTime == 0) {
+        load->FirstAttributeTime = GetSeconds() - load->StartTime;
+    }
+}
+
+static GLuint CreateBuffer(GLenum target, GLsizeiptr size, const void* data)
+{
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferData(target, size, data, GL_STATIC_DRAW);
+    return buffer;
+}
+
 MeshPod CreateQuad(float left, float top, float right, float bottom)
 {
     MeshPod pod = {0};
@@ -91,31 +149,41 @@ MeshPod LoadMesh(const char* path)
         fullpath = fullpath + path;
     }
 
-    // Open the CTM file:
+    // Open the CTM file, decoding directly into VBOs where possible:
+    MeshPod pod = {0};
+    StreamingLoad load = {0};
+    load.Pod = &pod;
+    load.StartTime = GetSeconds();
+
     CTMcontext ctmContext = ctmNewContext(CTM_IMPORT);
+    ctmStreamingImport(ctmContext, MapMeshArray, OnMeshProgress, &load);
     ctmLoad(ctmContext, fullpath.c_str());
+
+    for (int i = 0; i < load.MappedCount; ++i) {
+        glBindBuffer(load.MappedTargets[i], load.MappedBuffers[i]);
+        glUnmapBuffer(load.MappedTargets[i]);
+    }
+
     PezCheckCondition(ctmGetError(ctmContext) == CTM_NONE, "Unable to load OpenCTM file: %s\n", fullpath.c_str());
 
-    MeshPod pod = {0};
     pod.VertexCount = ctmGetInteger(ctmContext, CTM_VERTEX_COUNT);
     pod.IndexCount = 3 * ctmGetInteger(ctmContext, CTM_TRIANGLE_COUNT);
 
-    // Create the VBO for positions:
-    const CTMfloat* positions = ctmGetFloatArray(ctmContext, CTM_VERTICES);
-    GLsizeiptr size = pod.VertexCount * sizeof(float) * 3;
-    glGenBuffers(1, &pod.PositionsBuffer);
+    // Fall back to regular uploads for any arrays that couldn't be mapped:
+    if (!pod.PositionsBuffer) {
+        const CTMfloat* positions = ctmGetFloatArray(ctmContext, CTM_VERTICES);
+        pod.PositionsBuffer = CreateBuffer(GL_ARRAY_BUFFER, pod.VertexCount * sizeof(float) * 3, positions);
+    }
     glBindBuffer(GL_ARRAY_BUFFER, pod.PositionsBuffer);
-    glBufferData(GL_ARRAY_BUFFER, size, positions, GL_STATIC_DRAW);
     glEnableVertexAttribArray(SlotPosition);
     glVertexAttribPointer(SlotPosition, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
 
-    // Create the VBO for normals:
     const CTMfloat* normals = ctmGetFloatArray(ctmContext, CTM_NORMALS);
-    if (normals) {
-        GLsizeiptr size = pod.VertexCount * sizeof(float) * 3;
-        glGenBuffers(1, &pod.NormalsBuffer);
+    if (normals && !pod.NormalsBuffer) {
+        pod.NormalsBuffer = CreateBuffer(GL_ARRAY_BUFFER, pod.VertexCount * sizeof(float) * 3, normals);
+    }
+    if (pod.NormalsBuffer) {
         glBindBuffer(GL_ARRAY_BUFFER, pod.NormalsBuffer);
-        glBufferData(GL_ARRAY_BUFFER, size, normals, GL_STATIC_DRAW);
         glEnableVertexAttribArray(SlotNormal);
         glVertexAttribPointer(SlotNormal, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
     }
@@ -123,22 +191,21 @@ MeshPod LoadMesh(const char* path)
     // Create the VBO for texcoords:
     const CTMfloat* texcoords = ctmGetFloatArray(ctmContext, CTM_UV_MAP_1);
     if (texcoords) {
-        GLsizeiptr size = pod.VertexCount * sizeof(float) * 2;
-        glGenBuffers(1, &pod.TexCoordsBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, pod.TexCoordsBuffer);
-        glBufferData(GL_ARRAY_BUFFER, size, texcoords, GL_STATIC_DRAW);
+        pod.TexCoordsBuffer = CreateBuffer(GL_ARRAY_BUFFER, pod.VertexCount * sizeof(float) * 2, texcoords);
         glEnableVertexAttribArray(SlotTexCoord);
         glVertexAttribPointer(SlotTexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0);
     }
 
-    // Create the VBO for indices:
-    const CTMuint* indices = ctmGetIntegerArray(ctmContext, CTM_INDICES);
-    size = pod.IndexCount * sizeof(CTMuint);
-    glGenBuffers(1, &pod.IndexBuffer);
+    if (!pod.IndexBuffer) {
+        const CTMuint* indices = ctmGetIntegerArray(ctmContext, CTM_INDICES);
+        pod.IndexBuffer = CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, pod.IndexCount * sizeof(CTMuint), indices);
+    }
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pod.IndexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 
     ctmFreeContext(ctmContext);
 
+    PezDebugString("Loaded %s in %.1f ms (first attribute after %.1f ms)\n", path,
+        (GetSeconds() - load.StartTime) * 1000.0, load.FirstAttributeTime * 1000.0);
+
     return pod;
 }
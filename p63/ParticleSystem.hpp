@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <vmath.hpp>
+
+// Interleaved layout that the vertex shaders consume.
+struct Particle {
+    float Px;  // Position X
+    float Py;  // Position Y
+    float Pz;  // Position Z
+    float ToB; // Time of Birth
+    float Vx;  // Velocity X
+    float Vy;  // Velocity Y
+    float Vz;  // Velocity Z
+};
+
+// Particles are simulated as structure-of-arrays; live particles always occupy [0, Count).
+struct ParticleSystem {
+    std::vector<float> Px, Py, Pz;
+    std::vector<float> ToB;
+    std::vector<float> Vx, Vy, Vz;
+    unsigned int Count;
+    unsigned int Capacity;
+};
+
+// New particles start in a thin disk-shaped band.
+struct ParticleEmitter {
+    float BaseY;
+    float Radius;
+    float Band;
+    float OffsetZ;
+};
+
+typedef vmath::Vector3 (*VelocityField)(vmath::Point3 p);
+
+// Samples count positions at once, as structure-of-arrays.
+typedef void (*BatchVelocityField)(const float* x, const float* y, const float* z,
+    float* vx, float* vy, float* vz, int count);
+
+void InitParticleSystem(ParticleSystem* system, unsigned int capacity);
+
+// Midpoint RK2 step for every live particle.  Threads take chunks of particles on demand,
+// since the cost of a velocity sample varies across the plume.
+void AdvectParticles(ParticleSystem* system, VelocityField velocity, float timeStep);
+
+// Same step, but each chunk hands its positions to the field in two batched calls.
+void AdvectParticles(ParticleSystem* system, BatchVelocityField velocity, float timeStep);
+
+// Drops the particles above the ceiling and appends up to spawnCount new ones in the same
+// pass.  Survivors keep their order.  Returns the number of particles that were spawned.
+unsigned int KillAndSpawn(ParticleSystem* system, float ceiling, unsigned int spawnCount,
+    const ParticleEmitter& emitter, float time, unsigned int* seed);
+
+// Interleaves the live particles for upload; the remaining slots are zeroed.
+void PackParticles(const ParticleSystem& system, Particle* dest, unsigned int destCount);
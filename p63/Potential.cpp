@@ -0,0 +1,206 @@
+#include <cmath>
+#include <pez.h>
+#include "noise.h"
+#include "Potential.hpp"
+
+using namespace vmath;
+
+static const Point3 SphereCenter(0, 0, 0);
+static const float SphereRadius = 1.0f;
+static const float Epsilon = 1e-10f;
+static const float NoiseLengthScale[] = {0.4f, 0.23f, 0.11f};
+static const float NoiseGain[] = {1.0f, 0.5f, 0.25f};
+static const float PlumeHeight(8);
+static const float RingRadius(1.25f);
+static const float RingSpeed(0.3f);
+static const float RingsPerSecond(0.125f);
+static const float RingMagnitude(10);
+static const float RingFalloff(0.7f);
+
+static FlowNoise3 noise(PotentialNoiseSeed);
+static float NoiseTime = 0;
+
+inline float noise0(Vector3 s) { return noise(s.getX(), s.getY(), s.getZ()); }
+inline float noise1(Vector3 s) { return noise(s.getY() + 31.416f, s.getZ() - 47.853f, s.getX() + 12.793f); }
+inline float noise2(Vector3 s) { return noise(s.getZ() - 233.145f, s.getX() - 113.408f, s.getY() - 185.31f); }
+inline Vector3 noise3d(Vector3 s) { return Vector3(noise0(s), noise1(s), noise2(s)); };
+
+// Same as above; the rows of the Jacobian are the gradients of each component, with the
+// swizzles of noise1 and noise2 undone.
+inline Vector3 noise3d(Vector3 s, Matrix3& jacobian)
+{
+    Vector3 g0, g1, g2;
+    float n0 = noise(s.getX(), s.getY(), s.getZ(), g0);
+    float n1 = noise(s.getY() + 31.416f, s.getZ() - 47.853f, s.getX() + 12.793f, g1);
+    float n2 = noise(s.getZ() - 233.145f, s.getX() - 113.408f, s.getY() - 185.31f, g2);
+    jacobian = transpose(Matrix3(g0, Vector3(g1[2], g1[0], g1[1]), Vector3(g2[1], g2[2], g2[0])));
+    return Vector3(n0, n1, n2);
+}
+
+// Derivative of ramp(), which is flat outside [-1, 1].
+static float RampDerivative(float r)
+{
+    float x = (r + 1) / 2;
+    if (x < 0 || x > 1)
+        return 0;
+    return 30 * x * x * (1 - x) * (1 - x);
+}
+
+static float SampleDistance(Point3 p)
+{
+    Vector3 u = p - SphereCenter;
+    float d = length(u);
+    return d - SphereRadius;
+}
+
+// The obstacle is a sphere, so its distance gradient points away from the center, and the
+// gradient's own Jacobian is the projection onto the tangent plane divided by the radius.
+static Vector3 ComputeGradient(Point3 p, Matrix3& jacobian)
+{
+    Vector3 u = p - SphereCenter;
+    float d = length(u);
+    if (d < Epsilon) {
+        jacobian = Matrix3(0.0f);
+        return Vector3(0, 0, 0);
+    }
+    Vector3 n = u / d;
+    jacobian = (Matrix3::identity() - outer(n, n)) * (1 / d);
+    return n;
+}
+
+static Vector3 BlendVectors(Vector3 potential, float alpha, Vector3 distanceGradient)
+{
+    float dp = dot(potential, distanceGradient);
+    return alpha * potential + (1-alpha) * dp * distanceGradient;
+}
+
+// Jacobian of BlendVectors, given the derivatives of each of its inputs.
+static Matrix3 BlendJacobian(Vector3 potential, float alpha, Vector3 distanceGradient,
+    const Matrix3& dPotential, Vector3 dAlpha, const Matrix3& dGradient)
+{
+    float dp = dot(potential, distanceGradient);
+    Vector3 tangent = potential - dp * distanceGradient;
+    Matrix3 result;
+    for (int j = 0; j < 3; ++j) {
+        Vector3 dv = dPotential.getCol(j);
+        Vector3 dn = dGradient.getCol(j);
+        float ddp = dot(dv, distanceGradient) + dot(potential, dn);
+        result.setCol(j, dAlpha[j] * tangent + alpha * dv + (1-alpha) * (ddp * distanceGradient + dp * dn));
+    }
+    return result;
+}
+
+void SetPotentialTime(float time)
+{
+    NoiseTime = 0.5f*NoiseGain[0]/NoiseLengthScale[0]*time;
+    noise.set_time(NoiseTime);
+}
+
+// FNV-1a over the raw bytes of each parameter.
+static void HashBytes(unsigned int& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+}
+
+unsigned int GetPotentialHash()
+{
+    float center[3] = { SphereCenter.getX(), SphereCenter.getY(), SphereCenter.getZ() };
+    float scalars[] = { SphereRadius, PlumeCeiling, PlumeBase, PlumeHeight, RingRadius, RingSpeed,
+        RingsPerSecond, RingMagnitude, RingFalloff, NoiseTime };
+    unsigned int hash = 2166136261u;
+    HashBytes(hash, center, sizeof(center));
+    HashBytes(hash, scalars, sizeof(scalars));
+    HashBytes(hash, NoiseLengthScale, sizeof(NoiseLengthScale));
+    HashBytes(hash, NoiseGain, sizeof(NoiseGain));
+    return hash;
+}
+
+Vector3 SamplePotential(Point3 p, Matrix3* jacobian)
+{
+   Vector3 psi(0,0,0);
+   Matrix3 dGradient;
+   Vector3 gradient = ComputeGradient(p, dGradient);
+
+   float obstacleDistance = SampleDistance(p);
+   Vector3 dDistance = (obstacleDistance < 0 ? -1.0f : 1.0f) * gradient; // gradient of |distance|
+   if (jacobian)
+       *jacobian = Matrix3(0.0f);
+
+   // add turbulence octaves that respect boundaries, increasing upwards
+   float height = (p.getY() - PlumeBase) / PlumeHeight;
+   float height_factor = ramp(height);
+   Vector3 dHeight(0, RampDerivative(height) / PlumeHeight, 0);
+   for (unsigned int i=0; i < countof(NoiseLengthScale); ++i) {
+        Vector3 s = Vector3(p) / NoiseLengthScale[i];
+        float r = std::fabs(obstacleDistance) / NoiseLengthScale[i];
+        float d = ramp(r);
+        if (!jacobian) {
+            psi += height_factor*NoiseGain[i]*BlendVectors(noise3d(s), d, gradient);
+            continue;
+        }
+
+        Matrix3 dNoise;
+        Vector3 n = noise3d(s, dNoise);
+        Vector3 psi_i = BlendVectors(n, d, gradient);
+        Matrix3 dPsi = BlendJacobian(n, d, gradient, dNoise * (1 / NoiseLengthScale[i]),
+            RampDerivative(r) / NoiseLengthScale[i] * dDistance, dGradient);
+        psi += height_factor*NoiseGain[i]*psi_i;
+        *jacobian += NoiseGain[i] * (outer(psi_i, dHeight) + height_factor * dPsi);
+   }
+
+   Vector3 risingForce = Point3(0, 0, 0) - p;
+   risingForce = Vector3(-risingForce[2], 0, risingForce[0]);
+   const Matrix3 dRisingForce(Vector3(0, 0, -1), Vector3(0, 0, 0), Vector3(1, 0, 0));
+
+   // add rising vortex rings
+   float ring_y = PlumeCeiling;
+   float r = std::fabs(obstacleDistance) / RingRadius;
+   float d = ramp(r);
+   Vector3 dd = RampDerivative(r) / RingRadius * dDistance;
+   while (ring_y > PlumeBase) {
+      float ry = p.getY() - ring_y;
+      float rr = std::sqrt(p.getX()*p.getX()+p.getZ()*p.getZ());
+      float denominator = sqr(rr-RingRadius)+sqr(rr+RingRadius)+sqr(ry)+RingFalloff;
+      float rmag = RingMagnitude / denominator;
+      Vector3 rpsi = rmag * risingForce;
+      psi += BlendVectors(rpsi, d, gradient);
+      if (jacobian) {
+          // The denominator expands to 2(x^2 + z^2) + 2 RingRadius^2 + ry^2 + RingFalloff:
+          Vector3 dmag = (-rmag / denominator) * Vector3(4*p.getX(), 2*ry, 4*p.getZ());
+          Matrix3 dRing = outer(risingForce, dmag) + rmag * dRisingForce;
+          *jacobian += BlendJacobian(rpsi, d, gradient, dRing, dd, dGradient);
+      }
+      ring_y -= RingSpeed / RingsPerSecond;
+   }
+
+   return psi;
+}
+
+Vector3 ComputeCurl(Point3 p)
+{
+    Matrix3 j;
+    SamplePotential(p, &j);
+    return Vector3(j.getCol1()[2] - j.getCol2()[1],
+                   j.getCol2()[0] - j.getCol0()[2],
+                   j.getCol0()[1] - j.getCol1()[0]);
+}
+
+Vector3 ComputeCurlFiniteDifference(Point3 p, float e)
+{
+    Vector3 dx(e, 0, 0);
+    Vector3 dy(0, e, 0);
+    Vector3 dz(0, 0, e);
+
+    float x = SamplePotential(p + dy)[2] - SamplePotential(p - dy)[2]
+            - SamplePotential(p + dz)[1] + SamplePotential(p - dz)[1];
+
+    float y = SamplePotential(p + dz)[0] - SamplePotential(p - dz)[0]
+            - SamplePotential(p + dx)[2] + SamplePotential(p - dx)[2];
+
+    float z = SamplePotential(p + dx)[1] - SamplePotential(p - dx)[1]
+            - SamplePotential(p + dy)[0] + SamplePotential(p - dy)[0];
+
+    return Vector3(x, y, z) / (2*e);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <vmath.hpp>
+
+// The velocity field is the curl of a vector potential built from three octaves of flow
+// noise and a train of rising vortex rings, both damped near a spherical obstacle.
+
+static const float PlumeCeiling(3);
+static const float PlumeBase(-3);
+static const unsigned int PotentialNoiseSeed(171717);
+
+// Animates the flow noise; call once per frame before sampling.
+void SetPotentialTime(float time);
+
+// If jacobian is non-null, it receives d(psi)/dp with one column per axis of p.
+vmath::Vector3 SamplePotential(vmath::Point3 p, vmath::Matrix3* jacobian = 0);
+
+// Hash of the constants that shape the field and of the current noise time; baked copies of
+// the field are only valid while it stays the same.
+unsigned int GetPotentialHash();
+
+// Analytic curl, from a single potential sample.
+vmath::Vector3 ComputeCurl(vmath::Point3 p);
+
+// Central differences of SamplePotential; 12 samples.  Kept as a reference.
+vmath::Vector3 ComputeCurlFiniteDifference(vmath::Point3 p, float e = 1e-4f);
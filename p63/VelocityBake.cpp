@@ -0,0 +1,191 @@
+#include <cstdio>
+#include <cstring>
+#include "Potential.hpp"
+#include "VelocityBake.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace vmath;
+
+static const char Magic[4] = { 'C', 'U', 'R', 'L' };
+static const unsigned int Version = 1;
+
+// 32 bytes, so the samples that follow stay 16-byte aligned.
+struct BakeHeader {
+    char Magic[4];
+    unsigned int Version;
+    unsigned int Width;
+    unsigned int Height;
+    unsigned int Depth;
+    unsigned int NoiseSeed;
+    unsigned int ParametersHash;
+    unsigned int Reserved;
+};
+
+static BakeHeader MakeHeader(int width, int height, int depth)
+{
+    BakeHeader header;
+    memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = Version;
+    header.Width = width;
+    header.Height = height;
+    header.Depth = depth;
+    header.NoiseSeed = PotentialNoiseSeed;
+    header.ParametersHash = GetPotentialHash();
+    header.Reserved = 0;
+    return header;
+}
+
+static void* MapFile(const char* path, size_t expectedBytes)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+    LARGE_INTEGER size;
+    void* view = 0;
+    if (GetFileSizeEx(file, &size) && (size_t) size.QuadPart == expectedBytes) {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping) {
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    return view;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return 0;
+    struct stat info;
+    void* view = 0;
+    if (fstat(file, &info) == 0 && (size_t) info.st_size == expectedBytes) {
+        view = mmap(0, expectedBytes, PROT_READ, MAP_SHARED, file, 0);
+        if (view == MAP_FAILED)
+            view = 0;
+    }
+    close(file);
+    return view;
+#endif
+}
+
+static void UnmapFile(void* view, size_t bytes)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(view, bytes);
+#endif
+}
+
+static bool SaveBake(const char* path, const BakeHeader& header, const float* data, size_t dataBytes)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    bool saved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(data, 1, dataBytes, file) == dataBytes;
+    saved = fclose(file) == 0 && saved;
+    if (!saved)
+        remove(path);
+    return saved;
+}
+
+void BakeVelocity(float* dest, int width, int height, int depth, void (*progress)(int))
+{
+    const float W = 2.0f;
+    const float H = W * height / width;
+    const float D = W;
+    int finished = 0;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int slice = 0; slice < depth; ++slice) {
+        float* pData = dest + (size_t) slice * width * height * 3;
+        for (int row = 0; row < height; ++row) {
+            for (int col = 0; col < width; ++col) {
+                Point3 p;
+                p[0] = -W + 2 * W * col / width;
+                p[1] = -H + 2 * H * row / height;
+                p[2] = -D + 2 * D * slice / depth;
+                Vector3 v = ComputeCurl(p);
+                *pData++ = v[0];
+                *pData++ = v[1];
+                *pData++ = v[2];
+            }
+        }
+
+        int remaining;
+        #pragma omp critical
+        remaining = depth - ++finished;
+
+#ifdef _OPENMP
+        if (omp_get_thread_num() != 0)
+            continue;
+#endif
+        if (progress)
+            progress(remaining);
+    }
+
+    if (progress)
+        progress(0);
+}
+
+bool OpenVelocityBake(VelocityBake* bake, const char* path, int width, int height, int depth,
+    void (*progress)(int))
+{
+    BakeHeader header = MakeHeader(width, height, depth);
+    size_t dataBytes = (size_t) width * height * depth * 3 * sizeof(float);
+    size_t fileBytes = sizeof(header) + dataBytes;
+
+    CloseVelocityBake(bake);
+    bake->Width = width;
+    bake->Height = height;
+    bake->Depth = depth;
+    bake->Storage.clear();
+
+    bake->Mapping = MapFile(path, fileBytes);
+    if (bake->Mapping && !memcmp(bake->Mapping, &header, sizeof(header))) {
+        bake->MappingBytes = fileBytes;
+        bake->Data = (const float*) ((const char*) bake->Mapping + sizeof(header));
+        return true;
+    }
+    if (bake->Mapping)
+        UnmapFile(bake->Mapping, fileBytes);
+
+    // Bake into memory, then swap in a mapping of the saved copy so the heap copy can go:
+    bake->Storage.resize((size_t) width * height * depth * 3);
+    BakeVelocity(&bake->Storage[0], width, height, depth, progress);
+    bake->Data = &bake->Storage[0];
+    bake->Mapping = 0;
+    bake->MappingBytes = 0;
+
+    void* mapping = SaveBake(path, header, bake->Data, dataBytes) ? MapFile(path, fileBytes) : 0;
+    if (mapping) {
+        bake->Mapping = mapping;
+        bake->MappingBytes = fileBytes;
+        bake->Data = (const float*) ((const char*) mapping + sizeof(header));
+        std::vector<float>().swap(bake->Storage);
+    }
+    return false;
+}
+
+void CloseVelocityBake(VelocityBake* bake)
+{
+    if (bake->Mapping)
+        UnmapFile(bake->Mapping, bake->MappingBytes);
+    std::vector<float>().swap(bake->Storage);
+    bake->Mapping = 0;
+    bake->MappingBytes = 0;
+    bake->Data = 0;
+}
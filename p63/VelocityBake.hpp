@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// The curl of the potential, baked over the box that the velocity texture covers:
+// [-W, W] x [-H, H] x [-D, D] with W = D = 2 and H scaled by height / width.
+//
+// Bakes are saved with a header that records the grid size, the noise seed, and a hash of
+// the potential's parameters.  A later launch with the same settings maps the file instead of
+// recomputing it, and samples straight from the mapping.
+struct VelocityBake {
+    const float* Data;          // Interleaved xyz in scanline order; x varies fastest
+    int Width;
+    int Height;
+    int Depth;
+    void* Mapping;              // Base of the mapped file, or null if Data points into Storage
+    size_t MappingBytes;
+    std::vector<float> Storage; // Fallback when the bake can't be saved
+
+    VelocityBake() : Data(0), Width(0), Height(0), Depth(0), Mapping(0), MappingBytes(0) {}
+};
+
+// Maps the bake at path if its header matches; otherwise computes the field one slice per
+// task on all threads and saves it.  If given, progress receives the number of slices still
+// to go, always on the calling thread.  Returns true if the field came from the file; if it
+// had to be baked and couldn't be saved, Mapping is left null.  Any bake already open in
+// the struct is closed first.
+bool OpenVelocityBake(VelocityBake* bake, const char* path, int width, int height, int depth,
+    void (*progress)(int) = 0);
+
+void CloseVelocityBake(VelocityBake* bake);
+
+// Fills dest with width * height * depth * 3 floats.  Exposed for the benchmark.
+void BakeVelocity(float* dest, int width, int height, int depth, void (*progress)(int) = 0);
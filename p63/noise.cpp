@@ -128,6 +128,45 @@ operator()(float x, float y, float z) const
                   sx, sy, sz);
 }
 
+float Noise3::
+operator()(float x, float y, float z, vmath::Vector3 &gradient) const
+{
+   float floorx=std::floor(x), floory=std::floor(y), floorz=std::floor(z);
+   int i=(int)floorx, j=(int)floory, k=(int)floorz;
+   const vmath::Vector3 &n000=basis[hash_index(i,j,k)];
+   const vmath::Vector3 &n100=basis[hash_index(i+1,j,k)];
+   const vmath::Vector3 &n010=basis[hash_index(i,j+1,k)];
+   const vmath::Vector3 &n110=basis[hash_index(i+1,j+1,k)];
+   const vmath::Vector3 &n001=basis[hash_index(i,j,k+1)];
+   const vmath::Vector3 &n101=basis[hash_index(i+1,j,k+1)];
+   const vmath::Vector3 &n011=basis[hash_index(i,j+1,k+1)];
+   const vmath::Vector3 &n111=basis[hash_index(i+1,j+1,k+1)];
+   float fx=x-floorx, fy=y-floory, fz=z-floorz;
+   float sx=fx*fx*fx*(10-fx*(15-fx*6)),
+         sy=fy*fy*fy*(10-fy*(15-fy*6)),
+         sz=fz*fz*fz*(10-fz*(15-fz*6));
+   float dsx=30*fx*fx*(fx-1)*(fx-1),
+         dsy=30*fy*fy*(fy-1)*(fy-1),
+         dsz=30*fz*fz*(fz-1)*(fz-1);
+   float u000=    fx*n000[0] +     fy*n000[1] +     fz*n000[2],
+         u100=(fx-1)*n100[0] +     fy*n100[1] +     fz*n100[2],
+         u010=    fx*n010[0] + (fy-1)*n010[1] +     fz*n010[2],
+         u110=(fx-1)*n110[0] + (fy-1)*n110[1] +     fz*n110[2],
+         u001=    fx*n001[0] +     fy*n001[1] + (fz-1)*n001[2],
+         u101=(fx-1)*n101[0] +     fy*n101[1] + (fz-1)*n101[2],
+         u011=    fx*n011[0] + (fy-1)*n011[1] + (fz-1)*n011[2],
+         u111=(fx-1)*n111[0] + (fy-1)*n111[1] + (fz-1)*n111[2];
+
+   // Interpolated corner gradients, plus the derivative of each fade curve times the
+   // difference it blends across:
+   gradient=trilerp(n000, n100, n010, n110, n001, n101, n011, n111, sx, sy, sz);
+   gradient[0]+=dsx*bilerp(u100-u000, u110-u010, u101-u001, u111-u011, sy, sz);
+   gradient[1]+=dsy*bilerp(u010-u000, u110-u100, u011-u001, u111-u101, sx, sz);
+   gradient[2]+=dsz*bilerp(u001-u000, u101-u100, u011-u010, u111-u110, sx, sy);
+
+   return trilerp(u000, u100, u010, u110, u001, u101, u011, u111, sx, sy, sz);
+}
+
 FlowNoise3::
 FlowNoise3(unsigned int seed, float spin_variation)
    : Noise3(seed)
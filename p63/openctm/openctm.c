@@ -75,16 +75,18 @@ static void _ctmFreeMapList(_CTMcontext * self, _CTMfloatmap * aMapList)
 //-----------------------------------------------------------------------------
 static void _ctmClearMesh(_CTMcontext * self)
 {
-  // Free internally allocated mesh arrays
+  // Free internally allocated mesh arrays (arrays that were provided by a
+  // streaming import map() function are owned by the caller)
   if(self->mMode == CTM_IMPORT)
   {
-    if(self->mVertices)
+    if(self->mVertices && !(self->mExternalArrays & _CTM_EXTERNAL_VERTICES))
       free(self->mVertices);
-    if(self->mIndices)
+    if(self->mIndices && !(self->mExternalArrays & _CTM_EXTERNAL_INDICES))
       free(self->mIndices);
-    if(self->mNormals)
+    if(self->mNormals && !(self->mExternalArrays & _CTM_EXTERNAL_NORMALS))
       free(self->mNormals);
   }
+  self->mExternalArrays = 0;
 
   // Clear externally assigned mesh arrays
   self->mVertices = (CTMfloat *) 0;
@@ -198,6 +200,7 @@ CTMEXPORT CTMcontext CTMCALL ctmNewContext(CTMenum aMode)
   self->mError = CTM_NONE;
   self->mMethod = CTM_METHOD_MG1;
   self->mCompressionLevel = 1;
+  self->mCompressionThreads = 1;
   self->mVertexPrecision = 1.0f / 1024.0f;
   self->mNormalPrecision = 1.0f / 256.0f;
 
@@ -695,6 +698,80 @@ CTMEXPORT void CTMCALL ctmCompressionLevel(CTMcontext aContext,
   self->mCompressionLevel = aLevel;
 }
 
+//-----------------------------------------------------------------------------
+// ctmCompressionPreset()
+//-----------------------------------------------------------------------------
+CTMEXPORT void CTMCALL ctmCompressionPreset(CTMcontext aContext,
+  CTMenum aPreset)
+{
+  _CTMcontext * self = (_CTMcontext *) aContext;
+  if(!self) return;
+
+  // You are only allowed to change compression attributes in export mode
+  if(self->mMode != CTM_EXPORT)
+  {
+    self->mError = CTM_INVALID_OPERATION;
+    return;
+  }
+
+  // Check arguments
+  if((aPreset != CTM_PRESET_DEFAULT) && (aPreset != CTM_PRESET_FAST))
+  {
+    self->mError = CTM_INVALID_ARGUMENT;
+    return;
+  }
+
+  // Select the LZMA encoder settings
+  self->mFastCompression = (aPreset == CTM_PRESET_FAST) ? CTM_TRUE : CTM_FALSE;
+}
+
+//-----------------------------------------------------------------------------
+// ctmCompressionThreads()
+//-----------------------------------------------------------------------------
+CTMEXPORT void CTMCALL ctmCompressionThreads(CTMcontext aContext,
+  CTMuint aThreadCount)
+{
+  _CTMcontext * self = (_CTMcontext *) aContext;
+  if(!self) return;
+
+  // You are only allowed to change compression attributes in export mode
+  if(self->mMode != CTM_EXPORT)
+  {
+    self->mError = CTM_INVALID_OPERATION;
+    return;
+  }
+
+  // Check arguments
+  if(aThreadCount < 1)
+  {
+    self->mError = CTM_INVALID_ARGUMENT;
+    return;
+  }
+
+  // Set the number of compression threads
+  self->mCompressionThreads = aThreadCount;
+}
+
+//-----------------------------------------------------------------------------
+// ctmDecodeThreads()
+//-----------------------------------------------------------------------------
+CTMEXPORT void CTMCALL ctmDecodeThreads(CTMcontext aContext,
+  CTMuint aThreadCount)
+{
+  _CTMcontext * self = (_CTMcontext *) aContext;
+  if(!self) return;
+
+  // You are only allowed to change decoding attributes in import mode
+  if(self->mMode != CTM_IMPORT)
+  {
+    self->mError = CTM_INVALID_OPERATION;
+    return;
+  }
+
+  // Set the number of decoding threads
+  self->mDecodeThreads = aThreadCount;
+}
+
 //-----------------------------------------------------------------------------
 // ctmVertexPrecision()
 //-----------------------------------------------------------------------------
@@ -1171,6 +1248,49 @@ static CTMuint _ctmAllocateFloatMaps(_CTMcontext * self,
   return CTM_TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// _ctmAllocateArray() - Allocate a mesh array, using the streaming import
+// map() function if there is one.
+//-----------------------------------------------------------------------------
+static void * _ctmAllocateArray(_CTMcontext * self, CTMenum aArray,
+  CTMuint aSize, CTMuint aExternalBit)
+{
+  void * buf;
+
+  if(self->mMapFn)
+  {
+    buf = self->mMapFn(aArray, aSize, self->mStreamUserData);
+    if(buf)
+    {
+      self->mExternalArrays |= aExternalBit;
+      return buf;
+    }
+  }
+
+  return malloc(aSize);
+}
+
+//-----------------------------------------------------------------------------
+// ctmStreamingImport()
+//-----------------------------------------------------------------------------
+CTMEXPORT void CTMCALL ctmStreamingImport(CTMcontext aContext, CTMmapfn aMapFn,
+  CTMprogressfn aProgressFn, void * aUserData)
+{
+  _CTMcontext * self = (_CTMcontext *) aContext;
+  if(!self) return;
+
+  // Streaming only applies to import mode
+  if(self->mMode != CTM_IMPORT)
+  {
+    self->mError = CTM_INVALID_OPERATION;
+    return;
+  }
+
+  self->mMapFn = aMapFn;
+  self->mProgressFn = aProgressFn;
+  self->mStreamUserData = aUserData;
+}
+
 //-----------------------------------------------------------------------------
 // ctmLoadCustom()
 //-----------------------------------------------------------------------------
@@ -1191,6 +1311,7 @@ CTMEXPORT void CTMCALL ctmLoadCustom(CTMcontext aContext, CTMreadfn aReadFn,
   // Initialize stream
   self->mReadFn = aReadFn;
   self->mUserData = aUserData;
+  self->mBytesRead = 0;
 
   // Clear any old mesh arrays
   _ctmClearMesh(self);
@@ -1237,13 +1358,15 @@ CTMEXPORT void CTMCALL ctmLoadCustom(CTMcontext aContext, CTMreadfn aReadFn,
   _ctmStreamReadSTRING(self, &self->mFileComment);
 
   // Allocate memory for the mesh arrays
-  self->mVertices = (CTMfloat *) malloc(self->mVertexCount * sizeof(CTMfloat) * 3);
+  self->mVertices = (CTMfloat *) _ctmAllocateArray(self, CTM_VERTICES,
+    self->mVertexCount * sizeof(CTMfloat) * 3, _CTM_EXTERNAL_VERTICES);
   if(!self->mVertices)
   {
     self->mError = CTM_OUT_OF_MEMORY;
     return;
   }
-  self->mIndices = (CTMuint *) malloc(self->mTriangleCount * sizeof(CTMuint) * 3);
+  self->mIndices = (CTMuint *) _ctmAllocateArray(self, CTM_INDICES,
+    self->mTriangleCount * sizeof(CTMuint) * 3, _CTM_EXTERNAL_INDICES);
   if(!self->mIndices)
   {
     _ctmClearMesh(self);
@@ -1252,7 +1375,8 @@ CTMEXPORT void CTMCALL ctmLoadCustom(CTMcontext aContext, CTMreadfn aReadFn,
   }
   if(flags & _CTM_HAS_NORMALS_BIT)
   {
-    self->mNormals = (CTMfloat *) malloc(self->mVertexCount * sizeof(CTMfloat) * 3);
+    self->mNormals = (CTMfloat *) _ctmAllocateArray(self, CTM_NORMALS,
+      self->mVertexCount * sizeof(CTMfloat) * 3, _CTM_EXTERNAL_NORMALS);
     if(!self->mNormals)
     {
       _ctmClearMesh(self);
@@ -213,6 +213,14 @@ class CTMimporter {
       CheckError();
     }
 
+    /// Wrapper for ctmStreamingImport()
+    void StreamingImport(CTMmapfn aMapFn, CTMprogressfn aProgressFn,
+      void * aUserData)
+    {
+      ctmStreamingImport(mContext, aMapFn, aProgressFn, aUserData);
+      CheckError();
+    }
+
     // You can not copy nor assign from one CTMimporter object to another, since
     // the object contains hidden state. By declaring these dummy prototypes
     // without an implementation, you will at least get linker errors if you try
@@ -281,6 +289,20 @@ class CTMexporter {
       CheckError();
     }
 
+    /// Wrapper for ctmCompressionPreset()
+    void CompressionPreset(CTMenum aPreset)
+    {
+      ctmCompressionPreset(mContext, aPreset);
+      CheckError();
+    }
+
+    /// Wrapper for ctmCompressionThreads()
+    void CompressionThreads(CTMuint aThreadCount)
+    {
+      ctmCompressionThreads(mContext, aThreadCount);
+      CheckError();
+    }
+
     /// Wrapper for ctmVertexPrecision()
     void VertexPrecision(CTMfloat aPrecision)
     {
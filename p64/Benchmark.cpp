@@ -0,0 +1,158 @@
+// Headless benchmark for pyroclastic volume generation: the original per-voxel PerlinNoise3D
+// loop versus bricked PerlinContext evaluation on one thread and on all threads.  Then fills
+// the mip pyramid, checks each level against a plain reduction of the one above, and times
+// saving it to disk and reading it back.
+// Usage: Benchmark [maxSize]
+
+#include "Pyroclastic.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const char* Path = "PyroclasticBenchmark.dat";
+
+// The loop that CreatePyroclasticVolume used to run.
+static void FillReferenceVolume(unsigned char* data, int n, float r)
+{
+    unsigned char *ptr = data;
+    float frequency = 3.0f / n;
+    float center = n / 2.0f + 0.5f;
+    for (int x = 0; x < n; ++x) {
+        for (int y = 0; y < n; ++y) {
+            for (int z = 0; z < n; ++z) {
+                float dx = center-x;
+                float dy = center-y;
+                float dz = center-z;
+                float off = fabsf((float) PerlinNoise3D(x*frequency, y*frequency, z*frequency, 5, 6, 3));
+                float d = sqrtf(dx*dx+dy*dy+dz*dz)/(n);
+                *ptr++ = (d-off) < r ? 255 : 0;
+            }
+        }
+    }
+}
+
+static void SetThreadCount(int threadCount)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+}
+
+// Counts the voxels of a level that differ from a whole-level reduction of the one above.
+static size_t CheckLevel(const PyroclasticVolume& volume, int level)
+{
+    int size = volume.Size >> level;
+    int above = 2 * size;
+    const unsigned char* src = &volume.Voxels[volume.Offsets[level - 1]];
+    const unsigned char* dst = &volume.Voxels[volume.Offsets[level]];
+    size_t differences = 0;
+    for (int x = 0; x < size; ++x)
+        for (int y = 0; y < size; ++y)
+            for (int z = 0; z < size; ++z) {
+                int sum = 0;
+                for (int i = 0; i < 8; ++i)
+                    sum += src[((size_t) (2 * x + (i >> 2)) * above + 2 * y + ((i >> 1) & 1)) * above + 2 * z + (i & 1)];
+                differences += dst[((size_t) x * size + y) * size + z] != (sum + 4) / 8;
+            }
+    return differences;
+}
+
+static bool RunPyramid(int n, float r, const PerlinContext* noise, const unsigned char* volume, int threadCount)
+{
+    PyroclasticVolume serial, threaded;
+    SetThreadCount(1);
+    double start = GetSeconds();
+    FillPyroclasticPyramid(&serial, n, r, noise);
+    double serialTime = GetSeconds() - start;
+
+    SetThreadCount(threadCount);
+    start = GetSeconds();
+    FillPyroclasticPyramid(&threaded, n, r, noise);
+    double threadedTime = GetSeconds() - start;
+
+    size_t voxelCount = (size_t) n * n * n;
+    bool identical = serial.Voxels == threaded.Voxels && !memcmp(&serial.Voxels[0], volume, voxelCount);
+    size_t differences = 0;
+    for (int level = 1; level < serial.LevelCount; ++level)
+        differences += CheckLevel(serial, level);
+
+    remove(Path);
+    PyroclasticVolume cached;
+    bool saved = !OpenPyroclasticVolume(&cached, Path, n, r, noise);
+    start = GetSeconds();
+    bool loaded = OpenPyroclasticVolume(&cached, Path, n, r, noise);
+    double loadTime = GetSeconds() - start;
+    bool reused = saved && loaded && cached.Voxels == serial.Voxels;
+
+    // A different radius must not reuse the file:
+    bool rejected = !OpenPyroclasticVolume(&cached, Path, n, r * 2, noise);
+    remove(Path);
+
+    bool passed = identical && differences == 0 && reused && rejected;
+    printf("%3d^3  pyramid of %d levels: %6.1f ms  %2d threads: %6.1f ms  read from disk: %5.1f ms  "
+        "misreduced voxels: %d  %s\n",
+        n, serial.LevelCount, serialTime * 1000, threadCount, threadedTime * 1000, loadTime * 1000,
+        (int) differences, passed ? "identical" : "MISMATCH");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    int maxSize = argc > 1 ? atoi(argv[1]) : 256;
+    const float Radius = 0.025f;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    PerlinContext noise;
+    PerlinInit(&noise, 1);
+
+    bool passed = true;
+    for (int n = 128; n <= maxSize; n *= 2) {
+        size_t voxelCount = (size_t) n * n * n;
+        unsigned char* reference = new unsigned char[voxelCount];
+        unsigned char* batched = new unsigned char[voxelCount];
+
+        double start = GetSeconds();
+        FillReferenceVolume(reference, n, Radius);
+        double referenceTime = GetSeconds() - start;
+
+        SetThreadCount(1);
+        start = GetSeconds();
+        FillPyroclasticVolume(batched, n, Radius, &noise);
+        double batchedTime = GetSeconds() - start;
+
+        SetThreadCount(threadCount);
+        start = GetSeconds();
+        FillPyroclasticVolume(batched, n, Radius, &noise);
+        double threadedTime = GetSeconds() - start;
+
+        // The batched noise runs in single precision, so count any voxels that it moves across
+        // the surface; none do with these parameters:
+        size_t differences = 0;
+        for (size_t i = 0; i < voxelCount; ++i)
+            differences += reference[i] != batched[i];
+
+        printf("%3d^3  reference: %6.1f M voxels/s  bricked: %6.1f M voxels/s  %2d threads: %6.1f M voxels/s  "
+            "differing voxels: %d of %d\n",
+            n, voxelCount / referenceTime * 0.000001, voxelCount / batchedTime * 0.000001,
+            threadCount, voxelCount / threadedTime * 0.000001, (int) differences, (int) voxelCount);
+
+        passed = RunPyramid(n, Radius, &noise, batched, threadCount) && passed;
+
+        delete[] reference;
+        delete[] batched;
+    }
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+#include "Pyroclastic.h"
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <math.h>
+
+static const char Magic[4] = { 'P', 'Y', 'R', 'O' };
+static const unsigned int Version = 1;
+
+// 32 bytes, ahead of the levels.
+struct PyroclasticHeader {
+    char Magic[4];
+    unsigned int Version;
+    unsigned int Size;
+    unsigned int LevelCount;
+    float Radius;
+    unsigned int NoiseHash;
+    unsigned int Reserved[2];
+};
+
+// Scratch for one thread: the coordinates of a brick row and its noise.
+struct BrickRow {
+    float X[PyroclasticBrickSize];
+    float Y[PyroclasticBrickSize];
+    float Z[PyroclasticBrickSize];
+    float Offset[PyroclasticBrickSize];
+};
+
+static void FillBrick(unsigned char* data, int n, float r, const PerlinContext* noise, BrickRow* row,
+    int x0, int y0, int z0, int x1, int y1, int z1)
+{
+    float frequency = 3.0f / n;
+    float center = n / 2.0f + 0.5f;
+    int count = z1 - z0;
+    for (int z = z0; z < z1; ++z)
+        row->Z[z - z0] = z * frequency;
+
+    for (int x = x0; x < x1; ++x) {
+        std::fill(row->X, row->X + count, x * frequency);
+        for (int y = y0; y < y1; ++y) {
+            std::fill(row->Y, row->Y + count, y * frequency);
+
+            PerlinNoise3DBatch(noise, row->X, row->Y, row->Z, 5, 6, 3, row->Offset, count);
+
+            unsigned char* ptr = data + ((size_t) x * n + y) * n + z0;
+            float dx = center - x;
+            float dy = center - y;
+            for (int z = z0; z < z1; ++z) {
+                float dz = center - z;
+                float d = sqrtf(dx*dx+dy*dy+dz*dz)/(n);
+                bool isFilled = (d - fabsf(row->Offset[z - z0])) < r;
+                *ptr++ = isFilled ? 255 : 0;
+            }
+        }
+    }
+}
+
+// Averages 2x2x2 blocks of src, a cube of the given size, into the voxels of dst from
+// (x0, y0, z0) up to (x1, y1, z1):
+static void Downsample(const unsigned char* src, int size, unsigned char* dst,
+    int x0, int y0, int z0, int x1, int y1, int z1)
+{
+    int half = size / 2;
+    size_t slice = (size_t) size * size;
+    for (int x = x0; x < x1; ++x) {
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char* a = src + ((size_t) 2 * x * size + 2 * y) * size;
+            const unsigned char* b = a + size;
+            const unsigned char* c = a + slice;
+            const unsigned char* d = c + size;
+            unsigned char* ptr = dst + ((size_t) x * half + y) * half;
+            for (int z = z0; z < z1; ++z) {
+                int i = 2 * z;
+                int sum = a[i] + a[i + 1] + b[i] + b[i + 1] + c[i] + c[i + 1] + d[i] + d[i + 1];
+                ptr[z] = (unsigned char) ((sum + 4) >> 3);
+            }
+        }
+    }
+}
+
+// Fills level 0 brick by brick.  Bricks are reduced into levels 1 through brickLevels while
+// they're still in cache, so every brick corner has to sit on a voxel of those levels.
+static void FillBricks(unsigned char* const* levels, int n, float r, const PerlinContext* noise, int brickLevels)
+{
+    int bricksPerSide = (n + PyroclasticBrickSize - 1) / PyroclasticBrickSize;
+    int brickCount = bricksPerSide * bricksPerSide * bricksPerSide;
+
+    #pragma omp parallel
+    {
+        BrickRow row;
+
+        #pragma omp for schedule(dynamic)
+        for (int brick = 0; brick < brickCount; ++brick) {
+            int x0 = brick / (bricksPerSide * bricksPerSide) * PyroclasticBrickSize;
+            int y0 = brick / bricksPerSide % bricksPerSide * PyroclasticBrickSize;
+            int z0 = brick % bricksPerSide * PyroclasticBrickSize;
+            int x1 = std::min(x0 + PyroclasticBrickSize, n);
+            int y1 = std::min(y0 + PyroclasticBrickSize, n);
+            int z1 = std::min(z0 + PyroclasticBrickSize, n);
+            FillBrick(levels[0], n, r, noise, &row, x0, y0, z0, x1, y1, z1);
+
+            for (int level = 1; level <= brickLevels; ++level)
+                Downsample(levels[level - 1], n >> (level - 1), levels[level],
+                    x0 >> level, y0 >> level, z0 >> level, x1 >> level, y1 >> level, z1 >> level);
+        }
+    }
+}
+
+void FillPyroclasticVolume(unsigned char* data, int n, float r, const PerlinContext* noise)
+{
+    FillBricks(&data, n, r, noise, 0);
+}
+
+int GetPyroclasticLevelCount(int n)
+{
+    int count = 1;
+    for (; n > 1 && n % 2 == 0; n /= 2)
+        ++count;
+    return count;
+}
+
+static void AllocateLevels(PyroclasticVolume* volume, int n)
+{
+    volume->Size = n;
+    volume->LevelCount = GetPyroclasticLevelCount(n);
+    volume->Offsets.resize(volume->LevelCount);
+    size_t total = 0;
+    for (int level = 0; level < volume->LevelCount; ++level) {
+        size_t size = (size_t) (n >> level);
+        volume->Offsets[level] = total;
+        total += size * size * size;
+    }
+    volume->Voxels.resize(total);
+}
+
+void FillPyroclasticPyramid(PyroclasticVolume* volume, int n, float r, const PerlinContext* noise)
+{
+    AllocateLevels(volume, n);
+    std::vector<unsigned char*> levels(volume->LevelCount);
+    for (int level = 0; level < volume->LevelCount; ++level)
+        levels[level] = &volume->Voxels[volume->Offsets[level]];
+
+    // Bricks can be reduced as far as their sides stay even:
+    int brickLevels = 0;
+    while (brickLevels + 1 < volume->LevelCount && PyroclasticBrickSize % (2 << brickLevels) == 0)
+        ++brickLevels;
+    FillBricks(&levels[0], n, r, noise, brickLevels);
+
+    for (int level = brickLevels + 1; level < volume->LevelCount; ++level) {
+        int size = n >> level;
+        #pragma omp parallel for
+        for (int x = 0; x < size; ++x)
+            Downsample(levels[level - 1], 2 * size, levels[level], x, 0, 0, x + 1, size, size);
+    }
+}
+
+// FNV-1a over the noise tables, so a different seed doesn't pick up a stale volume:
+static unsigned int HashNoise(const PerlinContext* noise)
+{
+    const unsigned char* bytes = (const unsigned char*) noise;
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(PerlinContext); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+static PyroclasticHeader MakeHeader(int n, float r, const PerlinContext* noise)
+{
+    PyroclasticHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = Version;
+    header.Size = n;
+    header.LevelCount = GetPyroclasticLevelCount(n);
+    header.Radius = r;
+    header.NoiseHash = HashNoise(noise);
+    return header;
+}
+
+static bool SaveVolume(const char* path, const PyroclasticHeader& header, const PyroclasticVolume& volume)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    bool saved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(&volume.Voxels[0], 1, volume.Voxels.size(), file) == volume.Voxels.size();
+    saved = fclose(file) == 0 && saved;
+    if (!saved)
+        remove(path);
+    return saved;
+}
+
+bool OpenPyroclasticVolume(PyroclasticVolume* volume, const char* path, int n, float r,
+    const PerlinContext* noise)
+{
+    PyroclasticHeader header = MakeHeader(n, r, noise);
+    AllocateLevels(volume, n);
+
+    FILE* file = fopen(path, "rb");
+    if (file) {
+        PyroclasticHeader saved;
+        bool loaded = fread(&saved, sizeof(saved), 1, file) == 1 && !memcmp(&saved, &header, sizeof(header)) &&
+            fread(&volume->Voxels[0], 1, volume->Voxels.size(), file) == volume->Voxels.size() &&
+            fgetc(file) == EOF;
+        fclose(file);
+        if (loaded)
+            return true;
+    }
+
+    FillPyroclasticPyramid(volume, n, r, noise);
+    SaveVolume(path, header, *volume);
+    return false;
+}
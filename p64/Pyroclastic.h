@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+extern "C" {
+#include "perlin.h"
+}
+
+// Fills an n^3 grid of bytes with a sphere of radius r whose surface is displaced by
+// three octaves of Perlin noise; texels inside are 255 and the rest are 0.  The grid is cut
+// into bricks of PyroclasticBrickSize^3 that are filled in parallel, one row of a brick per
+// noise batch, so each thread writes to a small block of memory at a time.
+void FillPyroclasticVolume(unsigned char* data, int n, float r, const PerlinContext* noise);
+
+enum { PyroclasticBrickSize = 32 };
+
+// The volume with its mip pyramid.  Each level halves the one before it, averaging 2x2x2
+// blocks, until the size is odd; when n is a power of two the last level is a single voxel.
+// Levels are stored one after another in Voxels, with the same layout as the volume.
+struct PyroclasticVolume {
+    int Size;
+    int LevelCount;
+    std::vector<size_t> Offsets;        // Start of each level in Voxels
+    std::vector<unsigned char> Voxels;
+};
+
+int GetPyroclasticLevelCount(int n);
+
+// Fills every level.  While a brick is still in cache, it's reduced into the levels where it
+// covers whole voxels; the few small levels left are reduced afterwards.
+void FillPyroclasticPyramid(PyroclasticVolume* volume, int n, float r, const PerlinContext* noise);
+
+// Reads the volume at path if its header matches n, r, and the noise tables; otherwise fills
+// it and saves it there.  Returns true if the volume came from the file.
+bool OpenPyroclasticVolume(PyroclasticVolume* volume, const char* path, int n, float r,
+    const PerlinContext* noise);
@@ -1,8 +1,5 @@
 #include "Utility.h"
-
-extern "C" {
-#include "perlin.h"
-}
+#include "Pyroclastic.h"
 
 using namespace vmath;
 using std::string;
@@ -47,7 +44,7 @@ void PezInitialize()
     Programs.TwoPassIntervals = LoadProgram("TwoPass.VS", "TwoPass.Cube", "TwoPass.Intervals");
     Programs.TwoPassRaycast = LoadProgram("TwoPass.VS", "TwoPass.Fullscreen", "TwoPass.Raycast");
     CubeCenterVbo = CreatePointVbo(0, 0, 0);
-    CloudTexture = CreatePyroclasticVolume(128, 0.025f);
+    CloudTexture = CreatePyroclasticVolume(256, 0.025f);
     IntervalsFbo[0] = CreateSurface(cfg.Width, cfg.Height);
     IntervalsFbo[1] = CreateSurface(cfg.Width, cfg.Height);
 
@@ -171,47 +168,31 @@ static GLuint CreatePyroclasticVolume(int n, float r)
     glGenTextures(1, &handle);
     glBindTexture(GL_TEXTURE_3D, handle);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // The ray marches sample with texture() in loops that break on the data, where the implicit
+    // LOD is undefined, so minification stays on level 0.  The mips are there for textureLod.
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    unsigned char *data = new unsigned char[n*n*n];
-    unsigned char *ptr = data;
-
-    float frequency = 3.0f / n;
-    float center = n / 2.0f + 0.5f;
-
-    for(int x=0; x < n; ++x) {
-        for (int y=0; y < n; ++y) {
-            for (int z=0; z < n; ++z) {
-                float dx = center-x;
-                float dy = center-y;
-                float dz = center-z;
-
-                float off = fabsf((float) PerlinNoise3D(
-                    x*frequency,
-                    y*frequency,
-                    z*frequency,
-                    5,
-                    6, 3));
-
-                float d = sqrtf(dx*dx+dy*dy+dz*dz)/(n);
-                bool isFilled = (d-off) < r;
-                *ptr++ = isFilled ? 255 : 0;
-            }
-        }
-        PezDebugString("Slice %d of %d\n", x, n);
+    PerlinContext noise;
+    PerlinInit(&noise, 1);
+
+    // The pyramid is saved in the working directory and reused while n, r, and the noise agree:
+    PyroclasticVolume volume;
+    OpenPyroclasticVolume(&volume, "Pyroclastic.dat", n, r, &noise);
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, volume.LevelCount - 1);
+    for (int level = 0; level < volume.LevelCount; ++level) {
+        int size = n >> level;
+        glTexImage3D(GL_TEXTURE_3D, level,
+                     GL_LUMINANCE,
+                     size, size, size, 0,
+                     GL_LUMINANCE,
+                     GL_UNSIGNED_BYTE,
+                     &volume.Voxels[volume.Offsets[level]]);
     }
 
-    glTexImage3D(GL_TEXTURE_3D, 0,
-                 GL_LUMINANCE,
-                 n, n, n, 0,
-                 GL_LUMINANCE,
-                 GL_UNSIGNED_BYTE,
-                 data);
-
-    delete[] data;
     return handle;
 }
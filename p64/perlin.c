@@ -12,6 +12,14 @@ static double g2[B + B + 2][2];
 static double g1[B + B + 2];
 static int start = 1;
 
+/* Same sequence as the Microsoft C runtime's rand(), so the tables match the original */
+/* Windows build no matter which C library this is compiled against. */
+static int lcg(unsigned int *seed)
+{
+   *seed = *seed * 214013 + 2531011;
+   return (*seed >> 16) & 0x7fff;
+}
+
 double noise1(double arg)
 {
    int bx0, bx1;
@@ -140,23 +148,24 @@ void normalize3(double v[3])
 void init(void)
 {
    int i, j, k;
+   unsigned int seed = 1;
 
    for (i = 0 ; i < B ; i++) {
       p[i] = i;
-      g1[i] = (double)((rand() % (B + B)) - B) / B;
+      g1[i] = (double)((lcg(&seed) % (B + B)) - B) / B;
 
       for (j = 0 ; j < 2 ; j++)
-         g2[i][j] = (double)((rand() % (B + B)) - B) / B;
+         g2[i][j] = (double)((lcg(&seed) % (B + B)) - B) / B;
       normalize2(g2[i]);
 
       for (j = 0 ; j < 3 ; j++)
-         g3[i][j] = (double)((rand() % (B + B)) - B) / B;
+         g3[i][j] = (double)((lcg(&seed) % (B + B)) - B) / B;
       normalize3(g3[i]);
    }
 
    while (--i) {
       k = p[i];
-      p[i] = p[j = rand() % B];
+      p[i] = p[j = lcg(&seed) % B];
       p[j] = k;
    }
 
@@ -232,3 +241,138 @@ double PerlinNoise3D(double x,double y,double z,double alpha,double beta,int n)
    return(sum);
 }
 
+
+/* --- Reentrant, batched evaluation ---------------------------------*/
+
+void PerlinInit(PerlinContext *ctx, unsigned int seed)
+{
+   int i, j, k;
+   double g[3];
+
+   /* Consumes the generator exactly like init(), including the 1D and 2D tables: */
+   for (i = 0 ; i < B ; i++) {
+      ctx->p[i] = i;
+      lcg(&seed);
+      lcg(&seed);
+      lcg(&seed);
+
+      for (j = 0 ; j < 3 ; j++)
+         g[j] = (double)((lcg(&seed) % (B + B)) - B) / B;
+      normalize3(g);
+      for (j = 0 ; j < 3 ; j++)
+         ctx->g3[i][j] = (float) g[j];
+      ctx->g3[i][3] = 0;
+   }
+
+   while (--i) {
+      k = ctx->p[i];
+      ctx->p[i] = ctx->p[j = lcg(&seed) % B];
+      ctx->p[j] = k;
+   }
+
+   for (i = 0 ; i < B + 2 ; i++) {
+      ctx->p[B + i] = ctx->p[i];
+      for (j = 0 ; j < 4 ; j++)
+         ctx->g3[B + i][j] = ctx->g3[i][j];
+   }
+}
+
+/* Evaluates up to PERLIN_LANES samples.  Lattice setup, the corner dot products, and the */
+/* interpolation are separate loops over the lanes so that the compiler can vectorize all */
+/* but the table lookups. */
+static void noise3_lanes(const PerlinContext *ctx, const float *x, const float *y, const float *z,
+                         float *result, int count)
+{
+   int bx0[PERLIN_LANES], by0[PERLIN_LANES], bz0[PERLIN_LANES];
+   float rx0[PERLIN_LANES], ry0[PERLIN_LANES], rz0[PERLIN_LANES];
+   float sx[PERLIN_LANES], sy[PERLIN_LANES], sz[PERLIN_LANES];
+   float u[8][PERLIN_LANES];
+   int l;
+
+   for (l = 0 ; l < count ; l++) {
+      /* Truncation rounds toward zero, so step back for negative coordinates: */
+      int ix = (int) x[l], iy = (int) y[l], iz = (int) z[l];
+      ix -= x[l] < ix;
+      iy -= y[l] < iy;
+      iz -= z[l] < iz;
+      bx0[l] = ix & BM;
+      by0[l] = iy & BM;
+      bz0[l] = iz & BM;
+      rx0[l] = x[l] - ix;
+      ry0[l] = y[l] - iy;
+      rz0[l] = z[l] - iz;
+      sx[l] = rx0[l] * rx0[l] * (3.0f - 2.0f * rx0[l]);
+      sy[l] = ry0[l] * ry0[l] * (3.0f - 2.0f * ry0[l]);
+      sz[l] = rz0[l] * rz0[l] * (3.0f - 2.0f * rz0[l]);
+   }
+
+   for (l = 0 ; l < count ; l++) {
+      int i = ctx->p[bx0[l]];
+      int j = ctx->p[bx0[l] + 1];
+      int b00 = ctx->p[i + by0[l]];
+      int b10 = ctx->p[j + by0[l]];
+      int b01 = ctx->p[i + by0[l] + 1];
+      int b11 = ctx->p[j + by0[l] + 1];
+      int bz = bz0[l];
+      float rx1 = rx0[l] - 1, ry1 = ry0[l] - 1, rz1 = rz0[l] - 1;
+      const float *q;
+
+      /* The tables are padded to B + B + 2 entries, so the +1 lookups don't need to wrap: */
+      q = ctx->g3[b00 + bz];     u[0][l] = at3(rx0[l], ry0[l], rz0[l]);
+      q = ctx->g3[b10 + bz];     u[1][l] = at3(rx1, ry0[l], rz0[l]);
+      q = ctx->g3[b01 + bz];     u[2][l] = at3(rx0[l], ry1, rz0[l]);
+      q = ctx->g3[b11 + bz];     u[3][l] = at3(rx1, ry1, rz0[l]);
+      q = ctx->g3[b00 + bz + 1]; u[4][l] = at3(rx0[l], ry0[l], rz1);
+      q = ctx->g3[b10 + bz + 1]; u[5][l] = at3(rx1, ry0[l], rz1);
+      q = ctx->g3[b01 + bz + 1]; u[6][l] = at3(rx0[l], ry1, rz1);
+      q = ctx->g3[b11 + bz + 1]; u[7][l] = at3(rx1, ry1, rz1);
+   }
+
+   for (l = 0 ; l < count ; l++) {
+      float a = lerp(sx[l], u[0][l], u[1][l]);
+      float b = lerp(sx[l], u[2][l], u[3][l]);
+      float c0 = lerp(sy[l], a, b);
+      float d0;
+      a = lerp(sx[l], u[4][l], u[5][l]);
+      b = lerp(sx[l], u[6][l], u[7][l]);
+      d0 = lerp(sy[l], a, b);
+      result[l] = lerp(sz[l], c0, d0);
+   }
+}
+
+void PerlinNoise3Batch(const PerlinContext *ctx, const float *x, const float *y, const float *z,
+                       float *result, int count)
+{
+   int i;
+   for (i = 0 ; i < count ; i += PERLIN_LANES)
+      noise3_lanes(ctx, x + i, y + i, z + i, result + i,
+                   count - i < PERLIN_LANES ? count - i : PERLIN_LANES);
+}
+
+void PerlinNoise3DBatch(const PerlinContext *ctx, const float *x, const float *y, const float *z,
+                        float alpha, float beta, int n, float *result, int count)
+{
+   float px[PERLIN_LANES], py[PERLIN_LANES], pz[PERLIN_LANES], val[PERLIN_LANES];
+   int i, l, o, lanes;
+
+   for (i = 0 ; i < count ; i += PERLIN_LANES) {
+      float scale = 1;
+      lanes = count - i < PERLIN_LANES ? count - i : PERLIN_LANES;
+      for (l = 0 ; l < lanes ; l++) {
+         px[l] = x[i + l];
+         py[l] = y[i + l];
+         pz[l] = z[i + l];
+         result[i + l] = 0;
+      }
+      for (o = 0 ; o < n ; o++) {
+         noise3_lanes(ctx, px, py, pz, val, lanes);
+         for (l = 0 ; l < lanes ; l++) {
+            result[i + l] += val[l] / scale;
+            px[l] *= beta;
+            py[l] *= beta;
+            pz[l] *= beta;
+         }
+         scale *= alpha;
+      }
+   }
+}
@@ -15,6 +15,16 @@
 #define at2(rx,ry) ( rx * q[0] + ry * q[1] )
 #define at3(rx,ry,rz) ( rx * q[0] + ry * q[1] + rz * q[2] )
 
+/* The functions above share lazily initialized tables and aren't thread-safe.  A */
+/* PerlinContext owns its tables and can be shared freely between threads once it's */
+/* initialized; the batched functions take structure-of-arrays float coordinates. */
+#define PERLIN_LANES 8
+
+typedef struct PerlinContextRec {
+   int p[B + B + 2];
+   float g3[B + B + 2][4];
+} PerlinContext;
+
 void init(void);
 double noise1(double);
 double noise2(double *);
@@ -26,3 +36,10 @@ double PerlinNoise1D(double,double,double,int);
 double PerlinNoise2D(double,double,double,double,int);
 double PerlinNoise3D(double,double,double,double,double,int);
 
+/* A seed of 1 reproduces the tables used by the functions above. */
+void PerlinInit(PerlinContext *ctx, unsigned int seed);
+void PerlinNoise3Batch(const PerlinContext *ctx, const float *x, const float *y, const float *z,
+                       float *result, int count);
+void PerlinNoise3DBatch(const PerlinContext *ctx, const float *x, const float *y, const float *z,
+                        float alpha, float beta, int n, float *result, int count);
+
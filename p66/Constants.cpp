@@ -0,0 +1,25 @@
+#include "Constants.h"
+
+using namespace vmath;
+
+const float CellSize = 1.25f;
+const int ViewportWidth = 320;
+const int GridWidth = 96;
+const int ViewportHeight = ViewportWidth;
+const int GridHeight = GridWidth;
+const int GridDepth = GridWidth;
+const float SplatRadius = GridWidth / 8.0f;
+const float AmbientTemperature = 0.0f;
+const float ImpulseTemperature = 10.0f;
+const float ImpulseDensity = 1.0f;
+const int NumJacobiIterations = 40;
+const int MaxMultigridCycles = 8;
+const float MultigridTolerance = 0.01f;
+const float TimeStep = 0.25f;
+const float SmokeBuoyancy = 1.0f;
+const float SmokeWeight = 0.0125f;
+const float GradientScale = 1.125f / CellSize;
+const float TemperatureDissipation = 0.99f;
+const float VelocityDissipation = 0.99f;
+const float DensityDissipation = 0.9995f;
+const Vector3 ImpulsePosition( GridWidth / 2.0f, GridHeight - (int) SplatRadius / 2.0f, GridDepth / 2.0f);
@@ -0,0 +1,27 @@
+#pragma once
+#include <vmath.hpp>
+
+// Simulation settings shared by the GPU slab operators in Utility.cpp and their CPU
+// counterparts in FluidCpu.cpp.  Nothing here depends on OpenGL.
+
+extern const float CellSize;
+extern const int ViewportWidth;
+extern const int ViewportHeight;
+extern const int GridWidth;
+extern const int GridHeight;
+extern const int GridDepth;
+extern const float SplatRadius;
+extern const float AmbientTemperature;
+extern const float ImpulseTemperature;
+extern const float ImpulseDensity;
+extern const int NumJacobiIterations;
+extern const int MaxMultigridCycles;
+extern const float MultigridTolerance;
+extern const float TimeStep;
+extern const float SmokeBuoyancy;
+extern const float SmokeWeight;
+extern const float GradientScale;
+extern const float TemperatureDissipation;
+extern const float VelocityDissipation;
+extern const float DensityDissipation;
+extern const vmath::Vector3 ImpulsePosition;
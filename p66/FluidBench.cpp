@@ -0,0 +1,364 @@
+// Headless run of the smoke simulation on the CPU, with the same operators, settings, and step
+// order as PezUpdate in Fluid3d.cpp.  Reports steps per second on one thread and on all of
+// them, checks that the two runs agree, and reports how much divergence the pressure
+// projection leaves behind.  Optionally writes the final density for comparison.
+//
+// Then it takes the divergence of one more step and reports how the residual of the pressure
+// equation falls over time, for Jacobi iterations and for multigrid V-cycles.  Passing
+// "multigrid" projects every step with V-cycles instead of the fixed Jacobi iterations.
+//
+// With Jacobi, it also runs the same steps on sparse bricks and compares step time, memory,
+// and the final density against the dense grids, and times the ray march both ways.
+// Usage: FluidBench [stepCount] [densityFile|-] [jacobi|multigrid]
+
+#include "FluidCpu.h"
+#include "FluidSparse.h"
+#include "pez.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace vmath;
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// The platform layer isn't linked into the headless build, so failed checks print and quit:
+void PezCheckCondition(int condition, ...)
+{
+    if (condition)
+        return;
+    va_list a;
+    va_start(a, condition);
+    const char* format = va_arg(a, const char*);
+    vfprintf(stderr, format, a);
+    va_end(a);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static struct {
+    GridSlabPod Velocity;
+    GridSlabPod Density;
+    GridSlabPod Pressure;
+    GridSlabPod Temperature;
+} Slabs;
+
+static struct {
+    GridPod Divergence;
+    GridPod Obstacles;
+} Surfaces;
+
+static MultigridPod Solver;
+static bool UseMultigrid;
+
+static struct {
+    BrickMapPod Map;
+    SparseGridSlabPod Velocity;
+    SparseGridSlabPod Density;
+    SparseGridSlabPod Pressure;
+    SparseGridSlabPod Temperature;
+    SparseGridPod Divergence;
+    SparseObstaclesPod Obstacles;
+} Sparse;
+
+// Bricks stay active while any of their cells differs from the background by more than this:
+static const float BrickThreshold = 0.001f;
+static const int ImageSize = 128;
+
+static void InitFluid()
+{
+    Slabs.Velocity = CreateGridSlab(GridWidth, GridHeight, GridDepth, 3);
+    Slabs.Density = CreateGridSlab(GridWidth, GridHeight, GridDepth, 1);
+    Slabs.Pressure = CreateGridSlab(GridWidth, GridHeight, GridDepth, 1);
+    Slabs.Temperature = CreateGridSlab(GridWidth, GridHeight, GridDepth, 1);
+    Surfaces.Divergence = CreateGrid(GridWidth, GridHeight, GridDepth, 3);
+    Surfaces.Obstacles = CreateGrid(GridWidth, GridHeight, GridDepth, 3);
+    CreateObstacles(Surfaces.Obstacles);
+    Solver = CreateMultigrid(Surfaces.Obstacles);
+    ClearSurface(Slabs.Temperature.Ping, AmbientTemperature);
+}
+
+// Everything in a step up to the pressure solve.
+static void PrepareProjection()
+{
+    Advect(Slabs.Velocity.Ping, Slabs.Velocity.Ping, Surfaces.Obstacles, Slabs.Velocity.Pong, VelocityDissipation);
+    SwapSurfaces(&Slabs.Velocity);
+    Advect(Slabs.Velocity.Ping, Slabs.Temperature.Ping, Surfaces.Obstacles, Slabs.Temperature.Pong, TemperatureDissipation);
+    SwapSurfaces(&Slabs.Temperature);
+    Advect(Slabs.Velocity.Ping, Slabs.Density.Ping, Surfaces.Obstacles, Slabs.Density.Pong, DensityDissipation);
+    SwapSurfaces(&Slabs.Density);
+    ApplyBuoyancy(Slabs.Velocity.Ping, Slabs.Temperature.Ping, Slabs.Density.Ping, Slabs.Velocity.Pong);
+    SwapSurfaces(&Slabs.Velocity);
+    ApplyImpulse(Slabs.Temperature.Ping, ImpulsePosition, ImpulseTemperature);
+    ApplyImpulse(Slabs.Density.Ping, ImpulsePosition, ImpulseDensity);
+    ComputeDivergence(Slabs.Velocity.Ping, Surfaces.Obstacles, Surfaces.Divergence);
+}
+
+static void UpdateFluid()
+{
+    PrepareProjection();
+    // V-cycles start from the previous step's pressure, which is already close:
+    if (UseMultigrid) {
+        SolvePressure(&Solver, Surfaces.Divergence, Slabs.Pressure.Ping, MultigridTolerance, MaxMultigridCycles);
+    } else {
+        ClearSurface(Slabs.Pressure.Ping, 0);
+        for (int i = 0; i < NumJacobiIterations; ++i) {
+            Jacobi(Slabs.Pressure.Ping, Surfaces.Divergence, Surfaces.Obstacles, Slabs.Pressure.Pong);
+            SwapSurfaces(&Slabs.Pressure);
+        }
+    }
+    SubtractGradient(Slabs.Velocity.Ping, Slabs.Pressure.Ping, Surfaces.Obstacles, Slabs.Velocity.Pong);
+    SwapSurfaces(&Slabs.Velocity);
+}
+
+static void InitSparseFluid()
+{
+    Sparse.Map = CreateBrickMap(GridWidth, GridHeight, GridDepth);
+    Sparse.Velocity = CreateSparseGridSlab(Sparse.Map, 3, 0);
+    Sparse.Density = CreateSparseGridSlab(Sparse.Map, 1, 0);
+    Sparse.Pressure = CreateSparseGridSlab(Sparse.Map, 1, 0);
+    Sparse.Temperature = CreateSparseGridSlab(Sparse.Map, 1, AmbientTemperature);
+    Sparse.Divergence = CreateSparseGrid(Sparse.Map, 1, 0);
+    GridPod obstacles = CreateGrid(GridWidth, GridHeight, GridDepth, 3);
+    CreateObstacles(obstacles);
+    Sparse.Obstacles = CreateSparseObstacles(obstacles);
+}
+
+// Keeps the bricks that hold smoke, adds the ones the splat is about to land in, and moves
+// every grid over to them.  Velocity doesn't keep bricks alive: projection spreads a faint
+// flow through every active brick, which would fill the box within a few steps.
+static void ActivateSparseBricks()
+{
+    std::vector<unsigned char> flags(Sparse.Map.Slots.size(), 0);
+    MarkActiveBricks(Sparse.Map, Sparse.Density.Ping, Sparse.Obstacles, BrickThreshold, &flags);
+    MarkActiveBricks(Sparse.Map, Sparse.Temperature.Ping, Sparse.Obstacles, BrickThreshold, &flags);
+    MarkSplatBricks(Sparse.Map, ImpulsePosition, SplatRadius, &flags);
+
+    SparseGridPod* grids[] = {
+        &Sparse.Velocity.Ping, &Sparse.Velocity.Pong, &Sparse.Density.Ping, &Sparse.Density.Pong,
+        &Sparse.Pressure.Ping, &Sparse.Pressure.Pong, &Sparse.Temperature.Ping, &Sparse.Temperature.Pong,
+        &Sparse.Divergence,
+    };
+    ActivateBricks(&Sparse.Map, flags, grids, sizeof(grids) / sizeof(grids[0]));
+}
+
+static void UpdateSparseFluid()
+{
+    const BrickMapPod& map = Sparse.Map;
+    ActivateSparseBricks();
+    Advect(map, Sparse.Velocity.Ping, Sparse.Velocity.Ping, Sparse.Obstacles, Sparse.Velocity.Pong, VelocityDissipation);
+    SwapSurfaces(&Sparse.Velocity);
+    Advect(map, Sparse.Velocity.Ping, Sparse.Temperature.Ping, Sparse.Obstacles, Sparse.Temperature.Pong, TemperatureDissipation);
+    SwapSurfaces(&Sparse.Temperature);
+    Advect(map, Sparse.Velocity.Ping, Sparse.Density.Ping, Sparse.Obstacles, Sparse.Density.Pong, DensityDissipation);
+    SwapSurfaces(&Sparse.Density);
+    ApplyBuoyancy(map, Sparse.Velocity.Ping, Sparse.Temperature.Ping, Sparse.Density.Ping, Sparse.Velocity.Pong);
+    SwapSurfaces(&Sparse.Velocity);
+    ApplyImpulse(map, Sparse.Temperature.Ping, ImpulsePosition, ImpulseTemperature);
+    ApplyImpulse(map, Sparse.Density.Ping, ImpulsePosition, ImpulseDensity);
+    ComputeDivergence(map, Sparse.Velocity.Ping, Sparse.Obstacles, Sparse.Divergence);
+    ClearSurface(Sparse.Pressure.Ping, 0);
+    for (int i = 0; i < NumJacobiIterations; ++i) {
+        Jacobi(map, Sparse.Pressure.Ping, Sparse.Divergence, Sparse.Obstacles, Sparse.Pressure.Pong);
+        SwapSurfaces(&Sparse.Pressure);
+    }
+    SubtractGradient(map, Sparse.Velocity.Ping, Sparse.Pressure.Ping, Sparse.Obstacles, Sparse.Velocity.Pong);
+    SwapSurfaces(&Sparse.Velocity);
+}
+
+static size_t GetDenseByteCount()
+{
+    const GridPod* grids[] = {
+        &Slabs.Velocity.Ping, &Slabs.Velocity.Pong, &Slabs.Density.Ping, &Slabs.Density.Pong,
+        &Slabs.Pressure.Ping, &Slabs.Pressure.Pong, &Slabs.Temperature.Ping, &Slabs.Temperature.Pong,
+        &Surfaces.Divergence, &Surfaces.Obstacles,
+    };
+    size_t bytes = 0;
+    for (size_t i = 0; i < sizeof(grids) / sizeof(grids[0]); ++i)
+        bytes += grids[i]->Data.size() * sizeof(float);
+    return bytes;
+}
+
+static size_t GetSparseByteCount()
+{
+    const SparseGridPod* grids[] = {
+        &Sparse.Velocity.Ping, &Sparse.Velocity.Pong, &Sparse.Density.Ping, &Sparse.Density.Pong,
+        &Sparse.Pressure.Ping, &Sparse.Pressure.Pong, &Sparse.Temperature.Ping, &Sparse.Temperature.Pong,
+        &Sparse.Divergence, &Sparse.Obstacles.Solid,
+    };
+    size_t bytes = GetByteCount(Sparse.Map) + GetByteCount(Sparse.Obstacles.Map);
+    for (size_t i = 0; i < sizeof(grids) / sizeof(grids[0]); ++i)
+        bytes += GetByteCount(*grids[i]);
+    return bytes;
+}
+
+// Runs the same steps on bricks, and compares against the dense run that just finished.
+static void RunSparseBenchmark(int stepCount, double denseTime)
+{
+    InitSparseFluid();
+    double start = GetSeconds();
+    for (int step = 0; step < stepCount; ++step)
+        UpdateSparseFluid();
+    double sparseTime = GetSeconds() - start;
+
+    GridPod density = CreateGrid(GridWidth, GridHeight, GridDepth, 1);
+    ExpandGrid(Sparse.Map, Sparse.Density.Ping, density);
+    const std::vector<float>& dense = Slabs.Density.Ping.Data;
+    double total = 0;
+    float largest = 0;
+    for (size_t i = 0; i < density.Data.size(); ++i) {
+        total += density.Data[i];
+        largest = std::max(largest, std::fabs(density.Data[i] - dense[i]));
+    }
+
+    int brickCount = (int) Sparse.Map.Slots.size();
+    int activeCount = (int) Sparse.Map.Active.size();
+    printf("sparse %d^3 bricks, %d of %d active: %6.2f steps/s against %6.2f dense  memory: %.1f MB against %.1f MB\n",
+        (int) BrickSize, activeCount, brickCount, stepCount / sparseTime, stepCount / denseTime,
+        GetSparseByteCount() / 1048576.0, GetDenseByteCount() / 1048576.0);
+    printf("after %d steps  total density: %.2f  largest difference from dense: %.3e\n",
+        stepCount, total, largest);
+
+    std::vector<float> denseImage, sparseImage;
+    start = GetSeconds();
+    RaycastDensity(density, ImageSize, &denseImage);
+    double denseRaycast = GetSeconds() - start;
+    start = GetSeconds();
+    RaycastDensity(Sparse.Map, Sparse.Density.Ping, ImageSize, &sparseImage);
+    double sparseRaycast = GetSeconds() - start;
+    printf("raycast %dx%d  dense: %8.1f ms  skipping empty bricks: %8.1f ms  %s\n", ImageSize, ImageSize,
+        denseRaycast * 1000, sparseRaycast * 1000, denseImage == sparseImage ? "identical" : "MISMATCH");
+}
+
+// RMS divergence over the fluid cells that don't touch a wall, where the swizzled obstacle
+// velocities would otherwise dominate.
+static float InteriorDivergence(const GridPod& divergence)
+{
+    double sum = 0;
+    int count = 0;
+    const float* plane = divergence.Plane(0);
+    for (int z = 2; z < divergence.Depth - 2; ++z)
+        for (int y = 2; y < divergence.Height - 2; ++y)
+            for (int x = 2; x < divergence.Width - 2; ++x, ++count) {
+                float d = plane[(z * divergence.Height + y) * divergence.Width + x];
+                sum += d * d;
+            }
+    return (float) std::sqrt(sum / std::max(count, 1));
+}
+
+static double RunSteps(int stepCount, float* before, float* after)
+{
+    InitFluid();
+    double start = GetSeconds();
+    for (int step = 0; step < stepCount; ++step)
+        UpdateFluid();
+    double elapsed = GetSeconds() - start;
+
+    // The last step's divergence is still in its surface; measure what projection left:
+    *before = InteriorDivergence(Surfaces.Divergence);
+    ComputeDivergence(Slabs.Velocity.Ping, Surfaces.Obstacles, Surfaces.Divergence);
+    *after = InteriorDivergence(Surfaces.Divergence);
+    return elapsed;
+}
+
+// Solves the pressure of the step that follows the current state both ways, starting from
+// zero each time, and prints the residual at each checkpoint with the time spent so far.
+// Residuals are computed outside the timed sections, except the one multigrid checks itself.
+static void RunResidualBenchmark()
+{
+    PrepareProjection();
+    const GridPod& divergence = Surfaces.Divergence;
+    const GridPod& obstacles = Surfaces.Obstacles;
+    printf("pressure residual (relative RMS) against time:\n");
+
+    ClearSurface(Slabs.Pressure.Ping, 0);
+    double elapsed = 0;
+    int iterations = 0;
+    for (int checkpoint = 10; checkpoint <= 640; checkpoint *= 2) {
+        double start = GetSeconds();
+        for (; iterations < checkpoint; ++iterations) {
+            Jacobi(Slabs.Pressure.Ping, divergence, obstacles, Slabs.Pressure.Pong);
+            SwapSurfaces(&Slabs.Pressure);
+        }
+        elapsed += GetSeconds() - start;
+        printf("  jacobi     %4d iterations  %8.1f ms  %.3e\n", iterations, elapsed * 1000,
+            ComputeResidual(Slabs.Pressure.Ping, divergence, obstacles));
+    }
+
+    ClearSurface(Slabs.Pressure.Ping, 0);
+    elapsed = 0;
+    for (int cycles = 1; cycles <= MaxMultigridCycles; ++cycles) {
+        float residual;
+        double start = GetSeconds();
+        SolvePressure(&Solver, divergence, Slabs.Pressure.Ping, 0, 1, &residual);
+        elapsed += GetSeconds() - start;
+        printf("  multigrid  %4d cycles      %8.1f ms  %.3e\n", cycles, elapsed * 1000,
+            ComputeResidual(Slabs.Pressure.Ping, divergence, obstacles));
+    }
+
+    int levelCount = (int) Solver.Levels.size();
+    const MultigridLevelPod& coarsest = Solver.Levels.back();
+    printf("  multigrid uses %d levels, down to %dx%dx%d\n", levelCount,
+        coarsest.Width, coarsest.Height, coarsest.Depth);
+}
+
+int main(int argc, char** argv)
+{
+    int stepCount = argc > 1 ? atoi(argv[1]) : 10;
+    const char* densityFile = argc > 2 && strcmp(argv[2], "-") ? argv[2] : 0;
+    UseMultigrid = argc > 3 && !strcmp(argv[3], "multigrid");
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+    omp_set_num_threads(1);
+#else
+    int threadCount = 1;
+#endif
+
+    float before, after;
+    double singleTime = RunSteps(stepCount, &before, &after);
+    std::vector<float> single = Slabs.Density.Ping.Data;
+
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+    double threadedTime = RunSteps(stepCount, &before, &after);
+    bool identical = single == Slabs.Density.Ping.Data;
+
+    double total = 0;
+    for (size_t i = 0; i < single.size(); ++i)
+        total += single[i];
+
+    char projection[64];
+    if (UseMultigrid)
+        sprintf(projection, "multigrid to %g", MultigridTolerance);
+    else
+        sprintf(projection, "%d Jacobi iterations", NumJacobiIterations);
+
+    printf("fluid %dx%dx%d, %s  1 thread: %6.2f steps/s  %2d threads: %6.2f steps/s  %s\n",
+        GridWidth, GridHeight, GridDepth, projection,
+        stepCount / singleTime, threadCount, stepCount / threadedTime, identical ? "identical" : "MISMATCH");
+    printf("after %d steps  total density: %.2f  RMS interior divergence before projection: %.3e  after: %.3e\n",
+        stepCount, total, before, after);
+
+    if (UseMultigrid)
+        printf("sparse bricks only support the Jacobi projection; skipping the comparison\n");
+    else
+        RunSparseBenchmark(stepCount, threadedTime);
+    RunResidualBenchmark();
+
+    if (densityFile) {
+        bool written = WriteToFile(densityFile, Slabs.Density.Ping);
+        printf("density %s %s\n", written ? "written to" : "could not be written to", densityFile);
+        if (!written)
+            return 1;
+    }
+
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,511 @@
+#include "FluidCpu.h"
+#include "FluidOps.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace vmath;
+
+// Runs op over every cell, one row per task.  The first and last cells of each row clamp
+// their east and west neighbors, so they go through the scalar path; everything between
+// them goes Vector::Count cells at a time.
+template<class Op>
+static void ForEachCell(int width, int height, int depth, const Op& op)
+{
+    int rowCount = height * depth;
+
+    #pragma omp parallel for
+    for (int row = 0; row < rowCount; ++row) {
+        int y = row % height;
+        int z = row / height;
+        int c = row * width;
+        int s = (z * height + std::max(y - 1, 0)) * width;
+        int n = (z * height + std::min(y + 1, height - 1)) * width;
+        int d = (std::max(z - 1, 0) * height + y) * width;
+        int u = (std::min(z + 1, depth - 1) * height + y) * width;
+
+        int x = 0;
+        while (x < width) {
+            Stencil cell;
+            cell.C = c + x;
+            cell.W = c + std::max(x - 1, 0);
+            cell.E = c + std::min(x + 1, width - 1);
+            cell.S = s + x;
+            cell.N = n + x;
+            cell.D = d + x;
+            cell.U = u + x;
+            if (x > 0 && x + Vector::Count < width) {
+                op.template Apply<Vector>(cell);
+                x += Vector::Count;
+            } else {
+                op.template Apply<Scalar>(cell);
+                ++x;
+            }
+        }
+    }
+}
+
+GridPod CreateGrid(int width, int height, int depth, int numComponents)
+{
+    GridPod grid;
+    grid.Width = width;
+    grid.Height = height;
+    grid.Depth = depth;
+    grid.NumComponents = numComponents;
+    grid.Data.assign(width * height * depth * numComponents, 0.0f);
+    return grid;
+}
+
+GridSlabPod CreateGridSlab(int width, int height, int depth, int numComponents)
+{
+    GridSlabPod slab;
+    slab.Ping = CreateGrid(width, height, depth, numComponents);
+    slab.Pong = CreateGrid(width, height, depth, numComponents);
+    return slab;
+}
+
+// The box walls, with the first and last slices entirely solid; this is what the GPU version
+// rasterizes with its border lines and oversized end caps.
+void CreateObstacles(GridPod& dest)
+{
+    ClearSurface(dest, 0);
+    float* solid = dest.Plane(0);
+    for (int z = 0; z < dest.Depth; ++z) {
+        for (int y = 0; y < dest.Height; ++y) {
+            for (int x = 0; x < dest.Width; ++x) {
+                bool wall = z == 0 || z == dest.Depth - 1 ||
+                    x == 0 || x == dest.Width - 1 || y == 0 || y == dest.Height - 1;
+                if (wall)
+                    solid[(z * dest.Height + y) * dest.Width + x] = 1;
+            }
+        }
+    }
+}
+
+void SwapSurfaces(GridSlabPod* slab)
+{
+    slab->Ping.Data.swap(slab->Pong.Data);
+}
+
+void ClearSurface(GridPod& s, float v)
+{
+    std::fill(s.Data.begin(), s.Data.end(), v);
+}
+
+// Backtracing gathers from anywhere in the source, so this one stays scalar.
+void Advect(const GridPod& velocity, const GridPod& source, const GridPod& obstacles, GridPod& dest, float dissipation)
+{
+    int width = dest.Width, height = dest.Height, depth = dest.Depth;
+    const float* solid = obstacles.Plane(0);
+    const float* vx = velocity.Plane(0);
+    const float* vy = velocity.Plane(1);
+    const float* vz = velocity.Plane(2);
+    int rowCount = height * depth;
+
+    #pragma omp parallel for
+    for (int row = 0; row < rowCount; ++row) {
+        int y = row % height;
+        int z = row / height;
+        for (int x = 0; x < width; ++x) {
+            int i = row * width + x;
+            for (int c = 0; c < dest.NumComponents; ++c) {
+                float* out = dest.Plane(c) + i;
+                if (solid[i] > 0) {
+                    *out = 0;
+                    continue;
+                }
+                float px = x + 0.5f - TimeStep * vx[i];
+                float py = y + 0.5f - TimeStep * vy[i];
+                float pz = z + 0.5f - TimeStep * vz[i];
+                PlaneFetch fetch = { source.Plane(c), width, height };
+                *out = dissipation * SampleLinear(fetch, width, height, depth, px, py, pz);
+            }
+        }
+    }
+}
+
+void Jacobi(const GridPod& pressure, const GridPod& divergence, const GridPod& obstacles, GridPod& dest)
+{
+    JacobiOp op = { pressure.Plane(0), divergence.Plane(0), obstacles.Plane(0), dest.Plane(0) };
+    ForEachCell(dest.Width, dest.Height, dest.Depth, op);
+}
+
+void SubtractGradient(const GridPod& velocity, const GridPod& pressure, const GridPod& obstacles, GridPod& dest)
+{
+    GradientOp op;
+    for (int c = 0; c < 3; ++c) {
+        op.Velocity[c] = velocity.Plane(c);
+        op.Obstacle[c] = obstacles.Plane(c);
+        op.Dest[c] = dest.Plane(c);
+    }
+    op.Pressure = pressure.Plane(0);
+    ForEachCell(dest.Width, dest.Height, dest.Depth, op);
+}
+
+void ComputeDivergence(const GridPod& velocity, const GridPod& obstacles, GridPod& dest)
+{
+    DivergenceOp op;
+    for (int c = 0; c < 3; ++c) {
+        op.Velocity[c] = velocity.Plane(c);
+        op.Obstacle[c] = obstacles.Plane(c);
+    }
+    op.Dest = dest.Plane(0);
+    ForEachCell(dest.Width, dest.Height, dest.Depth, op);
+}
+
+// Alpha-blends the splat over dest, like the GPU version does with GL_BLEND.  Only cells
+// within the splat radius change, so only its bounding box is visited.
+void ApplyImpulse(GridPod& dest, Vector3 position, float value)
+{
+    float px = position.getX(), py = position.getY(), pz = position.getZ();
+    int x0 = std::max(0, (int) std::floor(px - SplatRadius)), x1 = std::min(dest.Width - 1, (int) std::ceil(px + SplatRadius));
+    int y0 = std::max(0, (int) std::floor(py - SplatRadius)), y1 = std::min(dest.Height - 1, (int) std::ceil(py + SplatRadius));
+    int z0 = std::max(0, (int) std::floor(pz - SplatRadius)), z1 = std::min(dest.Depth - 1, (int) std::ceil(pz + SplatRadius));
+
+    #pragma omp parallel for
+    for (int z = z0; z <= z1; ++z) {
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                float dx = x + 0.5f - px, dy = y + 0.5f - py, dz = z + 0.5f - pz;
+                float d = std::sqrt(dx * dx + dy * dy + dz * dz);
+                if (d >= SplatRadius)
+                    continue;
+                float a = std::min((SplatRadius - d) * 0.5f, 1.0f);
+                int i = (z * dest.Height + y) * dest.Width + x;
+                for (int c = 0; c < dest.NumComponents; ++c) {
+                    float* p = dest.Plane(c) + i;
+                    *p = a * value + (1 - a) * *p;
+                }
+            }
+        }
+    }
+}
+
+void ApplyBuoyancy(const GridPod& velocity, const GridPod& temperature, const GridPod& density, GridPod& dest)
+{
+    BuoyancyOp op;
+    for (int c = 0; c < 3; ++c) {
+        op.Velocity[c] = velocity.Plane(c);
+        op.Dest[c] = dest.Plane(c);
+    }
+    op.Temperature = temperature.Plane(0);
+    op.Density = density.Plane(0);
+    ForEachCell(dest.Width, dest.Height, dest.Depth, op);
+}
+
+static const int SmoothingSweeps = 2;
+static const int CoarsestSweeps = 32;
+
+static MultigridLevelPod CreateLevel(int width, int height, int depth, float cellSize)
+{
+    size_t count = (size_t) width * height * depth;
+    MultigridLevelPod level;
+    level.Width = width;
+    level.Height = height;
+    level.Depth = depth;
+    level.CellSize = cellSize;
+    level.Fluid.assign(count, 0);
+    level.Pressure.assign(count, 0.0f);
+    level.Rhs.assign(count, 0.0f);
+    level.Residual.assign(count, 0.0f);
+    return level;
+}
+
+static MultigridLevelPod CreateFinestLevel(const GridPod& obstacles)
+{
+    MultigridLevelPod level = CreateLevel(obstacles.Width, obstacles.Height, obstacles.Depth, CellSize);
+    const float* solid = obstacles.Plane(0);
+    for (size_t i = 0; i < level.Fluid.size(); ++i)
+        level.Fluid[i] = solid[i] > 0 ? 0 : 1;
+    return level;
+}
+
+static MultigridLevelPod CreateCoarseLevel(const MultigridLevelPod& fine)
+{
+    MultigridLevelPod level = CreateLevel((fine.Width + 1) / 2, (fine.Height + 1) / 2, (fine.Depth + 1) / 2,
+        fine.CellSize * 2);
+    for (int z = 0; z < fine.Depth; ++z)
+        for (int y = 0; y < fine.Height; ++y)
+            for (int x = 0; x < fine.Width; ++x)
+                if (fine.Fluid[(z * fine.Height + y) * fine.Width + x])
+                    level.Fluid[((z / 2) * level.Height + y / 2) * level.Width + x / 2] = 1;
+    return level;
+}
+
+// Sum of the fluid neighbors of cell i, and their count in k.  Cells past the edge of the
+// grid count as solid, which is what clamp-to-edge amounts to in Jacobi.
+static inline float SumNeighbors(const MultigridLevelPod& level, const float* p, int x, int y, int z, int i, int* k)
+{
+    const unsigned char* fluid = &level.Fluid[0];
+    int width = level.Width;
+    int slice = level.Width * level.Height;
+    float sum = 0;
+    int count = 0;
+    if (x > 0 && fluid[i - 1]) { sum += p[i - 1]; ++count; }
+    if (x < width - 1 && fluid[i + 1]) { sum += p[i + 1]; ++count; }
+    if (y > 0 && fluid[i - width]) { sum += p[i - width]; ++count; }
+    if (y < level.Height - 1 && fluid[i + width]) { sum += p[i + width]; ++count; }
+    if (z > 0 && fluid[i - slice]) { sum += p[i - slice]; ++count; }
+    if (z < level.Depth - 1 && fluid[i + slice]) { sum += p[i + slice]; ++count; }
+    *k = count;
+    return sum;
+}
+
+// Updates the fluid cells where x + y + z has the given parity.  Cells of one color only
+// read cells of the other, so rows can go to any thread in any order.
+static void Relax(MultigridLevelPod& level, int color)
+{
+    float* p = &level.Pressure[0];
+    const float* rhs = &level.Rhs[0];
+    float h2 = level.CellSize * level.CellSize;
+    int rowCount = level.Height * level.Depth;
+
+    #pragma omp parallel for
+    for (int row = 0; row < rowCount; ++row) {
+        int y = row % level.Height;
+        int z = row / level.Height;
+        for (int x = (y + z + color) & 1; x < level.Width; x += 2) {
+            int i = row * level.Width + x;
+            if (!level.Fluid[i])
+                continue;
+            int k;
+            float sum = SumNeighbors(level, p, x, y, z, i, &k);
+            p[i] = k ? (sum - h2 * rhs[i]) / k : 0;
+        }
+    }
+}
+
+static void ComputeLevelResidual(MultigridLevelPod& level)
+{
+    const float* p = &level.Pressure[0];
+    float inverseH2 = 1.0f / (level.CellSize * level.CellSize);
+    int rowCount = level.Height * level.Depth;
+
+    #pragma omp parallel for
+    for (int row = 0; row < rowCount; ++row) {
+        int y = row % level.Height;
+        int z = row / level.Height;
+        for (int x = 0; x < level.Width; ++x) {
+            int i = row * level.Width + x;
+            int k;
+            float sum = level.Fluid[i] ? SumNeighbors(level, p, x, y, z, i, &k) : 0;
+            level.Residual[i] = level.Fluid[i] ? level.Rhs[i] - (sum - k * p[i]) * inverseH2 : 0;
+        }
+    }
+}
+
+// Sums and squared sums over the fluid cells.  Rows are added up in order afterwards, so
+// the result doesn't depend on the thread count.
+static void SumFluid(const MultigridLevelPod& level, const std::vector<float>& values, double* sum, double* squares, int* count)
+{
+    int rowCount = level.Height * level.Depth;
+    std::vector<double> rowSums(rowCount), rowSquares(rowCount);
+    std::vector<int> rowCounts(rowCount);
+
+    #pragma omp parallel for
+    for (int row = 0; row < rowCount; ++row) {
+        double s = 0, q = 0;
+        int n = 0;
+        for (int i = row * level.Width; i < (row + 1) * level.Width; ++i) {
+            if (level.Fluid[i]) {
+                s += values[i];
+                q += (double) values[i] * values[i];
+                ++n;
+            }
+        }
+        rowSums[row] = s;
+        rowSquares[row] = q;
+        rowCounts[row] = n;
+    }
+
+    *sum = *squares = 0;
+    *count = 0;
+    for (int row = 0; row < rowCount; ++row) {
+        *sum += rowSums[row];
+        *squares += rowSquares[row];
+        *count += rowCounts[row];
+    }
+}
+
+// Subtracts the mean over the fluid cells and returns the RMS of what is left.
+static float RemoveMean(const MultigridLevelPod& level, std::vector<float>& values)
+{
+    double sum, squares;
+    int count;
+    SumFluid(level, values, &sum, &squares, &count);
+    if (!count)
+        return 0;
+    double mean = sum / count;
+    for (size_t i = 0; i < values.size(); ++i)
+        if (level.Fluid[i])
+            values[i] -= (float) mean;
+    return (float) std::sqrt(std::max(squares / count - mean * mean, 0.0));
+}
+
+static void Restrict(const MultigridLevelPod& fine, MultigridLevelPod& coarse)
+{
+    int rowCount = coarse.Height * coarse.Depth;
+
+    #pragma omp parallel for
+    for (int row = 0; row < rowCount; ++row) {
+        int y = row % coarse.Height;
+        int z = row / coarse.Height;
+        for (int x = 0; x < coarse.Width; ++x) {
+            int i = row * coarse.Width + x;
+            float sum = 0;
+            for (int fz = 2 * z; fz < std::min(2 * z + 2, fine.Depth); ++fz)
+                for (int fy = 2 * y; fy < std::min(2 * y + 2, fine.Height); ++fy)
+                    for (int fx = 2 * x; fx < std::min(2 * x + 2, fine.Width); ++fx)
+                        sum += fine.Residual[(fz * fine.Height + fy) * fine.Width + fx];
+            coarse.Rhs[i] = coarse.Fluid[i] ? sum * 0.125f : 0;
+            coarse.Pressure[i] = 0;
+        }
+    }
+}
+
+static void Prolongate(const MultigridLevelPod& coarse, MultigridLevelPod& fine)
+{
+    int rowCount = fine.Height * fine.Depth;
+
+    #pragma omp parallel for
+    for (int row = 0; row < rowCount; ++row) {
+        int y = row % fine.Height;
+        int z = row / fine.Height;
+        const float* source = &coarse.Pressure[((z / 2) * coarse.Height + y / 2) * coarse.Width];
+        for (int x = 0; x < fine.Width; ++x) {
+            int i = row * fine.Width + x;
+            if (fine.Fluid[i])
+                fine.Pressure[i] += source[x / 2];
+        }
+    }
+}
+
+static void VCycle(MultigridPod* solver, size_t levelIndex)
+{
+    MultigridLevelPod& level = solver->Levels[levelIndex];
+
+    // The coarsest grid is small enough to relax to convergence.  Rounding in the restricted
+    // residuals can leave it a constant part that has no solution, so take that out first:
+    if (levelIndex + 1 == solver->Levels.size()) {
+        RemoveMean(level, level.Rhs);
+        for (int i = 0; i < CoarsestSweeps; ++i) {
+            Relax(level, 0);
+            Relax(level, 1);
+        }
+        return;
+    }
+
+    MultigridLevelPod& coarse = solver->Levels[levelIndex + 1];
+    for (int i = 0; i < SmoothingSweeps; ++i) {
+        Relax(level, 0);
+        Relax(level, 1);
+    }
+    ComputeLevelResidual(level);
+    Restrict(level, coarse);
+    VCycle(solver, levelIndex + 1);
+    Prolongate(coarse, level);
+    for (int i = 0; i < SmoothingSweeps; ++i) {
+        Relax(level, 1);
+        Relax(level, 0);
+    }
+}
+
+// Coarsens until the next level would have fewer than four cells along some axis.
+MultigridPod CreateMultigrid(const GridPod& obstacles)
+{
+    MultigridPod solver;
+    solver.Levels.push_back(CreateFinestLevel(obstacles));
+    for (;;) {
+        const MultigridLevelPod& last = solver.Levels.back();
+        if (std::min(std::min(last.Width, last.Height), last.Depth) < 8)
+            break;
+        solver.Levels.push_back(CreateCoarseLevel(last));
+    }
+    return solver;
+}
+
+int SolvePressure(MultigridPod* solver, const GridPod& divergence, GridPod& pressure,
+    float tolerance, int maxCycles, float* residual)
+{
+    MultigridLevelPod& fine = solver->Levels[0];
+    const float* b = divergence.Plane(0);
+    float* p = pressure.Plane(0);
+    for (size_t i = 0; i < fine.Fluid.size(); ++i) {
+        fine.Rhs[i] = fine.Fluid[i] ? b[i] : 0;
+        fine.Pressure[i] = fine.Fluid[i] ? p[i] : 0;
+    }
+
+    float norm = RemoveMean(fine, fine.Rhs);
+    ComputeLevelResidual(fine);
+    float relative = norm > 0 ? RemoveMean(fine, fine.Residual) / norm : 0;
+
+    int cycles = 0;
+    while (cycles < maxCycles && relative > tolerance) {
+        VCycle(solver, 0);
+        ComputeLevelResidual(fine);
+        relative = RemoveMean(fine, fine.Residual) / norm;
+        ++cycles;
+    }
+
+    std::copy(fine.Pressure.begin(), fine.Pressure.end(), p);
+    if (residual)
+        *residual = relative;
+    return cycles;
+}
+
+float ComputeResidual(const GridPod& pressure, const GridPod& divergence, const GridPod& obstacles)
+{
+    MultigridLevelPod level = CreateFinestLevel(obstacles);
+    std::copy(divergence.Plane(0), divergence.Plane(0) + level.Rhs.size(), level.Rhs.begin());
+    std::copy(pressure.Plane(0), pressure.Plane(0) + level.Pressure.size(), level.Pressure.begin());
+    float norm = RemoveMean(level, level.Rhs);
+    ComputeLevelResidual(level);
+    float residual = RemoveMean(level, level.Residual);
+    return norm > 0 ? residual / norm : 0;
+}
+
+static unsigned short FloatToHalf(float f)
+{
+    unsigned int u;
+    memcpy(&u, &f, sizeof(u));
+    unsigned int sign = (u >> 16) & 0x8000;
+    int exponent = (int) ((u >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = u & 0x7fffff;
+
+    if (((u >> 23) & 0xff) == 0xff)
+        return (unsigned short) (sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return (unsigned short) (sign | 0x7c00);
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return (unsigned short) sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+            ++half;
+        return (unsigned short) (sign | half);
+    }
+
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return (unsigned short) half;
+}
+
+bool WriteToFile(const char* filename, const GridPod& density)
+{
+    size_t count = (size_t) density.Width * density.Height * density.Depth;
+    std::vector<unsigned short> cache(count);
+    const float* plane = density.Plane(0);
+    for (size_t i = 0; i < count; ++i)
+        cache[i] = FloatToHalf(plane[i]);
+
+    FILE* voxelsFile = fopen(filename, "wb");
+    if (!voxelsFile)
+        return false;
+    size_t written = fwrite(&cache[0], sizeof(unsigned short), count, voxelsFile);
+    return fclose(voxelsFile) == 0 && written == count;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <vmath.hpp>
+#include "Constants.h"
+
+// CPU counterparts of the slab operators in Utility.cpp, for headless runs and regression
+// tests.  They follow Fluid.glsl texel for texel, including its clamp-to-edge sampling and
+// its obstacle swizzles, but keep 32-bit floats where the textures keep halves.
+//
+// Grids store one plane per component, x fastest, so the stencils can work on whole rows:
+// rows are spread across threads and the interior of each row runs four cells at a time.
+
+struct GridPod {
+    int Width;
+    int Height;
+    int Depth;
+    int NumComponents;
+    std::vector<float> Data;
+
+    float* Plane(int component) { return &Data[component * Width * Height * Depth]; }
+    const float* Plane(int component) const { return &Data[component * Width * Height * Depth]; }
+};
+
+struct GridSlabPod {
+    GridPod Ping;
+    GridPod Pong;
+};
+
+GridPod CreateGrid(int width, int height, int depth, int numComponents);
+GridSlabPod CreateGridSlab(int width, int height, int depth, int numComponents);
+void CreateObstacles(GridPod& dest);
+void SwapSurfaces(GridSlabPod* slab);
+void ClearSurface(GridPod& s, float v);
+void Advect(const GridPod& velocity, const GridPod& source, const GridPod& obstacles, GridPod& dest, float dissipation);
+void Jacobi(const GridPod& pressure, const GridPod& divergence, const GridPod& obstacles, GridPod& dest);
+void SubtractGradient(const GridPod& velocity, const GridPod& pressure, const GridPod& obstacles, GridPod& dest);
+void ComputeDivergence(const GridPod& velocity, const GridPod& obstacles, GridPod& dest);
+void ApplyImpulse(GridPod& dest, vmath::Vector3 position, float value);
+void ApplyBuoyancy(const GridPod& velocity, const GridPod& temperature, const GridPod& density, GridPod& dest);
+
+// Geometric multigrid for the equation that Jacobi relaxes: the Laplacian of the pressure
+// equals the divergence in every fluid cell, with no flow through solid neighbors.  Each
+// level halves the grid; a coarse cell is fluid if any of its eight children is.  V-cycles
+// use red-black Gauss-Seidel to smooth, averaging to restrict, and injection to prolongate.
+struct MultigridLevelPod {
+    int Width;
+    int Height;
+    int Depth;
+    float CellSize;
+    std::vector<unsigned char> Fluid;
+    std::vector<float> Pressure;
+    std::vector<float> Rhs;
+    std::vector<float> Residual;
+};
+
+struct MultigridPod {
+    std::vector<MultigridLevelPod> Levels;
+};
+
+MultigridPod CreateMultigrid(const GridPod& obstacles);
+
+// Runs V-cycles from the given pressure until the residual drops below tolerance times the
+// divergence, or maxCycles have run.  Returns the number of cycles; if given, residual
+// receives the last relative residual.  Solid cells come back with zero pressure.
+int SolvePressure(MultigridPod* solver, const GridPod& divergence, GridPod& pressure,
+    float tolerance, int maxCycles, float* residual = 0);
+
+// RMS residual of the pressure equation over fluid cells, relative to the RMS divergence.
+// Walls all around make the equation singular, so the constant part of the divergence, which
+// no pressure can cancel and which doesn't change the gradient, is left out of both.
+float ComputeResidual(const GridPod& pressure, const GridPod& divergence, const GridPod& obstacles);
+
+// Writes the first component as raw half floats, in the same layout that WriteToFile in p69
+// reads back from a density texture, so CPU and GPU runs can be diffed directly.
+bool WriteToFile(const char* filename, const GridPod& density);
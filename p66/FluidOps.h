@@ -0,0 +1,206 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include "Constants.h"
+
+// Cell kernels shared by the dense operators in FluidCpu.cpp and the brick operators in
+// FluidSparse.cpp.  Each kernel reads and writes planes through the indices in a Stencil,
+// so it doesn't care whether the planes span the whole grid or one padded brick.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLUID_CPU_SSE2
+#endif
+
+// Lane types for the row kernels.  Select picks its first argument wherever the flag is
+// positive, which is how the shaders test "o.x > 0".
+struct Scalar {
+    typedef float Value;
+    enum { Count = 1 };
+    static Value Load(const float* p) { return *p; }
+    static void Store(float* p, Value v) { *p = v; }
+    static Value Set(float f) { return f; }
+    static Value Add(Value a, Value b) { return a + b; }
+    static Value Sub(Value a, Value b) { return a - b; }
+    static Value Mul(Value a, Value b) { return a * b; }
+    static Value Max(Value a, Value b) { return std::max(a, b); }
+    static Value Select(Value flag, Value a, Value b) { return flag > 0 ? a : b; }
+};
+
+#ifdef FLUID_CPU_SSE2
+struct Sse2 {
+    typedef __m128 Value;
+    enum { Count = 4 };
+    static Value Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, Value v) { _mm_storeu_ps(p, v); }
+    static Value Set(float f) { return _mm_set1_ps(f); }
+    static Value Add(Value a, Value b) { return _mm_add_ps(a, b); }
+    static Value Sub(Value a, Value b) { return _mm_sub_ps(a, b); }
+    static Value Mul(Value a, Value b) { return _mm_mul_ps(a, b); }
+    static Value Max(Value a, Value b) { return _mm_max_ps(a, b); }
+    static Value Select(Value flag, Value a, Value b)
+    {
+        __m128 mask = _mm_cmpgt_ps(flag, _mm_setzero_ps());
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+};
+typedef Sse2 Vector;
+#else
+typedef Scalar Vector;
+#endif
+
+// Index of a cell and of its six neighbors, clamped to the grid at the borders.
+struct Stencil {
+    int C, W, E, S, N, D, U;
+};
+
+struct JacobiOp {
+    const float* Pressure;
+    const float* Divergence;
+    const float* Solid;
+    float* Dest;
+
+    // Solid neighbors take the center pressure, for a zero gradient across the wall:
+    template<class L> void Apply(const Stencil& s) const
+    {
+        typename L::Value pC = L::Load(Pressure + s.C);
+        typename L::Value pN = L::Select(L::Load(Solid + s.N), pC, L::Load(Pressure + s.N));
+        typename L::Value pS = L::Select(L::Load(Solid + s.S), pC, L::Load(Pressure + s.S));
+        typename L::Value pE = L::Select(L::Load(Solid + s.E), pC, L::Load(Pressure + s.E));
+        typename L::Value pW = L::Select(L::Load(Solid + s.W), pC, L::Load(Pressure + s.W));
+        typename L::Value pU = L::Select(L::Load(Solid + s.U), pC, L::Load(Pressure + s.U));
+        typename L::Value pD = L::Select(L::Load(Solid + s.D), pC, L::Load(Pressure + s.D));
+        typename L::Value bC = L::Load(Divergence + s.C);
+        typename L::Value sum = L::Add(L::Add(L::Add(L::Add(L::Add(L::Add(pW, pE), pS), pN), pU), pD),
+            L::Mul(L::Set(-CellSize * CellSize), bC));
+        L::Store(Dest + s.C, L::Mul(sum, L::Set(0.1666f)));
+    }
+};
+
+// Obstacle velocities come from the obstacle texel's yzx swizzle, as in Fluid.glsl.
+struct DivergenceOp {
+    const float* Velocity[3];
+    const float* Obstacle[3];
+    float* Dest;
+
+    template<class L> void Apply(const Stencil& s) const
+    {
+        typename L::Value vE = L::Select(L::Load(Obstacle[0] + s.E), L::Load(Obstacle[1] + s.E), L::Load(Velocity[0] + s.E));
+        typename L::Value vW = L::Select(L::Load(Obstacle[0] + s.W), L::Load(Obstacle[1] + s.W), L::Load(Velocity[0] + s.W));
+        typename L::Value vN = L::Select(L::Load(Obstacle[0] + s.N), L::Load(Obstacle[2] + s.N), L::Load(Velocity[1] + s.N));
+        typename L::Value vS = L::Select(L::Load(Obstacle[0] + s.S), L::Load(Obstacle[2] + s.S), L::Load(Velocity[1] + s.S));
+        typename L::Value vU = L::Select(L::Load(Obstacle[0] + s.U), L::Load(Obstacle[0] + s.U), L::Load(Velocity[2] + s.U));
+        typename L::Value vD = L::Select(L::Load(Obstacle[0] + s.D), L::Load(Obstacle[0] + s.D), L::Load(Velocity[2] + s.D));
+        typename L::Value sum = L::Sub(L::Add(L::Sub(L::Add(L::Sub(vE, vW), vN), vS), vU), vD);
+        L::Store(Dest + s.C, L::Mul(L::Set(0.5f / CellSize), sum));
+    }
+};
+
+struct GradientOp {
+    const float* Velocity[3];
+    const float* Pressure;
+    const float* Obstacle[3];
+    float* Dest[3];
+
+    // Along each axis, a solid neighbor replaces the projected velocity with its own; when
+    // both neighbors are solid, the second one tested in the shader wins.
+    template<class L> void Apply(const Stencil& s) const
+    {
+        const float* solid = Obstacle[0];
+        typename L::Value zero = L::Set(0);
+        typename L::Value scale = L::Set(GradientScale);
+        typename L::Value oN = L::Load(solid + s.N), oS = L::Load(solid + s.S);
+        typename L::Value oE = L::Load(solid + s.E), oW = L::Load(solid + s.W);
+        typename L::Value oU = L::Load(solid + s.U), oD = L::Load(solid + s.D);
+
+        typename L::Value pC = L::Load(Pressure + s.C);
+        typename L::Value pN = L::Select(oN, pC, L::Load(Pressure + s.N));
+        typename L::Value pS = L::Select(oS, pC, L::Load(Pressure + s.S));
+        typename L::Value pE = L::Select(oE, pC, L::Load(Pressure + s.E));
+        typename L::Value pW = L::Select(oW, pC, L::Load(Pressure + s.W));
+        typename L::Value pU = L::Select(oU, pC, L::Load(Pressure + s.U));
+        typename L::Value pD = L::Select(oD, pC, L::Load(Pressure + s.D));
+
+        typename L::Value vX = L::Sub(L::Load(Velocity[0] + s.C), L::Mul(L::Sub(pE, pW), scale));
+        typename L::Value vY = L::Sub(L::Load(Velocity[1] + s.C), L::Mul(L::Sub(pN, pS), scale));
+        typename L::Value vZ = L::Sub(L::Load(Velocity[2] + s.C), L::Mul(L::Sub(pU, pD), scale));
+
+        typename L::Value wallX = L::Select(oW, L::Load(Obstacle[1] + s.W), L::Select(oE, L::Load(Obstacle[1] + s.E), zero));
+        typename L::Value wallY = L::Select(oS, L::Load(Obstacle[2] + s.S), L::Select(oN, L::Load(Obstacle[2] + s.N), zero));
+        typename L::Value wallZ = L::Select(oD, L::Load(Obstacle[0] + s.D), L::Select(oU, L::Load(Obstacle[0] + s.U), zero));
+        vX = L::Select(L::Max(oE, oW), wallX, vX);
+        vY = L::Select(L::Max(oN, oS), wallY, vY);
+        vZ = L::Select(L::Max(oU, oD), wallZ, vZ);
+
+        // Solid cells just take the obstacle's own velocity:
+        typename L::Value oC = L::Load(solid + s.C);
+        L::Store(Dest[0] + s.C, L::Select(oC, L::Load(Obstacle[1] + s.C), vX));
+        L::Store(Dest[1] + s.C, L::Select(oC, L::Load(Obstacle[2] + s.C), vY));
+        L::Store(Dest[2] + s.C, L::Select(oC, L::Load(Obstacle[0] + s.C), vZ));
+    }
+};
+
+struct BuoyancyOp {
+    const float* Velocity[3];
+    const float* Temperature;
+    const float* Density;
+    float* Dest[3];
+
+    // Hot cells rise toward -y, the same direction the splat sits from the center:
+    template<class L> void Apply(const Stencil& s) const
+    {
+        typename L::Value heat = L::Sub(L::Load(Temperature + s.C), L::Set(AmbientTemperature));
+        typename L::Value force = L::Sub(L::Mul(L::Mul(L::Set(TimeStep), heat), L::Set(SmokeBuoyancy)),
+            L::Mul(L::Load(Density + s.C), L::Set(SmokeWeight)));
+        typename L::Value vY = L::Load(Velocity[1] + s.C);
+        L::Store(Dest[0] + s.C, L::Load(Velocity[0] + s.C));
+        L::Store(Dest[1] + s.C, L::Select(heat, L::Sub(vY, force), vY));
+        L::Store(Dest[2] + s.C, L::Load(Velocity[2] + s.C));
+    }
+};
+
+// Linear filtering with clamp-to-edge, in texel units where texel centers sit at +0.5.  Fetch
+// gathers the eight texels at the corners of the given ranges, x fastest.
+template<class Fetch>
+inline float SampleLinear(const Fetch& fetch, int width, int height, int depth, float x, float y, float z)
+{
+    x -= 0.5f; y -= 0.5f; z -= 0.5f;
+    float fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+    float u = x - fx, v = y - fy, w = z - fz;
+    int x0 = (int) fx, y0 = (int) fy, z0 = (int) fz;
+    int x1 = std::min(std::max(x0 + 1, 0), width - 1);
+    int y1 = std::min(std::max(y0 + 1, 0), height - 1);
+    int z1 = std::min(std::max(z0 + 1, 0), depth - 1);
+    x0 = std::min(std::max(x0, 0), width - 1);
+    y0 = std::min(std::max(y0, 0), height - 1);
+    z0 = std::min(std::max(z0, 0), depth - 1);
+
+    float T[8];
+    fetch.Gather(x0, x1, y0, y1, z0, z1, T);
+    float c00 = (1 - u) * T[0] + u * T[1];
+    float c10 = (1 - u) * T[2] + u * T[3];
+    float c01 = (1 - u) * T[4] + u * T[5];
+    float c11 = (1 - u) * T[6] + u * T[7];
+    float c0 = (1 - v) * c00 + v * c10;
+    float c1 = (1 - v) * c01 + v * c11;
+    return (1 - w) * c0 + w * c1;
+}
+
+// Texel fetches from one plane of a dense grid.
+struct PlaneFetch {
+    const float* Plane;
+    int Width;
+    int Height;
+
+    void Gather(int x0, int x1, int y0, int y1, int z0, int z1, float* T) const
+    {
+        const float* p00 = Plane + (z0 * Height + y0) * Width;
+        const float* p10 = Plane + (z0 * Height + y1) * Width;
+        const float* p01 = Plane + (z1 * Height + y0) * Width;
+        const float* p11 = Plane + (z1 * Height + y1) * Width;
+        T[0] = p00[x0]; T[1] = p00[x1];
+        T[2] = p10[x0]; T[3] = p10[x1];
+        T[4] = p01[x0]; T[5] = p01[x1];
+        T[6] = p11[x0]; T[7] = p11[x1];
+    }
+};
@@ -0,0 +1,736 @@
+#include "FluidSparse.h"
+#include "FluidOps.h"
+#include "pez.h"
+#include <cstring>
+
+using namespace vmath;
+
+// Kernels that look at neighbors run on a copy of the brick padded with the facing layers of
+// the bricks around it, so every cell of the brick goes through the vector path.
+enum {
+    BrickCells = BrickSize * BrickSize * BrickSize,
+    Padded = BrickSize + 2,
+    PaddedCells = Padded * Padded * Padded,
+};
+
+static inline int BrickOffset(int x, int y, int z)
+{
+    return (z * BrickSize + y) * BrickSize + x;
+}
+
+static inline int PaddedOffset(int x, int y, int z)
+{
+    return ((z + 1) * Padded + y + 1) * Padded + x + 1;
+}
+
+static inline const float* GetBrick(const BrickMapPod& map, const SparseGridPod& grid, int brick, int component)
+{
+    int slot = map.Slots[brick];
+    return slot < 0 ? 0 : &grid.Data[((size_t) slot * grid.NumComponents + component) * BrickCells];
+}
+
+static inline float* GetSlot(SparseGridPod& grid, int slot, int component)
+{
+    return &grid.Data[((size_t) slot * grid.NumComponents + component) * BrickCells];
+}
+
+static inline int GetBrickIndex(const BrickMapPod& map, int x, int y, int z)
+{
+    return (z * map.BricksY + y) * map.BricksX + x;
+}
+
+// Texel fetches from one component of a sparse grid.  The eight texels of a linear sample
+// usually share a brick, which is then looked up once.
+struct SparseFetch {
+    const BrickMapPod* Map;
+    const SparseGridPod* Grid;
+    int Component;
+
+    void Gather(int x0, int x1, int y0, int y1, int z0, int z1, float* T) const
+    {
+        int bx = x0 / BrickSize, by = y0 / BrickSize, bz = z0 / BrickSize;
+        if (x1 / BrickSize == bx && y1 / BrickSize == by && z1 / BrickSize == bz) {
+            const float* data = GetBrick(*Map, *Grid, GetBrickIndex(*Map, bx, by, bz), Component);
+            if (!data) {
+                std::fill(T, T + 8, Grid->Background);
+                return;
+            }
+            const float* p = data + BrickOffset(x0 % BrickSize, y0 % BrickSize, z0 % BrickSize);
+            int dx = x1 - x0, dy = (y1 - y0) * BrickSize, dz = (z1 - z0) * BrickSize * BrickSize;
+            T[0] = p[0]; T[1] = p[dx];
+            T[2] = p[dy]; T[3] = p[dy + dx];
+            T[4] = p[dz]; T[5] = p[dz + dx];
+            T[6] = p[dz + dy]; T[7] = p[dz + dy + dx];
+            return;
+        }
+
+        // The texels straddle bricks; look each one up:
+        int bricks[3][2] = { { bx, x1 / BrickSize }, { by, y1 / BrickSize }, { bz, z1 / BrickSize } };
+        int cells[3][2] = { { x0 % BrickSize, x1 % BrickSize }, { y0 % BrickSize, y1 % BrickSize }, { z0 % BrickSize, z1 % BrickSize } };
+        for (int corner = 0; corner < 8; ++corner) {
+            int i = corner & 1, j = (corner >> 1) & 1, k = corner >> 2;
+            const float* data = GetBrick(*Map, *Grid, GetBrickIndex(*Map, bricks[0][i], bricks[1][j], bricks[2][k]), Component);
+            T[corner] = data ? data[BrickOffset(cells[0][i], cells[1][j], cells[2][k])] : Grid->Background;
+        }
+    }
+};
+
+static inline float SampleSparse(const BrickMapPod& map, const SparseGridPod& grid, int component, float x, float y, float z)
+{
+    SparseFetch fetch = { &map, &grid, component };
+    return SampleLinear(fetch, map.Width, map.Height, map.Depth, x, y, z);
+}
+
+// Copies one component of a brick into the middle of a padded block.
+static void GatherCenter(const BrickMapPod& map, const SparseGridPod& grid, int component, int brick, float* block)
+{
+    const float* own = GetBrick(map, grid, brick, component);
+    for (int z = 0; z < BrickSize; ++z) {
+        for (int y = 0; y < BrickSize; ++y) {
+            float* dest = block + PaddedOffset(0, y, z);
+            if (own)
+                memcpy(dest, own + BrickOffset(0, y, z), BrickSize * sizeof(float));
+            else
+                std::fill(dest, dest + BrickSize, grid.Background);
+        }
+    }
+}
+
+// Like GatherCenter, then adds the facing layers of the six neighbors.  Past the edge of the
+// grid the brick's own outer layer is repeated, which is what clamp-to-edge does for the dense
+// grids.  The edges and corners of the block aren't read by seven-point kernels.
+static void GatherBrick(const BrickMapPod& map, const SparseGridPod& grid, int component, int brick, float* block)
+{
+    GatherCenter(map, grid, component, brick, block);
+
+    int coord[3] = { brick % map.BricksX, (brick / map.BricksX) % map.BricksY, brick / (map.BricksX * map.BricksY) };
+    int count[3] = { map.BricksX, map.BricksY, map.BricksZ };
+    const float* own = GetBrick(map, grid, brick, component);
+
+    for (int face = 0; face < 6; ++face) {
+        int axis = face / 2;
+        int step = face % 2 ? 1 : -1;
+        int neighbor[3] = { coord[0], coord[1], coord[2] };
+        neighbor[axis] += step;
+
+        const float* source = own;
+        int from = step < 0 ? 0 : BrickSize - 1;
+        if (neighbor[axis] >= 0 && neighbor[axis] < count[axis]) {
+            source = GetBrick(map, grid, GetBrickIndex(map, neighbor[0], neighbor[1], neighbor[2]), component);
+            from = BrickSize - 1 - from;
+        }
+        int to = step < 0 ? -1 : BrickSize;
+
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        for (int j = 0; j < BrickSize; ++j) {
+            for (int i = 0; i < BrickSize; ++i) {
+                int s[3], d[3];
+                s[axis] = from;
+                d[axis] = to;
+                s[u] = d[u] = i;
+                s[v] = d[v] = j;
+                block[PaddedOffset(d[0], d[1], d[2])] = source ? source[BrickOffset(s[0], s[1], s[2])] : grid.Background;
+            }
+        }
+    }
+}
+
+static void ScatterBrick(const float* block, float* dest)
+{
+    for (int z = 0; z < BrickSize; ++z)
+        for (int y = 0; y < BrickSize; ++y)
+            memcpy(dest + BrickOffset(0, y, z), block + PaddedOffset(0, y, z), BrickSize * sizeof(float));
+}
+
+// Runs op over the middle of a padded block.
+template<class Op>
+static void ForEachPaddedCell(const Op& op)
+{
+    for (int z = 0; z < BrickSize; ++z) {
+        for (int y = 0; y < BrickSize; ++y) {
+            int row = PaddedOffset(0, y, z);
+            for (int x = 0; x < BrickSize; x += Vector::Count) {
+                Stencil cell;
+                cell.C = row + x;
+                cell.W = cell.C - 1;
+                cell.E = cell.C + 1;
+                cell.S = cell.C - Padded;
+                cell.N = cell.C + Padded;
+                cell.D = cell.C - Padded * Padded;
+                cell.U = cell.C + Padded * Padded;
+                op.template Apply<Vector>(cell);
+            }
+        }
+    }
+}
+
+// Runs a kernel that only reads the center cell straight over the bricks.
+template<class Op>
+static void ForEachBrickCell(const Op& op)
+{
+    for (int i = 0; i < BrickCells; i += Vector::Count) {
+        Stencil cell = { i, i, i, i, i, i, i };
+        op.template Apply<Vector>(cell);
+    }
+}
+
+// Flags each brick that is flagged in source or has a flagged neighbor, edges and corners
+// included.
+static void Dilate(const BrickMapPod& map, const std::vector<unsigned char>& source, std::vector<unsigned char>* dest)
+{
+    dest->assign(source.size(), 0);
+    for (int z = 0; z < map.BricksZ; ++z) {
+        for (int y = 0; y < map.BricksY; ++y) {
+            for (int x = 0; x < map.BricksX; ++x) {
+                if (!source[GetBrickIndex(map, x, y, z)])
+                    continue;
+                for (int k = std::max(z - 1, 0); k <= std::min(z + 1, map.BricksZ - 1); ++k)
+                    for (int j = std::max(y - 1, 0); j <= std::min(y + 1, map.BricksY - 1); ++j)
+                        for (int i = std::max(x - 1, 0); i <= std::min(x + 1, map.BricksX - 1); ++i)
+                            (*dest)[GetBrickIndex(map, i, j, k)] = 1;
+            }
+        }
+    }
+}
+
+// Replaces the active set with the flagged bricks and moves the grids over.
+static void SetActive(BrickMapPod* map, const std::vector<unsigned char>& active, SparseGridPod* const* grids, int gridCount)
+{
+    std::vector<int> slots(active.size(), -1);
+    std::vector<int> bricks;
+    for (size_t brick = 0; brick < active.size(); ++brick) {
+        if (active[brick]) {
+            slots[brick] = (int) bricks.size();
+            bricks.push_back((int) brick);
+        }
+    }
+
+    int slotCount = (int) bricks.size();
+    for (int g = 0; g < gridCount; ++g) {
+        SparseGridPod* grid = grids[g];
+        size_t blockSize = (size_t) grid->NumComponents * BrickCells;
+        std::vector<float> data(slotCount * blockSize);
+
+        #pragma omp parallel for
+        for (int slot = 0; slot < slotCount; ++slot) {
+            int previous = map->Slots[bricks[slot]];
+            float* dest = &data[slot * blockSize];
+            if (previous < 0)
+                std::fill(dest, dest + blockSize, grid->Background);
+            else
+                memcpy(dest, &grid->Data[previous * blockSize], blockSize * sizeof(float));
+        }
+        grid->Data.swap(data);
+    }
+
+    map->Slots.swap(slots);
+    map->Active.swap(bricks);
+}
+
+BrickMapPod CreateBrickMap(int width, int height, int depth)
+{
+    PezCheckCondition(width % BrickSize == 0 && height % BrickSize == 0 && depth % BrickSize == 0,
+        "Sparse grids need sides that are multiples of %d, not %dx%dx%d.", BrickSize, width, height, depth);
+
+    BrickMapPod map;
+    map.Width = width;
+    map.Height = height;
+    map.Depth = depth;
+    map.BricksX = width / BrickSize;
+    map.BricksY = height / BrickSize;
+    map.BricksZ = depth / BrickSize;
+    map.Slots.assign(map.BricksX * map.BricksY * map.BricksZ, -1);
+    return map;
+}
+
+SparseGridPod CreateSparseGrid(const BrickMapPod& map, int numComponents, float background)
+{
+    SparseGridPod grid;
+    grid.NumComponents = numComponents;
+    grid.Background = background;
+    grid.Data.assign(map.Active.size() * numComponents * BrickCells, background);
+    return grid;
+}
+
+SparseGridSlabPod CreateSparseGridSlab(const BrickMapPod& map, int numComponents, float background)
+{
+    SparseGridSlabPod slab;
+    slab.Ping = CreateSparseGrid(map, numComponents, background);
+    slab.Pong = CreateSparseGrid(map, numComponents, background);
+    return slab;
+}
+
+SparseObstaclesPod CreateSparseObstacles(const GridPod& obstacles)
+{
+    SparseObstaclesPod sparse;
+    sparse.Map = CreateBrickMap(obstacles.Width, obstacles.Height, obstacles.Depth);
+    sparse.Solid = CreateSparseGrid(sparse.Map, 1, 0);
+
+    const float* solid = obstacles.Plane(0);
+    std::vector<unsigned char> active(sparse.Map.Slots.size(), 0);
+    for (int z = 0; z < obstacles.Depth; ++z)
+        for (int y = 0; y < obstacles.Height; ++y)
+            for (int x = 0; x < obstacles.Width; ++x)
+                if (solid[(z * obstacles.Height + y) * obstacles.Width + x] > 0)
+                    active[GetBrickIndex(sparse.Map, x / BrickSize, y / BrickSize, z / BrickSize)] = 1;
+
+    SparseGridPod* grids[] = { &sparse.Solid };
+    SetActive(&sparse.Map, active, grids, 1);
+
+    for (size_t slot = 0; slot < sparse.Map.Active.size(); ++slot) {
+        int brick = sparse.Map.Active[slot];
+        int bx = brick % sparse.Map.BricksX;
+        int by = (brick / sparse.Map.BricksX) % sparse.Map.BricksY;
+        int bz = brick / (sparse.Map.BricksX * sparse.Map.BricksY);
+        float* dest = GetSlot(sparse.Solid, (int) slot, 0);
+        for (int z = 0; z < BrickSize; ++z)
+            for (int y = 0; y < BrickSize; ++y)
+                for (int x = 0; x < BrickSize; ++x) {
+                    int gx = bx * BrickSize + x, gy = by * BrickSize + y, gz = bz * BrickSize + z;
+                    dest[BrickOffset(x, y, z)] = solid[(gz * obstacles.Height + gy) * obstacles.Width + gx];
+                }
+    }
+    return sparse;
+}
+
+void MarkActiveBricks(const BrickMapPod& map, const SparseGridPod& grid, const SparseObstaclesPod& obstacles,
+    float threshold, std::vector<unsigned char>* flags)
+{
+    int slotCount = (int) map.Active.size();
+
+    #pragma omp parallel for schedule(dynamic, 4)
+    for (int slot = 0; slot < slotCount; ++slot) {
+        int brick = map.Active[slot];
+        const float* solid = GetBrick(obstacles.Map, obstacles.Solid, brick, 0);
+        bool found = false;
+        for (int c = 0; c < grid.NumComponents && !found; ++c) {
+            const float* data = &grid.Data[((size_t) slot * grid.NumComponents + c) * BrickCells];
+            for (int i = 0; i < BrickCells && !found; ++i)
+                found = !(solid && solid[i] > 0) && std::fabs(data[i] - grid.Background) > threshold;
+        }
+        if (found)
+            (*flags)[brick] = 1;
+    }
+}
+
+void MarkSplatBricks(const BrickMapPod& map, Vector3 position, float radius, std::vector<unsigned char>* flags)
+{
+    float p[3] = { position.getX(), position.getY(), position.getZ() };
+    int count[3] = { map.BricksX, map.BricksY, map.BricksZ };
+    int lo[3], hi[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        lo[axis] = std::max(0, (int) std::floor(p[axis] - radius) / BrickSize);
+        hi[axis] = std::min(count[axis] - 1, (int) std::ceil(p[axis] + radius) / BrickSize);
+    }
+    for (int z = lo[2]; z <= hi[2]; ++z)
+        for (int y = lo[1]; y <= hi[1]; ++y)
+            for (int x = lo[0]; x <= hi[0]; ++x)
+                (*flags)[GetBrickIndex(map, x, y, z)] = 1;
+}
+
+int ActivateBricks(BrickMapPod* map, const std::vector<unsigned char>& flags, SparseGridPod* const* grids, int gridCount)
+{
+    std::vector<unsigned char> active;
+    Dilate(*map, flags, &active);
+    SetActive(map, active, grids, gridCount);
+    return (int) map->Active.size();
+}
+
+void SwapSurfaces(SparseGridSlabPod* slab)
+{
+    slab->Ping.Data.swap(slab->Pong.Data);
+    std::swap(slab->Ping.Background, slab->Pong.Background);
+}
+
+void ClearSurface(SparseGridPod& s, float v)
+{
+    std::fill(s.Data.begin(), s.Data.end(), v);
+    s.Background = v;
+}
+
+void Advect(const BrickMapPod& map, const SparseGridPod& velocity, const SparseGridPod& source,
+    const SparseObstaclesPod& obstacles, SparseGridPod& dest, float dissipation)
+{
+    int slotCount = (int) map.Active.size();
+
+    #pragma omp parallel for schedule(dynamic, 4)
+    for (int slot = 0; slot < slotCount; ++slot) {
+        int brick = map.Active[slot];
+        int bx = brick % map.BricksX;
+        int by = (brick / map.BricksX) % map.BricksY;
+        int bz = brick / (map.BricksX * map.BricksY);
+        const float* solid = GetBrick(obstacles.Map, obstacles.Solid, brick, 0);
+        const float* vx = GetBrick(map, velocity, brick, 0);
+        const float* vy = GetBrick(map, velocity, brick, 1);
+        const float* vz = GetBrick(map, velocity, brick, 2);
+
+        for (int z = 0; z < BrickSize; ++z) {
+            for (int y = 0; y < BrickSize; ++y) {
+                for (int x = 0; x < BrickSize; ++x) {
+                    int i = BrickOffset(x, y, z);
+                    float px = bx * BrickSize + x + 0.5f - TimeStep * vx[i];
+                    float py = by * BrickSize + y + 0.5f - TimeStep * vy[i];
+                    float pz = bz * BrickSize + z + 0.5f - TimeStep * vz[i];
+                    for (int c = 0; c < dest.NumComponents; ++c) {
+                        float* out = GetSlot(dest, slot, c) + i;
+                        if (solid && solid[i] > 0) {
+                            *out = 0;
+                            continue;
+                        }
+                        *out = dissipation * SampleSparse(map, source, c, px, py, pz);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Jacobi(const BrickMapPod& map, const SparseGridPod& pressure, const SparseGridPod& divergence,
+    const SparseObstaclesPod& obstacles, SparseGridPod& dest)
+{
+    int slotCount = (int) map.Active.size();
+
+    #pragma omp parallel
+    {
+        std::vector<float> scratch(4 * PaddedCells, 0.0f);
+        float* p = &scratch[0];
+        float* b = p + PaddedCells;
+        float* solid = b + PaddedCells;
+        float* result = solid + PaddedCells;
+
+        #pragma omp for schedule(dynamic, 4)
+        for (int slot = 0; slot < slotCount; ++slot) {
+            int brick = map.Active[slot];
+            GatherBrick(map, pressure, 0, brick, p);
+            GatherCenter(map, divergence, 0, brick, b);
+            GatherBrick(obstacles.Map, obstacles.Solid, 0, brick, solid);
+            JacobiOp op = { p, b, solid, result };
+            ForEachPaddedCell(op);
+            ScatterBrick(result, GetSlot(dest, slot, 0));
+        }
+    }
+}
+
+void SubtractGradient(const BrickMapPod& map, const SparseGridPod& velocity, const SparseGridPod& pressure,
+    const SparseObstaclesPod& obstacles, SparseGridPod& dest)
+{
+    int slotCount = (int) map.Active.size();
+
+    #pragma omp parallel
+    {
+        // The obstacle velocities are all zero, so their planes share one block:
+        std::vector<float> scratch(10 * PaddedCells, 0.0f);
+        float* zero = &scratch[0];
+        float* solid = zero + PaddedCells;
+        float* p = solid + PaddedCells;
+        float* v = p + PaddedCells;
+        float* result = v + 3 * PaddedCells;
+
+        GradientOp op;
+        op.Pressure = p;
+        op.Obstacle[0] = solid;
+        op.Obstacle[1] = op.Obstacle[2] = zero;
+        for (int c = 0; c < 3; ++c) {
+            op.Velocity[c] = v + c * PaddedCells;
+            op.Dest[c] = result + c * PaddedCells;
+        }
+
+        #pragma omp for schedule(dynamic, 4)
+        for (int slot = 0; slot < slotCount; ++slot) {
+            int brick = map.Active[slot];
+            GatherBrick(map, pressure, 0, brick, p);
+            GatherBrick(obstacles.Map, obstacles.Solid, 0, brick, solid);
+            for (int c = 0; c < 3; ++c)
+                GatherCenter(map, velocity, c, brick, v + c * PaddedCells);
+            ForEachPaddedCell(op);
+            for (int c = 0; c < 3; ++c)
+                ScatterBrick(result + c * PaddedCells, GetSlot(dest, slot, c));
+        }
+    }
+}
+
+void ComputeDivergence(const BrickMapPod& map, const SparseGridPod& velocity, const SparseObstaclesPod& obstacles,
+    SparseGridPod& dest)
+{
+    int slotCount = (int) map.Active.size();
+
+    #pragma omp parallel
+    {
+        std::vector<float> scratch(6 * PaddedCells, 0.0f);
+        float* zero = &scratch[0];
+        float* solid = zero + PaddedCells;
+        float* v = solid + PaddedCells;
+        float* result = v + 3 * PaddedCells;
+
+        DivergenceOp op;
+        op.Obstacle[0] = solid;
+        op.Obstacle[1] = op.Obstacle[2] = zero;
+        for (int c = 0; c < 3; ++c)
+            op.Velocity[c] = v + c * PaddedCells;
+        op.Dest = result;
+
+        #pragma omp for schedule(dynamic, 4)
+        for (int slot = 0; slot < slotCount; ++slot) {
+            int brick = map.Active[slot];
+            GatherBrick(obstacles.Map, obstacles.Solid, 0, brick, solid);
+            for (int c = 0; c < 3; ++c)
+                GatherBrick(map, velocity, c, brick, v + c * PaddedCells);
+            ForEachPaddedCell(op);
+            ScatterBrick(result, GetSlot(dest, slot, 0));
+        }
+    }
+}
+
+void ApplyImpulse(const BrickMapPod& map, SparseGridPod& dest, Vector3 position, float value)
+{
+    float px = position.getX(), py = position.getY(), pz = position.getZ();
+    int x0 = std::max(0, (int) std::floor(px - SplatRadius)), x1 = std::min(map.Width - 1, (int) std::ceil(px + SplatRadius));
+    int y0 = std::max(0, (int) std::floor(py - SplatRadius)), y1 = std::min(map.Height - 1, (int) std::ceil(py + SplatRadius));
+    int z0 = std::max(0, (int) std::floor(pz - SplatRadius)), z1 = std::min(map.Depth - 1, (int) std::ceil(pz + SplatRadius));
+
+    #pragma omp parallel for
+    for (int z = z0; z <= z1; ++z) {
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                float dx = x + 0.5f - px, dy = y + 0.5f - py, dz = z + 0.5f - pz;
+                float d = std::sqrt(dx * dx + dy * dy + dz * dz);
+                int slot = map.Slots[GetBrickIndex(map, x / BrickSize, y / BrickSize, z / BrickSize)];
+                if (d >= SplatRadius || slot < 0)
+                    continue;
+                float a = std::min((SplatRadius - d) * 0.5f, 1.0f);
+                int i = BrickOffset(x % BrickSize, y % BrickSize, z % BrickSize);
+                for (int c = 0; c < dest.NumComponents; ++c) {
+                    float* p = GetSlot(dest, slot, c) + i;
+                    *p = a * value + (1 - a) * *p;
+                }
+            }
+        }
+    }
+}
+
+void ApplyBuoyancy(const BrickMapPod& map, const SparseGridPod& velocity, const SparseGridPod& temperature,
+    const SparseGridPod& density, SparseGridPod& dest)
+{
+    int slotCount = (int) map.Active.size();
+
+    #pragma omp parallel for
+    for (int slot = 0; slot < slotCount; ++slot) {
+        int brick = map.Active[slot];
+        BuoyancyOp op;
+        for (int c = 0; c < 3; ++c) {
+            op.Velocity[c] = GetBrick(map, velocity, brick, c);
+            op.Dest[c] = GetSlot(dest, slot, c);
+        }
+        op.Temperature = GetBrick(map, temperature, brick, 0);
+        op.Density = GetBrick(map, density, brick, 0);
+        ForEachBrickCell(op);
+    }
+}
+
+void ExpandGrid(const BrickMapPod& map, const SparseGridPod& grid, GridPod& dest)
+{
+    ClearSurface(dest, grid.Background);
+    int slotCount = (int) map.Active.size();
+
+    #pragma omp parallel for
+    for (int slot = 0; slot < slotCount; ++slot) {
+        int brick = map.Active[slot];
+        int bx = brick % map.BricksX;
+        int by = (brick / map.BricksX) % map.BricksY;
+        int bz = brick / (map.BricksX * map.BricksY);
+        for (int c = 0; c < grid.NumComponents; ++c) {
+            const float* source = GetBrick(map, grid, brick, c);
+            float* plane = dest.Plane(c);
+            for (int z = 0; z < BrickSize; ++z) {
+                for (int y = 0; y < BrickSize; ++y) {
+                    int row = ((bz * BrickSize + z) * dest.Height + by * BrickSize + y) * dest.Width + bx * BrickSize;
+                    memcpy(plane + row, source + BrickOffset(0, y, z), BrickSize * sizeof(float));
+                }
+            }
+        }
+    }
+}
+
+size_t GetByteCount(const BrickMapPod& map)
+{
+    return (map.Slots.size() + map.Active.size()) * sizeof(int);
+}
+
+size_t GetByteCount(const SparseGridPod& grid)
+{
+    return grid.Data.size() * sizeof(float);
+}
+
+// Ray march volumes.  Skip returns how many samples can be stepped over from texel position t
+// because they're known to be empty, or zero if the sample at t has to be taken.
+struct DenseVolume {
+    PlaneFetch Fetch;
+    int Width;
+    int Height;
+    int Depth;
+
+    float Sample(const float t[3]) const { return SampleLinear(Fetch, Width, Height, Depth, t[0], t[1], t[2]); }
+    int Skip(const float*, const float*) const { return 0; }
+};
+
+struct SparseVolume {
+    const BrickMapPod* Map;
+    const SparseGridPod* Grid;
+    std::vector<unsigned char> Occupied; // Active bricks and all their neighbors
+    int Size[3];
+    int Bricks[3];
+
+    float Sample(const float t[3]) const { return SampleSparse(*Map, *Grid, 0, t[0], t[1], t[2]); }
+
+    // Linear filtering reaches at most one cell past the cell around t, so a sample in a brick
+    // with no active neighbors only ever fetches the background.
+    int Skip(const float t[3], const float step[3]) const
+    {
+        int brick[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            // Truncation only differs from floor below zero, where both clamp to zero:
+            int cell = std::min(std::max((int) t[axis], 0), Size[axis] - 1);
+            brick[axis] = cell / BrickSize;
+        }
+        if (Occupied[(brick[2] * Bricks[1] + brick[1]) * Bricks[0] + brick[0]])
+            return 0;
+
+        // Every sample short of the brick's far side is empty too:
+        float steps = 1e9f;
+        for (int axis = 0; axis < 3; ++axis) {
+            float lo = (float) (brick[axis] * BrickSize);
+            float hi = lo + BrickSize;
+            if (brick[axis] == 0) lo = -1e9f;
+            if (brick[axis] == Bricks[axis] - 1) hi = 1e9f;
+            if (step[axis] > 0)
+                steps = std::min(steps, (hi - t[axis]) / step[axis]);
+            else if (step[axis] < 0)
+                steps = std::min(steps, (lo - t[axis]) / step[axis]);
+        }
+        return std::max(1, (int) std::min(steps - 0.001f, 1e6f));
+    }
+};
+
+// Follows Raycast.glsl, except that the light march advances and stops as its "Tl <= 0.01"
+// test intends; the shader is missing a break there.  Each sample position is computed from
+// its index rather than accumulated, so skipping ahead lands on the same positions.
+template<class Volume>
+static void RayMarch(const Volume& volume, const int size[3], int imageSize, std::vector<float>* image)
+{
+    const float FieldOfView = 0.7f;
+    const float EyeDistance = 3.5f;
+    const float Absorption = 10.0f;
+    const float LightIntensity = 10.0f;
+    const Vector3 LightPosition(1.0f, 1.0f, 2.0f);
+    const float maxDist = std::sqrt(2.0f);
+    const int numSamples = 128;
+    const float stepSize = maxDist / float(numSamples);
+    const int numLightSamples = 32;
+    const float lscale = maxDist / float(numLightSamples);
+    const float densityFactor = 10;
+
+    float focalLength = 1.0f / std::tan(FieldOfView / 2);
+    image->assign(imageSize * imageSize * 4, 0.0f);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int row = 0; row < imageSize; ++row) {
+        for (int col = 0; col < imageSize; ++col) {
+            Vector3 origin(0, 0, EyeDistance);
+            Vector3 dir = normalize(Vector3(2.0f * (col + 0.5f) / imageSize - 1, 2.0f * (row + 0.5f) / imageSize - 1, -focalLength));
+
+            float tnear = -1e9f, tfar = 1e9f;
+            for (int axis = 0; axis < 3; ++axis) {
+                float t0 = (-1 - origin[axis]) / dir[axis];
+                float t1 = (1 - origin[axis]) / dir[axis];
+                tnear = std::max(tnear, std::min(t0, t1));
+                tfar = std::min(tfar, std::max(t0, t1));
+            }
+            if (tnear > tfar)
+                continue;
+            tnear = std::max(tnear, 0.0f);
+
+            Vector3 rayStart = 0.5f * (origin + dir * tnear + Vector3(1));
+            Vector3 rayStop = 0.5f * (origin + dir * tfar + Vector3(1));
+            Vector3 step = normalize(rayStop - rayStart) * stepSize;
+            float travel = length(rayStop - rayStart);
+            float stepTexel[3] = { step[0] * size[0], step[1] * size[1], step[2] * size[2] };
+            float T = 1.0f;
+            float Lo = 0.0f;
+
+            for (int i = 0; i < numSamples && i * stepSize < travel; ) {
+                Vector3 pos = rayStart + step * (float) i;
+                float t[3] = { pos[0] * size[0], pos[1] * size[1], pos[2] * size[2] };
+                int skip = volume.Skip(t, stepTexel);
+                if (skip) {
+                    i += skip;
+                    continue;
+                }
+                ++i;
+
+                float density = volume.Sample(t) * densityFactor;
+                if (density <= 0.0f)
+                    continue;
+
+                T *= 1.0f - density * stepSize * Absorption;
+                if (T <= 0.01f)
+                    break;
+
+                Vector3 lightDir = normalize(LightPosition - pos) * lscale;
+                float Tl = 1.0f;
+                float lightStep[3] = { lightDir[0] * size[0], lightDir[1] * size[1], lightDir[2] * size[2] };
+                for (int s = 0; s < numLightSamples; ) {
+                    Vector3 lpos = pos + lightDir * (float) (s + 1);
+                    float l[3] = { lpos[0] * size[0], lpos[1] * size[1], lpos[2] * size[2] };
+                    int skip = volume.Skip(l, lightStep);
+                    if (skip) {
+                        s += skip;
+                        continue;
+                    }
+                    ++s;
+
+                    float ld = volume.Sample(l);
+                    Tl *= 1.0f - Absorption * stepSize * ld;
+                    if (Tl <= 0.01f)
+                        break;
+                }
+
+                Lo += LightIntensity * Tl * T * density * stepSize;
+            }
+
+            float* pixel = &(*image)[(row * imageSize + col) * 4];
+            pixel[0] = pixel[1] = pixel[2] = Lo;
+            pixel[3] = 1 - T;
+        }
+    }
+}
+
+void RaycastDensity(const GridPod& density, int size, std::vector<float>* image)
+{
+    DenseVolume volume;
+    PlaneFetch fetch = { density.Plane(0), density.Width, density.Height };
+    volume.Fetch = fetch;
+    volume.Width = density.Width;
+    volume.Height = density.Height;
+    volume.Depth = density.Depth;
+    int dims[3] = { density.Width, density.Height, density.Depth };
+    RayMarch(volume, dims, size, image);
+}
+
+void RaycastDensity(const BrickMapPod& map, const SparseGridPod& density, int size, std::vector<float>* image)
+{
+    SparseVolume volume;
+    volume.Map = &map;
+    volume.Grid = &density;
+    volume.Size[0] = map.Width;
+    volume.Size[1] = map.Height;
+    volume.Size[2] = map.Depth;
+    volume.Bricks[0] = map.BricksX;
+    volume.Bricks[1] = map.BricksY;
+    volume.Bricks[2] = map.BricksZ;
+    std::vector<unsigned char> active(map.Slots.size(), 0);
+    for (size_t brick = 0; brick < active.size(); ++brick)
+        active[brick] = map.Slots[brick] >= 0;
+    Dilate(map, active, &volume.Occupied);
+    RayMarch(volume, volume.Size, size, image);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "FluidCpu.h"
+
+// Sparse counterparts of the grids in FluidCpu.h, for when the smoke fills a small part of the
+// box.  The box is cut into bricks of BrickSize^3 cells; only active bricks have storage, and
+// only they are visited by the operators.  Everywhere else a grid reads as its background.
+//
+// All the grids of one simulation share a BrickMapPod, so a brick has the same slot in each of
+// them.  Each step, the bricks where the smoke is above a threshold are marked, along with the
+// ones under the splat; ActivateBricks dilates that set by one brick so the plume has room to
+// move, and moves every grid over to it.  Cells that get dropped are below the threshold, and
+// pressure reads as zero past the active bricks, much like an open boundary.
+
+enum { BrickSize = 8 };
+
+struct BrickMapPod {
+    int Width;                  // In cells; each must be a multiple of BrickSize
+    int Height;
+    int Depth;
+    int BricksX;
+    int BricksY;
+    int BricksZ;
+    std::vector<int> Slots;     // Slot of each brick, or -1 where it isn't active
+    std::vector<int> Active;    // Brick of each slot, in scanline order
+};
+
+struct SparseGridPod {
+    int NumComponents;
+    float Background;
+    std::vector<float> Data;    // Per slot, one BrickSize^3 block per component; x fastest
+};
+
+struct SparseGridSlabPod {
+    SparseGridPod Ping;
+    SparseGridPod Pong;
+};
+
+// Obstacles never move, so they get a map of their own that covers every brick with a solid
+// cell.  Only the solid flag is kept; obstacle velocities are zero, as CreateObstacles leaves
+// them, and the operators read them through the same swizzles as the dense ones.
+struct SparseObstaclesPod {
+    BrickMapPod Map;
+    SparseGridPod Solid;
+};
+
+// Fails through PezCheckCondition unless every side is a multiple of BrickSize.
+BrickMapPod CreateBrickMap(int width, int height, int depth);
+SparseGridPod CreateSparseGrid(const BrickMapPod& map, int numComponents, float background);
+SparseGridSlabPod CreateSparseGridSlab(const BrickMapPod& map, int numComponents, float background);
+SparseObstaclesPod CreateSparseObstacles(const GridPod& obstacles);
+
+// Sets flags for the active bricks that hold a fluid cell further than threshold from the
+// grid's background, in any component.  Flags has one entry per brick.
+void MarkActiveBricks(const BrickMapPod& map, const SparseGridPod& grid, const SparseObstaclesPod& obstacles,
+    float threshold, std::vector<unsigned char>* flags);
+
+// Sets flags for the bricks that a splat of the given radius overlaps.
+void MarkSplatBricks(const BrickMapPod& map, vmath::Vector3 position, float radius, std::vector<unsigned char>* flags);
+
+// Makes the flagged bricks and their neighbors active, and moves each grid over to the new
+// slots.  Bricks that were already active keep their contents; new ones start out at the
+// background.  Returns the number of active bricks.
+int ActivateBricks(BrickMapPod* map, const std::vector<unsigned char>& flags, SparseGridPod* const* grids, int gridCount);
+
+void SwapSurfaces(SparseGridSlabPod* slab);
+void ClearSurface(SparseGridPod& s, float v);
+void Advect(const BrickMapPod& map, const SparseGridPod& velocity, const SparseGridPod& source,
+    const SparseObstaclesPod& obstacles, SparseGridPod& dest, float dissipation);
+void Jacobi(const BrickMapPod& map, const SparseGridPod& pressure, const SparseGridPod& divergence,
+    const SparseObstaclesPod& obstacles, SparseGridPod& dest);
+void SubtractGradient(const BrickMapPod& map, const SparseGridPod& velocity, const SparseGridPod& pressure,
+    const SparseObstaclesPod& obstacles, SparseGridPod& dest);
+void ComputeDivergence(const BrickMapPod& map, const SparseGridPod& velocity, const SparseObstaclesPod& obstacles,
+    SparseGridPod& dest);
+void ApplyImpulse(const BrickMapPod& map, SparseGridPod& dest, vmath::Vector3 position, float value);
+void ApplyBuoyancy(const BrickMapPod& map, const SparseGridPod& velocity, const SparseGridPod& temperature,
+    const SparseGridPod& density, SparseGridPod& dest);
+
+// Writes the sparse grid out densely, with the background everywhere that isn't active.
+void ExpandGrid(const BrickMapPod& map, const SparseGridPod& grid, GridPod& dest);
+
+// Bytes held by the map's tables and by a grid's bricks.
+size_t GetByteCount(const BrickMapPod& map);
+size_t GetByteCount(const SparseGridPod& grid);
+
+// CPU version of the ray march in Raycast.glsl, seen from where Fluid3d.cpp puts the eye
+// before the trackball moves.  Fills size * size RGBA pixels, bottom row first.  The sparse
+// version skips samples whose filter footprint lies in inactive bricks; those sample zero
+// density, so it gives the same image as marching its expanded grid.
+void RaycastDensity(const GridPod& density, int size, std::vector<float>* image);
+void RaycastDensity(const BrickMapPod& map, const SparseGridPod& density, int size, std::vector<float>* image);
@@ -3,6 +3,7 @@
 #include <vmath.hpp>
 #include <pez.h>
 #include <glew.h>
+#include "Constants.h"
 
 enum AttributeSlot {
     SlotPosition,
@@ -64,23 +65,3 @@ void SubtractGradient(SurfacePod velocity, SurfacePod pressure, SurfacePod obsta
 void ComputeDivergence(SurfacePod velocity, SurfacePod obstacles, SurfacePod dest);
 void ApplyImpulse(SurfacePod dest, vmath::Vector3 position, float value);
 void ApplyBuoyancy(SurfacePod velocity, SurfacePod temperature, SurfacePod density, SurfacePod dest);
-
-extern const float CellSize;
-extern const int ViewportWidth;
-extern const int ViewportHeight;
-extern const int GridWidth;
-extern const int GridHeight;
-extern const int GridDepth;
-extern const float SplatRadius;
-extern const float AmbientTemperature;
-extern const float ImpulseTemperature;
-extern const float ImpulseDensity;
-extern const int NumJacobiIterations;
-extern const float TimeStep;
-extern const float SmokeBuoyancy;
-extern const float SmokeWeight;
-extern const float GradientScale;
-extern const float TemperatureDissipation;
-extern const float VelocityDissipation;
-extern const float DensityDissipation;
-extern const vmath::Vector3 ImpulsePosition;
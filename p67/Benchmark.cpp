@@ -0,0 +1,506 @@
+// Headless check and benchmark for the curl of the velocity potential: compares the analytic
+// Jacobian against central differences at random points around the plume, then times both.
+// Exits with a nonzero status if they disagree.  Also measures particle advection throughput
+// for the original array-of-structures loop versus the threaded ParticleSystem, and compares
+// the VectorGrid sampler against the macro-based lookup that SampleCachedCurl used to do, and
+// the effect of sorting the particles along Morton and Hilbert curves.
+// Finally bakes a small velocity grid and checks the on-disk cache.
+// Usage: Benchmark [sampleCount] [particleCount] [lookupCount]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <pez.h>
+#include "noise.h"
+#include "Potential.hpp"
+#include "ParticleSystem.hpp"
+#include "VelocityBake.hpp"
+#include "VectorGrid.hpp"
+#include "Timer.hpp"
+
+using namespace vmath;
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Random points in the box that CreateVelocityTexture covers, skipping the obstacle's surface
+// where the potential has a crease.
+static Point3 RandomPoint(unsigned int& seed)
+{
+    Point3 p;
+    do {
+        float x = randhashf(seed++, -2, 2);
+        float y = randhashf(seed++, -4, 4);
+        float z = randhashf(seed++, -2, 2);
+        p = Point3(x, y, z);
+    } while (std::fabs(length(Vector3(p)) - 1) < 0.01f);
+    return p;
+}
+
+// The loop that AdvanceTime used to run over the interleaved particles.
+static void AdvectReference(Particle* particleList, int count, float timeStep)
+{
+    Particle* pNode = particleList;
+    for (int i = 0; i < count; ++i, ++pNode) {
+        Point3 p(pNode->Px, pNode->Py, pNode->Pz);
+        Vector3 v = ComputeCurl(p);
+        Point3 midx = p + 0.5f * timeStep * v;
+        v = ComputeCurl(midx);
+        p += timeStep * v;
+        pNode->Px = p.getX(); pNode->Py = p.getY(); pNode->Pz = p.getZ();
+        pNode->Vx = v.getX(); pNode->Vy = v.getY(); pNode->Vz = v.getZ();
+    }
+}
+
+static void RunParticleBenchmark(int particleCount)
+{
+    const int StepCount = 3;
+    const float TimeStep = 0.01f;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    ParticleSystem system;
+    ParticleEmitter emitter = { PlumeBase, 0.5f, 4.0f, 0 };
+    unsigned int seed = 0;
+    InitParticleSystem(&system, particleCount);
+    KillAndSpawn(&system, PlumeCeiling, particleCount, emitter, 1.0f, &seed);
+
+    std::vector<Particle> reference(particleCount);
+    PackParticles(system, &reference[0], particleCount);
+
+    double start = GetSeconds();
+    for (int step = 0; step < StepCount; ++step)
+        AdvectReference(&reference[0], particleCount, TimeStep);
+    double referenceTime = GetSeconds() - start;
+
+    ParticleSystem single = system;
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+    start = GetSeconds();
+    for (int step = 0; step < StepCount; ++step)
+        AdvectParticles(&single, ComputeCurl, TimeStep);
+    double singleTime = GetSeconds() - start;
+
+#ifdef _OPENMP
+    omp_set_num_threads(threadCount);
+#endif
+    start = GetSeconds();
+    for (int step = 0; step < StepCount; ++step) {
+        AdvectParticles(&system, ComputeCurl, TimeStep);
+        KillAndSpawn(&system, PlumeCeiling, 0, emitter, 1.0f, &seed);
+    }
+    std::vector<Particle> packed(particleCount);
+    PackParticles(system, &packed[0], particleCount);
+    double threadedTime = GetSeconds() - start;
+
+    // Nothing reaches the ceiling in a few steps, so the packed arrays should match exactly:
+    bool identical = system.Count == (unsigned int) particleCount &&
+        memcmp(&reference[0], &packed[0], particleCount * sizeof(Particle)) == 0;
+
+    double steps = (double) particleCount * StepCount;
+    printf("advect %d particles  reference: %7.1f K/s  SoA: %7.1f K/s  %2d threads with compaction and pack: %7.1f K/s  %s\n",
+        particleCount, steps / referenceTime * 0.001, steps / singleTime * 0.001,
+        threadCount, steps / threadedTime * 0.001, identical ? "identical" : "MISMATCH");
+}
+
+// The lookup that SampleCachedCurl used to do on the flat cache.
+static Vector3 SampleReference(const std::vector<float>& data, int width, int height, int depth, Point3 p)
+{
+    const float W = 2.0f;
+    const float H = W * height / width;
+    const float D = W;
+    float x = width * (p[0] + W) / (2 * W);
+    float y = height * (p[1] + H) / (2 * H);
+    float z = depth * (p[2] + D) / (2 * D);
+    x = std::max(std::min(x, float(width-2)), 0.0f);
+    y = std::max(std::min(y, float(height-2)), 0.0f);
+    z = std::max(std::min(z, float(depth-2)), 0.0f);
+
+#define V(x,y,z) Vector3( \
+    data[int(z) * width * height * 3 + int(y) * width * 3 + int(x) * 3 + 0],   \
+    data[int(z) * width * height * 3 + int(y) * width * 3 + int(x) * 3 + 1],   \
+    data[int(z) * width * height * 3 + int(y) * width * 3 + int(x) * 3 + 2] )
+    Vector3 v000 = V(floor(x), floor(y), floor(z));
+    Vector3 v001 = V(floor(x), floor(y), ceil(z));
+    Vector3 v010 = V(floor(x), ceil(y), floor(z));
+    Vector3 v011 = V(floor(x), ceil(y), ceil(z));
+    Vector3 v100 = V(ceil(x), floor(y), floor(z));
+    Vector3 v101 = V(ceil(x), floor(y), ceil(z));
+    Vector3 v110 = V(ceil(x), ceil(y), floor(z));
+    Vector3 v111 = V(ceil(x), ceil(y), ceil(z));
+#undef V
+
+    float u = x - floor(x), v = y - floor(y), w = z - floor(z);
+    Vector3 v00_ = (1-w)*v000 + w*v001;
+    Vector3 v01_ = (1-w)*v010 + w*v011;
+    Vector3 v10_ = (1-w)*v100 + w*v101;
+    Vector3 v11_ = (1-w)*v110 + w*v111;
+    Vector3 v0__ = (1-v)*v00_ + v*v01_;
+    Vector3 v1__ = (1-v)*v10_ + v*v11_;
+    return (1-u)*v0__ + u*v1__;
+}
+
+static const VectorGrid* CurrentGrid;
+
+static Vector3 SampleGrid(Point3 p)
+{
+    return CurrentGrid->Sample(p);
+}
+
+static void SampleGridBatch(const float* x, const float* y, const float* z,
+    float* vx, float* vy, float* vz, int count)
+{
+    CurrentGrid->Sample(x, y, z, vx, vy, vz, count);
+}
+
+// Smooth stand-in for the baked curl, since baking the real one takes too long for a benchmark.
+static void CreateSyntheticField(std::vector<float>* data, int width, int height, int depth)
+{
+    data->resize((size_t) width * height * depth * 3);
+    float* pData = &(*data)[0];
+    for (int k = 0; k < depth; ++k)
+        for (int j = 0; j < height; ++j)
+            for (int i = 0; i < width; ++i) {
+                *pData++ = std::sin(i * 0.11f) * std::cos(j * 0.05f);
+                *pData++ = std::cos(k * 0.07f + i * 0.03f);
+                *pData++ = std::sin(j * 0.02f - k * 0.13f);
+            }
+}
+
+// Uses a smooth synthetic field at the resolution that the demo bakes, since baking the real
+// curl takes too long for a benchmark.  Returns false if any sampler strays from the reference.
+static bool RunGridBenchmark(int lookupCount)
+{
+    const int Width = 128, Height = 256, Depth = 128;
+    const float W = 2.0f, H = W * Height / Width, D = W;
+    const float Float32Tolerance = 1e-4f;
+    const float Float16Tolerance = 4e-3f;
+
+    std::vector<float> data;
+    CreateSyntheticField(&data, Width, Height, Depth);
+
+    // Lookups land anywhere in the box, plus a margin to exercise the clamping:
+    std::vector<float> x(lookupCount), y(lookupCount), z(lookupCount);
+    unsigned int seed = 0;
+    for (int i = 0; i < lookupCount; ++i) {
+        x[i] = randhashf(seed++, -1.1f * W, 1.1f * W);
+        y[i] = randhashf(seed++, -1.1f * H, 1.1f * H);
+        z[i] = randhashf(seed++, -1.1f * D, 1.1f * D);
+    }
+
+    std::vector<float> expected(lookupCount * 3);
+    double start = GetSeconds();
+    for (int i = 0; i < lookupCount; ++i) {
+        Vector3 v = SampleReference(data, Width, Height, Depth, Point3(x[i], y[i], z[i]));
+        expected[i * 3 + 0] = v[0];
+        expected[i * 3 + 1] = v[1];
+        expected[i * 3 + 2] = v[2];
+    }
+    double referenceTime = GetSeconds() - start;
+    printf("grid  macro reference:            %7.1f M lookups/s  %6.1f MB\n",
+        lookupCount / referenceTime * 1e-6, data.size() * sizeof(float) / (1024.0 * 1024.0));
+
+    bool passed = true;
+    std::vector<float> vx(lookupCount), vy(lookupCount), vz(lookupCount);
+    for (int config = 0; config < 4; ++config) {
+        VectorGrid::Precision precision = (config & 1) ? VectorGrid::Float16 : VectorGrid::Float32;
+        VectorGrid::Layout layout = (config & 2) ? VectorGrid::Bricked : VectorGrid::Linear;
+        VectorGrid grid;
+        grid.Init(Width, Height, Depth, Point3(-W, -H, -D), Vector3(2 * W, 2 * H, 2 * D), precision, layout);
+        grid.Assign(&data[0]);
+
+        std::vector<float> scalar(lookupCount * 3);
+        start = GetSeconds();
+        for (int i = 0; i < lookupCount; ++i) {
+            Vector3 v = grid.Sample(Point3(x[i], y[i], z[i]));
+            scalar[i * 3 + 0] = v[0];
+            scalar[i * 3 + 1] = v[1];
+            scalar[i * 3 + 2] = v[2];
+        }
+        double scalarTime = GetSeconds() - start;
+
+        float scalarError = 0;
+        for (int i = 0; i < lookupCount * 3; ++i)
+            scalarError = std::max(scalarError, std::fabs(scalar[i] - expected[i]));
+
+        start = GetSeconds();
+        grid.Sample(&x[0], &y[0], &z[0], &vx[0], &vy[0], &vz[0], lookupCount);
+        double batchTime = GetSeconds() - start;
+
+        float batchError = 0;
+        for (int i = 0; i < lookupCount; ++i) {
+            batchError = std::max(batchError, std::fabs(vx[i] - expected[i * 3 + 0]));
+            batchError = std::max(batchError, std::fabs(vy[i] - expected[i * 3 + 1]));
+            batchError = std::max(batchError, std::fabs(vz[i] - expected[i * 3 + 2]));
+        }
+
+        float tolerance = precision == VectorGrid::Float16 ? Float16Tolerance : Float32Tolerance;
+        bool ok = std::max(scalarError, batchError) < tolerance;
+        passed = passed && ok;
+        printf("grid  %s %s  scalar: %7.1f M lookups/s  batched: %7.1f M lookups/s  %6.1f MB  max error: %.1e  %s\n",
+            precision == VectorGrid::Float16 ? "half " : "float", layout == VectorGrid::Bricked ? "bricked" : "linear ",
+            lookupCount / scalarTime * 1e-6, lookupCount / batchTime * 1e-6,
+            grid.GetByteCount() / (1024.0 * 1024.0), std::max(scalarError, batchError), ok ? "PASS" : "FAIL");
+
+        // The batched advection path should reproduce the per-particle one:
+        if (config == 3) {
+            CurrentGrid = &grid;
+            ParticleSystem system;
+            ParticleEmitter emitter = { PlumeBase, 0.5f, 4.0f, 0 };
+            InitParticleSystem(&system, lookupCount);
+            KillAndSpawn(&system, PlumeCeiling, lookupCount, emitter, 1.0f, &seed);
+            ParticleSystem batched = system;
+
+            start = GetSeconds();
+            AdvectParticles(&system, SampleGrid, 0.01f);
+            double singleTime = GetSeconds() - start;
+            start = GetSeconds();
+            AdvectParticles(&batched, SampleGridBatch, 0.01f);
+            double batchedTime = GetSeconds() - start;
+
+            bool identical = system.Px == batched.Px && system.Py == batched.Py && system.Pz == batched.Pz &&
+                system.Vx == batched.Vx && system.Vy == batched.Vy && system.Vz == batched.Vz;
+            passed = passed && identical;
+            printf("grid  advect with half bricked grid  per particle: %7.1f K/s  batched: %7.1f K/s  %s\n",
+                lookupCount / singleTime * 0.001, lookupCount / batchedTime * 0.001,
+                identical ? "identical" : "MISMATCH");
+        }
+    }
+    return passed;
+}
+
+// Fraction of consecutive particles that land in different 16x16 pixel tiles of the demo's
+// 512x1024 view, as a stand-in for how well the blending in the particle pass hits the cache.
+static float GetTileSwitchRate(const ParticleSystem& system)
+{
+    const int Width = 512, Height = 1024, TileSize = 16;
+    const float W = 0.4f, H = W * Height / Width;
+    Matrix4 projection = Matrix4::frustum(-W, W, -H, H, 2, 500);
+    Matrix4 view = Matrix4::lookAt(Point3(0, 0, 7), Point3(0, 0, 0), Vector3(0, 1, 0));
+    Matrix4 modelviewProjection = projection * view;
+
+    int switches = 0, previous = -1;
+    for (unsigned int i = 0; i < system.Count; ++i) {
+        Vector4 clip = modelviewProjection * Point3(system.Px[i], system.Py[i], system.Pz[i]);
+        float x = (clip.getX() / clip.getW() * 0.5f + 0.5f) * Width;
+        float y = (clip.getY() / clip.getW() * 0.5f + 0.5f) * Height;
+        int tile = int(std::floor(y / TileSize)) * (Width / TileSize) + int(std::floor(x / TileSize));
+        if (i > 0 && tile != previous)
+            ++switches;
+        previous = tile;
+    }
+    return system.Count > 1 ? float(switches) / (system.Count - 1) : 0;
+}
+
+// Sorts particles spread through the plume along each curve, on one thread and on all of
+// them, then times advection through the demo's float grid before and after.  Returns false
+// if the two sorts differ, the keys are out of order, an attribute loses track of its
+// particle, or the sorted particles don't advect to the same places as the unsorted ones.
+static bool RunSortBenchmark(int particleCount)
+{
+    const int Width = 128, Height = 256, Depth = 128;
+    const float W = 2.0f, H = W * Height / Width, D = W;
+    const int StepCount = 3;
+    const int Level = 7;
+
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+#else
+    int threadCount = 1;
+#endif
+
+    std::vector<float> data;
+    CreateSyntheticField(&data, Width, Height, Depth);
+    VectorGrid grid;
+    grid.Init(Width, Height, Depth, Point3(-W, -H, -D), Vector3(2 * W, 2 * H, 2 * D));
+    grid.Attach(&data[0]);
+    CurrentGrid = &grid;
+
+    // Spawn order is random in space, as it is after the plume has been running for a while:
+    ParticleSystem system;
+    ParticleEmitter emitter = { PlumeBase, 1.0f, 6.0f, 0 };
+    unsigned int seed = 0;
+    InitParticleSystem(&system, particleCount);
+    KillAndSpawn(&system, PlumeCeiling, particleCount, emitter, 1.0f, &seed);
+    for (int i = 0; i < particleCount; ++i)
+        system.ToB[i] = float(i);
+
+    ParticleSystem unsorted = system;
+    double start = GetSeconds();
+    for (int step = 0; step < StepCount; ++step)
+        AdvectParticles(&unsorted, SampleGridBatch, 0.01f);
+    double unsortedTime = GetSeconds() - start;
+    printf("sort  %d particles  unsorted          advect: %7.1f K/s  tile switches: %4.1f%%\n",
+        particleCount, particleCount * StepCount / unsortedTime * 0.001, GetTileSwitchRate(system) * 100);
+
+    bool passed = true;
+    for (int order = MortonOrder; order <= HilbertOrder; ++order) {
+        ParticleSorter sorter;
+        InitParticleSorter(&sorter, ParticleOrder(order), Level, Point3(-W, -H, -D), Vector3(2 * W, 2 * H, 2 * D));
+
+        ParticleSystem single = system;
+#ifdef _OPENMP
+        omp_set_num_threads(1);
+#endif
+        start = GetSeconds();
+        SortParticles(&single, &sorter);
+        double singleTime = GetSeconds() - start;
+
+        ParticleSystem sorted = system;
+#ifdef _OPENMP
+        omp_set_num_threads(threadCount);
+#endif
+        start = GetSeconds();
+        SortParticles(&sorted, &sorter);
+        double threadedTime = GetSeconds() - start;
+
+        bool identical = single.Px == sorted.Px && single.Py == sorted.Py && single.Pz == sorted.Pz &&
+            single.ToB == sorted.ToB;
+
+        // Birth times were set to the old indices, so they show where each particle came from:
+        std::vector<bool> seen(particleCount, false);
+        bool tracked = true;
+        for (int i = 0; i < particleCount; ++i) {
+            int from = int(sorted.ToB[i]);
+            tracked = tracked && !seen[from] && (unsigned int) sorter.Pairs[i] == (unsigned int) from &&
+                sorted.Px[i] == system.Px[from] && sorted.Py[i] == system.Py[from] && sorted.Pz[i] == system.Pz[from];
+            seen[from] = true;
+            if (i > 0)
+                tracked = tracked && (sorter.Pairs[i] >> 32) >= (sorter.Pairs[i - 1] >> 32);
+        }
+        float tileRate = GetTileSwitchRate(sorted);
+
+        start = GetSeconds();
+        for (int step = 0; step < StepCount; ++step)
+            AdvectParticles(&sorted, SampleGridBatch, 0.01f);
+        double sortedTime = GetSeconds() - start;
+
+        for (int i = 0; i < particleCount; ++i) {
+            int from = int(sorted.ToB[i]);
+            tracked = tracked && sorted.Px[i] == unsorted.Px[from] && sorted.Py[i] == unsorted.Py[from] &&
+                sorted.Pz[i] == unsorted.Pz[from] && sorted.Vx[i] == unsorted.Vx[from];
+        }
+
+        passed = passed && identical && tracked;
+        printf("sort  %d particles  %s level %d  advect: %7.1f K/s  tile switches: %4.1f%%  "
+            "sort: %6.2f ms  %2d threads: %6.2f ms  %s\n",
+            particleCount, order == HilbertOrder ? "hilbert" : "morton ", Level,
+            particleCount * StepCount / sortedTime * 0.001, tileRate * 100,
+            singleTime * 1000, threadCount, threadedTime * 1000,
+            identical && tracked ? "identical" : "MISMATCH");
+    }
+    return passed;
+}
+
+// Bakes a small grid serially and in parallel, then saves it and maps it back.  Returns false
+// if any copy differs or if a stale file is accepted.
+static bool RunBakeBenchmark()
+{
+    const int Width = 32, Height = 64, Depth = 32;
+    const float W = 2.0f, H = W * Height / Width, D = W;
+    const char* Path = "BenchmarkVelocity.dat";
+    size_t count = (size_t) Width * Height * Depth * 3;
+
+    std::vector<float> reference(count);
+    double start = GetSeconds();
+    float* pData = &reference[0];
+    for (int slice = 0; slice < Depth; ++slice)
+        for (int row = 0; row < Height; ++row)
+            for (int col = 0; col < Width; ++col) {
+                Point3 p;
+                p[0] = -W + 2 * W * col / Width;
+                p[1] = -H + 2 * H * row / Height;
+                p[2] = -D + 2 * D * slice / Depth;
+                Vector3 v = ComputeCurl(p);
+                *pData++ = v[0];
+                *pData++ = v[1];
+                *pData++ = v[2];
+            }
+    double serialTime = GetSeconds() - start;
+
+    std::vector<float> parallel(count);
+    start = GetSeconds();
+    BakeVelocity(&parallel[0], Width, Height, Depth);
+    double parallelTime = GetSeconds() - start;
+
+    remove(Path);
+    VelocityBake bake;
+    bool loaded = OpenVelocityBake(&bake, Path, Width, Height, Depth);
+    bool saved = !loaded && bake.Mapping != 0;
+    CloseVelocityBake(&bake);
+
+    start = GetSeconds();
+    bool reloaded = OpenVelocityBake(&bake, Path, Width, Height, Depth);
+    double mapTime = GetSeconds() - start;
+    bool identical = parallel == reference && reloaded && bake.Mapping &&
+        memcmp(bake.Data, &reference[0], count * sizeof(float)) == 0;
+    CloseVelocityBake(&bake);
+
+    // A different potential must not reuse the file:
+    SetPotentialTime(2.5f);
+    bool rejected = !OpenVelocityBake(&bake, Path, Width, Height, Depth);
+    CloseVelocityBake(&bake);
+    SetPotentialTime(1.5f);
+    remove(Path);
+
+    bool passed = saved && identical && rejected;
+    printf("bake  %dx%dx%d  serial: %7.1f ms  parallel: %7.1f ms  mapped from disk: %5.2f ms  %s\n",
+        Width, Height, Depth, serialTime * 1000, parallelTime * 1000, mapTime * 1000,
+        passed ? "identical" : "MISMATCH");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    int sampleCount = argc > 1 ? atoi(argv[1]) : 10000;
+    int particleCount = argc > 2 ? atoi(argv[2]) : 100000;
+    int lookupCount = argc > 3 ? atoi(argv[3]) : 1000000;
+    const float Tolerance = 0.02f;
+
+    SetPotentialTime(1.5f);
+
+    // A larger step than the default keeps float cancellation below the truncation error:
+    unsigned int seed = 0;
+    float worstError = 0;
+    for (int i = 0; i < sampleCount; ++i) {
+        Point3 p = RandomPoint(seed);
+        Vector3 analytic = ComputeCurl(p);
+        Vector3 reference = ComputeCurlFiniteDifference(p, 1e-3f);
+        float error = length(analytic - reference) / std::max(length(reference), 1.0f);
+        worstError = std::max(worstError, error);
+    }
+
+    seed = 0;
+    Vector3 sum(0, 0, 0);
+    double start = GetSeconds();
+    for (int i = 0; i < sampleCount; ++i)
+        sum += ComputeCurlFiniteDifference(RandomPoint(seed));
+    double differenceTime = GetSeconds() - start;
+
+    seed = 0;
+    start = GetSeconds();
+    for (int i = 0; i < sampleCount; ++i)
+        sum += ComputeCurl(RandomPoint(seed));
+    double analyticTime = GetSeconds() - start;
+
+    printf("curl  finite differences: %7.1f K samples/s  analytic: %7.1f K samples/s  speedup: %4.1fx  "
+        "worst relative error: %.2e  %s\n",
+        sampleCount / differenceTime * 0.001, sampleCount / analyticTime * 0.001,
+        differenceTime / analyticTime, worstError, worstError < Tolerance ? "PASS" : "FAIL");
+
+    RunParticleBenchmark(particleCount);
+    bool gridPassed = RunGridBenchmark(lookupCount);
+    bool sortPassed = RunSortBenchmark(particleCount);
+    bool bakePassed = RunBakeBenchmark();
+
+    return worstError < Tolerance && gridPassed && sortPassed && bakePassed ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <pez.h>
+#include "noise.h"
+#include "ParticleSystem.hpp"
+#include "SpaceCurve.hpp"
+
+using namespace vmath;
+
+static const int ChunkSize = 256;
+
+// Radix sorting works on chunks of particles in parallel; each chunk counts its own digits.
+static const int RadixBits = 8;
+static const int RadixSize = 1 << RadixBits;
+static const int MinSortChunkSize = 4096;
+static const int MaxSortChunkCount = 64;
+
+void InitParticleSystem(ParticleSystem* system, unsigned int capacity)
+{
+    system->Px.assign(capacity, 0);
+    system->Py.assign(capacity, 0);
+    system->Pz.assign(capacity, 0);
+    system->ToB.assign(capacity, 0);
+    system->Vx.assign(capacity, 0);
+    system->Vy.assign(capacity, 0);
+    system->Vz.assign(capacity, 0);
+    system->Count = 0;
+    system->Capacity = capacity;
+}
+
+void AdvectParticles(ParticleSystem* system, VelocityField velocity, float timeStep)
+{
+    float* px = system->Count ? &system->Px[0] : 0;
+    float* py = system->Count ? &system->Py[0] : 0;
+    float* pz = system->Count ? &system->Pz[0] : 0;
+    float* vx = system->Count ? &system->Vx[0] : 0;
+    float* vy = system->Count ? &system->Vy[0] : 0;
+    float* vz = system->Count ? &system->Vz[0] : 0;
+    int count = (int) system->Count;
+    int chunkCount = (count + ChunkSize - 1) / ChunkSize;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        int end = std::min(count, (chunk + 1) * ChunkSize);
+        for (int i = chunk * ChunkSize; i < end; ++i) {
+            Point3 p(px[i], py[i], pz[i]);
+            Vector3 v = velocity(p);
+            Point3 midx = p + 0.5f * timeStep * v;
+            v = velocity(midx);
+            p += timeStep * v;
+            px[i] = p.getX(); py[i] = p.getY(); pz[i] = p.getZ();
+            vx[i] = v.getX(); vy[i] = v.getY(); vz[i] = v.getZ();
+        }
+    }
+}
+
+void AdvectParticles(ParticleSystem* system, BatchVelocityField velocity, float timeStep)
+{
+    float* px = system->Count ? &system->Px[0] : 0;
+    float* py = system->Count ? &system->Py[0] : 0;
+    float* pz = system->Count ? &system->Pz[0] : 0;
+    float* vx = system->Count ? &system->Vx[0] : 0;
+    float* vy = system->Count ? &system->Vy[0] : 0;
+    float* vz = system->Count ? &system->Vz[0] : 0;
+    int count = (int) system->Count;
+    int chunkCount = (count + ChunkSize - 1) / ChunkSize;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        int begin = chunk * ChunkSize;
+        int n = std::min(count, begin + ChunkSize) - begin;
+        float mx[ChunkSize], my[ChunkSize], mz[ChunkSize];
+        velocity(px + begin, py + begin, pz + begin, vx + begin, vy + begin, vz + begin, n);
+        for (int i = 0; i < n; ++i) {
+            mx[i] = px[begin + i] + 0.5f * timeStep * vx[begin + i];
+            my[i] = py[begin + i] + 0.5f * timeStep * vy[begin + i];
+            mz[i] = pz[begin + i] + 0.5f * timeStep * vz[begin + i];
+        }
+        velocity(mx, my, mz, vx + begin, vy + begin, vz + begin, n);
+        for (int i = begin; i < begin + n; ++i) {
+            px[i] += timeStep * vx[i];
+            py[i] += timeStep * vy[i];
+            pz[i] += timeStep * vz[i];
+        }
+    }
+}
+
+unsigned int KillAndSpawn(ParticleSystem* system, float ceiling, unsigned int spawnCount,
+    const ParticleEmitter& emitter, float time, unsigned int* seed)
+{
+    unsigned int alive = 0;
+    for (unsigned int i = 0; i < system->Count; ++i) {
+        if (system->Py[i] > ceiling)
+            continue;
+        if (alive != i) {
+            system->Px[alive] = system->Px[i];
+            system->Py[alive] = system->Py[i];
+            system->Pz[alive] = system->Pz[i];
+            system->ToB[alive] = system->ToB[i];
+            system->Vx[alive] = system->Vx[i];
+            system->Vy[alive] = system->Vy[i];
+            system->Vz[alive] = system->Vz[i];
+        }
+        ++alive;
+    }
+
+    spawnCount = std::min(spawnCount, system->Capacity - alive);
+    for (unsigned int i = alive; i < alive + spawnCount; ++i) {
+        float theta = randhashf((*seed)++, 0, TwoPi);
+        float r = randhashf((*seed)++, 0, emitter.Radius);
+        float y = randhashf((*seed)++, 0, emitter.Band);
+        system->Px[i] = r*std::cos(theta);
+        system->Py[i] = emitter.BaseY + y;
+        system->Pz[i] = r*std::sin(theta) + emitter.OffsetZ;
+        system->ToB[i] = time;
+        system->Vx[i] = system->Vy[i] = system->Vz[i] = 0;
+    }
+
+    system->Count = alive + spawnCount;
+    return spawnCount;
+}
+
+void InitParticleSorter(ParticleSorter* sorter, ParticleOrder order, int level, Point3 boxMin, Vector3 boxSize)
+{
+    sorter->Order = order;
+    sorter->Level = std::min(std::max(level, 1), (int) ParticleSortMaxLevel);
+    sorter->BoxMin = boxMin;
+    sorter->BoxSize = boxSize;
+}
+
+// Stable LSD sort on the key bits above the low word.  Each pass counts digits per chunk,
+// lays out the chunks in order within each digit, and scatters.
+static void RadixSort(std::vector<uint64_t>& pairs, std::vector<uint64_t>& scratch, int count, int keyBits)
+{
+    int chunkSize = std::max(MinSortChunkSize, (count + MaxSortChunkCount - 1) / MaxSortChunkCount);
+    int chunkCount = (count + chunkSize - 1) / chunkSize;
+    std::vector<int> cursors(chunkCount * RadixSize);
+
+    for (int shift = 32; shift < 32 + keyBits; shift += RadixBits) {
+        std::fill(cursors.begin(), cursors.end(), 0);
+        const uint64_t* source = &pairs[0];
+        uint64_t* dest = &scratch[0];
+
+        #pragma omp parallel for
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            int* counts = &cursors[chunk * RadixSize];
+            int end = std::min(count, (chunk + 1) * chunkSize);
+            for (int i = chunk * chunkSize; i < end; ++i)
+                ++counts[(source[i] >> shift) & (RadixSize - 1)];
+        }
+
+        int total = 0;
+        for (int digit = 0; digit < RadixSize; ++digit)
+            for (int chunk = 0; chunk < chunkCount; ++chunk) {
+                int& cursor = cursors[chunk * RadixSize + digit];
+                int n = cursor;
+                cursor = total;
+                total += n;
+            }
+
+        #pragma omp parallel for
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            int* cursor = &cursors[chunk * RadixSize];
+            int end = std::min(count, (chunk + 1) * chunkSize);
+            for (int i = chunk * chunkSize; i < end; ++i)
+                dest[cursor[(source[i] >> shift) & (RadixSize - 1)]++] = source[i];
+        }
+
+        pairs.swap(scratch);
+    }
+}
+
+static void GatherAttribute(std::vector<float>& values, std::vector<float>& gather, const uint64_t* pairs, int count)
+{
+    #pragma omp parallel for
+    for (int i = 0; i < count; ++i)
+        gather[i] = values[(unsigned int) pairs[i]];
+    values.swap(gather);
+}
+
+void SortParticles(ParticleSystem* system, ParticleSorter* sorter)
+{
+    int count = (int) system->Count;
+    if (count == 0)
+        return;
+    sorter->Pairs.resize(system->Capacity);
+    sorter->Scratch.resize(system->Capacity);
+    sorter->Gather.resize(system->Capacity);
+
+    // Key each particle by the cell it's in:
+    const int level = sorter->Level;
+    const float side = float(1 << level);
+    float scale[3], offset[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        scale[axis] = side / sorter->BoxSize[axis];
+        offset[axis] = -sorter->BoxMin[axis] * scale[axis];
+    }
+    const float* position[3] = { &system->Px[0], &system->Py[0], &system->Pz[0] };
+    uint64_t* pairs = &sorter->Pairs[0];
+    const bool hilbert = sorter->Order == HilbertOrder;
+
+    #pragma omp parallel for
+    for (int i = 0; i < count; ++i) {
+        unsigned cell[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            float c = position[axis][i] * scale[axis] + offset[axis];
+            cell[axis] = (unsigned) std::min(std::max(c, 0.0f), side - 1);
+        }
+        uint64_t key = hilbert ? EncodeHilbert(cell, level, 3) : EncodeMorton3(cell[0], cell[1], cell[2]);
+        pairs[i] = (key << 32) | (unsigned int) i;
+    }
+
+    RadixSort(sorter->Pairs, sorter->Scratch, count, 3 * level);
+
+    pairs = &sorter->Pairs[0];
+    GatherAttribute(system->Px, sorter->Gather, pairs, count);
+    GatherAttribute(system->Py, sorter->Gather, pairs, count);
+    GatherAttribute(system->Pz, sorter->Gather, pairs, count);
+    GatherAttribute(system->ToB, sorter->Gather, pairs, count);
+    GatherAttribute(system->Vx, sorter->Gather, pairs, count);
+    GatherAttribute(system->Vy, sorter->Gather, pairs, count);
+    GatherAttribute(system->Vz, sorter->Gather, pairs, count);
+}
+
+void PackParticles(const ParticleSystem& system, Particle* dest, unsigned int destCount)
+{
+    int count = (int) std::min(system.Count, destCount);
+
+    #pragma omp parallel for
+    for (int i = 0; i < count; ++i) {
+        dest[i].Px = system.Px[i];
+        dest[i].Py = system.Py[i];
+        dest[i].Pz = system.Pz[i];
+        dest[i].ToB = system.ToB[i];
+        dest[i].Vx = system.Vx[i];
+        dest[i].Vy = system.Vy[i];
+        dest[i].Vz = system.Vz[i];
+    }
+
+    Particle zero = Particle();
+    for (unsigned int i = count; i < destCount; ++i)
+        dest[i] = zero;
+}
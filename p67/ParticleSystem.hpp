@@ -0,0 +1,81 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <vmath.hpp>
+
+// Interleaved layout that the vertex shaders consume.
+struct Particle {
+    float Px;  // Position X
+    float Py;  // Position Y
+    float Pz;  // Position Z
+    float ToB; // Time of Birth
+    float Vx;  // Velocity X
+    float Vy;  // Velocity Y
+    float Vz;  // Velocity Z
+};
+
+// Particles are simulated as structure-of-arrays; live particles always occupy [0, Count).
+struct ParticleSystem {
+    std::vector<float> Px, Py, Pz;
+    std::vector<float> ToB;
+    std::vector<float> Vx, Vy, Vz;
+    unsigned int Count;
+    unsigned int Capacity;
+};
+
+// New particles start in a thin disk-shaped band.
+struct ParticleEmitter {
+    float BaseY;
+    float Radius;
+    float Band;
+    float OffsetZ;
+};
+
+// Keys for SortParticles.
+enum ParticleOrder { MortonOrder, HilbertOrder };
+enum { ParticleSortMaxLevel = 10 };
+
+// Sorting runs along a space-filling curve through 2^Level cells on a side of a box, which
+// should cover the velocity grid.  The buffers are kept from one sort to the next.
+struct ParticleSorter {
+    ParticleOrder Order;
+    int Level;
+    vmath::Point3 BoxMin;
+    vmath::Vector3 BoxSize;
+    std::vector<uint64_t> Pairs;    // Key in the high word and particle index in the low word
+    std::vector<uint64_t> Scratch;
+    std::vector<float> Gather;
+};
+
+typedef vmath::Vector3 (*VelocityField)(vmath::Point3 p);
+
+// Samples count positions at once, as structure-of-arrays.
+typedef void (*BatchVelocityField)(const float* x, const float* y, const float* z,
+    float* vx, float* vy, float* vz, int count);
+
+void InitParticleSystem(ParticleSystem* system, unsigned int capacity);
+
+// Midpoint RK2 step for every live particle.  Threads take chunks of particles on demand,
+// since the cost of a velocity sample varies across the plume.
+void AdvectParticles(ParticleSystem* system, VelocityField velocity, float timeStep);
+
+// Same step, but each chunk hands its positions to the field in two batched calls.
+void AdvectParticles(ParticleSystem* system, BatchVelocityField velocity, float timeStep);
+
+// Drops the particles above the ceiling and appends up to spawnCount new ones in the same
+// pass.  Survivors keep their order.  Returns the number of particles that were spawned.
+unsigned int KillAndSpawn(ParticleSystem* system, float ceiling, unsigned int spawnCount,
+    const ParticleEmitter& emitter, float time, unsigned int* seed);
+
+void InitParticleSorter(ParticleSorter* sorter, ParticleOrder order, int level,
+    vmath::Point3 boxMin, vmath::Vector3 boxSize);
+
+// Reorders the live particles along the curve, so that neighbours in memory sample nearby
+// parts of the velocity grid.  The keys are radix sorted in parallel and every attribute is
+// moved to match.  Particles with equal keys keep their order, so the result doesn't depend
+// on the number of threads; afterwards, the low words of sorter->Pairs give the old index of
+// each particle.
+void SortParticles(ParticleSystem* system, ParticleSorter* sorter);
+
+// Interleaves the live particles for upload; the remaining slots are zeroed.
+void PackParticles(const ParticleSystem& system, Particle* dest, unsigned int destCount);
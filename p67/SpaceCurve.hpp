@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+
+// Hilbert and Morton curves through a grid of 2^level cells on a side, in two or three
+// dimensions.  Each maps a distance along the curve to a cell and back in closed form, with no
+// recursion or state, so any cell can be found on its own and a whole curve can be filled in
+// parallel; the same indices serve as keys for sorting points spatially.
+//
+// The Hilbert curve is John Skilling's, from "Programming the Hilbert curve" (2004): the cell
+// is found from the Gray code of the index's interleaved bits, then each bit level undoes
+// the turns of the levels above it.  Consecutive cells are always face neighbours.
+
+enum {
+    SpaceCurveMaxLevel2D = 31,
+    SpaceCurveMaxLevel3D = 21,
+};
+
+uint64_t EncodeMorton2(unsigned x, unsigned y);
+uint64_t EncodeMorton3(unsigned x, unsigned y, unsigned z);
+void DecodeMorton2(uint64_t index, unsigned* x, unsigned* y);
+void DecodeMorton3(uint64_t index, unsigned* x, unsigned* y, unsigned* z);
+
+// Dims is 2 or 3, and axes holds one coordinate per dimension.
+uint64_t EncodeHilbert(const unsigned* axes, int level, int dims);
+void DecodeHilbert(uint64_t index, int level, int dims, unsigned* axes);
+
+// Writes the coordinates of all 2^(dims * level) cells in curve order, dims per cell.
+void FillHilbertAxes(int level, int dims, unsigned* axes);
+void FillMortonAxes(int level, int dims, unsigned* axes);
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <cassert>
+#include <string.h>
+#include "VectorGrid.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VECTOR_GRID_SSE2
+#endif
+
+using namespace vmath;
+
+static const int BrickSize = 4;
+
+static unsigned short FloatToHalf(float f)
+{
+    unsigned int u;
+    memcpy(&u, &f, sizeof(u));
+    unsigned int sign = (u >> 16) & 0x8000;
+    int exponent = (int) ((u >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = u & 0x7fffff;
+
+    if (((u >> 23) & 0xff) == 0xff)
+        return (unsigned short) (sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return (unsigned short) (sign | 0x7c00);
+
+    // Round to nearest even, both for denormals and normals; a carry out of the mantissa
+    // correctly bumps the exponent.
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return (unsigned short) sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+            ++half;
+        return (unsigned short) (sign | half);
+    }
+
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return (unsigned short) half;
+}
+
+// Rebiasing by a multiply handles denormal halves too, as long as denormal floats aren't
+// flushed to zero.  Infinities and NaNs are patched up separately.
+static float HalfToFloat(unsigned short h)
+{
+    unsigned int u = (h & 0x7fffu) << 13;
+    bool special = u >= 0x0f800000u;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    f *= 5.192296858534828e33f; // 2^112
+    memcpy(&u, &f, sizeof(u));
+    if (special)
+        u |= 0x7f800000u;
+    u |= (h & 0x8000u) << 16;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+inline float Load(float f) { return f; }
+inline float Load(unsigned short h) { return HalfToFloat(h); }
+
+inline float Lerp(float a, float b, float f) { return (1-f)*a + f*b; }
+
+#ifdef VECTOR_GRID_SSE2
+inline __m128 Load4(const float* f) { return _mm_loadu_ps(f); }
+
+// Same conversion as HalfToFloat, four at a time.
+inline __m128 Load4(const unsigned short* h)
+{
+    __m128i bits = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*) h), _mm_setzero_si128());
+    __m128i magnitude = _mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7fff)), 13);
+    __m128i special = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x0f7fffff));
+    __m128 f = _mm_mul_ps(_mm_castsi128_ps(magnitude), _mm_set1_ps(5.192296858534828e33f));
+    __m128i u = _mm_or_si128(_mm_castps_si128(f), _mm_and_si128(special, _mm_set1_epi32(0x7f800000)));
+    u = _mm_or_si128(u, _mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x8000)), 16));
+    return _mm_castsi128_ps(u);
+}
+#endif
+
+VectorGrid::VectorGrid() : m_precision(Float32), m_layout(Linear), m_attached(0)
+{
+    for (int a = 0; a < 3; ++a) {
+        m_size[a] = 0;
+        m_origin[a] = m_scale[a] = m_limit[a] = 0;
+    }
+}
+
+void VectorGrid::Init(int width, int height, int depth, Point3 origin, Vector3 extent,
+                      Precision precision, Layout layout)
+{
+    int size[3] = { width, height, depth };
+    int bricks[3];
+    for (int a = 0; a < 3; ++a) {
+        m_size[a] = size[a];
+        m_origin[a] = origin[a];
+        m_scale[a] = size[a] / extent[a];
+        m_limit[a] = float(size[a] - 2);
+        bricks[a] = (size[a] + BrickSize - 1) / BrickSize;
+    }
+
+    // Scanline offsets are plain strides; brick offsets split each coordinate into a brick
+    // index and a position within the brick, and both parts are still separable per axis.
+    unsigned int count;
+    if (layout == Linear) {
+        unsigned int stride = 3;
+        for (int a = 0; a < 3; ++a) {
+            m_offsets[a].resize(size[a]);
+            for (int i = 0; i < size[a]; ++i)
+                m_offsets[a][i] = i * stride;
+            stride *= size[a];
+        }
+        count = stride;
+    } else {
+        const int BrickVolume = BrickSize * BrickSize * BrickSize;
+        unsigned int brickStride = 3 * BrickVolume;
+        unsigned int innerStride = 3;
+        for (int a = 0; a < 3; ++a) {
+            m_offsets[a].resize(size[a]);
+            for (int i = 0; i < size[a]; ++i)
+                m_offsets[a][i] = (i / BrickSize) * brickStride + (i % BrickSize) * innerStride;
+            brickStride *= bricks[a];
+            innerStride *= BrickSize;
+        }
+        count = brickStride;
+    }
+
+    m_precision = precision;
+    m_layout = layout;
+    m_attached = 0;
+    m_floats.clear();
+    m_halves.clear();
+    if (precision == Float32)
+        m_floats.assign(count, 0.0f);
+    else
+        m_halves.assign(count, 0);
+}
+
+void VectorGrid::Assign(const float* xyz)
+{
+    for (int k = 0; k < m_size[2]; ++k) {
+        for (int j = 0; j < m_size[1]; ++j) {
+            unsigned int row = m_offsets[1][j] + m_offsets[2][k];
+            for (int i = 0; i < m_size[0]; ++i, xyz += 3) {
+                unsigned int offset = row + m_offsets[0][i];
+                for (int c = 0; c < 3; ++c) {
+                    if (m_precision == Float32)
+                        m_floats[offset + c] = xyz[c];
+                    else
+                        m_halves[offset + c] = FloatToHalf(xyz[c]);
+                }
+            }
+        }
+    }
+}
+
+void VectorGrid::Attach(const float* xyz)
+{
+    assert(m_precision == Float32 && m_layout == Linear);
+    std::vector<float>().swap(m_floats);
+    m_attached = xyz;
+}
+
+size_t VectorGrid::GetByteCount() const
+{
+    return m_floats.size() * sizeof(float) + m_halves.size() * sizeof(unsigned short);
+}
+
+Vector3 VectorGrid::Sample(Point3 p) const
+{
+    if (m_attached)
+        return SampleOne(m_attached, p[0], p[1], p[2]);
+    if (m_precision == Float32)
+        return SampleOne(&m_floats[0], p[0], p[1], p[2]);
+    return SampleOne(&m_halves[0], p[0], p[1], p[2]);
+}
+
+void VectorGrid::Sample(const float* x, const float* y, const float* z,
+                        float* vx, float* vy, float* vz, int count) const
+{
+    if (m_attached)
+        SampleBatch(m_attached, x, y, z, vx, vy, vz, count);
+    else if (m_precision == Float32)
+        SampleBatch(&m_floats[0], x, y, z, vx, vy, vz, count);
+    else
+        SampleBatch(&m_halves[0], x, y, z, vx, vy, vz, count);
+}
+
+// Corners are numbered with bit 0 for +x, bit 1 for +y, and bit 2 for +z.  The blend order
+// (z, then y, then x) matches the original SampleCachedCurl.
+template<class T>
+Vector3 VectorGrid::SampleOne(const T* data, float x, float y, float z) const
+{
+    float t[3] = { x, y, z };
+    float f[3];
+    unsigned int offsets[3][2];
+    for (int a = 0; a < 3; ++a) {
+        t[a] = (t[a] - m_origin[a]) * m_scale[a];
+        t[a] = std::max(std::min(t[a], m_limit[a]), 0.0f);
+        int i = (int) t[a];
+        f[a] = t[a] - i;
+        offsets[a][0] = m_offsets[a][i];
+        offsets[a][1] = m_offsets[a][i + 1];
+    }
+
+    const T* corners[8];
+    for (int corner = 0; corner < 8; ++corner)
+        corners[corner] = data + offsets[0][corner & 1] + offsets[1][(corner >> 1) & 1] + offsets[2][corner >> 2];
+
+    Vector3 result;
+    for (int c = 0; c < 3; ++c) {
+        float v[8];
+        for (int corner = 0; corner < 8; ++corner)
+            v[corner] = Load(corners[corner][c]);
+        float v00 = Lerp(v[0], v[4], f[2]);
+        float v01 = Lerp(v[2], v[6], f[2]);
+        float v10 = Lerp(v[1], v[5], f[2]);
+        float v11 = Lerp(v[3], v[7], f[2]);
+        result[c] = Lerp(Lerp(v00, v01, f[1]), Lerp(v10, v11, f[1]), f[0]);
+    }
+    return result;
+}
+
+template<class T>
+void VectorGrid::SampleBatch(const T* data, const float* x, const float* y, const float* z,
+                             float* vx, float* vy, float* vz, int count) const
+{
+    int i = 0;
+
+#ifdef VECTOR_GRID_SSE2
+    // Coordinates, weights, and blending are four-wide; only the corner fetches are scalar,
+    // since SSE2 has no gather.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1);
+    const float* in[3] = { x, y, z };
+    float* out[3] = { vx, vy, vz };
+    __m128 origin[3], scale[3], limit[3];
+    for (int a = 0; a < 3; ++a) {
+        origin[a] = _mm_set1_ps(m_origin[a]);
+        scale[a] = _mm_set1_ps(m_scale[a]);
+        limit[a] = _mm_set1_ps(m_limit[a]);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 f[3];
+        int cells[3][4];
+        for (int a = 0; a < 3; ++a) {
+            __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in[a] + i), origin[a]), scale[a]);
+            t = _mm_max_ps(_mm_min_ps(t, limit[a]), zero);
+            __m128i cell = _mm_cvttps_epi32(t);
+            f[a] = _mm_sub_ps(t, _mm_cvtepi32_ps(cell));
+            _mm_storeu_si128((__m128i*) cells[a], cell);
+        }
+
+        T corners[3][8][4];
+        for (int lane = 0; lane < 4; ++lane) {
+            unsigned int ox[2] = { m_offsets[0][cells[0][lane]], m_offsets[0][cells[0][lane] + 1] };
+            unsigned int oy[2] = { m_offsets[1][cells[1][lane]], m_offsets[1][cells[1][lane] + 1] };
+            unsigned int oz[2] = { m_offsets[2][cells[2][lane]], m_offsets[2][cells[2][lane] + 1] };
+            for (int corner = 0; corner < 8; ++corner) {
+                const T* sample = data + ox[corner & 1] + oy[(corner >> 1) & 1] + oz[corner >> 2];
+                corners[0][corner][lane] = sample[0];
+                corners[1][corner][lane] = sample[1];
+                corners[2][corner][lane] = sample[2];
+            }
+        }
+
+        #define LERP(A, B, F) _mm_add_ps(_mm_mul_ps(_mm_sub_ps(one, F), A), _mm_mul_ps(F, B))
+        for (int c = 0; c < 3; ++c) {
+            __m128 v[8];
+            for (int corner = 0; corner < 8; ++corner)
+                v[corner] = Load4(corners[c][corner]);
+            __m128 v00 = LERP(v[0], v[4], f[2]);
+            __m128 v01 = LERP(v[2], v[6], f[2]);
+            __m128 v10 = LERP(v[1], v[5], f[2]);
+            __m128 v11 = LERP(v[3], v[7], f[2]);
+            __m128 v0 = LERP(v00, v01, f[1]);
+            __m128 v1 = LERP(v10, v11, f[1]);
+            _mm_storeu_ps(out[c] + i, LERP(v0, v1, f[0]));
+        }
+        #undef LERP
+    }
+#endif
+
+    for (; i < count; ++i) {
+        Vector3 v = SampleOne(data, x[i], y[i], z[i]);
+        vx[i] = v[0];
+        vy[i] = v[1];
+        vz[i] = v[2];
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <vmath.hpp>
+
+// A 3D grid of vectors over an axis-aligned box, sampled with trilinear filtering and clamped
+// at the borders.  Samples can be stored as 32-bit or 16-bit floats, either in scanline order
+// or in 4x4x4 bricks so that the eight corners of a lookup tend to share cache lines.
+//
+// Both layouts are separable: the offset of sample (i, j, k) is OffsetX[i] + OffsetY[j] +
+// OffsetZ[k], so a lookup never needs more than three table reads to find its corners.
+class VectorGrid {
+public:
+    enum Precision { Float32, Float16 };
+    enum Layout { Linear, Bricked };
+
+    VectorGrid();
+
+    // Sample (i, j, k) sits at origin + (i, j, k) * extent / (width, height, depth).
+    void Init(int width, int height, int depth, vmath::Point3 origin, vmath::Vector3 extent,
+              Precision precision = Float32, Layout layout = Linear);
+
+    // Fills the grid from interleaved xyz floats in scanline order (x varies fastest).
+    void Assign(const float* xyz);
+
+    // Samples straight from caller-owned floats in the same order, for a Float32, Linear grid.
+    // The floats must outlive the grid or the next Init.
+    void Attach(const float* xyz);
+
+    vmath::Vector3 Sample(vmath::Point3 p) const;
+
+    // Structure-of-arrays batch; uses SSE2 when it's available.
+    void Sample(const float* x, const float* y, const float* z,
+                float* vx, float* vy, float* vz, int count) const;
+
+    // Storage owned by the grid; attached floats don't count.
+    size_t GetByteCount() const;
+
+private:
+    template<class T> void SampleBatch(const T* data, const float* x, const float* y, const float* z,
+                                       float* vx, float* vy, float* vz, int count) const;
+    template<class T> vmath::Vector3 SampleOne(const T* data, float x, float y, float z) const;
+
+    int m_size[3];
+    float m_origin[3];
+    float m_scale[3];
+    float m_limit[3];
+    Precision m_precision;
+    Layout m_layout;
+    const float* m_attached;
+    std::vector<unsigned int> m_offsets[3];
+    std::vector<float> m_floats;
+    std::vector<unsigned short> m_halves;
+};
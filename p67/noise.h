@@ -1,4 +1,5 @@
 #pragma once
+#include <climits>
 #include <vmath.hpp>
 
 template<class T> inline T sqr(const T &x) { return x*x; }
@@ -28,6 +29,8 @@ struct Noise3
    void reinitialize(unsigned int seed);
    float operator()(float x, float y, float z) const;
    float operator()(const vmath::Vector3 &x) const { return (*this)(x[0], x[1], x[2]); }
+   // Same value as above, plus its analytic gradient with respect to (x, y, z):
+   float operator()(float x, float y, float z, vmath::Vector3 &gradient) const;
 
    protected:
    static const unsigned int n=128;
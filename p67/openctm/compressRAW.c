@@ -124,6 +124,7 @@ int _ctmUncompressMesh_RAW(_CTMcontext * self)
   }
   for(i = 0; i < self->mTriangleCount * 3; ++ i)
     self->mIndices[i] = _ctmStreamReadUINT(self);
+  _ctmStreamArrayReady(self, CTM_INDICES);
 
   // Read vertices
   if(_ctmStreamReadUINT(self) != FOURCC("VERT"))
@@ -133,6 +134,7 @@ int _ctmUncompressMesh_RAW(_CTMcontext * self)
   }
   for(i = 0; i < self->mVertexCount * 3; ++ i)
     self->mVertices[i] = _ctmStreamReadFLOAT(self);
+  _ctmStreamArrayReady(self, CTM_VERTICES);
 
   // Read normals
   if(self->mNormals)
@@ -144,6 +146,7 @@ int _ctmUncompressMesh_RAW(_CTMcontext * self)
     }
     for(i = 0; i < self->mVertexCount * 3; ++ i)
       self->mNormals[i] = _ctmStreamReadFLOAT(self);
+    _ctmStreamArrayReady(self, CTM_NORMALS);
   }
 
   // Read UV maps
@@ -37,6 +37,11 @@
 // Flags for the Mesh flags field of the file header
 #define _CTM_HAS_NORMALS_BIT 0x00000001
 
+// Flags for arrays that were provided by a streaming import map() function
+#define _CTM_EXTERNAL_INDICES  0x00000001
+#define _CTM_EXTERNAL_VERTICES 0x00000002
+#define _CTM_EXTERNAL_NORMALS  0x00000004
+
 //-----------------------------------------------------------------------------
 // _CTMfloatmap - Internal representation of a floating point based vertex map
 // (used for UV maps and attribute maps).
@@ -50,6 +55,20 @@ struct _CTMfloatmap_struct {
   _CTMfloatmap * mNext; // Pointer to the next map in the list (linked list)
 };
 
+//-----------------------------------------------------------------------------
+// _CTMpackedints - An integer array together with its compressed form (used
+// for multithreaded encoding and decoding).
+//-----------------------------------------------------------------------------
+typedef struct {
+  unsigned char * mPacked;  // LZMA compressed data
+  CTMuint mPackedSize;      // Size of the compressed data
+  unsigned char mProps[5];  // LZMA compression props
+  CTMint * mData;           // Destination array
+  CTMuint mCount;           // Number of elements in the destination array
+  CTMuint mSize;            // Number of integers per element
+  CTMint mSignedInts;       // Signed magnitude integers?
+} _CTMpackedints;
+
 //-----------------------------------------------------------------------------
 // _CTMcontext - Internal CTM context structure.
 //-----------------------------------------------------------------------------
@@ -102,6 +121,30 @@ typedef struct {
 
   // User data (for stream read/write - usually the stream handle)
   void * mUserData;
+
+  // Streaming import map() function pointer (optional)
+  CTMmapfn mMapFn;
+
+  // Streaming import progress() function pointer (optional)
+  CTMprogressfn mProgressFn;
+
+  // User data for the streaming import callbacks
+  void * mStreamUserData;
+
+  // Number of bytes consumed from the stream by the current import
+  CTMuint mBytesRead;
+
+  // Arrays that live in caller provided memory (_CTM_EXTERNAL_* bits)
+  CTMuint mExternalArrays;
+
+  // Number of threads used for decoding packed data (0 or 1 = single threaded)
+  CTMuint mDecodeThreads;
+
+  // Number of threads used for sorting and compressing (0 or 1 = single threaded)
+  CTMuint mCompressionThreads;
+
+  // Use the fast compression preset?
+  CTMint mFastCompression;
 } _CTMcontext;
 
 //-----------------------------------------------------------------------------
@@ -125,6 +168,12 @@ int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData, CTMuint aCount,
 int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData, CTMuint aCount, CTMuint aSize, CTMint aSignedInts);
 int _ctmStreamReadPackedFloats(_CTMcontext * self, CTMfloat * aData, CTMuint aCount, CTMuint aSize);
 int _ctmStreamWritePackedFloats(_CTMcontext * self, CTMfloat * aData, CTMuint aCount, CTMuint aSize);
+int _ctmStreamReadPackedBlock(_CTMcontext * self, _CTMpackedints * aBlock);
+CTMenum _ctmUnpackInts(_CTMpackedints * aBlock);
+CTMenum _ctmPackInts(_CTMpackedints * aBlock, CTMuint aLevel, CTMint aFast);
+void _ctmStreamWritePackedBlock(_CTMcontext * self, _CTMpackedints * aBlock);
+void _ctmStreamProgress(_CTMcontext * self);
+void _ctmStreamArrayReady(_CTMcontext * self, CTMenum aArray);
 
 //-----------------------------------------------------------------------------
 // Funcion prototypes for compressRAW.c
@@ -28,6 +28,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <LzmaLib.h>
+#include <LzmaDec.h>
+#include <Alloc.h>
 #include "openctm.h"
 #include "internal.h"
 
@@ -35,15 +37,26 @@
 #include <stdio.h>
 #endif
 
+// Size of the chunks that packed data is read and decoded in
+#define _CTM_STREAM_CHUNK_SIZE 65536
+
+static void *_ctmSzAlloc(void *p, size_t size) { p = p; return MyAlloc(size); }
+static void _ctmSzFree(void *p, void *address) { p = p; MyFree(address); }
+static ISzAlloc _ctmAlloc = { _ctmSzAlloc, _ctmSzFree };
+
 //-----------------------------------------------------------------------------
 // _ctmStreamRead() - Read data from a stream.
 //-----------------------------------------------------------------------------
 CTMuint _ctmStreamRead(_CTMcontext * self, void * aBuf, CTMuint aCount)
 {
+  CTMuint count;
+
   if(!self->mUserData || !self->mReadFn)
     return 0;
 
-  return self->mReadFn(aBuf, aCount, self->mUserData);
+  count = self->mReadFn(aBuf, aCount, self->mUserData);
+  self->mBytesRead += count;
+  return count;
 }
 
 //-----------------------------------------------------------------------------
@@ -168,18 +181,36 @@ void _ctmStreamWriteSTRING(_CTMcontext * self, const char * aValue)
 }
 
 //-----------------------------------------------------------------------------
-// _ctmStreamReadPackedInts() - Read an compressed binary integer data array
-// from a stream, and uncompress it.
+// _ctmStreamProgress() - Report streaming import progress (if requested).
 //-----------------------------------------------------------------------------
-int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
-  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+void _ctmStreamProgress(_CTMcontext * self)
 {
-  size_t packedSize, unpackedSize;
-  CTMuint i, k, x;
-  CTMint value;
-  unsigned char * packed, * tmp;
-  unsigned char props[5];
-  int lzmaRes;
+  if(self->mProgressFn)
+    self->mProgressFn(CTM_NONE, self->mBytesRead, self->mStreamUserData);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamArrayReady() - Report that an array has been fully decoded.
+//-----------------------------------------------------------------------------
+void _ctmStreamArrayReady(_CTMcontext * self, CTMenum aArray)
+{
+  if(self->mProgressFn)
+    self->mProgressFn(aArray, self->mBytesRead, self->mStreamUserData);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamReadLZMA() - Read an LZMA packed block from a stream, and
+// uncompress it into aDest. The packed data is read and decoded in small
+// chunks, so that it never has to be held in memory as a whole.
+//-----------------------------------------------------------------------------
+static int _ctmStreamReadLZMA(_CTMcontext * self, unsigned char * aDest,
+  size_t aSize)
+{
+  CLzmaDec dec;
+  ELzmaStatus status;
+  unsigned char props[5], * chunk;
+  size_t packedSize, chunkSize, srcPos, srcLen;
+  int lzmaRes = SZ_OK;
 
   // Read packed data size from the stream
   packedSize = (size_t) _ctmStreamReadUINT(self);
@@ -187,49 +218,91 @@ int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
   // Read LZMA compression props from the stream
   _ctmStreamRead(self, (void *) props, 5);
 
-  // Allocate memory and read the packed data from the stream
-  packed = (unsigned char *) malloc(packedSize);
-  if(!packed)
+  chunk = (unsigned char *) malloc(_CTM_STREAM_CHUNK_SIZE);
+  if(!chunk)
   {
     self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
   }
-  _ctmStreamRead(self, (void *) packed, packedSize);
 
-  // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
-  if(!tmp)
+  LzmaDec_Construct(&dec);
+  if(LzmaDec_AllocateProbs(&dec, props, 5, &_ctmAlloc) != SZ_OK)
   {
-    free(packed);
-    self->mError = CTM_OUT_OF_MEMORY;
+    free(chunk);
+    self->mError = CTM_LZMA_ERROR;
     return CTM_FALSE;
   }
 
-  // Uncompress
-  unpackedSize = aCount * aSize * 4;
-  lzmaRes = LzmaUncompress(tmp, &unpackedSize, packed,
-                           &packedSize, props, 5);
+  // Decode straight into the destination buffer, which acts as the dictionary
+  dec.dic = aDest;
+  dec.dicBufSize = aSize;
+  LzmaDec_Init(&dec);
 
-  // Free the packed array
-  free(packed);
+  while((packedSize > 0) && (dec.dicPos < aSize) && (lzmaRes == SZ_OK))
+  {
+    chunkSize = packedSize < _CTM_STREAM_CHUNK_SIZE ? packedSize :
+                _CTM_STREAM_CHUNK_SIZE;
+    if(_ctmStreamRead(self, (void *) chunk, (CTMuint) chunkSize) != chunkSize)
+    {
+      lzmaRes = SZ_ERROR_INPUT_EOF;
+      break;
+    }
+    packedSize -= chunkSize;
+
+    srcPos = 0;
+    while((srcPos < chunkSize) && (dec.dicPos < aSize))
+    {
+      srcLen = chunkSize - srcPos;
+      lzmaRes = LzmaDec_DecodeToDic(&dec, aSize, chunk + srcPos, &srcLen,
+                                    LZMA_FINISH_ANY, &status);
+      srcPos += srcLen;
+      if((lzmaRes != SZ_OK) || (srcLen == 0))
+        break;
+    }
+
+    _ctmStreamProgress(self);
+  }
+
+  // Skip any trailing packed data
+  while(packedSize > 0)
+  {
+    chunkSize = packedSize < _CTM_STREAM_CHUNK_SIZE ? packedSize :
+                _CTM_STREAM_CHUNK_SIZE;
+    if(_ctmStreamRead(self, (void *) chunk, (CTMuint) chunkSize) != chunkSize)
+      break;
+    packedSize -= chunkSize;
+  }
+
+  LzmaDec_FreeProbs(&dec, &_ctmAlloc);
+  free(chunk);
 
   // Error?
-  if((lzmaRes != SZ_OK) || (unpackedSize != aCount * aSize * 4))
+  if((lzmaRes != SZ_OK) || (dec.dicPos != aSize))
   {
     self->mError = CTM_LZMA_ERROR;
-    free(tmp);
     return CTM_FALSE;
   }
 
-  // Convert interleaved array to integers
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmInterleavedToInts() - Convert a byte interleaved array to integers.
+//-----------------------------------------------------------------------------
+static void _ctmInterleavedToInts(const unsigned char * aTmp, CTMint * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  CTMuint i, k, x;
+  CTMint value;
+
   for(i = 0; i < aCount; ++ i)
   {
     for(k = 0; k < aSize; ++ k)
     {
-      value = (CTMint) tmp[i + k * aCount + 3 * aCount * aSize] |
-              (((CTMint) tmp[i + k * aCount + 2 * aCount * aSize]) << 8) |
-              (((CTMint) tmp[i + k * aCount + aCount * aSize]) << 16) |
-              (((CTMint) tmp[i + k * aCount]) << 24);
+      value = (CTMint) aTmp[i + k * aCount + 3 * aCount * aSize] |
+              (((CTMint) aTmp[i + k * aCount + 2 * aCount * aSize]) << 8) |
+              (((CTMint) aTmp[i + k * aCount + aCount * aSize]) << 16) |
+              (((CTMint) aTmp[i + k * aCount]) << 24);
       // Convert signed magnitude to two's complement?
       if(aSignedInts)
       {
@@ -239,6 +312,34 @@ int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
       aData[i * aSize + k] = value;
     }
   }
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamReadPackedInts() - Read an compressed binary integer data array
+// from a stream, and uncompress it.
+//-----------------------------------------------------------------------------
+int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  unsigned char * tmp;
+
+  // Allocate memory for interleaved array
+  tmp = (unsigned char *) malloc(aCount * aSize * 4);
+  if(!tmp)
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+
+  // Read and uncompress
+  if(!_ctmStreamReadLZMA(self, tmp, aCount * aSize * 4))
+  {
+    free(tmp);
+    return CTM_FALSE;
+  }
+
+  // Convert interleaved array to integers
+  _ctmInterleavedToInts(tmp, aData, aCount, aSize, aSignedInts);
 
   // Free the interleaved array
   free(tmp);
@@ -247,70 +348,147 @@ int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
 }
 
 //-----------------------------------------------------------------------------
-// _ctmStreamWritePackedInts() - Compress a binary integer data array, and
-// write it to a stream.
+// _ctmStreamReadPackedBlock() - Read a compressed binary integer data array
+// from a stream without uncompressing it. The destination array is described
+// by aBlock, and is filled in by a later call to _ctmUnpackInts().
 //-----------------------------------------------------------------------------
-int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData,
-  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+int _ctmStreamReadPackedBlock(_CTMcontext * self, _CTMpackedints * aBlock)
 {
-  int lzmaRes, lzmaAlgo;
-  CTMuint i, k;
+  // Read packed data size from the stream
+  aBlock->mPackedSize = _ctmStreamReadUINT(self);
+
+  // Read LZMA compression props from the stream
+  _ctmStreamRead(self, (void *) aBlock->mProps, 5);
+
+  // Allocate memory and read the packed data from the stream
+  aBlock->mPacked = (unsigned char *) malloc(aBlock->mPackedSize);
+  if(!aBlock->mPacked)
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+  if(_ctmStreamRead(self, (void *) aBlock->mPacked, aBlock->mPackedSize) != aBlock->mPackedSize)
+  {
+    self->mError = CTM_LZMA_ERROR;
+    return CTM_FALSE;
+  }
+  _ctmStreamProgress(self);
+
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmUnpackInts() - Uncompress a block that was read with
+// _ctmStreamReadPackedBlock(), and free its packed data. This function does
+// not touch the context, so several blocks can be unpacked concurrently.
+// Returns CTM_NONE on success, or an error code.
+//-----------------------------------------------------------------------------
+CTMenum _ctmUnpackInts(_CTMpackedints * aBlock)
+{
+  size_t packedSize, unpackedSize;
+  unsigned char * tmp;
+  int lzmaRes;
+
+  // Allocate memory for interleaved array
+  unpackedSize = aBlock->mCount * aBlock->mSize * 4;
+  tmp = (unsigned char *) malloc(unpackedSize);
+  if(!tmp)
+    return CTM_OUT_OF_MEMORY;
+
+  // Uncompress
+  packedSize = (size_t) aBlock->mPackedSize;
+  lzmaRes = LzmaUncompress(tmp, &unpackedSize, aBlock->mPacked,
+                           &packedSize, aBlock->mProps, 5);
+
+  // Free the packed array
+  free(aBlock->mPacked);
+  aBlock->mPacked = (unsigned char *) 0;
+
+  // Error?
+  if((lzmaRes != SZ_OK) || (unpackedSize != aBlock->mCount * aBlock->mSize * 4))
+  {
+    free(tmp);
+    return CTM_LZMA_ERROR;
+  }
+
+  // Convert interleaved array to integers
+  _ctmInterleavedToInts(tmp, aBlock->mData, aBlock->mCount, aBlock->mSize,
+                        aBlock->mSignedInts);
+
+  // Free the interleaved array
+  free(tmp);
+
+  return CTM_NONE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmPackInts() - Compress the integer array that is described by aBlock into
+// aBlock->mPacked. This function does not touch the context, so several blocks
+// can be packed concurrently. Returns CTM_NONE on success, or an error code.
+//-----------------------------------------------------------------------------
+CTMenum _ctmPackInts(_CTMpackedints * aBlock, CTMuint aLevel, CTMint aFast)
+{
+  int lzmaRes, lzmaAlgo, lzmaFb;
+  CTMuint i, k, count, size;
   CTMint value;
   size_t bufSize, outPropsSize;
-  unsigned char * packed, outProps[5], *tmp;
+  unsigned char * tmp;
 #ifdef __DEBUG_
-  CTMuint negCount = 0;  
+  CTMuint negCount = 0;
 #endif
 
+  count = aBlock->mCount;
+  size = aBlock->mSize;
+
   // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
+  tmp = (unsigned char *) malloc(count * size * 4);
   if(!tmp)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
+    return CTM_OUT_OF_MEMORY;
 
   // Convert integers to an interleaved array
-  for(i = 0; i < aCount; ++ i)
+  for(i = 0; i < count; ++ i)
   {
-    for(k = 0; k < aSize; ++ k)
+    for(k = 0; k < size; ++ k)
     {
-      value = aData[i * aSize + k];
+      value = aBlock->mData[i * size + k];
       // Convert two's complement to signed magnitude?
-      if(aSignedInts)
+      if(aBlock->mSignedInts)
         value = value < 0 ? -1 - (value << 1) : value << 1;
 #ifdef __DEBUG_
       else if(value < 0)
         ++ negCount;
 #endif
-      tmp[i + k * aCount + 3 * aCount * aSize] = value & 0x000000ff;
-      tmp[i + k * aCount + 2 * aCount * aSize] = (value >> 8) & 0x000000ff;
-      tmp[i + k * aCount + aCount * aSize] = (value >> 16) & 0x000000ff;
-      tmp[i + k * aCount] = (value >> 24) & 0x000000ff;
+      tmp[i + k * count + 3 * count * size] = value & 0x000000ff;
+      tmp[i + k * count + 2 * count * size] = (value >> 8) & 0x000000ff;
+      tmp[i + k * count + count * size] = (value >> 16) & 0x000000ff;
+      tmp[i + k * count] = (value >> 24) & 0x000000ff;
     }
   }
 
   // Allocate memory for the packed data
-  bufSize = 1000 + aCount * aSize * 4;
-  packed = (unsigned char *) malloc(bufSize);
-  if(!packed)
+  bufSize = 1000 + count * size * 4;
+  aBlock->mPacked = (unsigned char *) malloc(bufSize);
+  if(!aBlock->mPacked)
   {
     free(tmp);
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
+    return CTM_OUT_OF_MEMORY;
   }
 
-  // Call LZMA to compress
+  // Call LZMA to compress. The fast preset uses the hash chain match finder
+  // with short matches, which trades a few percent of the ratio for speed.
   outPropsSize = 5;
-  lzmaAlgo = (self->mCompressionLevel < 1 ? 0 : 1);
-  lzmaRes = LzmaCompress(packed,
+  lzmaAlgo = ((aLevel < 1) || aFast) ? 0 : 1;
+  lzmaFb = aFast ? 16 : -1;
+  lzmaRes = LzmaCompress(aBlock->mPacked,
                          &bufSize,
                          (const unsigned char *) tmp,
-                         aCount * aSize * 4,
-                         outProps,
+                         count * size * 4,
+                         aBlock->mProps,
                          &outPropsSize,
-                         self->mCompressionLevel, // Level (0-9)
-                         0, -1, -1, -1, -1, -1,   // Default values (set by level)
+                         aLevel,                  // Level (0-9)
+                         0, -1, -1, -1,           // Default values (set by level)
+                         lzmaFb,                  // Fast bytes (-1 = set by level)
+                         -1,                      // Default threads (set by level)
                          lzmaAlgo                 // Algorithm (0 = fast, 1 = normal)
                         );
 
@@ -320,26 +498,60 @@ int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData,
   // Error?
   if(lzmaRes != SZ_OK)
   {
-    self->mError = CTM_LZMA_ERROR;
-    free(packed);
-    return CTM_FALSE;
+    free(aBlock->mPacked);
+    aBlock->mPacked = (unsigned char *) 0;
+    return CTM_LZMA_ERROR;
   }
 
 #ifdef __DEBUG_
-  printf("%d->%d bytes (%d negative words)\n", aCount * aSize * 4, (int) bufSize, negCount);
+  printf("%d->%d bytes (%d negative words)\n", count * size * 4, (int) bufSize, negCount);
 #endif
 
+  aBlock->mPackedSize = (CTMuint) bufSize;
+  return CTM_NONE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamWritePackedBlock() - Write a block that was compressed with
+// _ctmPackInts() to a stream, and free its packed data.
+//-----------------------------------------------------------------------------
+void _ctmStreamWritePackedBlock(_CTMcontext * self, _CTMpackedints * aBlock)
+{
   // Write packed data size to the stream
-  _ctmStreamWriteUINT(self, (CTMuint) bufSize);
+  _ctmStreamWriteUINT(self, aBlock->mPackedSize);
 
   // Write LZMA compression props to the stream
-  _ctmStreamWrite(self, (void *) outProps, 5);
+  _ctmStreamWrite(self, (void *) aBlock->mProps, 5);
 
   // Write the packed data to the stream
-  _ctmStreamWrite(self, (void *) packed, (CTMuint) bufSize);
+  _ctmStreamWrite(self, (void *) aBlock->mPacked, aBlock->mPackedSize);
 
   // Free the packed data
-  free(packed);
+  free(aBlock->mPacked);
+  aBlock->mPacked = (unsigned char *) 0;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamWritePackedInts() - Compress a binary integer data array, and
+// write it to a stream.
+//-----------------------------------------------------------------------------
+int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  _CTMpackedints block;
+  CTMenum err;
+
+  block.mData = aData;
+  block.mCount = aCount;
+  block.mSize = aSize;
+  block.mSignedInts = aSignedInts;
+  err = _ctmPackInts(&block, self->mCompressionLevel, self->mFastCompression);
+  if(err != CTM_NONE)
+  {
+    self->mError = err;
+    return CTM_FALSE;
+  }
+  _ctmStreamWritePackedBlock(self, &block);
 
   return CTM_TRUE;
 }
@@ -352,51 +564,23 @@ int _ctmStreamReadPackedFloats(_CTMcontext * self, CTMfloat * aData,
   CTMuint aCount, CTMuint aSize)
 {
   CTMuint i, k;
-  size_t packedSize, unpackedSize;
   union {
     CTMfloat f;
     CTMint i;
   } value;
-  unsigned char * packed, * tmp;
-  unsigned char props[5];
-  int lzmaRes;
-
-  // Read packed data size from the stream
-  packedSize = (size_t) _ctmStreamReadUINT(self);
-
-  // Read LZMA compression props from the stream
-  _ctmStreamRead(self, (void *) props, 5);
-
-  // Allocate memory and read the packed data from the stream
-  packed = (unsigned char *) malloc(packedSize);
-  if(!packed)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
-  _ctmStreamRead(self, (void *) packed, packedSize);
+  unsigned char * tmp;
 
   // Allocate memory for interleaved array
   tmp = (unsigned char *) malloc(aCount * aSize * 4);
   if(!tmp)
   {
-    free(packed);
     self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
   }
 
-  // Uncompress
-  unpackedSize = aCount * aSize * 4;
-  lzmaRes = LzmaUncompress(tmp, &unpackedSize, packed,
-                           &packedSize, props, 5);
-
-  // Free the packed array
-  free(packed);
-
-  // Error?
-  if((lzmaRes != SZ_OK) || (unpackedSize != aCount * aSize * 4))
+  // Read and uncompress
+  if(!_ctmStreamReadLZMA(self, tmp, aCount * aSize * 4))
   {
-    self->mError = CTM_LZMA_ERROR;
     free(tmp);
     return CTM_FALSE;
   }
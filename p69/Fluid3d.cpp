@@ -48,6 +48,13 @@ static bool ExportMovie = false;
 static int ViewSamples = GridWidth*2;
 static int LightSamples = GridWidth;
 static float Fips = -4;
+static bool RecordFrames = false;
+static const char* CacheFilename = "Density96.vol";
+static VolumeRecorderPod Recording;
+static int RecordedFrames = 0;
+static VolumeStreamPod Playback;
+static int PlaybackPosition = 0;
+static std::vector<unsigned short> PlaybackFrame;
 
 PezConfig PezGetConfig()
 {
@@ -60,6 +67,15 @@ PezConfig PezGetConfig()
     return config;
 }
 
+static bool StartPlayback()
+{
+    if (!StartVolumeStream(&Playback, CacheFilename, 4))
+        return false;
+    PlaybackPosition = 0;
+    PlaybackFrame.resize(Playback.Width * Playback.Height * Playback.Depth);
+    return true;
+}
+
 void PezInitialize()
 {
     PezConfig cfg = PezGetConfig();
@@ -83,7 +99,15 @@ void PezInitialize()
     CreateObstacles(Surfaces.Obstacles);
     ClearSurface(Slabs.Temperature.Ping, AmbientTemperature);
 
-    if (!SimulateFluid)
+    // Frames are compressed on a background thread; a few can queue up while it catches up:
+    if (RecordFrames && SimulateFluid) {
+        bool created = StartVolumeRecorder(&Recording, CacheFilename, GridWidth, GridHeight, GridDepth, 8, 4);
+        PezCheckCondition(created, "Unable to create volume cache.");
+        RecordedFrames = 0;
+    }
+
+    // Play back a recording if there is one, else the single frame that WriteToFile dumps:
+    if (!SimulateFluid && !StartPlayback())
         ReadFromFile("Density96.dat", Slabs.Density.Ping);
 
     glDisable(GL_DEPTH_TEST);
@@ -224,6 +248,14 @@ void PezUpdate(unsigned int microseconds)
         }
         SubtractGradient(Slabs.Velocity.Ping, Slabs.Pressure.Ping, Surfaces.Obstacles, Slabs.Velocity.Pong);
         SwapSurfaces(&Slabs.Velocity);
+
+        if (Recording.State && !AppendToCache(&Recording, RecordedFrames++, Slabs.Density.Ping)) {
+            StopVolumeRecorder(&Recording);
+            PezDebugString("Unable to write %s; recording stopped.\n", CacheFilename);
+        }
+    } else if (Playback.State) {
+        if (GetStreamedFrame(&Playback, PlaybackPosition++, &PlaybackFrame[0]))
+            UploadHalves(Slabs.Density.Ping, &PlaybackFrame[0]);
     }
 
     if (ExportMovie) {
@@ -261,5 +293,15 @@ void PezHandleMouse(int x, int y, int action)
 void PezHandleKey(char c)
 {
     SimulateFluid = !SimulateFluid;
+
+    // Finish the recording and loop it back:
+    if (!SimulateFluid && Recording.State) {
+        if (!StopVolumeRecorder(&Recording))
+            PezDebugString("Unable to finish writing %s.\n", CacheFilename);
+        StartPlayback();
+    } else if (SimulateFluid && Playback.State) {
+        StopVolumeStream(&Playback);
+    }
+
     //WriteToFile("Density96.dat", Slabs.Density.Ping);
 }
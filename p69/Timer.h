@@ -0,0 +1,24 @@
+#pragma once
+
+// Wall-clock seconds since some fixed point, for timing loads and benchmarks.
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+inline double GetSeconds()
+{
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+}
+#else
+#include <sys/time.h>
+inline double GetSeconds()
+{
+    struct timeval tp;
+    gettimeofday(&tp, 0);
+    return tp.tv_sec + tp.tv_usec * 0.000001;
+}
+#endif
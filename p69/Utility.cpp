@@ -545,18 +545,34 @@ void WriteToFile(const char* filename, SurfacePod density)
     glBindTexture(GL_TEXTURE_3D, density.ColorTexture);
     glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_HALF_FLOAT, &cache[0]);
     FILE* voxelsFile = fopen(filename, "wb");
+    PezCheckCondition(voxelsFile != 0, "Unable to dump out volume texture.");
     size_t bytesWritten = fwrite(&cache[0], 1, requiredBytes, voxelsFile);
+    fclose(voxelsFile);
     PezCheckCondition(bytesWritten == requiredBytes, "Unable to dump out volume texture.");
 }
 
 void ReadFromFile(const char* filename, SurfacePod density)
 {
     size_t requiredBytes = density.Width * density.Height * density.Depth * 2;
-    std::vector<unsigned char> cache(requiredBytes);
+    std::vector<unsigned short> cache(requiredBytes / 2);
     FILE* voxelsFile = fopen(filename, "rb");
+    PezCheckCondition(voxelsFile != 0, "Unable to slurp up volume texture.");
     size_t bytesRead = fread(&cache[0], 1, requiredBytes, voxelsFile);
+    fclose(voxelsFile);
     PezCheckCondition(bytesRead == requiredBytes, "Unable to slurp up volume texture.");
+    UploadHalves(density, &cache[0]);
+}
 
+bool AppendToCache(VolumeRecorderPod* recorder, int frameIndex, SurfacePod density)
+{
+    std::vector<unsigned short> halves(density.Width * density.Height * density.Depth);
+    glBindTexture(GL_TEXTURE_3D, density.ColorTexture);
+    glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_HALF_FLOAT, &halves[0]);
+    return RecordVolumeFrame(recorder, frameIndex, &halves[0]);
+}
+
+void UploadHalves(SurfacePod density, const unsigned short* halves)
+{
     glBindTexture(GL_TEXTURE_3D, density.ColorTexture);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, density.Width, density.Height, density.Depth, 0, GL_RED, GL_HALF_FLOAT, &cache[0]);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, density.Width, density.Height, density.Depth, 0, GL_RED, GL_HALF_FLOAT, halves);
 }
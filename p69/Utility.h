@@ -3,6 +3,7 @@
 #include <vmath.hpp>
 #include <pez.h>
 #include <glew.h>
+#include "VolumeCache.h"
 
 enum AttributeSlot {
     SlotPosition,
@@ -55,6 +56,8 @@ void ApplyImpulse(SurfacePod dest, vmath::Vector3 position, float value);
 void ApplyBuoyancy(SurfacePod velocity, SurfacePod temperature, SurfacePod density, SurfacePod dest);
 void WriteToFile(const char* filename, SurfacePod density);
 void ReadFromFile(const char* filename, SurfacePod density);
+bool AppendToCache(VolumeRecorderPod* recorder, int frameIndex, SurfacePod density);
+void UploadHalves(SurfacePod density, const unsigned short* halves);
 TexturePod OverlayText(std::string message);
 void ExportScreenshot(const char* filename);
 
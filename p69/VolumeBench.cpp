@@ -0,0 +1,211 @@
+// Headless check of the volume cache.  Records a sequence of synthetic 96^3 density frames
+// (a few soft blobs rising through the box), then reports the compression ratio, encode and
+// decode rates, and the worst quantization error for 8 and 16 bits.  Checks that random
+// access matches sequential reads, that streamed playback (looping, and after a seek) matches
+// both, that recording on a background thread writes the same file as appending inline, and
+// that a recording that was never closed gets its index back.
+// Usage: VolumeBench [frameCount]
+
+#include "VolumeCache.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+static const int Size = 96;
+static const char* Filename = "VolumeBench.vol";
+
+typedef std::vector<unsigned short> Frame;
+
+static Frame CreateFrame(int frameIndex)
+{
+    Frame frame(Size * Size * Size);
+    for (int z = 0; z < Size; ++z)
+        for (int y = 0; y < Size; ++y)
+            for (int x = 0; x < Size; ++x) {
+                float density = 0;
+                for (int blob = 0; blob < 3; ++blob) {
+                    float cx = 48 + 14 * std::sin(0.05f * frameIndex + 2.1f * blob);
+                    float cy = std::fmod(10 + 1.5f * frameIndex + 30 * blob, 96.0f);
+                    float cz = 48 + 14 * std::cos(0.07f * frameIndex + 1.3f * blob);
+                    float dx = x - cx, dy = y - cy, dz = z - cz;
+                    float d2 = dx * dx + dy * dy + dz * dz;
+                    if (d2 < 18 * 18)
+                        density += std::exp(-d2 / 60.0f);
+                }
+                frame[(z * Size + y) * Size + x] = FloatToHalf(density);
+            }
+    return frame;
+}
+
+static long GetFileSize(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// Largest difference between two frames, and the largest value of the first.
+static float GetMaxError(const Frame& a, const Frame& b, float* maxValue)
+{
+    float error = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        float v = HalfToFloat(a[i]);
+        *maxValue = std::max(*maxValue, v);
+        error = std::max(error, std::fabs(v - HalfToFloat(b[i])));
+    }
+    return error;
+}
+
+static bool TestQuantization(const std::vector<Frame>& frames, int quantizeBits)
+{
+    int frameCount = (int) frames.size();
+    double rawBytes = (double) frameCount * Size * Size * Size * sizeof(unsigned short);
+
+    VolumeCachePod cache;
+    double start = GetSeconds();
+    bool written = CreateVolumeCache(&cache, Filename, Size, Size, Size, quantizeBits);
+    for (int i = 0; i < frameCount && written; ++i)
+        written = AppendVolumeFrame(&cache, i, &frames[i][0]);
+    written = CloseVolumeCache(&cache) && written;
+    double encodeTime = GetSeconds() - start;
+    long fileBytes = GetFileSize(Filename);
+
+    // Sequential reads, then the same frames backwards:
+    std::vector<Frame> decoded(frameCount, Frame(Size * Size * Size));
+    bool opened = OpenVolumeCache(&cache, Filename) && (int) cache.Index.size() == frameCount;
+    bool read = opened;
+    start = GetSeconds();
+    for (int i = 0; i < frameCount && read; ++i)
+        read = ReadVolumeFrame(&cache, i, &decoded[i][0]);
+    double decodeTime = GetSeconds() - start;
+
+    bool identical = read;
+    Frame frame(Size * Size * Size);
+    for (int i = frameCount - 1; i >= 0 && identical; --i)
+        identical = ReadVolumeFrame(&cache, i, &frame[0]) && frame == decoded[i];
+    if (opened)
+        CloseVolumeCache(&cache);
+
+    // Each brick is quantized within its own range, which is at most the largest value; the
+    // result is then rounded to a half.
+    float maxError = 0, maxValue = 0;
+    for (int i = 0; i < frameCount && read; ++i)
+        maxError = std::max(maxError, GetMaxError(frames[i], decoded[i], &maxValue));
+    float tolerance = maxValue * (0.5f / ((1 << quantizeBits) - 1) + 1.0f / 2048);
+
+    printf("%2d bits: %.1f MB -> %.2f MB (%.1f:1), encode %.0f MB/s, decode %.0f MB/s, max error %g (tolerance %g), random access %s\n",
+        quantizeBits, rawBytes / 1e6, fileBytes / 1e6, rawBytes / fileBytes,
+        rawBytes / 1e6 / encodeTime, rawBytes / 1e6 / decodeTime, maxError, tolerance,
+        identical ? "identical" : "MISMATCH");
+
+    bool passed = written && read && identical && maxError <= tolerance;
+    if (!passed || quantizeBits != 8)
+        return passed;
+
+    // Play the recording twice through the stream, jump back to the middle, and compare:
+    VolumeStreamPod stream;
+    if (!StartVolumeStream(&stream, Filename, 4))
+        return false;
+    bool streamed = stream.FrameCount == frameCount;
+    start = GetSeconds();
+    for (int position = 0; position < 2 * frameCount && streamed; ++position)
+        streamed = GetStreamedFrame(&stream, position, &frame[0]) && frame == decoded[position % frameCount];
+    double streamTime = GetSeconds() - start;
+    for (int position = frameCount / 2; position < frameCount && streamed; ++position)
+        streamed = GetStreamedFrame(&stream, position, &frame[0]) && frame == decoded[position];
+    StopVolumeStream(&stream);
+    printf("Streamed playback: %.0f frames/s, %s\n", 2 * frameCount / streamTime, streamed ? "identical" : "MISMATCH");
+    return streamed;
+}
+
+static std::vector<char> ReadWholeFile(const char* path)
+{
+    std::vector<char> contents(GetFileSize(path));
+    FILE* file = fopen(path, "rb");
+    if (file) {
+        if (!contents.empty() && fread(&contents[0], 1, contents.size(), file) != contents.size())
+            contents.clear();
+        fclose(file);
+    }
+    return contents;
+}
+
+// Records through the background writer, and checks that the file matches one written inline.
+// Reports how long each call to record a frame held up the caller.
+static bool TestRecorder(const std::vector<Frame>& frames)
+{
+    int frameCount = (int) frames.size();
+    VolumeCachePod cache;
+    double start = GetSeconds();
+    bool written = CreateVolumeCache(&cache, Filename, Size, Size, Size, 8);
+    for (int i = 0; i < frameCount && written; ++i)
+        written = AppendVolumeFrame(&cache, i, &frames[i][0]);
+    written = CloseVolumeCache(&cache) && written;
+    double inlineTime = GetSeconds() - start;
+    std::vector<char> expected = ReadWholeFile(Filename);
+    remove(Filename);
+
+    VolumeRecorderPod recorder;
+    double blockedTime = 0;
+    bool recorded = StartVolumeRecorder(&recorder, Filename, Size, Size, Size, 8, 4);
+    for (int i = 0; i < frameCount && recorded; ++i) {
+        start = GetSeconds();
+        recorded = RecordVolumeFrame(&recorder, i, &frames[i][0]);
+        blockedTime += GetSeconds() - start;
+    }
+    recorded = StopVolumeRecorder(&recorder) && recorded;
+
+    bool identical = written && recorded && !expected.empty() && ReadWholeFile(Filename) == expected;
+    printf("Background recording: %.1f ms per frame in the caller (%.1f ms inline), %s\n",
+        1000 * blockedTime / frameCount, 1000 * inlineTime / frameCount, identical ? "identical" : "MISMATCH");
+    return identical;
+}
+
+// Leaves the index unwritten, as when the app quits while recording.
+static bool TestRecovery(const std::vector<Frame>& frames)
+{
+    VolumeCachePod cache;
+    int frameCount = std::min((int) frames.size(), 5);
+    bool written = CreateVolumeCache(&cache, Filename, Size, Size, Size, 8);
+    for (int i = 0; i < frameCount && written; ++i)
+        written = AppendVolumeFrame(&cache, i, &frames[i][0]);
+    if (cache.File)
+        fclose(cache.File);
+
+    Frame frame(Size * Size * Size);
+    bool recovered = written && OpenVolumeCache(&cache, Filename);
+    if (recovered) {
+        recovered = (int) cache.Index.size() == frameCount && ReadVolumeFrame(&cache, frameCount - 1, &frame[0]);
+        CloseVolumeCache(&cache);
+    }
+    printf("Unclosed recording: %s\n", recovered ? "index rebuilt" : "MISMATCH");
+    return recovered;
+}
+
+int main(int argc, char** argv)
+{
+    int frameCount = argc > 1 ? atoi(argv[1]) : 60;
+    if (frameCount < 1) {
+        printf("Usage: VolumeBench [frameCount]\n");
+        return 1;
+    }
+
+    std::vector<Frame> frames(frameCount);
+    for (int i = 0; i < frameCount; ++i)
+        frames[i] = CreateFrame(i);
+
+    bool passed = TestQuantization(frames, 8);
+    passed = TestQuantization(frames, 16) && passed;
+    passed = TestRecorder(frames) && passed;
+    passed = TestRecovery(frames) && passed;
+    remove(Filename);
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,716 @@
+#include "VolumeCache.h"
+#include "lzma/LzmaLib.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+static const char Magic[4] = { 'V', 'O', 'L', 'C' };
+static const unsigned int Version = 1;
+
+// LZMA settings for frames: the fast mode, with a dictionary that holds a whole 96^3 frame.
+static const int CompressionLevel = 3;
+static const unsigned DictionarySize = 1 << 20;
+
+float HalfToFloat(unsigned short h)
+{
+    unsigned int sign = (h & 0x8000) << 16;
+    unsigned int exponent = (h >> 10) & 0x1f;
+    unsigned int mantissa = h & 0x3ff;
+    unsigned int u;
+    if (exponent == 0x1f) {
+        u = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent) {
+        u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa) {
+        // Renormalize the denormal:
+        exponent = 113;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        u = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    } else {
+        u = sign;
+    }
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+unsigned short FloatToHalf(float f)
+{
+    unsigned int u;
+    memcpy(&u, &f, sizeof(u));
+    unsigned int sign = (u >> 16) & 0x8000;
+    int exponent = (int) ((u >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = u & 0x7fffff;
+
+    if (((u >> 23) & 0xff) == 0xff)
+        return (unsigned short) (sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return (unsigned short) (sign | 0x7c00);
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return (unsigned short) sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+            ++half;
+        return (unsigned short) (sign | half);
+    }
+
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        ++half;
+    return (unsigned short) half;
+}
+
+static bool Seek(FILE* file, unsigned long long offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (__int64) offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t) offset, SEEK_SET) == 0;
+#endif
+}
+
+static unsigned long long Tell(FILE* file)
+{
+#ifdef _WIN32
+    return (unsigned long long) _ftelli64(file);
+#else
+    return (unsigned long long) ftello(file);
+#endif
+}
+
+// Calls visit(brick, x0, y0, z0, x1, y1, z1) for each brick, in scanline order; bricks on the
+// far sides are cut short when the grid isn't a multiple of the brick size.
+template<class Visit>
+static void ForEachBrick(const VolumeCacheHeader& header, Visit& visit)
+{
+    int size = header.BrickSize;
+    int brick = 0;
+    for (int z0 = 0; z0 < (int) header.Depth; z0 += size)
+        for (int y0 = 0; y0 < (int) header.Height; y0 += size)
+            for (int x0 = 0; x0 < (int) header.Width; x0 += size)
+                visit(brick++, x0, y0, z0,
+                    std::min(x0 + size, (int) header.Width),
+                    std::min(y0 + size, (int) header.Height),
+                    std::min(z0 + size, (int) header.Depth));
+}
+
+static int GetBrickCount(const VolumeCacheHeader& header)
+{
+    int size = header.BrickSize;
+    return ((header.Width + size - 1) / size) * ((header.Height + size - 1) / size) * ((header.Depth + size - 1) / size);
+}
+
+// Finds the range of each brick, so it can be written ahead of the values.
+struct RangeVisitor {
+    const VolumeCacheHeader* Header;
+    const unsigned short* Halves;
+    float* Ranges;
+
+    void operator()(int brick, int x0, int y0, int z0, int x1, int y1, int z1)
+    {
+        float lo = HalfToFloat(Halves[(z0 * Header->Height + y0) * Header->Width + x0]);
+        float hi = lo;
+        for (int z = z0; z < z1; ++z)
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x) {
+                    float v = HalfToFloat(Halves[(z * Header->Height + y) * Header->Width + x]);
+                    lo = std::min(lo, v);
+                    hi = std::max(hi, v);
+                }
+        Ranges[brick * 2] = lo;
+        Ranges[brick * 2 + 1] = hi;
+    }
+};
+
+struct QuantizeVisitor {
+    const VolumeCacheHeader* Header;
+    const unsigned short* Halves;
+    const float* Ranges;
+    std::vector<unsigned char>* Raw;
+
+    void operator()(int brick, int x0, int y0, int z0, int x1, int y1, int z1)
+    {
+        float lo = Ranges[brick * 2], hi = Ranges[brick * 2 + 1];
+        if (!(hi > lo))
+            return;
+        unsigned int top = (1u << Header->QuantizeBits) - 1;
+        float scale = top / (hi - lo);
+        for (int z = z0; z < z1; ++z)
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x) {
+                    float v = HalfToFloat(Halves[(z * Header->Height + y) * Header->Width + x]);
+                    unsigned int q = std::min((unsigned int) ((v - lo) * scale + 0.5f), top);
+                    Raw->push_back((unsigned char) q);
+                    if (Header->QuantizeBits > 8)
+                        Raw->push_back((unsigned char) (q >> 8));
+                }
+    }
+};
+
+struct DequantizeVisitor {
+    const VolumeCacheHeader* Header;
+    const float* Ranges;
+    const unsigned char* Values;
+    const unsigned char* End;
+    unsigned short* Halves;
+    bool Overrun;
+
+    void operator()(int brick, int x0, int y0, int z0, int x1, int y1, int z1)
+    {
+        float lo = Ranges[brick * 2], hi = Ranges[brick * 2 + 1];
+        bool constant = !(hi > lo);
+        int valueBytes = Header->QuantizeBits > 8 ? 2 : 1;
+        size_t count = (size_t) (x1 - x0) * (y1 - y0) * (z1 - z0);
+        if (!constant && (size_t) (End - Values) < count * valueBytes) {
+            Overrun = true;
+            return;
+        }
+
+        unsigned short fill = FloatToHalf(lo);
+        float step = constant ? 0 : (hi - lo) / ((1u << Header->QuantizeBits) - 1);
+        for (int z = z0; z < z1; ++z)
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x) {
+                    unsigned short* dest = &Halves[(z * Header->Height + y) * Header->Width + x];
+                    if (constant) {
+                        *dest = fill;
+                        continue;
+                    }
+                    unsigned int q = Values[0];
+                    if (valueBytes > 1)
+                        q |= Values[1] << 8;
+                    Values += valueBytes;
+                    *dest = FloatToHalf(lo + q * step);
+                }
+    }
+};
+
+bool CreateVolumeCache(VolumeCachePod* cache, const char* path, int width, int height, int depth, int quantizeBits)
+{
+    VolumeCacheHeader& header = cache->Header;
+    memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = Version;
+    header.Width = width;
+    header.Height = height;
+    header.Depth = depth;
+    header.BrickSize = VolumeBrickSize;
+    header.ValueType = VolumeHalf;
+    header.QuantizeBits = quantizeBits > 8 ? 16 : 8;
+    header.FrameCount = 0;
+    header.Reserved = 0;
+    header.IndexOffset = 0;
+    cache->Index.clear();
+    cache->Writing = true;
+
+    cache->File = fopen(path, "wb");
+    if (!cache->File)
+        return false;
+    if (fwrite(&header, sizeof(header), 1, cache->File) != 1) {
+        fclose(cache->File);
+        cache->File = 0;
+        return false;
+    }
+    return true;
+}
+
+bool AppendVolumeFrame(VolumeCachePod* cache, int frameIndex, const unsigned short* halves)
+{
+    const VolumeCacheHeader& header = cache->Header;
+    int brickCount = GetBrickCount(header);
+    std::vector<float> ranges(brickCount * 2);
+    RangeVisitor rangeVisitor = { &header, halves, &ranges[0] };
+    ForEachBrick(header, rangeVisitor);
+
+    std::vector<unsigned char> raw(ranges.size() * sizeof(float));
+    memcpy(&raw[0], &ranges[0], raw.size());
+    raw.reserve(raw.size() + (size_t) header.Width * header.Height * header.Depth * (header.QuantizeBits / 8));
+    QuantizeVisitor quantizeVisitor = { &header, halves, &ranges[0], &raw };
+    ForEachBrick(header, quantizeVisitor);
+
+    VolumeFrameHeader frame;
+    memset(&frame, 0, sizeof(frame));
+    size_t packedBytes = raw.size() + raw.size() / 3 + 128;
+    size_t propertiesSize = sizeof(frame.Properties);
+    std::vector<unsigned char> packed(packedBytes);
+    int result = LzmaCompress(&packed[0], &packedBytes, &raw[0], raw.size(), frame.Properties, &propertiesSize,
+        CompressionLevel, DictionarySize, -1, -1, -1, -1, 1, 0);
+    if (result != SZ_OK)
+        return false;
+
+    frame.FrameIndex = frameIndex;
+    frame.RawBytes = (unsigned int) raw.size();
+    frame.PackedBytes = (unsigned int) packedBytes;
+
+    VolumeIndexEntry entry;
+    entry.Offset = Tell(cache->File);
+    entry.FrameIndex = frameIndex;
+    entry.Reserved = 0;
+    if (fwrite(&frame, sizeof(frame), 1, cache->File) != 1 ||
+        fwrite(&packed[0], 1, packedBytes, cache->File) != packedBytes)
+        return false;
+
+    cache->Index.push_back(entry);
+    cache->Header.FrameCount = (unsigned int) cache->Index.size();
+    return true;
+}
+
+static bool ByFrameIndex(const VolumeIndexEntry& a, const VolumeIndexEntry& b)
+{
+    return a.FrameIndex < b.FrameIndex;
+}
+
+// Walks the frame headers of a cache whose index never got written.  A frame that was only
+// partly written ends the walk.
+static void RebuildIndex(VolumeCachePod* cache)
+{
+    Seek(cache->File, 0);
+    fseek(cache->File, 0, SEEK_END);
+    unsigned long long fileSize = Tell(cache->File);
+    unsigned long long offset = sizeof(VolumeCacheHeader);
+
+    cache->Index.clear();
+    VolumeFrameHeader frame;
+    while (offset + sizeof(frame) <= fileSize && Seek(cache->File, offset) &&
+        fread(&frame, sizeof(frame), 1, cache->File) == 1) {
+        unsigned long long next = offset + sizeof(frame) + frame.PackedBytes;
+        if (next > fileSize)
+            break;
+        VolumeIndexEntry entry = { offset, frame.FrameIndex, 0 };
+        cache->Index.push_back(entry);
+        offset = next;
+    }
+}
+
+bool OpenVolumeCache(VolumeCachePod* cache, const char* path)
+{
+    cache->Writing = false;
+    cache->Index.clear();
+    cache->File = fopen(path, "rb");
+    if (!cache->File)
+        return false;
+
+    VolumeCacheHeader& header = cache->Header;
+    bool valid = fread(&header, sizeof(header), 1, cache->File) == 1 &&
+        !memcmp(header.Magic, Magic, sizeof(Magic)) && header.Version == Version &&
+        header.ValueType == VolumeHalf && header.BrickSize > 0 &&
+        (header.QuantizeBits == 8 || header.QuantizeBits == 16);
+    if (!valid) {
+        fclose(cache->File);
+        cache->File = 0;
+        return false;
+    }
+
+    if (header.IndexOffset) {
+        cache->Index.resize(header.FrameCount);
+        if (header.FrameCount && (!Seek(cache->File, header.IndexOffset) ||
+            fread(&cache->Index[0], sizeof(VolumeIndexEntry), header.FrameCount, cache->File) != header.FrameCount))
+            RebuildIndex(cache);
+    } else {
+        RebuildIndex(cache);
+    }
+
+    std::stable_sort(cache->Index.begin(), cache->Index.end(), ByFrameIndex);
+    header.FrameCount = (unsigned int) cache->Index.size();
+    return true;
+}
+
+bool ReadVolumeFrame(VolumeCachePod* cache, int frameIndex, unsigned short* halves)
+{
+    VolumeIndexEntry key = { 0, (unsigned int) frameIndex, 0 };
+    std::vector<VolumeIndexEntry>::const_iterator entry =
+        std::lower_bound(cache->Index.begin(), cache->Index.end(), key, ByFrameIndex);
+    if (entry == cache->Index.end() || entry->FrameIndex != (unsigned int) frameIndex)
+        return false;
+
+    VolumeFrameHeader frame;
+    if (!Seek(cache->File, entry->Offset) || fread(&frame, sizeof(frame), 1, cache->File) != 1 ||
+        frame.FrameIndex != (unsigned int) frameIndex)
+        return false;
+
+    std::vector<unsigned char> packed(frame.PackedBytes);
+    if (frame.PackedBytes && fread(&packed[0], 1, frame.PackedBytes, cache->File) != frame.PackedBytes)
+        return false;
+
+    const VolumeCacheHeader& header = cache->Header;
+    size_t rangeBytes = GetBrickCount(header) * 2 * sizeof(float);
+    if (frame.RawBytes < rangeBytes)
+        return false;
+
+    std::vector<unsigned char> raw(frame.RawBytes);
+    size_t rawBytes = raw.size();
+    size_t packedBytes = packed.size();
+    int result = LzmaUncompress(&raw[0], &rawBytes, packed.empty() ? 0 : &packed[0], &packedBytes,
+        frame.Properties, sizeof(frame.Properties));
+    if (result != SZ_OK || rawBytes != raw.size())
+        return false;
+
+    std::vector<float> ranges(GetBrickCount(header) * 2);
+    memcpy(&ranges[0], &raw[0], rangeBytes);
+    DequantizeVisitor visitor = { &header, &ranges[0], &raw[0] + rangeBytes, &raw[0] + raw.size(), halves, false };
+    ForEachBrick(header, visitor);
+    return !visitor.Overrun;
+}
+
+bool CloseVolumeCache(VolumeCachePod* cache)
+{
+    if (!cache->File)
+        return false;
+
+    bool closed = true;
+    if (cache->Writing) {
+        VolumeCacheHeader& header = cache->Header;
+        header.IndexOffset = Tell(cache->File);
+        header.FrameCount = (unsigned int) cache->Index.size();
+        closed = (cache->Index.empty() ||
+            fwrite(&cache->Index[0], sizeof(VolumeIndexEntry), cache->Index.size(), cache->File) == cache->Index.size()) &&
+            Seek(cache->File, 0) && fwrite(&header, sizeof(header), 1, cache->File) == 1;
+    }
+
+    closed = fclose(cache->File) == 0 && closed;
+    cache->File = 0;
+    return closed;
+}
+
+// The read-ahead thread decodes positions Next, Next + 1, ... into the ring while fewer than
+// AheadCount of them are waiting to be played.  Slot i holds the position in Positions[i].
+// Seeking bumps Generation, so a frame decoded for the old position gets dropped.
+struct VolumeStreamState {
+    VolumeCachePod Cache;
+    int FrameSize;
+    int AheadCount;
+    std::vector<unsigned short> Ring;
+    std::vector<int> Positions;
+    int Wanted;
+    int Next;
+    int Generation;
+    bool Failed;
+    bool Stopping;
+#ifdef _WIN32
+    CRITICAL_SECTION Lock;
+    CONDITION_VARIABLE Changed;
+    HANDLE Thread;
+#else
+    pthread_mutex_t Lock;
+    pthread_cond_t Changed;
+    pthread_t Thread;
+#endif
+};
+
+// Both background threads (read-ahead and recording) share their state with the caller
+// through a Lock, a Changed condition, and a Thread handle:
+#ifdef _WIN32
+typedef DWORD (WINAPI* WorkerFunction)(LPVOID);
+template <typename T> static void Lock(T* state) { EnterCriticalSection(&state->Lock); }
+template <typename T> static void Unlock(T* state) { LeaveCriticalSection(&state->Lock); }
+template <typename T> static void Wait(T* state) { SleepConditionVariableCS(&state->Changed, &state->Lock, INFINITE); }
+template <typename T> static void Signal(T* state) { WakeAllConditionVariable(&state->Changed); }
+#else
+typedef void* (*WorkerFunction)(void*);
+template <typename T> static void Lock(T* state) { pthread_mutex_lock(&state->Lock); }
+template <typename T> static void Unlock(T* state) { pthread_mutex_unlock(&state->Lock); }
+template <typename T> static void Wait(T* state) { pthread_cond_wait(&state->Changed, &state->Lock); }
+template <typename T> static void Signal(T* state) { pthread_cond_broadcast(&state->Changed); }
+#endif
+
+template <typename T> static bool StartWorker(T* state, WorkerFunction function)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&state->Lock);
+    InitializeConditionVariable(&state->Changed);
+    state->Thread = CreateThread(0, 0, function, state, 0, 0);
+    return state->Thread != 0;
+#else
+    pthread_mutex_init(&state->Lock, 0);
+    pthread_cond_init(&state->Changed, 0);
+    return pthread_create(&state->Thread, 0, function, state) == 0;
+#endif
+}
+
+// Sets Stopping and waits for the thread to see it.
+template <typename T> static void StopWorker(T* state)
+{
+    Lock(state);
+    state->Stopping = true;
+    Signal(state);
+    Unlock(state);
+
+#ifdef _WIN32
+    WaitForSingleObject(state->Thread, INFINITE);
+    CloseHandle(state->Thread);
+    DeleteCriticalSection(&state->Lock);
+#else
+    pthread_join(state->Thread, 0);
+    pthread_mutex_destroy(&state->Lock);
+    pthread_cond_destroy(&state->Changed);
+#endif
+}
+
+static void ReadAhead(VolumeStreamState* state)
+{
+    std::vector<unsigned short> frame(state->FrameSize);
+    int frameCount = (int) state->Cache.Index.size();
+
+    Lock(state);
+    for (;;) {
+        while (!state->Stopping && (state->Failed || state->Next - state->Wanted >= state->AheadCount))
+            Wait(state);
+        if (state->Stopping)
+            break;
+
+        int position = state->Next;
+        int generation = state->Generation;
+        Unlock(state);
+        int frameIndex = state->Cache.Index[position % frameCount].FrameIndex;
+        bool decoded = ReadVolumeFrame(&state->Cache, frameIndex, &frame[0]);
+        Lock(state);
+
+        if (generation != state->Generation)
+            continue;
+        if (decoded) {
+            int slot = position % state->AheadCount;
+            std::copy(frame.begin(), frame.end(), state->Ring.begin() + (size_t) slot * state->FrameSize);
+            state->Positions[slot] = position;
+            ++state->Next;
+        } else {
+            state->Failed = true;
+        }
+        Signal(state);
+    }
+    Unlock(state);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI ReadAheadThread(LPVOID state)
+{
+    ReadAhead((VolumeStreamState*) state);
+    return 0;
+}
+#else
+static void* ReadAheadThread(void* state)
+{
+    ReadAhead((VolumeStreamState*) state);
+    return 0;
+}
+#endif
+
+bool StartVolumeStream(VolumeStreamPod* stream, const char* path, int aheadCount)
+{
+    stream->State = 0;
+    VolumeStreamState* state = new VolumeStreamState;
+    if (!OpenVolumeCache(&state->Cache, path) || state->Cache.Index.empty()) {
+        CloseVolumeCache(&state->Cache);
+        delete state;
+        return false;
+    }
+
+    const VolumeCacheHeader& header = state->Cache.Header;
+    stream->Width = header.Width;
+    stream->Height = header.Height;
+    stream->Depth = header.Depth;
+    stream->FrameCount = (int) state->Cache.Index.size();
+
+    state->FrameSize = header.Width * header.Height * header.Depth;
+    state->AheadCount = std::max(aheadCount, 1);
+    state->Ring.resize((size_t) state->AheadCount * state->FrameSize);
+    state->Positions.assign(state->AheadCount, -1);
+    state->Wanted = 0;
+    state->Next = 0;
+    state->Generation = 0;
+    state->Failed = false;
+    state->Stopping = false;
+
+    if (!StartWorker(state, ReadAheadThread)) {
+        CloseVolumeCache(&state->Cache);
+        delete state;
+        return false;
+    }
+    stream->State = state;
+    return true;
+}
+
+bool GetStreamedFrame(VolumeStreamPod* stream, int position, unsigned short* halves)
+{
+    VolumeStreamState* state = stream->State;
+    if (!state || position < 0)
+        return false;
+
+    int slot = position % state->AheadCount;
+    Lock(state);
+    bool buffered = state->Positions[slot] == position;
+    bool upcoming = position >= state->Wanted && position <= state->Next;
+    if (!buffered && !upcoming) {
+        ++state->Generation;
+        state->Next = position;
+        state->Failed = false;
+        std::fill(state->Positions.begin(), state->Positions.end(), -1);
+    }
+    state->Wanted = position;
+    Signal(state);
+
+    while (state->Positions[slot] != position && !state->Failed)
+        Wait(state);
+    bool found = state->Positions[slot] == position;
+    if (found) {
+        const unsigned short* source = &state->Ring[(size_t) slot * state->FrameSize];
+        std::copy(source, source + state->FrameSize, halves);
+    }
+    Unlock(state);
+    return found;
+}
+
+void StopVolumeStream(VolumeStreamPod* stream)
+{
+    VolumeStreamState* state = stream->State;
+    if (!state)
+        return;
+
+    StopWorker(state);
+    CloseVolumeCache(&state->Cache);
+    delete state;
+    stream->State = 0;
+}
+
+// The recording thread appends frames Written, Written + 1, ... up to Queued from a ring of
+// QueueCount slots; frame number n waits in slot n % QueueCount.  After a failed write, frames
+// are still taken off the queue but dropped.
+struct VolumeRecorderState {
+    VolumeCachePod Cache;
+    int FrameSize;
+    int QueueCount;
+    std::vector<unsigned short> Ring;
+    std::vector<int> FrameIndices;
+    int Queued;
+    int Written;
+    bool Failed;
+    bool Stopping;
+#ifdef _WIN32
+    CRITICAL_SECTION Lock;
+    CONDITION_VARIABLE Changed;
+    HANDLE Thread;
+#else
+    pthread_mutex_t Lock;
+    pthread_cond_t Changed;
+    pthread_t Thread;
+#endif
+};
+
+static void WriteBehind(VolumeRecorderState* state)
+{
+    Lock(state);
+    for (;;) {
+        while (!state->Stopping && state->Written == state->Queued)
+            Wait(state);
+        if (state->Written == state->Queued)
+            break;
+
+        int slot = state->Written % state->QueueCount;
+        bool failed = state->Failed;
+        Unlock(state);
+        bool appended = failed || AppendVolumeFrame(&state->Cache, state->FrameIndices[slot],
+            &state->Ring[(size_t) slot * state->FrameSize]);
+        Lock(state);
+
+        state->Failed = state->Failed || !appended;
+        ++state->Written;
+        Signal(state);
+    }
+    Unlock(state);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI WriteBehindThread(LPVOID state)
+{
+    WriteBehind((VolumeRecorderState*) state);
+    return 0;
+}
+#else
+static void* WriteBehindThread(void* state)
+{
+    WriteBehind((VolumeRecorderState*) state);
+    return 0;
+}
+#endif
+
+bool StartVolumeRecorder(VolumeRecorderPod* recorder, const char* path, int width, int height, int depth,
+    int quantizeBits, int queueCount)
+{
+    recorder->State = 0;
+    VolumeRecorderState* state = new VolumeRecorderState;
+    if (!CreateVolumeCache(&state->Cache, path, width, height, depth, quantizeBits)) {
+        delete state;
+        return false;
+    }
+
+    state->FrameSize = width * height * depth;
+    state->QueueCount = std::max(queueCount, 1);
+    state->Ring.resize((size_t) state->QueueCount * state->FrameSize);
+    state->FrameIndices.assign(state->QueueCount, -1);
+    state->Queued = 0;
+    state->Written = 0;
+    state->Failed = false;
+    state->Stopping = false;
+
+    if (!StartWorker(state, WriteBehindThread)) {
+        CloseVolumeCache(&state->Cache);
+        delete state;
+        return false;
+    }
+    recorder->State = state;
+    return true;
+}
+
+bool RecordVolumeFrame(VolumeRecorderPod* recorder, int frameIndex, const unsigned short* halves)
+{
+    VolumeRecorderState* state = recorder->State;
+    if (!state)
+        return false;
+
+    Lock(state);
+    while (!state->Failed && state->Queued - state->Written >= state->QueueCount)
+        Wait(state);
+    bool failed = state->Failed;
+    Unlock(state);
+    if (failed)
+        return false;
+
+    // Only this thread moves Queued, and the writer doesn't touch the slot until it does:
+    int slot = state->Queued % state->QueueCount;
+    std::copy(halves, halves + state->FrameSize, state->Ring.begin() + (size_t) slot * state->FrameSize);
+    state->FrameIndices[slot] = frameIndex;
+
+    Lock(state);
+    ++state->Queued;
+    Signal(state);
+    Unlock(state);
+    return true;
+}
+
+bool StopVolumeRecorder(VolumeRecorderPod* recorder)
+{
+    VolumeRecorderState* state = recorder->State;
+    if (!state)
+        return false;
+
+    StopWorker(state);
+    bool closed = CloseVolumeCache(&state->Cache);
+    bool recorded = closed && !state->Failed;
+    delete state;
+    recorder->State = 0;
+    return recorded;
+}
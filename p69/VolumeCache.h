@@ -0,0 +1,110 @@
+#pragma once
+#include <vector>
+#include <cstdio>
+
+// Frame sequences of half-float volumes, as read back from the density texture, in one file:
+//
+//     header | frame | frame | ... | index
+//
+// The header records the grid size, the value type, how values are quantized, and where the
+// index starts.  Each frame starts with its own small header (frame index, sizes, and LZMA
+// properties) followed by an LZMA stream.  Inside the stream, the volume is cut into bricks
+// of VolumeBrickSize^3 cells; each brick stores its range, then its values quantized to 8 or 16
+// bits within that range.  Bricks with a single value (most of the empty space) store only
+// the range.  The index maps frame numbers to file offsets for random access.  It's written on
+// close; if a recording was cut short, the reader rebuilds it by walking the frame headers.
+
+enum { VolumeBrickSize = 16 };
+
+enum VolumeValueType {
+    VolumeHalf = 1,
+};
+
+struct VolumeCacheHeader {
+    char Magic[4];
+    unsigned int Version;
+    unsigned int Width;
+    unsigned int Height;
+    unsigned int Depth;
+    unsigned int BrickSize;
+    unsigned int ValueType;
+    unsigned int QuantizeBits;
+    unsigned int FrameCount;
+    unsigned int Reserved;
+    unsigned long long IndexOffset; // Zero until the cache is closed
+};
+
+struct VolumeFrameHeader {
+    unsigned int FrameIndex;
+    unsigned int RawBytes;
+    unsigned int PackedBytes;
+    unsigned char Properties[5];
+    unsigned char Reserved[3];
+};
+
+struct VolumeIndexEntry {
+    unsigned long long Offset;
+    unsigned int FrameIndex;
+    unsigned int Reserved;
+};
+
+struct VolumeCachePod {
+    FILE* File;
+    VolumeCacheHeader Header;
+    std::vector<VolumeIndexEntry> Index;    // Sorted by frame index when reading
+    bool Writing;
+};
+
+// Creates a cache for writing; quantizeBits is 8 or 16.
+bool CreateVolumeCache(VolumeCachePod* cache, const char* path, int width, int height, int depth, int quantizeBits);
+
+// Compresses one frame of width * height * depth halves, x fastest, and appends it.
+bool AppendVolumeFrame(VolumeCachePod* cache, int frameIndex, const unsigned short* halves);
+
+// Opens a cache for reading and loads (or rebuilds) its index.
+bool OpenVolumeCache(VolumeCachePod* cache, const char* path);
+
+// Decodes the frame with the given frame index into width * height * depth halves.
+bool ReadVolumeFrame(VolumeCachePod* cache, int frameIndex, unsigned short* halves);
+
+// After writing, appends the index and finishes the header.  Closes the file either way.
+bool CloseVolumeCache(VolumeCachePod* cache);
+
+// Decodes frames on a background thread ahead of playback.  Frames are requested by their
+// position in the index, so playback can loop with a simple counter.  Asking for the next frame
+// is normally a copy out of a ring of decoded frames; asking for any other frame restarts the
+// read-ahead from there and waits for it.
+struct VolumeStreamPod {
+    struct VolumeStreamState* State;
+    int Width;
+    int Height;
+    int Depth;
+    int FrameCount;
+};
+
+bool StartVolumeStream(VolumeStreamPod* stream, const char* path, int aheadCount);
+
+// Copies frame number position into halves; returns false if it couldn't be decoded.
+bool GetStreamedFrame(VolumeStreamPod* stream, int position, unsigned short* halves);
+
+void StopVolumeStream(VolumeStreamPod* stream);
+
+// Compresses and appends frames on a background thread, so that recording doesn't stall the
+// caller for the LZMA encode.  Each frame is copied into a ring of queueCount slots; asking to
+// record a frame only waits when the ring is full.
+struct VolumeRecorderPod {
+    struct VolumeRecorderState* State;
+};
+
+bool StartVolumeRecorder(VolumeRecorderPod* recorder, const char* path, int width, int height, int depth,
+    int quantizeBits, int queueCount);
+
+// Queues a copy of the frame; returns false once any earlier frame has failed to write.
+bool RecordVolumeFrame(VolumeRecorderPod* recorder, int frameIndex, const unsigned short* halves);
+
+// Writes whatever is still queued and closes the cache; returns false if any frame was lost.
+bool StopVolumeRecorder(VolumeRecorderPod* recorder);
+
+// Conversions to and from GL_HALF_FLOAT; FloatToHalf rounds to nearest even.
+float HalfToFloat(unsigned short h);
+unsigned short FloatToHalf(float f);